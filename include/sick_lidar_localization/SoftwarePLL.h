@@ -65,6 +65,31 @@ public:
   @return initialization status
   */
 	bool IsInitialized() const { return IsInitialized_; }
+	/**
+	@brief Returns the linear model of the SoftwarePLL. The system timestamp in seconds can be estimated from
+	       sensor ticks by firstTimeStamp + (int32_t)(tick - firstTick) * slope, which is identical to GetCorrectedTimeStamp().
+	*
+	@param[out] firstTick: first sensor tick in the fifo buffer (reference tick)
+	@param[out] firstTimeStamp: first timestamp in the fifo buffer in seconds (reference timestamp)
+	@param[out] slope: interpolated slope (gradient of the regression line)
+	@return true if the model is valid, false otherwise (SoftwarePLL not initialized)
+	*/
+	bool GetLinearModel(uint32_t& firstTick, double& firstTimeStamp, double& slope) const;
+	
+	/**
+	@brief Returns the residual standard deviation of the regression in seconds, i.e. the rms of the differences between
+	       measured timestamps and the regression line (calculated at the last update of the interpolation slope)
+	*
+	@return residual standard deviation in seconds
+	*/
+	double ResidualStdDev() const { return ResidualStdDev_; }
+  
+  /**
+  @brief Returns the counter of extrapolated divergences (number of times the estimated and measured receive timestamp differed more than AllowedTimeDeviation
+  *
+  @return counter of extrapolated divergences
+  */
+	uint32_t ExtrapolationDivergenceCounter() const { return ExtrapolationDivergenceCounter_; }
 
 protected:
 	
@@ -131,13 +156,6 @@ protected:
   */
 	void AllowedTimeDeviation(double val) { AllowedTimeDeviation_ = val; }
   
-  /**
-  @brief Returns the counter of extrapolated divergences (number of times the estimated and measured receive timestamp differed more than AllowedTimeDeviation
-  *
-  @return counter of extrapolated divergences
-  */
-	uint32_t ExtrapolationDivergenceCounter() const { return ExtrapolationDivergenceCounter_; }
-  
   /**
   @brief Sets the counter of extrapolated divergences (number of times the estimated and measured receive timestamp differed more than AllowedTimeDeviation
   *
@@ -147,7 +165,9 @@ protected:
 
 	/**
 	@brief Pushes measurement timestamp and sensor ticks to the fifo,
-				 updates tick fifo and clock (timestamp) fifo
+				 updates tick fifo and clock (timestamp) fifo.
+				 The fifo is a ring buffer, the oldest measurement is replaced and the running
+				 regression sums are updated incrementally, i.e. PushIntoFifo is O(1) and allocation-free.
   *
 	@param curTimeStamp: measurement timestamp in seconds (receive time)
 	@param curtick: sensor ticks
@@ -172,21 +192,36 @@ private:
 	const int FifoSize_;
 	static const double MaxAllowedTimeDeviation_;
 	static const uint32_t MaxExtrapolationCounter_;
-	std::vector<uint32_t> TickFifo_;
-	std::vector<double> ClockFifo_;
+	std::vector<uint64_t> TickFifo_;  // ring buffer of unwrapped sensor ticks (allocated once in the constructor)
+	std::vector<double> ClockFifo_;   // ring buffer of timestamps in seconds (allocated once in the constructor)
+	int FifoHead_;                    // index of the oldest measurement in the ring buffer (i.e. next index to write)
+	uint64_t ReferenceTick_;          // regression sums are computed relative to ReferenceTick_ and ReferenceTimeStamp_
+	double ReferenceTimeStamp_;       // (first measurement), to keep the values small and numerically stable
+	uint64_t LastUnwrappedTick_;      // last unwrapped sensor tick, used to unwrap 32 bit tick overflows
+	bool HasReference_;               // true after the first measurement, i.e. ReferenceTick_ and ReferenceTimeStamp_ are set
+	double MeanTick_;                 // running mean of ticks relative to ReferenceTick_ (Welford)
+	double MeanClock_;                // running mean of timestamps relative to ReferenceTimeStamp_ (Welford)
+	double SumSqTick_;                // running sum of squared tick deviations from MeanTick_ (Welford)
+	double SumSqClock_;               // running sum of squared timestamp deviations from MeanClock_ (Welford)
+	double SumCoTickClock_;           // running sum of products of tick and timestamp deviations (Welford co-moment)
 	bool IsInitialized_;
 	double FirstTimeStamp_;
 	double AllowedTimeDeviation_;
 	uint64_t FirstTick_;
 	uint32_t Lastcurtick_ = 0;
 	double InterpolationSlope_;
+	double ResidualStdDev_;           // residual standard deviation of the regression in seconds
 	bool NearSameTimeStamp(double relTimeStamp1, double relTimeStamp2);
 	bool UpdateInterpolationSlope();
+	void AddToRegression(double tick, double clock);      // adds a measurement to the running sums, O(1)
+	void RemoveFromRegression(double tick, double clock); // removes a measurement from the running sums, O(1)
+	void RecomputeRegression();                           // recomputes the running sums from the fifo to avoid accumulation of rounding errors
 	uint32_t ExtrapolationDivergenceCounter_;
-	SoftwarePLL(int fifo_length = 7) : FifoSize_(fifo_length), TickFifo_(fifo_length,0), ClockFifo_(fifo_length,0)
+	SoftwarePLL(int fifo_length = 7) : NumberValInFifo_(0), FifoSize_(fifo_length), TickFifo_(fifo_length,0), ClockFifo_(fifo_length,0), FifoHead_(0),
+		ReferenceTick_(0), ReferenceTimeStamp_(0), LastUnwrappedTick_(0), HasReference_(false), MeanTick_(0), MeanClock_(0), SumSqTick_(0), SumSqClock_(0), SumCoTickClock_(0),
+		IsInitialized_(false), FirstTimeStamp_(0), FirstTick_(0), InterpolationSlope_(0), ResidualStdDev_(0), ExtrapolationDivergenceCounter_(0)
 	{
 		AllowedTimeDeviation(SoftwarePLL::MaxAllowedTimeDeviation_); // 1 ms
-		NumberValInFifo_ = 0;
 	}
 	// verhindert, dass ein Objekt von ausserhalb von N erzeugt wird.
 	// protected, wenn man von der Klasse noch erben moechte
@@ -0,0 +1,287 @@
+/*
+ * @brief cola_broker serves cola requests of other components (cola_service_node, sim_loc_time_sync) on a local
+ * unix domain socket with a compact binary framing. It forwards the requests to the driver monitor, which owns the
+ * tcp connections to the localization controller. ROS services remain as a compatibility interface.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#ifndef __SIM_LOC_COLA_BROKER_H_INCLUDED
+#define __SIM_LOC_COLA_BROKER_H_INCLUDED
+
+#include <boost/asio.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <list>
+#include <string>
+#include <vector>
+
+#include "sick_lidar_localization/SickLocColaTelegramSrv.h"
+
+namespace sick_lidar_localization
+{
+  /*!
+   * class ColaBroker serves cola requests of other components on a local unix domain socket and forwards them
+   * to the driver monitor, which owns the tcp connections to the localization controller. Compared to the ros
+   * services "SickLocColaTelegram" and "SickLocColaTimestampTelegram", there's no master lookup, no ros
+   * serialization and no extra service hop, i.e. a timestamp request of sim_loc_time_sync reaches the
+   * localization controller with one local ipc hop.
+   *
+   * Framing (native byte order, the socket is local):
+   * - Request:  uint32 payload length, uint32 request id, uint8 channel (0: cola, 1: timestamp), uint32 response timeout in microseconds, Cola-ASCII request
+   * - Response: uint32 payload length, uint32 request id, uint8 success, uint32 send timestamp sec, uint32 send timestamp nsec,
+   *             uint32 receive timestamp sec, uint32 receive timestamp nsec, Cola-ASCII response
+   *
+   * The payload length does not include the 4 byte length field. Cola requests are processed concurrently by a pool of
+   * worker threads, i.e. a client can send several requests on one connection and match the responses by request id.
+   * Timestamp requests are processed by a separate thread and never wait behind other cola requests.
+   */
+  class ColaBroker
+  {
+  public:
+  
+    /*!
+     * Channel of a cola request
+     */
+    typedef enum COLA_CHANNEL_ENUM
+    {
+      COLA_REQUEST_CHANNEL = 0,      ///< cola requests, handled like ros service "SickLocColaTelegram"
+      TIMESTAMP_REQUEST_CHANNEL = 1  ///< timestamp requests ("sMN LocRequestTimestamp"), handled like ros service "SickLocColaTimestampTelegram"
+    } COLA_CHANNEL;
+    
+    /*!
+     * Handler for cola requests, f.e. DriverMonitor::serviceCbColaTelegram
+     */
+    typedef boost::function<bool(sick_lidar_localization::SickLocColaTelegramSrv::Request & cola_request, sick_lidar_localization::SickLocColaTelegramSrv::Response & cola_response)> RequestHandler;
+    
+    /*!
+     * Constructor. The broker does not start automatically, call start() and stop() to start and stop.
+     * @param[in] cola_handler handler for cola requests, f.e. DriverMonitor::serviceCbColaTelegram
+     * @param[in] timestamp_handler handler for timestamp requests, f.e. DriverMonitor::serviceCbColaTimestampTelegram (default: cola_handler)
+     * @param[in] num_worker_threads number of cola requests processed concurrently, default: 4
+     */
+    ColaBroker(const RequestHandler & cola_handler, const RequestHandler & timestamp_handler = RequestHandler(), int num_worker_threads = 4);
+    
+    /*!
+     * Destructor, stops the broker and removes the socket file.
+     */
+    virtual ~ColaBroker();
+    
+    /*!
+     * Creates the unix domain socket and starts to accept clients. An existing socket file (f.e. of a previous run) is replaced.
+     * @param[in] socket_path path of the unix domain socket, f.e. "/tmp/sick_lidar_localization_cola.sock"
+     * @return true on success, false on failure
+     */
+    virtual bool start(const std::string & socket_path);
+    
+    /*!
+     * Closes all client connections, stops the worker threads and removes the socket file.
+     * Requests in progress are completed, but their responses are discarded.
+     */
+    virtual void stop(void);
+    
+    /*!
+     * Encodes a request frame (length, request id, channel, timeout and Cola-ASCII request).
+     * @param[in] request_id request id, returned with the response
+     * @param[in] channel cola or timestamp channel
+     * @param[in] cola_request cola request
+     * @return request frame
+     */
+    static std::vector<uint8_t> encodeRequest(uint32_t request_id, COLA_CHANNEL channel, const sick_lidar_localization::SickLocColaTelegramSrv::Request & cola_request);
+    
+    /*!
+     * Decodes the payload of a request frame (i.e. without length field).
+     * @param[in] payload payload of a request frame
+     * @param[out] request_id request id
+     * @param[out] channel cola or timestamp channel
+     * @param[out] cola_request cola request
+     * @return true on success, false on invalid payload
+     */
+    static bool decodeRequest(const std::vector<uint8_t> & payload, uint32_t & request_id, COLA_CHANNEL & channel, sick_lidar_localization::SickLocColaTelegramSrv::Request & cola_request);
+    
+    /*!
+     * Encodes a response frame (length, request id, success, timestamps and Cola-ASCII response).
+     * @param[in] request_id request id of the request
+     * @param[in] success true: request successfull, false: request failed
+     * @param[in] cola_response cola response
+     * @return response frame
+     */
+    static std::vector<uint8_t> encodeResponse(uint32_t request_id, bool success, const sick_lidar_localization::SickLocColaTelegramSrv::Response & cola_response);
+    
+    /*!
+     * Decodes the payload of a response frame (i.e. without length field).
+     * @param[in] payload payload of a response frame
+     * @param[out] request_id request id
+     * @param[out] success true: request successfull, false: request failed
+     * @param[out] cola_response cola response
+     * @return true on success, false on invalid payload
+     */
+    static bool decodeResponse(const std::vector<uint8_t> & payload, uint32_t & request_id, bool & success, sick_lidar_localization::SickLocColaTelegramSrv::Response & cola_response);
+    
+    /*!
+     * Returns the max. payload length of a frame. Longer frames are invalid, the connection is closed.
+     */
+    static uint32_t maxPayloadLength(void) { return 0x10000; }
+    
+  protected:
+  
+    /*!
+     * class Session: a client connection
+     */
+    class Session
+    {
+    public:
+      Session(boost::asio::io_service & io_service) : socket(io_service), payload_length(0) {} ///< Constructor
+      boost::asio::local::stream_protocol::socket socket; ///< unix domain socket connected to the client
+      uint32_t payload_length;                            ///< payload length of the request frame currently received
+      std::vector<uint8_t> payload;                       ///< payload of the request frame currently received
+      std::list<std::vector<uint8_t> > write_queue;       ///< response frames to send, the front frame is currently sent
+    };
+    typedef boost::shared_ptr<Session> SessionPtr; ///< shared pointer to a client connection
+    
+    /*!
+     * Appends a value in native byte order to a frame
+     */
+    template<typename T> static void appendValue(std::vector<uint8_t> & frame, const T & value)
+    {
+      const uint8_t* p_value = reinterpret_cast<const uint8_t*>(&value);
+      frame.insert(frame.end(), p_value, p_value + sizeof(value));
+    }
+    
+    /*!
+     * Reads a value in native byte order from a payload and increments the read position
+     * @return true on success, false if the payload is too short
+     */
+    template<typename T> static bool readValue(const std::vector<uint8_t> & payload, size_t & pos, T & value)
+    {
+      if(pos + sizeof(value) > payload.size())
+        return false;
+      std::copy(payload.begin() + pos, payload.begin() + pos + sizeof(value), reinterpret_cast<uint8_t*>(&value));
+      pos += sizeof(value);
+      return true;
+    }
+    
+    /*!
+     * Accepts the next client connection (asynchronous, io thread)
+     */
+    void startAccept(void);
+    
+    /*!
+     * Callback after a client connected (io thread), starts to receive requests and to accept the next client
+     */
+    void onAccept(SessionPtr session, const boost::system::error_code & error);
+    
+    /*!
+     * Receives the length field of the next request frame (asynchronous, io thread)
+     */
+    void startRead(SessionPtr session);
+    
+    /*!
+     * Callback after the length field of a request frame has been received (io thread), receives the payload
+     */
+    void onReadLength(SessionPtr session, const boost::system::error_code & error);
+    
+    /*!
+     * Callback after the payload of a request frame has been received (io thread), passes the request to the worker threads
+     * and receives the next request
+     */
+    void onReadPayload(SessionPtr session, const boost::system::error_code & error);
+    
+    /*!
+     * Processes a request by the cola or timestamp handler (worker or timestamp thread) and queues the response
+     */
+    void runRequest(SessionPtr session, const std::vector<uint8_t> & payload);
+    
+    /*!
+     * Queues a response frame and starts sending, if not yet done (io thread)
+     */
+    void queueResponse(SessionPtr session, const std::vector<uint8_t> & frame);
+    
+    /*!
+     * Callback after a response frame has been sent (io thread), sends the next queued response
+     */
+    void onWrite(SessionPtr session, const boost::system::error_code & error);
+    
+    /*!
+     * Closes a client connection (io thread)
+     */
+    void closeSession(SessionPtr session);
+    
+    /*!
+     * Closes the acceptor and all client connections (io thread)
+     */
+    void closeAll(void);
+    
+    /*
+     * member data
+     */
+    
+    RequestHandler m_cola_handler;                       ///< handler for cola requests
+    RequestHandler m_timestamp_handler;                  ///< handler for timestamp requests
+    int m_num_worker_threads;                            ///< number of cola requests processed concurrently
+    std::string m_socket_path;                           ///< path of the unix domain socket
+    boost::asio::io_service m_io_service;                ///< io service for the unix domain sockets (accept, read and write)
+    boost::asio::io_service::work* m_io_work;            ///< keeps m_io_service running while the broker is started
+    boost::thread* m_io_thread;                          ///< thread running m_io_service
+    boost::asio::local::stream_protocol::acceptor m_acceptor; ///< acceptor for client connections
+    std::list<SessionPtr> m_sessions;                    ///< client connections (accessed by the io thread only)
+    boost::asio::io_service m_request_service;           ///< io service for the worker threads processing cola requests
+    boost::asio::io_service::work* m_request_work;       ///< keeps m_request_service running while the broker is started
+    boost::thread_group m_request_threads;               ///< worker threads processing cola requests
+    boost::asio::io_service m_timestamp_service;         ///< io service for the thread processing timestamp requests
+    boost::asio::io_service::work* m_timestamp_work;     ///< keeps m_timestamp_service running while the broker is started
+    boost::thread* m_timestamp_thread;                   ///< thread processing timestamp requests
+    
+  }; // class ColaBroker
+  
+} // namespace sick_lidar_localization
+#endif // __SIM_LOC_COLA_BROKER_H_INCLUDED
@@ -0,0 +1,138 @@
+/*
+ * @brief cola_broker_client sends cola requests to the cola broker of the driver on a local unix domain socket. It keeps a pool of connections to the broker, so concurrent requests don't block each other.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#ifndef __SIM_LOC_COLA_BROKER_CLIENT_H_INCLUDED
+#define __SIM_LOC_COLA_BROKER_CLIENT_H_INCLUDED
+
+#include <boost/asio.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <list>
+#include <string>
+
+#include "sick_lidar_localization/cola_broker.h"
+#include "sick_lidar_localization/persistent_service_client.h"
+#include "sick_lidar_localization/SickLocColaTelegramSrv.h"
+
+namespace sick_lidar_localization
+{
+  /*!
+   * class ColaBrokerClient sends cola requests to the cola broker of the driver on a local unix domain socket,
+   * see ColaBroker for the framing. Connections to the broker are kept open and reused, i.e. there's no
+   * connection setup per request. If the broker is not available (disabled or driver not running), call()
+   * returns without sending the request, and the caller can fall back to the ros service.
+   */
+  class ColaBrokerClient
+  {
+  public:
+  
+    /*!
+     * Constructor
+     * @param[in] socket_path path of the unix domain socket of the cola broker (empty: broker disabled, all requests are sent by ros services)
+     */
+    ColaBrokerClient(const std::string & socket_path = "");
+    
+    /*!
+     * Destructor, closes all connections and prints the statistics
+     */
+    virtual ~ColaBrokerClient();
+    
+    /*!
+     * Sends a cola request to the cola broker and waits for its response.
+     * @param[in] cola_request cola request
+     * @param[out] cola_response cola response
+     * @param[out] request_sent true, if the request has been sent to the broker, false if the broker is not available (request not sent)
+     * @param[in] channel cola or timestamp channel
+     * @return true on success, false in case of errors (broker not available, connection lost or request failed)
+     */
+    virtual bool call(sick_lidar_localization::SickLocColaTelegramSrv::Request & cola_request, sick_lidar_localization::SickLocColaTelegramSrv::Response & cola_response,
+      bool & request_sent, ColaBroker::COLA_CHANNEL channel = ColaBroker::COLA_REQUEST_CHANNEL);
+    
+    /*!
+     * Returns the statistics (number of calls and failures, latency) of all broker requests
+     */
+    virtual ServiceCallStatistics statistics(void);
+    
+  protected:
+  
+    typedef boost::shared_ptr<boost::asio::local::stream_protocol::socket> SocketPtr; ///< shared pointer to a connection to the broker
+    
+    /*!
+     * Returns an idle connection to the broker or connects a new one.
+     * @return connection to the broker or empty pointer, if the broker is not available
+     */
+    virtual SocketPtr acquireConnection(void);
+    
+    /*!
+     * Returns a connection after a successfull request to the pool of idle connections.
+     * @param[in] connection connection acquired by acquireConnection()
+     */
+    virtual void releaseConnection(const SocketPtr & connection);
+    
+    /*
+     * member data
+     */
+    
+    std::string m_socket_path;               ///< path of the unix domain socket of the cola broker (empty: broker disabled)
+    boost::asio::io_service m_io_service;    ///< io service for the connections (synchronous send and receive only)
+    boost::mutex m_connection_mutex;         ///< protects m_idle_connections, m_request_id, m_broker_available and m_statistics
+    std::list<SocketPtr> m_idle_connections; ///< connections to the broker currently not in use
+    uint32_t m_request_id;                   ///< request id of the last request
+    bool m_broker_available;                 ///< true if the last connect succeeded (a change is logged once)
+    ServiceCallStatistics m_statistics;      ///< number of calls and failures, latency of all broker requests
+    
+  }; // class ColaBrokerClient
+  
+} // namespace sick_lidar_localization
+#endif // __SIM_LOC_COLA_BROKER_CLIENT_H_INCLUDED
@@ -1,6 +1,6 @@
 /*
  * @brief cola_configuration sets the initial SIM result output configuration
- * using ros cola services.
+ * using cola telegrams. Only settings different from the current controller settings are sent.
  * Configures the following result output settings from launch file:
  * LocSetResultPort, LocSetResultMode, LocSetResultPoseEnabled, LocSetResultEndianness, LocSetResultPoseInterval,
  * LocRequestResultData
@@ -59,16 +59,26 @@
 #ifndef __SIM_LOC_COLA_CONFIGURATION_H_INCLUDED
 #define __SIM_LOC_COLA_CONFIGURATION_H_INCLUDED
 
+#include <boost/thread.hpp>
+#include <string>
+#include <vector>
+
+#include "sick_lidar_localization/cola_schema.h"
 #include "sick_lidar_localization/cola_services.h"
 
 namespace sick_lidar_localization
 {
   /*!
    * Class sick_lidar_localization::ColaConfiguration sets the initial SIM result output configuration
-   * using ros cola services.
+   * using cola telegrams.
    * Configures the following result output settings from launch file:
    * LocSetResultPort, LocSetResultMode, LocSetResultPoseEnabled, LocSetResultEndianness, LocSetResultPoseInterval,
    * LocRequestResultData
+   *
+   * The configuration is idempotent: the current settings are read from the localization controller ("sRN LocResultPort" etc.),
+   * and only settings different from the launch file are sent. All reads resp. writes are sent at once and pipelined by
+   * ColaServices::sendColaTelegramAsync(). Failed settings are read and compared again after tcp_connection_retry_delay.
+   * The time from start() until the controller is configured is logged and available by timeToConfigured().
    */
   class ColaConfiguration
   {
@@ -76,8 +86,10 @@ namespace sick_lidar_localization
     
     /*!
      * Constructor
+     * @param[in] nh ros node handle
+     * @param[in] cola_services cola services to send cola telegrams asynchronously
      */
-    ColaConfiguration(ros::NodeHandle* nh = 0);
+    ColaConfiguration(ros::NodeHandle* nh = 0, sick_lidar_localization::ColaServices* cola_services = 0);
     
     /*!
      * Destructor
@@ -97,43 +109,80 @@ namespace sick_lidar_localization
      * Stops transmitting the initial result output configuration to the localization controller.
      */
     virtual void stop(void);
+    
+    /*!
+     * Returns the time in seconds from start() until the localization controller has been configured,
+     * or -1 if the configuration is still in progress (or has been cancelled).
+     */
+    virtual double timeToConfigured(void);
 
   protected:
   
     /*!
-     * Thread callback, transmits the initial SIM result output configuration using ros cola services.
+     * class ConfigurationItem: a result output setting with its launch file parameter, the cola variable
+     * to read the current value and the cola method to change it.
+     */
+    class ConfigurationItem
+    {
+    public:
+      ConfigurationItem(const std::string & param = "", const std::string & variable = "", const std::string & method = "", sick_lidar_localization::ColaSchema::COLA_TYPE type = sick_lidar_localization::ColaSchema::UINT8)
+      : param_name(param), variable_name(variable), method_name(method), value_type(type), configured_value(-1), current_value(-1) {} ///< Constructor
+      std::string param_name;     ///< launch file parameter, f.e. "SickLocSetResultPort"
+      std::string variable_name;  ///< cola variable to read the current value, f.e. "LocResultPort"
+      std::string method_name;    ///< cola method to change the value, f.e. "LocSetResultPort"
+      sick_lidar_localization::ColaSchema::COLA_TYPE value_type; ///< type of the value, f.e. UINT16 for the result port
+      int32_t configured_value;   ///< value from launch file (-1: not configured)
+      int32_t current_value;      ///< current value read from the localization controller (-1: unknown)
+    };
+  
+    /*!
+     * Thread callback, transmits the initial SIM result output configuration using cola telegrams.
      * Configures the following result output settings from launch file:
      * LocSetResultPort, LocSetResultMode, LocSetResultPoseEnabled, LocSetResultEndianness, LocSetResultPoseInterval,
      * LocRequestResultData
      */
     virtual void runConfigurationThreadCb(void);
-  
+    
     /*!
-     * Calls a ros service until successfully executed or configuration thread cancelled.
-     * @param[in/out] service_telegram service request and response
-     * @param[in] service_client ros service client
-     * @param[in] retry_delay delay before next retry in case of errors
-     * @return true on success or false on failure
+     * Reads the current value of all configured settings from the localization controller (pipelined "sRN" requests).
+     * The current value of a setting is -1, if it could not be read.
+     * @param[in,out] settings result output settings
      */
-    template<typename T> bool callService(T & service_telegram, ros::ServiceClient & service_client, double retry_delay)
-    {
-      service_telegram.response.success = false;
-      while(ros::ok() && m_nh && m_configuration_thread_running && (!service_client.call(service_telegram) || !service_telegram.response.success))
-      {
-        ROS_WARN_STREAM("## ERROR ColaConfiguration: service call(" << sick_lidar_localization::Utils::flattenToString(service_telegram.request) << ") failed, response: " << sick_lidar_localization::Utils::flattenToString(service_telegram.response) << ", retrying");
-        ros::Duration(retry_delay).sleep();
-      }
-      ROS_INFO_STREAM("ColaConfiguration " << typeid(T).name() << " " << (service_telegram.response.success ? "successfull" : "failed"));
-      return service_telegram.response.success;
-    }
+    virtual void readCurrentSettings(std::vector<ConfigurationItem> & settings);
+    
+    /*!
+     * Sends all configured settings different from the current value to the localization controller (pipelined "sMN" requests).
+     * The current value of a setting is updated after a successfull response.
+     * @param[in,out] settings result output settings
+     * @param[out] changed_settings names of the settings changed successfully
+     * @return number of failed settings (0: all settings configured)
+     */
+    virtual size_t writeChangedSettings(std::vector<ConfigurationItem> & settings, std::vector<std::string> & changed_settings);
+    
+    /*!
+     * Sends cola requests pipelined and waits for all responses.
+     * @param[in] cola_requests cola requests (Cola-ASCII, f.e. "sRN LocResultPort")
+     * @return responses from localization controller (command_name empty in case of errors)
+     */
+    virtual std::vector<sick_lidar_localization::SickLocColaTelegramMsg> sendColaTelegrams(const std::vector<std::string> & cola_requests);
+    
+    /*!
+     * Parses the first parameter of a cola response, returns true if the response matches the command name
+     * and the parameter is a valid value of the given type.
+     */
+    static bool parseResponseValue(const sick_lidar_localization::SickLocColaTelegramMsg & cola_response, const std::string & command_name,
+      sick_lidar_localization::ColaSchema::COLA_TYPE value_type, int64_t & value);
     
     /*
      * member variables
      */
 
     ros::NodeHandle* m_nh;                  ///< ros node handle
+    sick_lidar_localization::ColaServices* m_cola_services; ///< cola services to send cola telegrams asynchronously
     boost::thread* m_configuration_thread;  ///< thread to transmit configuration
     bool m_configuration_thread_running;    ///< true: m_configuration_thread is running, otherwise false
+    boost::mutex m_time_to_configured_mutex; ///< protects m_time_to_configured
+    double m_time_to_configured;            ///< time in seconds from start() until the localization controller has been configured (-1: not yet configured)
     
   }; // class ColaServices
   
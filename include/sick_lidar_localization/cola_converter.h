@@ -92,6 +92,24 @@ namespace sick_lidar_localization
      */
     static std::vector<uint8_t> ConvertColaAscii(const std::string & cola_telegram);
   
+    /*!
+     * @brief Converts a Cola-ASCII telegram to string. The output string is resized and overwritten,
+     * i.e. its capacity is reused for repeated conversions.
+     * @param[in] cola_telegram Cola-ASCII telegram, starting with 0x02 and ending with 0x03
+     * @param[in] size number of bytes in cola_telegram
+     * @param[out] cola_ascii Cola-ASCII string, f.e. "<STX>sMN SetAccessMode 3 F4724744<ETX>"
+     */
+    static void ConvertColaAscii(const uint8_t* cola_telegram, size_t size, std::string & cola_ascii);
+  
+    /*!
+     * @brief Converts a Cola telegram from Cola-ASCII string to binary. The output vector is resized and overwritten,
+     * i.e. its capacity is reused for repeated conversions.
+     * @param[in] cola_telegram Cola-ASCII string, f.e. "<STX>sMN SetAccessMode 3 F4724744<ETX>"
+     * @param[in] size number of characters in cola_telegram
+     * @param[out] cola_binary Cola-ASCII telegram, f.e. { 0x02, 0x73, 0x4D, 0x4E, ... , 0x03 }
+     */
+    static void ConvertColaAscii(const char* cola_telegram, size_t size, std::vector<uint8_t> & cola_binary);
+  
     /*!
      * @brief Converts and returns a Cola telegram from Cola-ASCII to Cola-Binary.
      * @param[in] cola_telegram Cola-ASCII telegram, f.e. { 0x02, 0x73, 0x4D, 0x4E, 0x20, 0x53, 0x65, 0x74, 0x41, 0x63, 0x63,  0x65,
@@ -128,6 +146,48 @@ namespace sick_lidar_localization
     static uint32_t ColaBinaryTelegramLength(const std::vector<uint8_t> & cola_telegram);
     
   protected:
+  
+    /*!
+     * @brief class LookupTable contains the lookup tables to convert between Cola-ASCII strings and binary data,
+     * generated once from s_ascii_table and s_ascii_map: a direct lookup table for single characters
+     * and a hash table for tags like "<STX>" or "<ETX>".
+     */
+    class LookupTable
+    {
+    public:
+      
+      /*!
+       * Constructor, generates the lookup tables from s_ascii_table and s_ascii_map.
+       */
+      LookupTable();
+      
+      /*!
+       * Returns the binary value of the tag starting at cola_telegram[0] (f.e. 0x02 for "<STX>"), or -1 if no tag found.
+       * @param[in] cola_telegram Cola-ASCII string starting with '<'
+       * @param[in] size number of characters in cola_telegram
+       * @param[out] tag_length number of characters of the tag found, f.e. 5 for "<STX>"
+       * @return binary value of the tag, or -1 if no tag found
+       */
+      int findTag(const char* cola_telegram, size_t size, size_t & tag_length) const;
+  
+      uint8_t ascii_to_binary[256];   ///< single character lookup table, f.e. ascii_to_binary['A']:=0x41 (0 for unmapped characters)
+      uint8_t binary_to_length[256];  ///< length of s_ascii_table[n], f.e. binary_to_length[0x02]:=5 ("<STX>")
+      
+    protected:
+      
+      /*!
+       * Returns the hash table index of a tag, computed from the 2 or 3 characters between '<' and '>'.
+       */
+      static size_t tagHash(uint32_t tag_key) { return (size_t)((tag_key * 0x9E3779B1u) >> 26); }
+      
+      uint32_t m_tag_keys[64];   ///< hash table keys: characters between '<' and '>', f.e. 'S'|('T'<<8)|('X'<<16) for "<STX>" (0: empty slot)
+      uint8_t m_tag_values[64];  ///< hash table values: binary value of a tag, f.e. 0x02 for "<STX>"
+    };
+  
+    /*!
+     * @brief Returns the lookup tables, generated once at first call.
+     */
+    static const LookupTable & lookupTable(void);
     
     /*
      * member data
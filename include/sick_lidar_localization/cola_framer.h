@@ -0,0 +1,140 @@
+/*
+ * @brief cola_framer splits a tcp byte stream into Cola-ASCII and Cola-Binary telegrams.
+ * Data are appended in chunks as received, telegram boundaries (<STX>...<ETX> resp. 0x02020202 + length header)
+ * are searched incrementally, i.e. each byte is inspected once.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#ifndef __SIM_LOC_COLA_FRAMER_H_INCLUDED
+#define __SIM_LOC_COLA_FRAMER_H_INCLUDED
+
+#include <ros/ros.h>
+#include <deque>
+#include <vector>
+
+namespace sick_lidar_localization
+{
+  /*!
+   * class ColaFramer splits a tcp byte stream into Cola-ASCII and Cola-Binary telegrams.
+   * Bytes are pushed in chunks as they are read from the socket, complete telegrams are popped.
+   * A single chunk can contain several telegrams or parts of telegrams. Each telegram is returned
+   * with the receive timestamp of the chunk containing its first byte.
+   * Telegram boundaries are detected incrementally:
+   * Cola-Binary telegrams start with 0x02020202 followed by a 4 byte payload length,
+   * any other data are Cola-ASCII telegrams terminated by <ETX>.
+   * ColaFramer is not threadsafe, it's used by one receiver thread.
+   */
+  class ColaFramer
+  {
+  public:
+    
+    /*!
+     * Constructor
+     * @param[in] max_telegram_size max. size of a telegram in byte, buffered data are discarded if a telegram exceeds this size, default: 1 MByte
+     */
+    ColaFramer(size_t max_telegram_size = 1024 * 1024);
+    
+    /*!
+     * Appends received data.
+     * @param[in] data data received
+     * @param[in] size number of bytes received
+     * @param[in] receive_timestamp receive timestamp (ros timestamp immediately after data received)
+     */
+    void push(const uint8_t* data, size_t size, const ros::Time & receive_timestamp);
+    
+    /*!
+     * Removes and returns the next complete telegram, if available.
+     * @param[out] telegram telegram received (Cola-Binary or Cola-Ascii)
+     * @param[out] receive_timestamp receive timestamp of the first telegram byte
+     * @return true if a complete telegram has been returned, false otherwise (telegram not yet completed)
+     */
+    bool pop(std::vector<uint8_t> & telegram, ros::Time & receive_timestamp);
+    
+    /*!
+     * Returns the number of buffered bytes not yet returned by pop().
+     */
+    size_t size(void) const { return m_buffer.size() - m_head; }
+    
+    /*!
+     * Discards all buffered data, f.e. after reconnect.
+     */
+    void clear(void);
+    
+  protected:
+    
+    /*!
+     * Searches the end of the telegram starting at m_head.
+     * @param[out] telegram_end buffer index behind the last byte of the telegram
+     * @return true if the telegram is complete, false otherwise
+     */
+    bool findTelegramEnd(size_t & telegram_end);
+    
+    /*!
+     * Discards all buffered data after an invalid telegram, telegrams are resynchronized with the next chunk.
+     * @param[in] reason error message
+     */
+    void resync(const std::string & reason);
+    
+    /*
+     * member data
+     */
+    
+    std::vector<uint8_t> m_buffer;  ///< buffered data, the next telegram starts at m_buffer[m_head]
+    size_t m_head;                  ///< start index of the next telegram in m_buffer
+    size_t m_scan_pos;              ///< m_buffer has been searched for <ETX> up to m_scan_pos
+    size_t m_max_telegram_size;     ///< max. size of a telegram in byte
+    std::deque<std::pair<size_t, ros::Time> > m_chunk_timestamps; ///< start index in m_buffer and receive timestamp of each chunk
+    
+  }; // class ColaFramer
+  
+} // namespace sick_lidar_localization
+#endif // __SIM_LOC_COLA_FRAMER_H_INCLUDED
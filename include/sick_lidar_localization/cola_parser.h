@@ -61,6 +61,8 @@
 #ifndef __SIM_LOC_COLA_PARSER_H_INCLUDED
 #define __SIM_LOC_COLA_PARSER_H_INCLUDED
 
+#include <boost/utility/string_view.hpp>
+
 #include "sick_lidar_localization/SickLocColaTelegramMsg.h"
 #include "sick_lidar_localization/cola_converter.h"
 
@@ -105,6 +107,41 @@ namespace sick_lidar_localization
        MAX_COLA_COMMAND_NUMBER ///< Number of possible COLA_SOPAS_COMMANDs incl. invalid command
     } COLA_SOPAS_COMMAND;
   
+    /*!
+     * @brief class ColaTelegramView is a tokenized Cola-ASCII telegram with command type, command name and parameter.
+     * Command name and parameter are views into the original Cola-ASCII telegram, i.e. the telegram must not
+     * be modified or destroyed while a ColaTelegramView is in use. Parameter are iterated by nextParameter():
+     * <pre>
+     * size_t pos = 0;
+     * boost::string_view parameter;
+     * while(telegram_view.nextParameter(pos, parameter))
+     *   ...
+     * </pre>
+     */
+    class ColaTelegramView
+    {
+    public:
+      ColaTelegramView() : command_type(sINVALID), command_name(), parameter_list(), has_parameter(false) {} ///< Constructor
+      
+      /*!
+       * @brief Returns the next parameter starting at parameter_list[pos] and moves pos behind the parameter.
+       * @param[in,out] pos start position in parameter_list, initially 0
+       * @param[out] parameter next parameter
+       * @return true if a parameter has been returned, false if no more parameter
+       */
+      bool nextParameter(size_t & pos, boost::string_view & parameter) const;
+      
+      /*!
+       * @brief Returns the number of parameter.
+       */
+      size_t parameterCount(void) const;
+      
+      COLA_SOPAS_COMMAND command_type;   ///< One of the SOPAS Commands enumerated in COLA_SOPAS_COMMAND (sRN, sRA, sMN, sMA, or sWN)
+      boost::string_view command_name;   ///< Name of command like "SetAccessMode", "LocSetResultPoseEnabled", "LocRequestTimestamp", etc.
+      boost::string_view parameter_list; ///< All parameter separated by spaces, f.e. "3 F4724744"
+      bool has_parameter;                ///< true if the telegram has parameter (possibly empty), false otherwise
+    };
+  
     /*!
      * @brief Creates and returns a Cola telegram (type SickLocColaTelegramMsg).
      * @param[in] command_type One of the SOPAS Commands enumerated in COLA_SOPAS_COMMAND (sRN, sRA, sMN, sMA, or sWN)
@@ -132,6 +169,15 @@ namespace sick_lidar_localization
      */
     static sick_lidar_localization::SickLocColaTelegramMsg decodeColaTelegram(const std::string & cola_ascii);
   
+    /*!
+     * @brief Splits a Cola-ASCII telegram into command type, command name and parameter without copying or allocating.
+     * decodeColaTelegram() uses this tokenizer and copies the result into a SickLocColaTelegramMsg.
+     * @param[in] cola_ascii Cola-ASCII telegram, f.e. "<STX>sAN LocRequestTimestamp 1EAF3F4<ETX>"
+     * @param[out] telegram_view tokenized telegram with views into cola_ascii
+     * @return true on success, false on parse error (command_type of telegram_view will be sINVALID)
+     */
+    static bool tokenizeColaTelegram(const boost::string_view & cola_ascii, ColaTelegramView & telegram_view);
+  
     /*!
      * @brief Encodes and returns a Cola Binary telegram from ros message SickLocColaTelegramMsg.
      * @param[in] cola_telegram Cola telegram, f.e. createColaTelegram(sMN, "SetAccessMode", {"3", "F4724744"})
@@ -192,6 +238,13 @@ namespace sick_lidar_localization
     
   protected:
   
+    /*!
+     * @brief Converts and returns a COLA_SOPAS_COMMAND from a string view without allocating.
+     * @param[in] sopas_command One of the SOPAS commands ("sRN", "sRA", "sMN", "sMA", or "sWN")
+     * @return COLA_SOPAS_COMMAND, or sINVALID for unknown commands
+     */
+    static COLA_SOPAS_COMMAND findSopasCommand(const boost::string_view & sopas_command);
+  
     static const std::string s_command_type_string[MAX_COLA_COMMAND_NUMBER]; ///< static table to convert COLA_SOPAS_COMMAND to string, f.e. s_command_type_string[sRN]:="sRN", s_command_type_string[sRA]:="sRA" and so on
     static const std::map<std::string, COLA_SOPAS_COMMAND> s_command_type_map; ///< static map to convert COLA_SOPAS_COMMANDs from string to enum, f.e. s_command_type_map["sRN"]:=sRN, s_command_type_map["sRA"]:=sRA and so on
     static const std::string s_cola_ascii_start_tag; ///< All Cola-ACSII telegrams start with s_cola_ascii_start_tag := "<STX>" ("Start of TeXt")
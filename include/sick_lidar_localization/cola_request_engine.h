@@ -0,0 +1,231 @@
+/*
+ * @brief cola_request_engine sends cola requests to the localization controller and matches the responses to the
+ * outstanding requests, i.e. several cola requests can be in flight on one tcp connection at the same time.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#ifndef __SIM_LOC_COLA_REQUEST_ENGINE_H_INCLUDED
+#define __SIM_LOC_COLA_REQUEST_ENGINE_H_INCLUDED
+
+#include <boost/asio.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <list>
+
+#include "sick_lidar_localization/cola_transmitter.h"
+
+namespace sick_lidar_localization
+{
+  /*!
+   * class ColaRequestEngine sends cola requests to the localization controller and matches the responses to the
+   * outstanding requests. Several threads can call transmit() concurrently, i.e. up to max_outstanding_requests
+   * requests are in flight on one tcp connection without waiting for each other.
+   *
+   * Responses are matched to requests by command type and name, f.e. "sRA LocState" is the response to "sRN LocState",
+   * "sAN LocRequestTimestamp" is the response to "sMN LocRequestTimestamp". Requests with identical names are answered
+   * in order. Error responses ("sFA") do not contain a command name and are assigned to the oldest outstanding request.
+   * Responses without outstanding request are discarded. After a timeout, the late response of the timed out request
+   * can still arrive (the connection is kept open, if any telegram has been received since the request was sent).
+   * The first response matching a timed out request is therefore discarded, i.e. it is never assigned to the next
+   * request with the same name. A second timeout of a request with the same name before its late response arrived
+   * is a link error.
+   * Event telegrams ("sSN") sent by the localization controller after an event registration ("sEN") are not responses,
+   * they are passed to the event callback.
+   *
+   * Each request has its own timeout, implemented by an asio deadline timer.
+   */
+  class ColaRequestEngine
+  {
+  public:
+    
+    /*!
+     * Callback for event telegrams ("sSN"), called by the receiver thread with the event telegram (Cola-Binary or Cola-ASCII)
+     * and its receive timestamp. The callback must return quickly and must not call transmit(), since responses are
+     * received by the same thread.
+     */
+    typedef boost::function<void(const std::vector<uint8_t> & event_telegram, const ros::Time & receive_timestamp)> EventCallback;
+    
+    /*!
+     * Constructor. The engine does not connect automatically, call start() and stop() to start and stop.
+     * @param[in] server_adress ip adress of the localization controller, default: 192.168.0.1
+     * @param[in] tcp_port tcp port for command requests, default: 2111
+     * @param[in] max_outstanding_requests max. number of requests in flight at the same time, default: 4 (1: one request at a time)
+     */
+    ColaRequestEngine(const std::string & server_adress = "192.168.0.1", int tcp_port = 2111, int max_outstanding_requests = 4);
+    
+    /*!
+     * Destructor, stops the engine and closes the tcp connection.
+     */
+    virtual ~ColaRequestEngine();
+    
+    /*!
+     * Connects to the localization controller and starts the receiver and timer threads. The engine can be restarted after stop().
+     * @return true on success, false on failure (localization controller unknown or unreachable)
+     */
+    virtual bool start(void);
+    
+    /*!
+     * Stops the receiver and timer threads and closes the tcp connection. Outstanding requests fail immediately.
+     * Can be called by any thread, also while other threads call transmit().
+     */
+    virtual void stop(void);
+    
+    /*!
+     * Sends a request and waits for the matching response with timeout.
+     * @param[in] request Cola-ASCII or Cola-Binary request telegram
+     * @param[in] timeout timeout in seconds for the response
+     * @param[out] response response telegram received (Cola-Binary or Cola-Ascii)
+     * @param[out] send_timestamp send timestamp (ros timestamp immediately before tcp send)
+     * @param[out] receive_timestamp receive timestamp (ros timestamp immediately after first response byte received)
+     * @return true on success, false on failure (connection error or timeout)
+     */
+    virtual bool transmit(const std::vector<uint8_t> & request, double timeout, std::vector<uint8_t> & response, ros::Time & send_timestamp, ros::Time & receive_timestamp);
+    
+    /*!
+     * Returns true after a connection error, i.e. if the connection has been closed by the localization controller,
+     * receiving or sending failed, a request timed out without any response received since the request was sent,
+     * or a request timed out again before the late response of its previous timeout arrived. The engine should be
+     * stopped and restarted in this case.
+     */
+    virtual bool linkError(void);
+    
+    /*!
+     * Sets the callback for event telegrams ("sSN"). Event telegrams are discarded, if no callback is set.
+     * @param[in] event_callback callback for event telegrams
+     */
+    virtual void setEventCallback(const EventCallback & event_callback);
+    
+    /*!
+     * Splits a Cola-ASCII or Cola-Binary telegram into command type and command name,
+     * f.e. "sRA" and "LocState" for "<STX>sRA LocState 2<ETX>"
+     * @param[in] telegram Cola-ASCII or Cola-Binary telegram
+     * @param[out] command_type command type, f.e. "sRA"
+     * @param[out] command_name command name, f.e. "LocState" (empty for error responses "sFA")
+     * @return true on success, false if telegram is not a valid cola telegram
+     */
+    static bool parseCommand(const std::vector<uint8_t> & telegram, std::string & command_type, std::string & command_name);
+    
+  protected:
+    
+    /*!
+     * class PendingRequest: an outstanding request waiting for its response
+     */
+    class PendingRequest
+    {
+    public:
+      PendingRequest(boost::asio::io_service & io_service) : timer(io_service), completed(false), success(false) {} ///< Constructor
+      std::string command_type;          ///< command type of the request, f.e. "sRN"
+      std::string command_name;          ///< command name of the request, f.e. "LocState"
+      boost::asio::deadline_timer timer; ///< timer for the response timeout
+      bool completed;                    ///< true: response received, timed out or engine stopped
+      bool success;                      ///< true: response received
+      std::vector<uint8_t> response;     ///< response telegram
+      ros::Time send_timestamp;          ///< send timestamp (ros timestamp immediately before tcp send)
+      ros::Time receive_timestamp;       ///< receive timestamp (ros timestamp immediately after first response byte received)
+    };
+    typedef boost::shared_ptr<PendingRequest> PendingRequestPtr; ///< shared pointer to a pending request
+    
+    typedef std::pair<std::string, std::string> CommandId; ///< command type and name of a request, f.e. "sRN" and "LocState"
+    
+    /*!
+     * Returns true, if a response with the given command type and name answers a request with the given command type and name.
+     */
+    static bool responseMatchesRequest(const std::string & response_type, const std::string & response_name, const std::string & request_type, const std::string & request_name);
+    
+    /*!
+     * Completes a pending request and removes it from the list of outstanding requests. Must be called with m_mutex locked.
+     */
+    void completeRequest(std::list<PendingRequestPtr>::iterator iter_request, bool success);
+    
+    /*!
+     * Discards a late response to a timed out request. Must be called with m_mutex locked.
+     * @param[in] response_type command type of the response
+     * @param[in] response_name command name of the response
+     * @return true if the response answers a timed out request (response discarded), false otherwise
+     */
+    bool discardLateResponse(const std::string & response_type, const std::string & response_name);
+    
+    /*!
+     * Timer callback, completes a request with timeout error.
+     */
+    void onTimeout(PendingRequestPtr request, const boost::system::error_code & error);
+    
+    /*!
+     * Thread callback, receives response telegrams and dispatches them to the outstanding requests resp. event telegrams to the event callback.
+     */
+    void runReceiverThreadCb(void);
+    
+    /*
+     * member data
+     */
+    
+    sick_lidar_localization::ColaTransmitter m_transmitter; ///< tcp connection to the localization controller
+    size_t m_max_outstanding_requests;          ///< max. number of requests in flight at the same time
+    boost::mutex m_mutex;                       ///< protects m_pending_requests, m_timed_out_requests, m_running, m_link_error, m_last_receive_timestamp and m_event_callback
+    boost::condition_variable m_condition;      ///< notified whenever a request completes
+    boost::mutex m_send_mutex;                  ///< serializes tcp sends
+    std::list<PendingRequestPtr> m_pending_requests; ///< outstanding requests in send order
+    std::list<CommandId> m_timed_out_requests;  ///< requests timed out while the connection was alive, in timeout order, their late responses are discarded
+    bool m_running;                             ///< true: engine started, false: engine stopped
+    bool m_link_error;                          ///< true after a connection error
+    ros::Time m_last_receive_timestamp;         ///< receive timestamp of the last response
+    EventCallback m_event_callback;             ///< callback for event telegrams ("sSN")
+    boost::asio::io_service m_timer_service;    ///< io service for the request timers
+    boost::asio::io_service::work* m_timer_work;///< keeps m_timer_service running while the engine is started
+    boost::thread* m_timer_thread;              ///< thread running m_timer_service
+    boost::thread* m_receiver_thread;           ///< thread to receive responses from the localization controller
+    
+  }; // class ColaRequestEngine
+  
+} // namespace sick_lidar_localization
+#endif // __SIM_LOC_COLA_REQUEST_ENGINE_H_INCLUDED
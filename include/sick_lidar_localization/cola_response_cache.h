@@ -0,0 +1,180 @@
+/*
+ * @brief cola_response_cache caches responses to read-only Cola variables with a time to live per variable.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#ifndef __SIM_LOC_COLA_RESPONSE_CACHE_H_INCLUDED
+#define __SIM_LOC_COLA_RESPONSE_CACHE_H_INCLUDED
+
+#include <boost/thread.hpp>
+#include <boost/utility/string_view.hpp>
+#include <map>
+#include <set>
+#include <string>
+
+#include "sick_lidar_localization/cola_parser.h"
+#include "sick_lidar_localization/SickLocColaTelegramSrv.h"
+
+namespace sick_lidar_localization
+{
+  /*!
+   * class ColaResponseCache caches the responses to read-only Cola variables like "sRN LocState" with a
+   * configurable time to live per variable. Any write (sWN) or method (sMN) not listed as read-only invalidates
+   * all cached responses, since it may change the variables. Usage:
+   * <pre>
+   * uint64_t cache_generation = 0;
+   * if(cache.lookup(cola_request, cola_response, cache_generation))
+   *   return true; // cached response
+   * bool success = transmit(cola_request, cola_response);
+   * cache.update(cola_request, success, cola_response, cache_generation);
+   * </pre>
+   * ColaResponseCache is thread-safe. A response is not cached, if a write or method has been started while
+   * the read request was outstanding (generation changed).
+   */
+  class ColaResponseCache
+  {
+  public:
+    
+    /*!
+     * Constructor
+     * @param[in] time_to_live time to live in seconds for each cached variable, f.e. { {"LocState", 0.5}, {"LocResultState", 0.5} }
+     */
+    ColaResponseCache(const std::map<std::string, double> & time_to_live = std::map<std::string, double>());
+    
+    /*!
+     * Sets the time to live in seconds for each cached variable. Variables not listed (or with time to live <= 0) are not cached.
+     * @param[in] time_to_live time to live in seconds for each cached variable, f.e. { {"LocState", 0.5}, {"LocResultState", 0.5} }
+     */
+    void setTimeToLive(const std::map<std::string, double> & time_to_live);
+    
+    /*!
+     * Returns a cached response for a cola request, if the request is cacheable and the cached response has not
+     * yet expired. If the request is a write or method, all cached responses are invalidated.
+     * @param[in] cola_ascii_request Cola-ASCII request, f.e. "sRN LocState"
+     * @param[out] cola_response cached response (if true returned)
+     * @param[out] generation generation of the cache, to be passed to update() after transmitting the request
+     * @return true if a cached response is returned, false otherwise (request must be sent to the localization controller)
+     */
+    bool lookup(const std::string & cola_ascii_request, sick_lidar_localization::SickLocColaTelegramSrv::Response & cola_response, uint64_t & generation);
+    
+    /*!
+     * Updates the cache after a request has been transmitted: a successful response to a cacheable request is
+     * cached, a write or method invalidates all cached responses.
+     * @param[in] cola_ascii_request Cola-ASCII request, f.e. "sRN LocState"
+     * @param[in] success true if the request has been successfully transmitted
+     * @param[in] cola_response response from localization controller
+     * @param[in] generation generation returned by lookup()
+     */
+    void update(const std::string & cola_ascii_request, bool success, const sick_lidar_localization::SickLocColaTelegramSrv::Response & cola_response, uint64_t generation);
+    
+    /*!
+     * Invalidates all cached responses.
+     */
+    void invalidate(void);
+    
+    /*!
+     * Returns the default time to live of cached variables: 0.5 seconds for "LocState", "LocResultState" and "IsSystemReady".
+     */
+    static std::map<std::string, double> defaultTimeToLive(void);
+    
+    /*!
+     * Returns the number of cache hits and misses in a readable format, f.e. for logging
+     */
+    std::string statistics(void);
+    
+  protected:
+    
+    /*!
+     * Enumeration of request types
+     */
+    typedef enum REQUEST_TYPE_ENUM
+    {
+      UNCACHED = 0,   ///< request is neither cached nor does it invalidate the cache
+      CACHEABLE = 1,  ///< read-only request with time to live > 0
+      INVALIDATES = 2 ///< write or method, invalidates all cached responses
+    } REQUEST_TYPE;
+    
+    /*!
+     * Returns the type of a cola request and the time to live of cacheable requests (m_cache_mutex must be locked).
+     * @param[in] cola_ascii_request Cola-ASCII request, f.e. "sRN LocState"
+     * @param[out] time_to_live time to live in seconds of cacheable requests
+     * @return type of request
+     */
+    REQUEST_TYPE requestType(const std::string & cola_ascii_request, double & time_to_live);
+    
+    /*!
+     * class CacheEntry is a cached response with its expiration time
+     */
+    class CacheEntry
+    {
+    public:
+      CacheEntry() : expiration_time(0) {} ///< Constructor
+      sick_lidar_localization::SickLocColaTelegramSrv::Response cola_response; ///< cached response
+      double expiration_time; ///< monotonic time in seconds, when the cached response expires
+    };
+    
+    /*
+     * member data
+     */
+    
+    std::map<std::string, double> m_time_to_live;         ///< time to live in seconds for each cached variable
+    std::map<std::string, CacheEntry> m_cache;            ///< cached responses by Cola-ASCII request
+    uint64_t m_generation;                                ///< incremented by each invalidation
+    size_t m_hits;                                        ///< number of cache hits
+    size_t m_misses;                                      ///< number of cache misses of cacheable requests
+    boost::mutex m_cache_mutex;                           ///< mutex to protect the cache
+    static const std::set<std::string> s_read_only_methods; ///< methods which never change any variable, f.e. "IsSystemReady" or "LocRequestTimestamp"
+    
+  }; // class ColaResponseCache
+  
+} // namespace sick_lidar_localization
+#endif // __SIM_LOC_COLA_RESPONSE_CACHE_H_INCLUDED
@@ -0,0 +1,226 @@
+/*
+ * @brief cola_schema encodes and decodes Cola-Binary telegrams directly from native values.
+ * Parameter types of the supported commands are given by a command schema, f.e. LocSetPose(int32,int32,int32,uint16),
+ * i.e. Cola-Binary parameter are not converted from and to hex strings.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#ifndef __SIM_LOC_COLA_SCHEMA_H_INCLUDED
+#define __SIM_LOC_COLA_SCHEMA_H_INCLUDED
+
+#include <boost/utility/string_view.hpp>
+#include <string>
+#include <vector>
+
+#include "sick_lidar_localization/cola_parser.h"
+
+namespace sick_lidar_localization
+{
+  /*!
+   * class ColaSchema encodes and decodes Cola-Binary telegrams directly from native values.
+   * The parameter types of the supported commands are given by a static command schema, f.e.
+   * "LocSetPose(int32,int32,int32,uint16) -> uint8" or "LocRequestTimestamp -> uint32".
+   * Cola-Binary parameter are encoded big endian without separators, i.e. "sMN LocSetPose +10300 -5200 +30000 +1000"
+   * is encoded by { "sMN LocSetPose ", 0x0000283C, 0xFFFFEBB0, 0x00007530, 0x03E8 }.
+   *
+   * Cola-ASCII parameter are parsed and formatted once by the schema types: a leading sign denotes a decimal value,
+   * otherwise the value is hex (see Operation-Instruction-v1.1.0.241R.pdf, chapter 5.8 "About CoLa-A telegrams").
+   * Commands not listed in the schema (or with a different number of parameter) are not encoded, use
+   * ColaAsciiBinaryConverter::ColaAsciiToColaBinary() and ColaAsciiBinaryConverter::ColaBinaryToColaAscii() in this case.
+   */
+  class ColaSchema
+  {
+  public:
+  
+    /*!
+     * Enumeration of Cola-Binary parameter types
+     */
+    typedef enum COLA_TYPE_ENUM
+    {
+      INT8 = 0,   ///< signed 8 bit integer
+      UINT8 = 1,  ///< unsigned 8 bit integer (also bool)
+      INT16 = 2,  ///< signed 16 bit integer
+      UINT16 = 3, ///< unsigned 16 bit integer
+      INT32 = 4,  ///< signed 32 bit integer
+      UINT32 = 5  ///< unsigned 32 bit integer
+    } COLA_TYPE;
+    
+    /*!
+     * class CommandSchema contains the parameter types of a command request (sRN, sMN, sWN) and its response (sRA, sAN).
+     */
+    class CommandSchema
+    {
+    public:
+      const char* command_name;                ///< Name of command like "LocSetPose", "LocRequestTimestamp", etc.
+      std::vector<COLA_TYPE> request_types;    ///< parameter types of the request (sRN, sMN, sWN)
+      std::vector<COLA_TYPE> response_types;   ///< parameter types of the response (sRA, sAN) and event (sSN)
+    };
+    
+    /*!
+     * Returns the parameter types of a command, or 0 if the command is not listed in the schema.
+     * Method and write answers sMA and sWA have no parameter. Event registrations sEN and sEA have one uint8 parameter
+     * (1: subscribe, 0: unsubscribe), event telegrams sSN have the parameter types of the response to the variable.
+     * @param[in] command_type command type (sRN, sRA, sMN, sAN, sMA, sWN, sWA, sEN, sEA or sSN)
+     * @param[in] command_name command name, f.e. "LocSetPose"
+     * @return parameter types or 0 if not found
+     */
+    static const std::vector<COLA_TYPE>* findParameterTypes(sick_lidar_localization::ColaParser::COLA_SOPAS_COMMAND command_type, const boost::string_view & command_name);
+    
+    /*!
+     * Encodes a Cola-Binary telegram from native parameter values.
+     * @param[in] command_type command type, f.e. sMN
+     * @param[in] command_name command name, f.e. "LocSetPose"
+     * @param[in] values parameter values, f.e. { 10300, -5200, 30000, 1000 }
+     * @param[out] cola_binary Cola-Binary telegram incl. header and checksum
+     * @return true on success, false if the command is not listed in the schema or the values do not match the parameter types
+     */
+    static bool encodeColaBinary(sick_lidar_localization::ColaParser::COLA_SOPAS_COMMAND command_type, const boost::string_view & command_name,
+      const std::vector<int64_t> & values, std::vector<uint8_t> & cola_binary);
+  
+    /*!
+     * Encodes a Cola-Binary telegram from a Cola-ASCII telegram, each parameter is parsed once by its schema type.
+     * @param[in] cola_ascii Cola-ASCII telegram with or without "<STX>" and "<ETX>", f.e. "sMN LocSetPose +10300 -5200 +30000 +1000"
+     * @param[out] cola_binary Cola-Binary telegram incl. header and checksum
+     * @return true on success, false if the command is not listed in the schema or the parameter do not match the parameter types
+     */
+    static bool encodeColaBinary(const boost::string_view & cola_ascii, std::vector<uint8_t> & cola_binary);
+  
+    /*!
+     * Encodes a Cola-Binary telegram from a cola telegram message, each parameter is parsed once by its schema type.
+     * @param[in] cola_telegram cola telegram message
+     * @param[out] cola_binary Cola-Binary telegram incl. header and checksum
+     * @return true on success, false if the command is not listed in the schema or the parameter do not match the parameter types
+     */
+    static bool encodeColaBinary(const sick_lidar_localization::SickLocColaTelegramMsg & cola_telegram, std::vector<uint8_t> & cola_binary);
+  
+    /*!
+     * Decodes a Cola-Binary telegram into native parameter values.
+     * @param[in] cola_binary Cola-Binary telegram incl. header and checksum
+     * @param[out] command_type command type, f.e. sAN
+     * @param[out] command_name command name, f.e. "LocRequestTimestamp"
+     * @param[out] values parameter values, f.e. { 0x1EF6B06E }
+     * @return true on success, false if the telegram is invalid, the command is not listed in the schema or the payload does not match the parameter types
+     */
+    static bool decodeColaBinary(const std::vector<uint8_t> & cola_binary, sick_lidar_localization::ColaParser::COLA_SOPAS_COMMAND & command_type,
+      std::string & command_name, std::vector<int64_t> & values);
+  
+    /*!
+     * Decodes a Cola-Binary telegram into a cola telegram message. Parameter of requests are formatted as decimal values
+     * with sign (f.e. "+2201"), unsigned parameter of responses as hex values (f.e. "1EF6B06E", like the localization controller responds in Cola-ASCII).
+     * @param[in] cola_binary Cola-Binary telegram incl. header and checksum
+     * @param[out] cola_telegram cola telegram message
+     * @return true on success, false if the telegram is invalid, the command is not listed in the schema or the payload does not match the parameter types
+     */
+    static bool decodeColaBinary(const std::vector<uint8_t> & cola_binary, sick_lidar_localization::SickLocColaTelegramMsg & cola_telegram);
+  
+    /*!
+     * Decodes a Cola-Binary telegram into a Cola-ASCII telegram without "<STX>" and "<ETX>", see decodeColaBinary(cola_binary, cola_telegram).
+     * @param[in] cola_binary Cola-Binary telegram incl. header and checksum
+     * @param[out] cola_ascii Cola-ASCII telegram, f.e. "sAN LocRequestTimestamp 1EF6B06E"
+     * @return true on success, false if the telegram is invalid, the command is not listed in the schema or the payload does not match the parameter types
+     */
+    static bool decodeColaBinary(const std::vector<uint8_t> & cola_binary, std::string & cola_ascii);
+  
+    /*!
+     * Parses a Cola-ASCII parameter: a leading sign denotes a decimal value ("+2201", "-5200"), otherwise the value is hex ("1EF6B06E").
+     * Hex values of signed types are two's complement ("FFFFEBB0" is -5200 for INT32).
+     * @param[in] parameter Cola-ASCII parameter
+     * @param[in] type parameter type
+     * @param[out] value parsed value
+     * @return true on success, false on parse error or if the value is out of range of the parameter type
+     */
+    static bool parseColaAsciiValue(const boost::string_view & parameter, COLA_TYPE type, int64_t & value);
+  
+    /*!
+     * Formats a parameter value as Cola-ASCII and appends it to cola_ascii.
+     * @param[in] type parameter type
+     * @param[in] value parameter value
+     * @param[in] decimal_with_sign true: format decimal with sign ("+2201"), false: format unsigned types hex ("899") and signed types decimal with sign
+     * @param[in,out] cola_ascii formatted value appended
+     */
+    static void appendColaAsciiValue(COLA_TYPE type, int64_t value, bool decimal_with_sign, std::string & cola_ascii);
+    
+  protected:
+  
+    /*! Returns the size of a parameter type in byte */
+    static size_t typeSize(COLA_TYPE type) { return (size_t)1 << (type / 2); }
+  
+    /*! Returns true for signed parameter types */
+    static bool typeSigned(COLA_TYPE type) { return (type % 2) == 0; }
+  
+    /*! Returns true if value is in range of a parameter type */
+    static bool inRange(COLA_TYPE type, int64_t value);
+  
+    /*! Returns true for request command types (sRN, sMN, sWN, sEN) */
+    static bool isRequest(sick_lidar_localization::ColaParser::COLA_SOPAS_COMMAND command_type);
+  
+    /*!
+     * Encodes a Cola-Binary telegram: 4 byte STX, 4 byte payload length, payload (command type, command name, parameter) and checksum.
+     * @param[in] command_type command type, f.e. sMN
+     * @param[in] command_name command name, f.e. "LocSetPose"
+     * @param[in] parameter_types parameter types
+     * @param[in] values parameter values
+     * @param[out] cola_binary Cola-Binary telegram incl. header and checksum
+     * @return true on success, false if the values do not match the parameter types
+     */
+    static bool encode(sick_lidar_localization::ColaParser::COLA_SOPAS_COMMAND command_type, const boost::string_view & command_name,
+      const std::vector<COLA_TYPE> & parameter_types, const std::vector<int64_t> & values, std::vector<uint8_t> & cola_binary);
+  
+    /*!
+     * Returns the command schema table
+     */
+    static const std::vector<CommandSchema> & commandSchemaTable(void);
+  
+  }; // class ColaSchema
+  
+} // namespace sick_lidar_localization
+#endif // __SIM_LOC_COLA_SCHEMA_H_INCLUDED
@@ -71,7 +71,16 @@
 #ifndef __SIM_LOC_COLA_SERVICES_H_INCLUDED
 #define __SIM_LOC_COLA_SERVICES_H_INCLUDED
 
+#include <boost/asio.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/future.hpp>
+#include <list>
+
+#include "sick_lidar_localization/cola_broker_client.h"
 #include "sick_lidar_localization/cola_parser.h"
+#include "sick_lidar_localization/persistent_service_client.h"
 #include "sick_lidar_localization/SickLocColaTelegramSrv.h"
 #include "sick_lidar_localization/SickLocIsSystemReadySrv.h"
 #include "sick_lidar_localization/SickLocStateSrv.h"
@@ -108,21 +117,51 @@ namespace sick_lidar_localization
    * "SickLocSetPose"               | srv/SickLocSetPoseSrv.srv               | "sMN LocSetPose <posex> <posey> <yaw> <uncertainty>" | Initialize vehicle pose
    *
    * See Telegram-Listing-v1.1.0.241R.pdf for further details about Cola telegrams.
+   *
+   * Cola telegrams can be sent asynchronously by sendColaTelegramAsync(), returning a future or invoking a completion
+   * callback. Concurrent service calls and asynchronous requests use their own persistent connections to ros service
+   * "SickLocColaTelegram", i.e. they overlap instead of queueing behind each other.
+   *
+   * If the cola broker of the driver is available (parameter cola_broker_socket), cola telegrams are sent by the broker
+   * on a local unix domain socket. Ros service "SickLocColaTelegram" is used as fallback, if the broker is disabled or
+   * not available.
    */
   class ColaServices
   {
   public:
     
+    /*!
+     * Completion callback of asynchronous cola requests, called with the decoded response from localization controller
+     * (response.command_name is empty in case of errors)
+     */
+    typedef boost::function<void(const sick_lidar_localization::SickLocColaTelegramMsg &)> ColaResponseCallback;
+    
     /*!
      * Constructor
      */
     ColaServices(ros::NodeHandle* nh = 0);
     
     /*!
-     * Destructor
+     * Destructor, cancels all asynchronous requests not yet started
      */
     virtual ~ColaServices();
   
+    /*!
+     * Sends a cola telegram asynchronously using ros service "SickLocColaTelegram". Returns immediately,
+     * the decoded response from localization controller is available by the returned future.
+     * @param[in] cola_ascii_request request (Cola-ASCII, f.e. "sRN LocState")
+     * @return future of the response from localization controller (command_name empty in case of errors)
+     */
+    virtual boost::shared_future<sick_lidar_localization::SickLocColaTelegramMsg> sendColaTelegramAsync(const std::string & cola_ascii_request);
+  
+    /*!
+     * Sends a cola telegram asynchronously using ros service "SickLocColaTelegram". Returns immediately,
+     * completion_callback is called by a worker thread after the response has been received (or the request failed).
+     * @param[in] cola_ascii_request request (Cola-ASCII, f.e. "sRN LocState")
+     * @param[in] completion_callback callback with the response from localization controller (command_name empty in case of errors)
+     */
+    virtual void sendColaTelegramAsync(const std::string & cola_ascii_request, ColaResponseCallback completion_callback);
+  
     /*!
      * Callback for service messages (SickLocIsSystemReadySrv, Check if the system is ready).
      * Sends a cola telegram "sMN IsSystemReady" and receives the response from localization controller
@@ -245,12 +284,44 @@ namespace sick_lidar_localization
   
   protected:
   
+    /*! Persistent ros service client for ros service "SickLocColaTelegram" */
+    typedef sick_lidar_localization::PersistentServiceClient<sick_lidar_localization::SickLocColaTelegramSrv> ColaServiceClient;
+    typedef boost::shared_ptr<ColaServiceClient> ColaServiceClientPtr;
+  
     /*!
-     * Sends a cola telegram using ros service "SickLocColaTelegram", receives and returns the response from localization controller
+     * Sends a cola telegram using the cola broker or ros service "SickLocColaTelegram", receives and returns the response from localization controller.
+     * Thread-safe, concurrent calls use different broker connections resp. service clients and overlap. Responses to read-only variables
+     * like "sRN LocState" are cached by sim_loc_driver only, which receives all cola requests and events.
      * @param[in] cola_ascii_request request (Cola-ASCII, f.e. "sMN IsSystemReady")
      * @return response from localization controller
      */
     virtual sick_lidar_localization::SickLocColaTelegramMsg sendColaTelegram(const std::string & cola_ascii_request);
+  
+    /*!
+     * Returns an idle service client from m_idle_service_clients, or creates a new one if all service clients are busy.
+     * A ros service connection handles one call at a time, therefore each concurrent call needs its own service client.
+     */
+    virtual ColaServiceClientPtr acquireServiceClient(void);
+  
+    /*!
+     * Returns a service client to m_idle_service_clients after a service call.
+     * @param[in] service_client service client acquired by acquireServiceClient()
+     */
+    virtual void releaseServiceClient(const ColaServiceClientPtr & service_client);
+  
+    /*!
+     * Runs an asynchronous cola request in a worker thread, calls sendColaTelegram and the completion callback.
+     * @param[in] cola_ascii_request request (Cola-ASCII, f.e. "sRN LocState")
+     * @param[in] completion_callback callback with the response from localization controller
+     */
+    virtual void runAsyncRequestCb(const std::string & cola_ascii_request, ColaResponseCallback completion_callback);
+  
+    /*!
+     * Completion callback of sendColaTelegramAsync returning a future, sets the response as value of the promise.
+     * @param[in] response_promise promise of the response
+     * @param[in] cola_response response from localization controller
+     */
+    static void setResponsePromise(boost::shared_ptr<boost::promise<sick_lidar_localization::SickLocColaTelegramMsg> > response_promise, const sick_lidar_localization::SickLocColaTelegramMsg & cola_response);
 
     /*!
      * Converts and returns the parameter of a cola ascii telegram into a numeric value.
@@ -300,9 +371,16 @@ namespace sick_lidar_localization
      * member variables
      */
   
+    ros::NodeHandle* m_nh;                             ///< ros node handle
     double m_cola_response_timeout;                    ///< Timeout in seconds for cola responses from localization controller, default: 1
+    int m_cola_pipeline_depth;                         ///< Number of worker threads for asynchronous cola requests, default: 4
     std::vector<ros::ServiceServer> m_service_server;  ///< list of ros service provider for services listed above
-    ros::ServiceClient m_service_client;               ///< client to call ros service "SickLocColaTelegram" to send cola telegrams and receive cola responses from localization controller
+    std::list<ColaServiceClientPtr> m_idle_service_clients; ///< idle clients to call ros service "SickLocColaTelegram" to send cola telegrams and receive cola responses from localization controller
+    boost::mutex m_service_client_mutex;               ///< mutex to protect m_idle_service_clients
+    boost::asio::io_service m_async_service;           ///< io service to queue asynchronous cola requests
+    boost::asio::io_service::work* m_async_work;       ///< keeps m_async_service running while ColaServices exists
+    boost::thread_group m_async_threads;               ///< worker threads running asynchronous cola requests
+    boost::shared_ptr<sick_lidar_localization::ColaBrokerClient> m_cola_broker_client; ///< client to send cola telegrams by the cola broker of the driver (local unix domain socket)
   
   }; // class ColaServices
   
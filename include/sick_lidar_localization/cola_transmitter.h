@@ -57,6 +57,7 @@
 #define __SIM_LOC_COLA_TRANSMITTER_H_INCLUDED
 
 #include "sick_lidar_localization/client_socket.h"
+#include "sick_lidar_localization/cola_framer.h"
 #include "sick_lidar_localization/fifo_buffer.h"
 
 namespace sick_lidar_localization
@@ -94,6 +95,13 @@ namespace sick_lidar_localization
      */
     virtual bool close(void);
   
+    /*!
+     * Shuts down the tcp connection to the localization server without closing the socket, i.e. a thread blocked
+     * in receive() returns and a concurrent send() fails, but the socket handle remains valid until close().
+     * @return true on success, false on failure (f.e. not connected)
+     */
+    virtual bool shutdown(void);
+  
     /*!
      * Send data to the localization server.
      * @param[in] data data to be send
@@ -121,7 +129,19 @@ namespace sick_lidar_localization
     virtual bool receive(std::vector<uint8_t> & telegram, double timeout, ros::Time & receive_timestamp);
   
     /*!
-     * Receive a cola telegram from a socket.
+     * Receive a cola telegram from the localization server. Returns immediately, if the connection has been closed
+     * by peer or a socket error occured.
+     * @param[out] telegram telegram received (Cola-Binary or Cola-Ascii)
+     * @param[in] timeout timeout in seconds
+     * @param[out] receive_timestamp receive timestamp in seconds (ros timestamp immediately after first response byte received)
+     * @param[out] connection_error true if the connection has been closed by peer (end of file), on socket errors or if the socket is closed, false otherwise
+     * @return true on success, false on failure (connection error or timeout)
+     */
+    virtual bool receive(std::vector<uint8_t> & telegram, double timeout, ros::Time & receive_timestamp, bool & connection_error);
+  
+    /*!
+     * Receive a cola telegram from a socket. Note: Data received after the first telegram are discarded,
+     * use receive() with a ColaFramer to receive a stream of telegrams.
      * @param[in] socket socket to read from
      * @param[out] telegram telegram received (Cola-Binary or Cola-Ascii)
      * @param[in] timeout timeout in seconds
@@ -130,6 +150,32 @@ namespace sick_lidar_localization
      */
     static bool receive(boost::asio::ip::tcp::socket & socket, std::vector<uint8_t> & telegram, double timeout,ros::Time & receive_timestamp);
   
+    /*!
+     * Receive a cola telegram from a socket. All bytes available are read at once and appended to a framer,
+     * which splits them into telegrams. Telegrams already buffered by the framer are returned without reading.
+     * @param[in] socket socket to read from
+     * @param[in,out] framer buffers the data received, must be used for all reads from this socket
+     * @param[out] telegram telegram received (Cola-Binary or Cola-Ascii)
+     * @param[in] timeout timeout in seconds
+     * @param[out] receive_timestamp receive timestamp in seconds (ros timestamp immediately after first response byte received)
+     * @return true on success, false on failure (connection error or timeout)
+     */
+    static bool receive(boost::asio::ip::tcp::socket & socket, sick_lidar_localization::ColaFramer & framer, std::vector<uint8_t> & telegram, double timeout, ros::Time & receive_timestamp);
+  
+    /*!
+     * Receive a cola telegram from a socket. All bytes available are read at once and appended to a framer,
+     * which splits them into telegrams. Telegrams already buffered by the framer are returned without reading.
+     * Returns immediately, if the connection has been closed by peer or a socket error occured.
+     * @param[in] socket socket to read from
+     * @param[in,out] framer buffers the data received, must be used for all reads from this socket
+     * @param[out] telegram telegram received (Cola-Binary or Cola-Ascii)
+     * @param[in] timeout timeout in seconds
+     * @param[out] receive_timestamp receive timestamp in seconds (ros timestamp immediately after first response byte received)
+     * @param[out] connection_error true if the connection has been closed by peer (end of file), on socket errors or if the socket is closed, false otherwise
+     * @return true on success, false on failure (connection error or timeout)
+     */
+    static bool receive(boost::asio::ip::tcp::socket & socket, sick_lidar_localization::ColaFramer & framer, std::vector<uint8_t> & telegram, double timeout, ros::Time & receive_timestamp, bool & connection_error);
+  
     /*!
      * Starts a thread to receive response telegrams from the localization server.
      * The receiver thread pushes responses to a fifo buffer, which can be popped by waitPopResponse().
@@ -170,14 +216,6 @@ namespace sick_lidar_localization
       ros::Time receive_timestamp;        ///< receive timestamp in seconds (ros timestamp immediately after first response byte received)
     };
   
-    /*!
-     * Returns true, if data end with etx, i.e. the trailing (etx.size()) byte in data are identical to etx.
-     * @param[in] data data received
-     * @param[in] etx ETX tag (binary or ascii)
-     * @return true if data end with etx, false otherwise
-     */
-    static bool dataEndWithETX(const std::vector<uint8_t> & data, const std::vector<uint8_t> & etx);
-
     /*!
      * Thread callback, receives response telegrams from localization server and pushes them to m_response_fifo.
      */
@@ -191,6 +229,7 @@ namespace sick_lidar_localization
     int m_tcp_port;                                     ///< tcp port of the localization controller, default: 2111 for command requests and 2112 for  command responses
     boost::asio::io_service m_ioservice;                ///< boost io service for tcp connections
     sick_lidar_localization::ClientSocket m_tcp_socket; ///< tcp socket connected to the localization controller
+    sick_lidar_localization::ColaFramer m_framer;        ///< splits the data received from m_tcp_socket into telegrams
     double m_receive_timeout;                           ///< default timeout in seconds for receive functions
     bool m_receiver_thread_running;                     ///< true: m_receiver_thread is running, otherwise false
     boost::thread* m_receiver_thread;                   ///< thread to receive responses from localization server
@@ -56,15 +56,22 @@
 #ifndef __SIM_LOC_DRIVER_MONITOR_H_INCLUDED
 #define __SIM_LOC_DRIVER_MONITOR_H_INCLUDED
 
-#include "sick_lidar_localization/cola_transmitter.h"
+#include <boost/weak_ptr.hpp>
+
+#include "sick_lidar_localization/cola_request_engine.h"
+#include "sick_lidar_localization/cola_response_cache.h"
 #include "sick_lidar_localization/driver_thread.h"
 #include "sick_lidar_localization/utils.h"
+#include "sick_lidar_localization/SickLocControllerStateMsg.h"
 
 namespace sick_lidar_localization
 {
   /*!
    * Class sick_lidar_localization::DriverMonitor monitors the driver thread implemented by sick_lidar_localization::DriverThread
    * and starts a new driver thread after tcp errors (connection lost, socket shutdown, message timeouts etc.).
+   * The state of the localization controller (LocState, LocResultState, LocMapState) is subscribed by cola events ("sEN")
+   * and published on topic "controller_state" immediately after each change. If event subscriptions are disabled or fail,
+   * the state is polled.
    */
   class DriverMonitor
   {
@@ -113,32 +120,105 @@ namespace sick_lidar_localization
   
     /*!
      * Callback for service messages (SickLocColaTelegramSrv). Handles Cola requests and responses, sends and receives Cola-ASCII telegrams to resp. from
-     * the localization controller
+     * the localization controller. Read-only variables like "sRN LocState" are answered from m_cola_response_cache within their time to live.
      * @param[in] cola_request Cola command request, will be encoded and send to the localization controller
      * @param[out] cola_response Cola command response from localization controller
      */
     virtual bool serviceCbColaTelegram(sick_lidar_localization::SickLocColaTelegramSrv::Request & cola_request, sick_lidar_localization::SickLocColaTelegramSrv::Response & cola_response);
+  
+    /*!
+     * Callback for service messages (SickLocColaTelegramSrv) for timestamp requests ("sMN LocRequestTimestamp").
+     * Timestamp requests are sent on a separate tcp connection to the localization controller (port cola_timestamp_tcp_port),
+     * reserved for time synchronization. They never wait behind other cola requests (f.e. a slow "sMN LocStopAndSave"),
+     * which would increase their round trip time. If the separate connection is disabled (cola_timestamp_tcp_port = 0)
+     * or fails, the request is sent by serviceCbColaTelegram.
+     * @param[in] cola_request Cola command request, will be encoded and send to the localization controller
+     * @param[out] cola_response Cola command response from localization controller
+     */
+    virtual bool serviceCbColaTimestampTelegram(sick_lidar_localization::SickLocColaTelegramSrv::Request & cola_request, sick_lidar_localization::SickLocColaTelegramSrv::Response & cola_response);
 
   protected:
 
     /*!
-     * Initializes cola sender and receiver for cola requests and responses
-     * @param[in] server_adress ip adress of the localization controller, default: 192.168.0.1
-     * @param[in] ip_port_cola ip port for command requests and responses, default: 2111
-     * @param[in] receive_timeout timeout in seconds for receive functions
+     * Returns the cola request engine for a tcp port, creates and starts the engine if not yet done.
+     * @param[in,out] cola_engine cola request engine, created and started if not yet done (m_cola_engine_mutex locked by this function)
+     * @param[in] ip_port_cola ip port for command requests and responses
+     * @return cola request engine, or an empty pointer if the localization controller is not reachable
+     */
+    boost::shared_ptr<sick_lidar_localization::ColaRequestEngine> getColaEngine(boost::shared_ptr<sick_lidar_localization::ColaRequestEngine> & cola_engine, int ip_port_cola);
+    
+    /*!
+     * Stops and removes a cola request engine after a connection error. The engine is restarted by the next request.
+     * @param[in,out] cola_engine cola request engine (m_cola_engine_mutex locked by this function)
+     * @param[in] failed_engine engine with connection error, cola_engine is reset only if still identical to failed_engine
+     */
+    void resetColaEngine(boost::shared_ptr<sick_lidar_localization::ColaRequestEngine> & cola_engine, const boost::shared_ptr<sick_lidar_localization::ColaRequestEngine> & failed_engine);
+  
+    /*!
+     * Sends a Cola request and receives the response using a given cola request engine.
+     * Called concurrently by serviceCbColaTelegram and serviceCbColaTimestampTelegram, several requests
+     * can be outstanding at the same time.
+     * @param[in,out] cola_engine cola request engine, created and started if not yet done, restarted after connection errors
+     * @param[in] ip_port_cola ip port for command requests and responses
+     * @param[in] cola_request Cola command request, will be encoded and send to the localization controller
+     * @param[out] cola_response Cola command response from localization controller
+     */
+    bool transmitColaTelegram(boost::shared_ptr<sick_lidar_localization::ColaRequestEngine> & cola_engine, int ip_port_cola,
+      sick_lidar_localization::SickLocColaTelegramSrv::Request & cola_request, sick_lidar_localization::SickLocColaTelegramSrv::Response & cola_response);
+
+    /*!
+     * Converts a Cola-Binary or Cola-ASCII response or event telegram from the localization controller to a Cola-ASCII string
+     * including "<STX>" and "<ETX>". Typed Cola-Binary telegrams are decoded by the ColaSchema.
+     * @param[in] binary_response response or event telegram received from the localization controller
+     * @return Cola-ASCII telegram, f.e. "<STX>sRA LocState 2<ETX>"
+     */
+    std::string decodeColaResponse(const std::vector<uint8_t> & binary_response);
+    
+    /*!
+     * Subscribes the state variables of the localization controller by cola event registrations ("sEN <variable> 1") and
+     * queries their initial values. Subscriptions are sent once per tcp connection, i.e. again after a reconnect.
+     * A failed registration of a required variable is retried after 5 seconds, the state is polled meanwhile.
+     * @return true, if LocState and LocResultState are subscribed on the current connection, otherwise false (state is polled)
+     */
+    bool subscribeColaEvents(void);
+    
+    /*!
+     * Checks the cola connection with event subscriptions by "sRN LocState" every cola_liveness_interval seconds.
+     * Events are sent after changes only, i.e. a half-open tcp connection (f.e. after a power loss of the localization
+     * controller or a disconnected cable) is not detected by missing events. A failed request resets the connection,
+     * and events are subscribed again on the new connection. The response updates LocState, if an event has been lost.
+     */
+    void checkColaLiveness(void);
+    
+    /*!
+     * Callback for cola event telegrams ("sSN"), called by the receiver thread of the cola request engine.
+     * Updates and publishes the controller state and invalidates the cached cola responses.
+     * @param[in] event_telegram event telegram (Cola-Binary or Cola-ASCII), f.e. "sSN LocState 2"
+     * @param[in] receive_timestamp receive timestamp of the event telegram
+     */
+    void eventCbColaTelegram(const std::vector<uint8_t> & event_telegram, const ros::Time & receive_timestamp);
+    
+    /*!
+     * Sets a state variable of the localization controller and publishes the controller state, if the value changed.
+     * The timeout for result telegrams restarts, when localization or result output has been enabled.
+     * @param[in] variable_name name of the state variable: "LocState", "LocResultState" or "LocMapState"
+     * @param[in] value new value of the state variable
      */
-    bool initColaTransmitter(const std::string & server_adress, int ip_port_cola, double receive_timeout);
+    void updateControllerState(const std::string & variable_name, int32_t value);
     
     /*!
-     * Stops cola sender and receiver for cola requests and responses
-     * (if started by a cola service request "SickLocColaTelegram")
+     * Returns the controller state as received by cola events, if LocState and LocResultState are subscribed on the current connection.
+     * @param[out] controller_state controller state
+     * @return true, if the controller state is up to date by cola events, false otherwise (state has to be polled)
      */
-    void stopColaTransmitter(void);
+    bool getSubscribedControllerState(sick_lidar_localization::SickLocControllerStateMsg & controller_state);
 
     /*!
      * Returns true, if result telegrams have been received within configured timeout "monitoring_message_timeout".
-     * If no result telegrams have been received within the timeout, the localization status is queried by ros service
-     * "SickLocState". If localization is not activated (LocState != 2), this function returns true (no error).
+     * If no result telegrams have been received within the timeout, the localization state is checked: if LocState and
+     * LocResultState are subscribed by cola events, their last values are used without any request. Otherwise the state
+     * is polled by "sRN LocState" and "sRN LocResultState". If localization is not activated (LocState != 2)
+     * or result output is disabled, this function returns true (no error).
      * Otherwise, result telegrams are missing and false is returned (error).
      */
     bool resultTelegramsReceiveStatusIsOk(void);
@@ -164,8 +244,21 @@ namespace sick_lidar_localization
     double m_monitoring_rate;                ///< frequency to monitor driver messages, default: once per second
     double m_receive_telegrams_timeout;      ///< timeout for driver messages, shutdown tcp-sockets and reconnect after message timeout, default: 1 second
     double m_cola_response_timeout;          ///< timeout in seconds for cola responses from localization controller, default: 1
-    sick_lidar_localization::ColaTransmitter* m_cola_transmitter; ///< transmitter for cola commands (send requests, receive responses)
-    boost::mutex m_service_cb_mutex;          ///< mutex to protect serviceCbColaTelegram (one service request at a time)
+    int m_cola_pipeline_depth;               ///< max. number of cola requests in flight on one tcp connection, default: 4 (1: one request at a time)
+    boost::mutex m_cola_engine_mutex;        ///< protects m_cola_engine and m_cola_timestamp_engine
+    boost::shared_ptr<sick_lidar_localization::ColaRequestEngine> m_cola_engine; ///< request engine for cola commands (send requests, receive and match responses)
+    int m_ip_port_cola_timestamp;            ///< ip port for timestamp requests on a separate tcp connection, default: ip_port_cola (0: disabled, timestamp requests share the connection of other cola requests)
+    boost::shared_ptr<sick_lidar_localization::ColaRequestEngine> m_cola_timestamp_engine; ///< request engine for timestamp requests ("sMN LocRequestTimestamp") on a separate tcp connection
+    sick_lidar_localization::ColaResponseCache m_cola_response_cache; ///< cached responses to read-only variables like "sRN LocState", invalidated by writes and methods
+    bool m_cola_events_enabled;              ///< true (default): subscribe the controller state by cola events ("sEN"), false: poll the controller state
+    boost::weak_ptr<sick_lidar_localization::ColaRequestEngine> m_cola_event_engine; ///< request engine with event subscriptions sent, i.e. the connection receiving event telegrams
+    bool m_cola_events_subscribed;           ///< true: LocState and LocResultState subscribed on m_cola_event_engine, false: event registration failed or not yet done
+    ros::Time m_cola_event_retry;            ///< time to retry a failed event registration on m_cola_event_engine
+    boost::mutex m_controller_state_mutex;   ///< protects m_controller_state, m_cola_event_engine, m_cola_events_subscribed and m_cola_event_retry
+    sick_lidar_localization::SickLocControllerStateMsg m_controller_state; ///< current state of the localization controller (LocState, LocResultState, LocMapState)
+    ros::Publisher m_controller_state_publisher; ///< ros publisher for the controller state (type SickLocControllerStateMsg)
+    double m_cola_liveness_interval;         ///< interval in seconds to check the cola connection by "sRN LocState" while the controller state is subscribed by events, default: 10 (0: disabled)
+    ros::Time m_cola_liveness_check;         ///< time of the last liveness check or event subscription (monitoring thread only)
   
   }; // class DriverMonitor
   
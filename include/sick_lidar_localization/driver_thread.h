@@ -69,6 +69,11 @@
 
 #include "sick_lidar_localization/client_socket.h"
 #include "sick_lidar_localization/fifo_buffer.h"
+#include "sick_lidar_localization/monotonic_clock.h"
+#include "sick_lidar_localization/seqlock.h"
+#include "sick_lidar_localization/tick_unwrapper.h"
+#include "sick_lidar_localization/time_sync_model.h"
+#include "sick_lidar_localization/SickLocTimeSyncModelMsg.h"
 
 namespace sick_lidar_localization
 {
@@ -127,6 +132,14 @@ namespace sick_lidar_localization
      * @return true if driver thread is running, false otherwise.
      */
     virtual bool isRunning(void);
+  
+    /*!
+     * Callback for software pll model messages (SickLocTimeSyncModelMsg) from sim_loc_time_sync.
+     * The software pll model is shared with the converter thread, which calculates the system time
+     * of vehicle poses from lidar ticks without calling ros service "SickLocTimeSync".
+     * @param[in] msg software pll model (SickLocTimeSyncModelMsg)
+     */
+    virtual void messageCbTimeSyncModel(const sick_lidar_localization::SickLocTimeSyncModelMsg & msg);
 
   protected:
   
@@ -154,6 +167,19 @@ namespace sick_lidar_localization
      */
     virtual void runConverterThreadCb(void);
   
+    /*!
+     * class ReceivedTelegram contains a binary result port telegram and the system time when it has been received.
+     * The receive timestamp is published in the header of SickLocResultPortTelegramMsg and can be used by
+     * sim_loc_time_sync to estimate the system time from lidar ticks by telegram arrivals (time_sync_estimator "fusion").
+     */
+    class ReceivedTelegram
+    {
+    public:
+      ReceivedTelegram(const std::vector<uint8_t> & _data = std::vector<uint8_t>(), const ros::Time & _receive_time = ros::Time(0)) : data(_data), receive_time(_receive_time) {} ///< Constructor
+      std::vector<uint8_t> data; ///< binary result port telegram
+      ros::Time receive_time;    ///< system time when the telegram has been received
+    };
+  
     /*
      * member data
      */
@@ -169,11 +195,13 @@ namespace sick_lidar_localization
     bool m_tcp_receiver_thread_running;                     ///< true: m_tcp_receiver_thread is running, otherwise false
     boost::thread* m_converter_thread;                      ///< thread to convert and publish localization data
     bool m_converter_thread_running;                        ///< true: m_converter_thread is running, otherwise false
-    sick_lidar_localization::FifoBuffer<std::vector<uint8_t>, boost::mutex> m_fifo_buffer; ///< fifo buffer to transfer data from receiver thread to converter thread
+    sick_lidar_localization::FifoBuffer<ReceivedTelegram, boost::mutex> m_fifo_buffer; ///< fifo buffer to transfer received telegrams from receiver thread to converter thread
     ros::Publisher m_result_telegrams_publisher;            ///< ros publisher for result port telegram messages (type SickLocResultPortTelegramMsg)
     std::string m_result_telegrams_frame_id;                ///< ros frame id of result port telegram messages (type SickLocResultPortTelegramMsg), default: "sick_lidar_localization"
-    ros::ServiceClient m_timesync_service_client;           ///< client to call ros service "SickLocTimeSync" to calculate system time from ticks by software pll
+    ros::Subscriber m_time_sync_model_subscriber;           ///< ros subscriber for software pll model messages (type SickLocTimeSyncModelMsg) published by sim_loc_time_sync
+    sick_lidar_localization::SeqLock<sick_lidar_localization::TimeSyncModel> m_time_sync_model; ///< software pll model to calculate system time from ticks, written by messageCbTimeSyncModel, read lock-free by the converter thread
     double m_software_pll_expected_initialization_duration; ///< expected initialization time for software pll (system time from lidar ticks not yet available)
+    sick_lidar_localization::TickUnwrapper m_tick_unwrapper; ///< extends the 32 bit lidar ticks of result telegrams to 64 bit, used by the converter thread only
   
     /*
      * configuration and member data for diagnostic messages
@@ -0,0 +1,179 @@
+/*
+ * @brief monotonic_clock provides the monotonic system clock (CLOCK_MONOTONIC) and a mapping between
+ * monotonic time and ros time, to run the software pll immune to steps of the system clock.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#ifndef __SIM_LOC_MONOTONIC_CLOCK_H_INCLUDED
+#define __SIM_LOC_MONOTONIC_CLOCK_H_INCLUDED
+
+#include <atomic>
+#include <math.h>
+#include <time.h>
+
+#include "sick_lidar_localization/time_sync_model.h"
+
+namespace sick_lidar_localization
+{
+  /*!
+   * class MonotonicClock returns the monotonic system time (CLOCK_MONOTONIC), which is never stepped by
+   * NTP or chrony. CLOCK_MONOTONIC is slewed with the same frequency correction as the system clock, i.e.
+   * the offset between system time and monotonic time is constant except for clock steps.
+   */
+  class MonotonicClock
+  {
+  public:
+    
+    /*!
+     * Returns the monotonic system time in seconds.
+     */
+    static double now(void)
+    {
+      struct timespec monotonic_time;
+      clock_gettime(CLOCK_MONOTONIC, &monotonic_time);
+      return monotonic_time.tv_sec + 1.0e-9 * monotonic_time.tv_nsec;
+    }
+  };
+  
+  /*!
+   * class ClockMapping tracks the offset between system time (ros time) and monotonic time. The software pll
+   * estimates monotonic time from lidar ticks, system timestamps are mapped to monotonic time at input and
+   * monotonic time is mapped to system time at output. A step of the system clock changes the offset only,
+   * but not the model of the software pll. If disabled, the mapping is the identity (software pll runs on
+   * system time). ClockMapping is thread-safe, i.e. updated by one thread and evaluated by others.
+   */
+  class ClockMapping
+  {
+  public:
+    
+    /*!
+     * Constructor
+     * @param[in] enabled true: map system time to monotonic time, false: identity mapping
+     */
+    ClockMapping(bool enabled = true) : m_enabled(enabled), m_initialized(false), m_offset(0) {}
+  
+    /*!
+     * Copy constructor
+     */
+    ClockMapping(const ClockMapping & mapping) : m_enabled(mapping.m_enabled), m_initialized(mapping.m_initialized.load()), m_offset(mapping.m_offset.load()) {}
+  
+    /*!
+     * Assignment operator
+     */
+    ClockMapping & operator=(const ClockMapping & mapping)
+    {
+      m_enabled = mapping.m_enabled;
+      m_initialized = mapping.m_initialized.load();
+      m_offset = mapping.m_offset.load();
+      return *this;
+    }
+    
+    /*!
+     * Updates the offset with system time and monotonic time sampled at the same time.
+     * @param[in] system_time current system time in seconds
+     * @param[in] monotonic_time current monotonic time in seconds
+     * @param[in] max_step offset changes greater than max_step seconds are reported as clock step
+     * @return true if the system clock has been stepped, false otherwise
+     */
+    bool update(double system_time, double monotonic_time, double max_step = 0.01)
+    {
+      if(!m_enabled)
+        return false;
+      double offset = system_time - monotonic_time;
+      double last_offset = m_offset.exchange(offset);
+      return m_initialized.exchange(true) && fabs(offset - last_offset) > max_step;
+    }
+  
+    /*!
+     * Returns the current offset in seconds between system time and monotonic time (0 if disabled).
+     */
+    double offset(void) const { return m_enabled ? m_offset.load() : 0; }
+  
+    /*!
+     * Maps system time to monotonic time.
+     * @param[in] system_time system time in seconds
+     * @return monotonic time in seconds (or system_time if disabled)
+     */
+    double toMonotonic(double system_time) const { return system_time - offset(); }
+  
+    /*!
+     * Maps monotonic time to system time.
+     * @param[in] monotonic_time monotonic time in seconds
+     * @return system time in seconds (or monotonic_time if disabled)
+     */
+    double toSystemTime(double monotonic_time) const { return monotonic_time + offset(); }
+  
+    /*!
+     * Maps a model estimating monotonic time from ticks to a model estimating system time from ticks.
+     * @param[in] monotonic_model model estimating monotonic time from ticks
+     * @return model estimating system time from ticks
+     */
+    TimeSyncModel toSystemTime(const TimeSyncModel & monotonic_model) const
+    {
+      return TimeSyncModel(monotonic_model.valid, monotonic_model.reference_tick, toSystemTime(monotonic_model.reference_time), monotonic_model.slope);
+    }
+  
+    /*!
+     * Returns true if the mapping is enabled, i.e. the software pll runs on monotonic time.
+     */
+    bool enabled(void) const { return m_enabled; }
+  
+  protected:
+  
+    bool m_enabled;                  ///< true: map system time to monotonic time, false: identity mapping
+    std::atomic<bool> m_initialized; ///< true after first update
+    std::atomic<double> m_offset;    ///< offset between system time and monotonic time in seconds
+  
+  }; // class ClockMapping
+  
+} // namespace sick_lidar_localization
+#endif // __SIM_LOC_MONOTONIC_CLOCK_H_INCLUDED
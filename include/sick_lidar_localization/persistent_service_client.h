@@ -0,0 +1,234 @@
+/*
+ * @brief sim_loc_persistent_service_client implements persistent and auto-reconnecting ros service clients with call statistics.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#ifndef __SIM_LOC_PERSISTENT_SERVICE_CLIENT_H_INCLUDED
+#define __SIM_LOC_PERSISTENT_SERVICE_CLIENT_H_INCLUDED
+
+#include <ros/ros.h>
+#include <boost/thread.hpp>
+#include <float.h>
+#include <sstream>
+#include <string>
+
+namespace sick_lidar_localization
+{
+  /*!
+   * class ServiceCallStatistics counts ros service calls and measures their latency.
+   */
+  class ServiceCallStatistics
+  {
+  public:
+  
+    /*! Constructor */
+    ServiceCallStatistics() : calls(0), failures(0), reconnects(0), latency_last(0), latency_min(0), latency_max(0), latency_sum(0) {}
+  
+    /*!
+     * Updates the statistics after a service call.
+     * @param[in] success true: service call successfull, false: service call failed
+     * @param[in] latency duration of the service call in seconds
+     */
+    void update(bool success, double latency)
+    {
+      if(!success)
+        failures++;
+      latency_last = latency;
+      latency_min = ((calls > 0) ? std::min(latency_min, latency) : latency);
+      latency_max = ((calls > 0) ? std::max(latency_max, latency) : latency);
+      latency_sum += latency;
+      calls++;
+    }
+  
+    /*! Returns the mean latency of all service calls in seconds */
+    double latencyMean(void) const { return ((calls > 0) ? (latency_sum / calls) : 0); }
+  
+    /*! Returns the statistics in a readable format, f.e. for logging */
+    std::string toString(void) const
+    {
+      std::stringstream s;
+      s << calls << " calls, " << failures << " failures, " << reconnects << " reconnects, latency [ms]: last " << (1000 * latency_last)
+        << ", min " << (1000 * latency_min) << ", max " << (1000 * latency_max) << ", mean " << (1000 * latencyMean());
+      return s.str();
+    }
+  
+    size_t calls;        ///< number of service calls
+    size_t failures;     ///< number of failed service calls
+    size_t reconnects;   ///< number of reconnects (service client re-resolved after a connection dropped)
+    double latency_last; ///< latency of the last service call in seconds
+    double latency_min;  ///< min. latency of all service calls in seconds
+    double latency_max;  ///< max. latency of all service calls in seconds
+    double latency_sum;  ///< sum of latencies of all service calls in seconds
+  };
+  
+  /*!
+   * class PersistentServiceClient wraps a persistent ros::ServiceClient, which keeps its connection to the
+   * service provider open. The master lookup and the tcp handshake are done once, not for each service call.
+   * If the connection drops (f.e. the service provider has been restarted), the service is re-resolved and
+   * the call is repeated once with the new connection. PersistentServiceClient counts all service calls and
+   * measures their latency, see statistics().
+   */
+  template<typename ServiceType> class PersistentServiceClient
+  {
+  public:
+  
+    /*!
+     * Constructor
+     * @param[in] nh ros node handle
+     * @param[in] service_name name of the ros service, f.e. "SickLocColaTelegram"
+     */
+    PersistentServiceClient(ros::NodeHandle* nh = 0, const std::string & service_name = "") : m_nh(nh), m_service_name(service_name), m_client_generation(0), m_client_connected(false)
+    {
+      if(m_nh)
+        m_service_client = m_nh->serviceClient<ServiceType>(m_service_name, true);
+    }
+  
+    /*!
+     * Destructor, prints the service call statistics
+     */
+    ~PersistentServiceClient()
+    {
+      if(m_nh && m_statistics.calls > 0)
+        ROS_INFO_STREAM("PersistentServiceClient \"" << m_service_name << "\": " << m_statistics.toString());
+    }
+  
+    /*!
+     * Calls the ros service. If the persistent connection has been dropped, the service is re-resolved
+     * and the call is repeated once.
+     * @param[in,out] service_telegram service request and response
+     * @return true on success, false in case of errors (service not available or service call failed)
+     */
+    bool call(ServiceType & service_telegram)
+    {
+      if(!m_nh)
+        return false;
+      ros::WallTime start_time = ros::WallTime::now();
+      size_t client_generation = 0;
+      ros::ServiceClient service_client = getServiceClient(client_generation);
+      bool success = service_client.call(service_telegram);
+      if(!success && !service_client.isValid() && resetServiceClient(client_generation)) // connection dropped: re-resolve the service and retry once
+      {
+        ROS_WARN_STREAM("PersistentServiceClient: connection to ros service \"" << m_service_name << "\" lost, reconnecting");
+        service_client = getServiceClient(client_generation);
+        success = service_client.call(service_telegram);
+      }
+      boost::lock_guard<boost::mutex> client_lockguard(m_client_mutex);
+      if(success && client_generation == m_client_generation)
+        m_client_connected = true;
+      m_statistics.update(success, (ros::WallTime::now() - start_time).toSec());
+      return success;
+    }
+  
+    /*!
+     * Returns the name of the ros service
+     */
+    const std::string & serviceName(void) const { return m_service_name; }
+  
+    /*!
+     * Returns the statistics (number of calls, failures and reconnects, latency) of all service calls
+     */
+    ServiceCallStatistics statistics(void)
+    {
+      boost::lock_guard<boost::mutex> client_lockguard(m_client_mutex);
+      return m_statistics;
+    }
+
+  protected:
+  
+    /*!
+     * Returns the persistent service client. A new persistent client connects on its first call, i.e. it is
+     * not valid before. If the service is not available, the client tries again with the next call.
+     * @param[out] client_generation generation of the returned client, incremented by resetServiceClient()
+     * @return persistent service client
+     */
+    ros::ServiceClient getServiceClient(size_t & client_generation)
+    {
+      boost::lock_guard<boost::mutex> client_lockguard(m_client_mutex);
+      client_generation = m_client_generation;
+      return m_service_client;
+    }
+  
+    /*!
+     * Creates a new service client after the connection of a call failed. A reconnect is counted only if the
+     * current client had been connected before, i.e. failed calls while the service is not available are no reconnects.
+     * @param[in] client_generation generation of the client whose call failed
+     * @return true if the call should be repeated with a new client, false otherwise (client never connected)
+     */
+    bool resetServiceClient(size_t client_generation)
+    {
+      boost::lock_guard<boost::mutex> client_lockguard(m_client_mutex);
+      if(client_generation != m_client_generation)
+        return true; // client already replaced by a concurrent call
+      if(!m_client_connected)
+        return false; // service not yet available
+      m_service_client = m_nh->serviceClient<ServiceType>(m_service_name, true);
+      m_client_generation++;
+      m_client_connected = false;
+      m_statistics.reconnects++;
+      return true;
+    }
+  
+    /*
+     * member data
+     */
+    
+    ros::NodeHandle* m_nh;                ///< ros node handle
+    std::string m_service_name;           ///< name of the ros service, f.e. "SickLocColaTelegram"
+    ros::ServiceClient m_service_client;  ///< persistent ros service client
+    size_t m_client_generation;           ///< generation of m_service_client, incremented with each new client
+    bool m_client_connected;              ///< true if m_service_client has been connected successfully
+    ServiceCallStatistics m_statistics;   ///< number of calls, failures, reconnects and latency of all service calls
+    boost::mutex m_client_mutex;          ///< mutex to protect m_service_client, m_client_generation, m_client_connected and m_statistics
+  };
+  
+} // namespace sick_lidar_localization
+#endif // __SIM_LOC_PERSISTENT_SERVICE_CLIENT_H_INCLUDED
@@ -0,0 +1,152 @@
+/*
+ * @brief round_trip_filter implements an NTP-style filter for LocRequestTimestamp round trip times:
+ * only measurements within a margin of the minimum round trip time of recent measurements are used
+ * to update the software pll.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#ifndef __SIM_LOC_ROUND_TRIP_FILTER_H_INCLUDED
+#define __SIM_LOC_ROUND_TRIP_FILTER_H_INCLUDED
+
+#include <stdint.h>
+#include <vector>
+
+namespace sick_lidar_localization
+{
+  /*!
+   * class RoundTripFilter implements an NTP-style filter for round trip times of LocRequestTimestamp measurements.
+   * The system time of a measurement is the mean of send and receive time, which is biased if the request or the
+   * response has been delayed (f.e. queued behind other cola telegrams). Delayed measurements have a large round
+   * trip time. RoundTripFilter keeps the round trip times of the last window_size measurements and accepts a
+   * measurement only if its round trip time is
+   * - positive and not greater than max_round_trip_time (f.e. the cola response timeout), and
+   * - within margin seconds of the minimum round trip time in the window.
+   * Rejected measurements are kept in the window, i.e. the minimum adapts to a permanent change of the network
+   * latency after window_size measurements.
+   */
+  class RoundTripFilter
+  {
+  public:
+    
+    /*!
+     * Constructor
+     * @param[in] window_size number of recent measurements to determine the minimum round trip time, default: 16
+     * @param[in] margin max. difference in seconds between round trip time and minimum round trip time of accepted measurements, default: 0.002
+     * @param[in] max_round_trip_time max. round trip time in seconds, default: 1.0
+     */
+    RoundTripFilter(int window_size = 16, double margin = 0.002, double max_round_trip_time = 1.0);
+    
+    /*!
+     * Adds the round trip time of a measurement to the filter window and returns true, if the measurement is accepted.
+     * @param[in] round_trip_time round trip time in seconds (receive time - send time)
+     * @return true if the measurement is accepted, false if the measurement should not update the software pll
+     */
+    bool update(double round_trip_time);
+    
+    /*!
+     * Returns the round trip time of the last measurement in seconds.
+     */
+    double last(void) const { return m_last; }
+    
+    /*!
+     * Returns the minimum round trip time in seconds of the measurements in the filter window.
+     */
+    double minimum(void) const;
+  
+    /*!
+     * Returns the median round trip time in seconds of the measurements in the filter window.
+     */
+    double median(void) const;
+    
+    /*!
+     * Returns the p-quantile (0 <= p <= 1) of the round trip times in seconds of the measurements in the filter window.
+     * @param[in] p quantile, f.e. 0.99 for the 99th percentile
+     */
+    double percentile(double p) const;
+  
+    /*!
+     * Returns the standard deviation of round trip times in seconds of the measurements in the filter window.
+     */
+    double stddev(void) const;
+  
+    /*!
+     * Returns true if the last measurement has been accepted.
+     */
+    bool lastAccepted(void) const { return m_last_accepted; }
+  
+    /*!
+     * Returns the number of accepted measurements since start.
+     */
+    uint32_t acceptedCount(void) const { return m_accepted_cnt; }
+  
+    /*!
+     * Returns the number of rejected measurements since start.
+     */
+    uint32_t rejectedCount(void) const { return m_rejected_cnt; }
+  
+  protected:
+    
+    std::vector<double> m_window;         ///< ring buffer of the round trip times of recent measurements
+    int m_window_cnt;                     ///< number of measurements in the ring buffer
+    int m_window_head;                    ///< index of the next measurement in the ring buffer
+    double m_margin;                      ///< max. difference in seconds between round trip time and minimum round trip time of accepted measurements
+    double m_max_round_trip_time;         ///< max. round trip time in seconds
+    double m_last;                        ///< round trip time of the last measurement
+    bool m_last_accepted;                 ///< true if the last measurement has been accepted
+    uint32_t m_accepted_cnt;              ///< number of accepted measurements
+    uint32_t m_rejected_cnt;              ///< number of rejected measurements
+    mutable std::vector<double> m_workspace; ///< preallocated workspace for median and percentiles
+  
+  }; // class RoundTripFilter
+  
+} // namespace sick_lidar_localization
+#endif // __SIM_LOC_ROUND_TRIP_FILTER_H_INCLUDED
@@ -0,0 +1,123 @@
+/*
+ * @brief sim_loc_seqlock implements a sequence lock for lock-free reading of a shared value.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#ifndef __SIM_LOC_SEQLOCK_H_INCLUDED
+#define __SIM_LOC_SEQLOCK_H_INCLUDED
+
+#include <atomic>
+#include <stdint.h>
+#include <type_traits>
+#include <boost/thread.hpp>
+
+namespace sick_lidar_localization
+{
+  /*!
+   * class SeqLock implements a sequence lock ("seqlock") to share a small value between threads.
+   * Readers never block: get() copies the value and retries, if the value has been modified during the copy.
+   * Writers are serialized by a mutex and increment the sequence counter before and after modifying the value,
+   * i.e. an odd sequence counter indicates a write in progress.
+   * SeqLock is designed for values which are read frequently and written rarely (f.e. a software pll model
+   * read for every result telegram and updated every few seconds). ElementType must be trivially copyable.
+   */
+  template<typename ElementType> class SeqLock
+  {
+  public:
+  
+    static_assert(std::is_trivially_copyable<ElementType>::value, "SeqLock<ElementType> requires a trivially copyable ElementType");
+  
+    /*! Constructor with optional initialization of the value */
+    SeqLock(const ElementType & value = ElementType()) : m_sequence(0), m_value(value) {}
+  
+    /*! Sets the value threadsafe (writers are serialized, readers are not blocked) */
+    void set(const ElementType & value)
+    {
+      boost::lock_guard<boost::mutex> writer_lockguard(m_writer_mutex);
+      uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+      m_sequence.store(sequence + 1, std::memory_order_relaxed); // odd sequence: write in progress
+      std::atomic_thread_fence(std::memory_order_release);
+      m_value = value;
+      m_sequence.store(sequence + 2, std::memory_order_release); // even sequence: write completed
+    }
+  
+    /*! Returns the value threadsafe without locking (retries if the value has been modified while reading) */
+    ElementType get(void) const
+    {
+      ElementType value;
+      uint32_t sequence_before = 0, sequence_after = 0;
+      do
+      {
+        sequence_before = m_sequence.load(std::memory_order_acquire);
+        value = m_value;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        sequence_after = m_sequence.load(std::memory_order_relaxed);
+      } while((sequence_before & 1) != 0 || sequence_before != sequence_after);
+      return value;
+    }
+  
+    /*! Returns the current sequence counter, which is incremented by 2 with each call of set() */
+    uint32_t sequence(void) const
+    {
+      return m_sequence.load(std::memory_order_acquire);
+    }
+
+  protected:
+  
+    /** member variables */
+    std::atomic<uint32_t> m_sequence; ///< sequence counter, odd while a write is in progress
+    ElementType m_value;              ///< protected value
+    boost::mutex m_writer_mutex;      ///< mutex to serialize writers
+  };
+  
+} // namespace sick_lidar_localization
+#endif // __SIM_LOC_SEQLOCK_H_INCLUDED
@@ -101,6 +101,16 @@ namespace sick_lidar_localization
      */
     static sick_lidar_localization::SickLocColaTelegramMsg createColaResponse(const sick_lidar_localization::SickLocColaTelegramMsg & cola_request);
   
+    /*!
+     * Creates and returns a synthetical cola event telegram "sSN <variable_name> <value>" with the current value of a
+     * controller setting, f.e. "sSN LocState 2". Events are registered by "sEN <variable_name> 1" requests.
+     * @param[in] variable_name name of the controller setting, f.e. "LocState"
+     * @param[out] value current value of the controller setting
+     * @param[out] cola_event synthetical cola event telegram
+     * @return true on success, false if variable_name is not a controller setting
+     */
+    static bool createColaEvent(const std::string & variable_name, int32_t & value, sick_lidar_localization::SickLocColaTelegramMsg & cola_event);
+  
     /*!
      * Returns the result pose interval, i.e. the interval in number of scans
      * 1 (default): result with each processed scan
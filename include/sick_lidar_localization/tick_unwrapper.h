@@ -0,0 +1,138 @@
+/*
+ * @brief tick_unwrapper extends the 32 bit lidar ticks (milliseconds, overflow after 49.7 days)
+ * to a 64 bit tick counter, which is continued across 32 bit overflows.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#ifndef __SIM_LOC_TICK_UNWRAPPER_H_INCLUDED
+#define __SIM_LOC_TICK_UNWRAPPER_H_INCLUDED
+
+#include <math.h>
+#include <stdint.h>
+
+namespace sick_lidar_localization
+{
+  /*!
+   * class TickUnwrapper extends the 32 bit lidar ticks of result telegrams and LocRequestTimestamp responses
+   * (milliseconds, overflow after about 49.7 days) to a 64 bit tick counter. The 64 bit counter continues
+   * across 32 bit overflows, i.e. it increases monotonically as long as the localization controller is running.
+   * If the ticks are inconsistent with the elapsed time (f.e. after a restart of the localization controller),
+   * the counter restarts with the current ticks.
+   */
+  class TickUnwrapper
+  {
+  public:
+    
+    /*!
+     * Constructor
+     * @param[in] max_deviation max. deviation in seconds between elapsed ticks and elapsed time, default: 60 seconds
+     */
+    TickUnwrapper(double max_deviation = 60.0) : m_max_deviation(max_deviation), m_initialized(false), m_last_tick(0), m_last_time(0) {}
+    
+    /*!
+     * Returns the 64 bit tick counter following last_tick, i.e. the 64 bit tick closest to last_tick
+     * with the lower 32 bit equal to ticks. Ticks must be received at least once within 24.8 days.
+     * @param[in] last_tick last 64 bit tick
+     * @param[in] ticks current 32 bit lidar ticks
+     * @return current 64 bit tick
+     */
+    static uint64_t unwrap(uint64_t last_tick, uint32_t ticks)
+    {
+      return last_tick + (int64_t)(int32_t)(ticks - (uint32_t)(last_tick & 0xFFFFFFFF));
+    }
+    
+    /*!
+     * Extends the current 32 bit lidar ticks to the 64 bit tick counter.
+     * @param[in] ticks current 32 bit lidar ticks
+     * @param[in] monotonic_time current monotonic time in seconds, used to detect a restart of the localization controller
+     * @return current 64 bit tick
+     */
+    uint64_t update(uint32_t ticks, double monotonic_time)
+    {
+      if(m_initialized)
+      {
+        uint64_t tick = unwrap(m_last_tick, ticks);
+        double deviation = 0.001 * (double)(int64_t)(tick - m_last_tick) - (monotonic_time - m_last_time);
+        if(fabs(deviation) <= m_max_deviation)
+        {
+          m_last_tick = tick;
+          m_last_time = monotonic_time;
+          return m_last_tick;
+        }
+      }
+      m_initialized = true; // first ticks or restart of the localization controller: restart the 64 bit tick counter
+      m_last_tick = ticks;
+      m_last_time = monotonic_time;
+      return m_last_tick;
+    }
+    
+    /*!
+     * Returns the last 64 bit tick
+     */
+    uint64_t last(void) const { return m_last_tick; }
+    
+    /*!
+     * Resets the tick counter
+     */
+    void reset(void) { m_initialized = false; m_last_tick = 0; m_last_time = 0; }
+    
+  protected:
+    
+    double m_max_deviation; ///< max. deviation in seconds between elapsed ticks and elapsed time
+    bool m_initialized;     ///< true after first update
+    uint64_t m_last_tick;   ///< last 64 bit tick
+    double m_last_time;     ///< monotonic time of the last update
+    
+  }; // class TickUnwrapper
+  
+} // namespace sick_lidar_localization
+#endif // __SIM_LOC_TICK_UNWRAPPER_H_INCLUDED
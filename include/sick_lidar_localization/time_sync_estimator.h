@@ -0,0 +1,286 @@
+/*
+ * @brief sim_loc_time_sync_estimator implements estimators for the linear model between lidar ticks and system time.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#ifndef __SIM_LOC_TIME_SYNC_ESTIMATOR_H_INCLUDED
+#define __SIM_LOC_TIME_SYNC_ESTIMATOR_H_INCLUDED
+
+#include <math.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "sick_lidar_localization/time_sync_model.h"
+
+class SoftwarePLL;
+
+namespace sick_lidar_localization
+{
+  /*!
+   * class TimeSyncEstimatorConfig contains the configuration of time sync estimators.
+   */
+  class TimeSyncEstimatorConfig
+  {
+  public:
+  
+    /*! Constructor with default configuration */
+    TimeSyncEstimatorConfig() : estimator("software_pll"), fifo_length(7), max_time_deviation(0.1), max_divergence_count(20),
+      kalman_measurement_noise(0.005), kalman_drift_noise(1.0), fusion_window(30.0) {}
+  
+    std::string estimator;           ///< type of estimator: "software_pll" (default, least squares fit), "kalman" (two-state kalman filter), "theil_sen" (robust fit) or "fusion" (result telegram arrivals and LocRequestTimestamps)
+    int fifo_length;                 ///< number of measurements used by software_pll and theil_sen, default: 7
+    double max_time_deviation;       ///< max. allowed time difference in seconds between estimated and measured timestamp, default: 0.1
+    int max_divergence_count;        ///< estimator is reset after max_divergence_count consecutive measurements exceeding max_time_deviation, default: 20
+    double kalman_measurement_noise; ///< kalman filter: standard deviation of measured timestamps in seconds (network jitter), default: 0.005
+    double kalman_drift_noise;       ///< kalman filter: random walk of the clock drift in ppm per sqrt(second), default: 1.0 (tracks drift ramps f.e. by warm up)
+    double fusion_window;            ///< fusion estimator: time window in seconds of the lower envelope of result telegram arrivals, default: 30
+  };
+  
+  /*!
+   * class TimeSyncEstimator is the interface of estimators for the linear model between lidar ticks and system time.
+   * Estimators are updated with pairs of lidar ticks and system timestamps (f.e. by LocRequestTimestamp measurements)
+   * and return a TimeSyncModel to calculate system time from lidar ticks.
+   * Implementations:
+   * - SoftwarePllEstimator: least squares fit by SoftwarePLL (default)
+   * - KalmanEstimator: two-state (offset, drift) kalman filter
+   * - TheilSenEstimator: robust Theil-Sen fit (median of pairwise slopes)
+   * - FusionEstimator: lower envelope of result telegram arrivals, calibrated by LocRequestTimestamp measurements
+   */
+  class TimeSyncEstimator
+  {
+  public:
+  
+    /*! Destructor */
+    virtual ~TimeSyncEstimator() {}
+  
+    /*!
+     * Creates and returns a new estimator configured by config.estimator, or 0 in case of an unknown estimator type.
+     * @param[in] config estimator configuration
+     * @param[in] id identifier of the estimator (used for SoftwarePLL instances)
+     * @return new estimator (delete after use), or 0 in case of an invalid configuration
+     */
+    static TimeSyncEstimator* create(const TimeSyncEstimatorConfig & config, const std::string & id);
+  
+    /*!
+     * Updates the estimator with a new measurement.
+     * @param[in] system_time system timestamp in seconds
+     * @param[in] ticks lidar ticks in milliseconds
+     * @return true if the measurement has been accepted, false otherwise (duplicated ticks or outlier)
+     */
+    virtual bool update(double system_time, uint32_t ticks) = 0;
+  
+    /*!
+     * Updates the estimator with the arrival of a result telegram, i.e. the system time when the telegram was received
+     * and its lidar ticks (Payload.Timestamp). Arrival times are delayed by processing and transmission, therefore
+     * they are ignored by all estimators except FusionEstimator.
+     * @param[in] arrival_time system timestamp in seconds when the result telegram was received
+     * @param[in] ticks lidar ticks of the result telegram in milliseconds
+     * @return true if the arrival has been used, false otherwise
+     */
+    virtual bool updateArrival(double arrival_time, uint32_t ticks) { return false; }
+  
+    /*!
+     * Returns the current model to calculate system time from lidar ticks (invalid during initialization).
+     */
+    virtual TimeSyncModel model(void) const = 0;
+  
+    /*!
+     * Returns true, if the estimator is initialized, i.e. its model is valid.
+     */
+    virtual bool isInitialized(void) const { return model().valid; }
+  
+    /*!
+     * Returns the number of consecutive measurements rejected as outlier (0 if the estimator does not reject measurements).
+     */
+    virtual int divergenceCount(void) const { return 0; }
+  
+    /*!
+     * Returns the residual rms of the estimator in seconds, i.e. the rms of the differences between measured system times
+     * and the fitted model (0 if not available).
+     */
+    virtual double residualRms(void) const { return 0; }
+  
+    /*!
+     * Returns the type of the estimator ("software_pll", "kalman", "theil_sen" or "fusion").
+     */
+    virtual std::string type(void) const = 0;
+  };
+  
+  /*!
+   * class SoftwarePllEstimator implements the TimeSyncEstimator interface by a SoftwarePLL instance (least squares fit).
+   */
+  class SoftwarePllEstimator : public TimeSyncEstimator
+  {
+  public:
+    SoftwarePllEstimator(const TimeSyncEstimatorConfig & config, const std::string & id); ///< Constructor
+    virtual bool update(double system_time, uint32_t ticks);                               ///< Updates the SoftwarePLL
+    virtual TimeSyncModel model(void) const;                                               ///< Returns the SoftwarePLL model
+    virtual std::string type(void) const { return "software_pll"; }                        ///< Returns "software_pll"
+    virtual int divergenceCount(void) const;                                               ///< Returns the divergence counter of the SoftwarePLL
+    virtual double residualRms(void) const;                                                ///< Returns the residual standard deviation of the SoftwarePLL
+  protected:
+    SoftwarePLL & m_software_pll; ///< SoftwarePLL instance
+  };
+  
+  /*!
+   * class KalmanEstimator implements the TimeSyncEstimator interface by a two-state kalman filter.
+   * State is the system time at the last accepted tick (offset) and the system time per tick (drift).
+   * Measurements with an innovation exceeding max_time_deviation or 5 sigma are rejected. The filter
+   * is reset after max_divergence_count consecutive rejected measurements.
+   */
+  class KalmanEstimator : public TimeSyncEstimator
+  {
+  public:
+    KalmanEstimator(const TimeSyncEstimatorConfig & config); ///< Constructor
+    virtual bool update(double system_time, uint32_t ticks); ///< Kalman prediction and update
+    virtual TimeSyncModel model(void) const;                 ///< Returns the model by current filter state
+    virtual std::string type(void) const { return "kalman"; } ///< Returns "kalman"
+    virtual int divergenceCount(void) const { return m_divergence_cnt; } ///< Returns the number of consecutive rejected measurements
+    virtual double residualRms(void) const { return sqrt(m_innovation_sq); } ///< Returns the rms of innovations of accepted measurements
+  protected:
+    void reset(double system_time, uint32_t ticks);          ///< Resets the filter and initializes its state with a measurement
+    TimeSyncEstimatorConfig m_config; ///< estimator configuration
+    bool m_has_reference;             ///< true after the first measurement
+    uint64_t m_reference_tick;        ///< unwrapped tick of the first measurement
+    double m_reference_time;          ///< system time of the first measurement
+    uint64_t m_last_tick;             ///< unwrapped tick of the last accepted measurement
+    double m_time;                    ///< state: system time at m_last_tick relative to m_reference_time
+    double m_slope;                   ///< state: system time in seconds per tick
+    double m_covariance[2][2];        ///< state covariance
+    int m_accepted_cnt;               ///< number of accepted measurements since last reset
+    int m_divergence_cnt;             ///< number of consecutive rejected measurements
+    double m_innovation_sq;           ///< exponentially weighted mean of squared innovations of accepted measurements
+  };
+  
+  /*!
+   * class TheilSenEstimator implements the TimeSyncEstimator interface by a robust Theil-Sen fit over the last
+   * fifo_length measurements: slope is the median of all pairwise slopes, offset is the median of all residuals.
+   * Buffers are allocated once in the constructor.
+   */
+  class TheilSenEstimator : public TimeSyncEstimator
+  {
+  public:
+    TheilSenEstimator(const TimeSyncEstimatorConfig & config);   ///< Constructor
+    virtual bool update(double system_time, uint32_t ticks);     ///< Adds a measurement and updates the fit
+    virtual TimeSyncModel model(void) const { return m_model; }  ///< Returns the model by the last fit
+    virtual std::string type(void) const { return "theil_sen"; } ///< Returns "theil_sen"
+    virtual int divergenceCount(void) const { return m_divergence_cnt; } ///< Returns the number of consecutive rejected measurements
+    virtual double residualRms(void) const { return m_residual_rms; }    ///< Returns the residual rms of the last fit
+  protected:
+    void fit(void);                   ///< Fits slope and offset to all measurements in the fifo
+    TimeSyncEstimatorConfig m_config; ///< estimator configuration
+    std::vector<uint64_t> m_ticks;    ///< ring buffer of unwrapped ticks
+    std::vector<double> m_times;      ///< ring buffer of system timestamps relative to m_reference_time
+    std::vector<double> m_workspace;  ///< preallocated workspace for pairwise slopes and residuals
+    int m_fifo_cnt;                   ///< number of measurements in the fifo
+    int m_fifo_head;                  ///< index of the next measurement in the fifo
+    bool m_has_reference;             ///< true after the first measurement
+    uint64_t m_reference_tick;        ///< unwrapped tick of the first measurement
+    double m_reference_time;          ///< system time of the first measurement
+    uint64_t m_last_tick;             ///< unwrapped tick of the last measurement
+    int m_divergence_cnt;             ///< number of consecutive rejected measurements
+    double m_residual_rms;            ///< residual rms of the last fit
+    TimeSyncModel m_model;            ///< current model
+  };
+  
+  /*!
+   * class FusionEstimator implements the TimeSyncEstimator interface by fusion of result telegram arrivals and
+   * LocRequestTimestamp measurements. Result telegrams arrive with scan rate, but delayed by processing and
+   * transmission. The minimum arrival delay per second (lower envelope) is fitted by a line over the last
+   * fusion_window seconds, which provides the clock drift. The constant offset between envelope and lidar
+   * clock is calibrated by the median deviation of the last fifo_length LocRequestTimestamp measurements.
+   * Therefore the model becomes valid after the first LocRequestTimestamp, i.e. within about a second after
+   * start. Arrival times have a higher jitter than round trip filtered LocRequestTimestamps, therefore the estimator
+   * hands over to a least squares fit of the LocRequestTimestamps after fifo_length measurements. Without result
+   * telegrams, the estimator uses the least squares fit of the LocRequestTimestamps only.
+   */
+  class FusionEstimator : public TimeSyncEstimator
+  {
+  public:
+    FusionEstimator(const TimeSyncEstimatorConfig & config);         ///< Constructor
+    virtual bool update(double system_time, uint32_t ticks);         ///< Adds a LocRequestTimestamp measurement and updates the fit
+    virtual bool updateArrival(double arrival_time, uint32_t ticks); ///< Adds a result telegram arrival to the lower envelope and updates the fit
+    virtual TimeSyncModel model(void) const { return m_model; }      ///< Returns the model by the last fit
+    virtual std::string type(void) const { return "fusion"; }       ///< Returns "fusion"
+    virtual int divergenceCount(void) const { return m_divergence_cnt; } ///< Returns the number of consecutive rejected LocRequestTimestamp measurements
+    virtual double residualRms(void) const { return m_residual_rms; }    ///< Returns the residual rms of the LocRequestTimestamp measurements
+  protected:
+    void setReference(double system_time, uint32_t ticks); ///< Sets the reference tick and time on first measurement
+    void reset(void);                      ///< Clears envelope and measurements, maybe due to abrupt change of time base
+    void fit(void);                        ///< Fits the envelope and calibrates its offset by LocRequestTimestamp measurements
+    TimeSyncEstimatorConfig m_config;      ///< estimator configuration
+    bool m_has_reference;                  ///< true after the first measurement
+    uint64_t m_reference_tick;             ///< unwrapped tick of the first measurement
+    double m_reference_time;               ///< system time of the first measurement
+    uint64_t m_last_tick;                  ///< latest unwrapped tick of all measurements
+    std::vector<uint64_t> m_envelope_ticks; ///< ring buffer of unwrapped ticks of the earliest arrival per second
+    std::vector<double> m_envelope_times;  ///< ring buffer of the earliest arrival per second relative to m_reference_time
+    int m_envelope_cnt;                    ///< number of completed seconds in the envelope ring buffer
+    int m_envelope_head;                   ///< index of the next completed second in the envelope ring buffer
+    bool m_current_valid;                  ///< true if the current second contains at least one arrival
+    uint64_t m_current_start;              ///< unwrapped tick of the first arrival in the current second
+    uint64_t m_current_tick;               ///< unwrapped tick of the earliest arrival in the current second
+    double m_current_time;                 ///< earliest arrival in the current second relative to m_reference_time
+    std::vector<uint64_t> m_request_ticks; ///< ring buffer of unwrapped ticks of LocRequestTimestamp measurements
+    std::vector<double> m_request_times;   ///< ring buffer of LocRequestTimestamp system times relative to m_reference_time
+    int m_request_cnt;                     ///< number of measurements in the LocRequestTimestamp ring buffer
+    int m_request_head;                    ///< index of the next measurement in the LocRequestTimestamp ring buffer
+    std::vector<double> m_workspace;       ///< preallocated workspace for the offset calibration
+    double m_latency;                      ///< calibrated delay between lower envelope and LocRequestTimestamp measurements in seconds
+    int m_divergence_cnt;                  ///< number of consecutive rejected LocRequestTimestamp measurements
+    double m_residual_rms;                 ///< residual rms of the LocRequestTimestamp measurements of the last fit
+    TimeSyncModel m_model;                 ///< current model
+  };
+  
+} // namespace sick_lidar_localization
+#endif // __SIM_LOC_TIME_SYNC_ESTIMATOR_H_INCLUDED
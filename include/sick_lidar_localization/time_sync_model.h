@@ -0,0 +1,145 @@
+/*
+ * @brief sim_loc_time_sync_model implements the linear model of the software pll to calculate system time from lidar ticks.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#ifndef __SIM_LOC_TIME_SYNC_MODEL_H_INCLUDED
+#define __SIM_LOC_TIME_SYNC_MODEL_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace sick_lidar_localization
+{
+  /*!
+   * class TimeSyncModel is the linear model estimated by the software pll:
+   * system_time(ticks) = reference_time + (ticks - reference_tick) * slope
+   * TimeSyncModel is a trivially copyable value, which can be shared between threads by a SeqLock
+   * and evaluated locally, i.e. without calling ros service "SickLocTimeSync".
+   */
+  class TimeSyncModel
+  {
+  public:
+  
+    /*! Constructor */
+    TimeSyncModel(bool _valid = false, uint32_t _reference_tick = 0, double _reference_time = 0, double _slope = 0)
+    : valid(_valid), reference_tick(_reference_tick), reference_time(_reference_time), slope(_slope) {}
+  
+    /*!
+     * Calculates the system time from lidar ticks.
+     * @param[in] ticks lidar ticks in milliseconds
+     * @param[out] sec seconds part of the system time
+     * @param[out] nsec nano seconds part of the system time
+     * @return true on success, false if the model is not valid (software pll still initializing)
+     */
+    bool tickToTime(uint32_t ticks, uint32_t & sec, uint32_t & nsec) const
+    {
+      if(!valid)
+        return false;
+      int32_t delta_ticks = (int32_t)(ticks - reference_tick); // tick difference, robust against 32 bit overflow of lidar ticks
+      double system_time = reference_time + delta_ticks * slope;
+      sec = (uint32_t)system_time;
+      nsec = (uint32_t)(1.0e9 * (system_time - sec));
+      return true;
+    }
+  
+    /*!
+     * Calculates the system times of an array of lidar ticks. The loop has no branches and no function calls,
+     * i.e. it can be vectorized by the compiler. Use this function to convert many ticks at once, f.e. to
+     * reprocess a recorded log.
+     * @param[in] ticks array of lidar ticks in milliseconds
+     * @param[in] count number of elements in ticks, sec and nsec
+     * @param[out] sec seconds part of the system times
+     * @param[out] nsec nano seconds part of the system times
+     * @return true on success, false if the model is not valid (software pll still initializing)
+     */
+    bool ticksToTimes(const uint32_t* ticks, size_t count, uint32_t* sec, uint32_t* nsec) const
+    {
+      if(!valid)
+        return false;
+      const uint32_t tick0 = reference_tick;
+      const double time0 = reference_time, dt = slope;
+      for(size_t n = 0; n < count; n++)
+      {
+        double system_time = time0 + (int32_t)(ticks[n] - tick0) * dt; // tick difference, robust against 32 bit overflow of lidar ticks
+        uint32_t system_sec = (uint32_t)system_time;
+        sec[n] = system_sec;
+        nsec[n] = (uint32_t)(1.0e9 * (system_time - system_sec));
+      }
+      return true;
+    }
+  
+    /*!
+     * Combines two models by their mean, i.e. the returned model calculates the mean of the system times
+     * estimated by model1 and model2 (f.e. the mean of the estimated send and receive time).
+     * @param[in] model1 first model
+     * @param[in] model2 second model
+     * @return mean of model1 and model2, invalid if model1 or model2 is invalid
+     */
+    static TimeSyncModel mean(const TimeSyncModel & model1, const TimeSyncModel & model2)
+    {
+      if(!model1.valid || !model2.valid)
+        return TimeSyncModel();
+      // system_time(ticks) = 0.5 * (time1 + (ticks - tick1) * slope1 + time2 + (ticks - tick2) * slope2)
+      //                    = reference_time + (ticks - tick1) * 0.5 * (slope1 + slope2)
+      double reference_time = 0.5 * (model1.reference_time + model2.reference_time + (int32_t)(model1.reference_tick - model2.reference_tick) * model2.slope);
+      return TimeSyncModel(true, model1.reference_tick, reference_time, 0.5 * (model1.slope + model2.slope));
+    }
+  
+    bool valid;              ///< true: model is valid, false: software pll still initializing
+    uint32_t reference_tick; ///< reference lidar tick in milliseconds
+    double reference_time;   ///< system time in seconds at reference_tick
+    double slope;            ///< system time in seconds per lidar tick (i.e. about 0.001)
+  };
+  
+} // namespace sick_lidar_localization
+#endif // __SIM_LOC_TIME_SYNC_MODEL_H_INCLUDED
@@ -0,0 +1,141 @@
+/*
+ * @brief time_sync_scheduler adapts the rate of LocRequestTimestamp requests to the quality of
+ * the time synchronization: requests are sent faster when residuals, round trip time jitter or divergence
+ * counts rise, and slower down to a configurable minimum rate while the software pll is stable.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#ifndef __SIM_LOC_TIME_SYNC_SCHEDULER_H_INCLUDED
+#define __SIM_LOC_TIME_SYNC_SCHEDULER_H_INCLUDED
+
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace sick_lidar_localization
+{
+  /*!
+   * class TimeSyncScheduler adapts the rate of LocRequestTimestamp requests to the quality of the time
+   * synchronization. The interval between two requests is
+   * - 1/max_rate during the initial phase (initial_length measurements), while the software pll is not
+   *   initialized, after divergent measurements (f.e. after a reconnect or an abrupt change of time base) and
+   *   after a failed request (f.e. timeout or lost connection),
+   * - halved if the residual rms or the round trip time jitter exceed residual_tolerance,
+   * - increased by 50% up to 1/min_rate if residual rms and round trip time jitter are below residual_tolerance/2.
+   * Residual rms, round trip time mean and jitter are exponentially weighted averages over the last measurements.
+   * If adaptive scheduling is disabled, the interval is 1/max_rate during the initial phase and 1/rate otherwise.
+   */
+  class TimeSyncScheduler
+  {
+  public:
+    
+    /*!
+     * Constructor
+     * @param[in] adaptive true: adaptive scheduling, false: constant rate after initial phase
+     * @param[in] rate rate of LocRequestTimestamp requests after the initial phase (not adaptive), default: 0.1
+     * @param[in] min_rate minimum rate of LocRequestTimestamp requests (adaptive scheduling), default: 0.05
+     * @param[in] max_rate rate of LocRequestTimestamp requests during initial phase and after divergence, default: 1.0
+     * @param[in] initial_length number of measurements with max_rate after start, default: 10
+     * @param[in] residual_tolerance tolerated residual rms and round trip time jitter in seconds, default: 0.005
+     */
+    TimeSyncScheduler(bool adaptive = true, double rate = 0.1, double min_rate = 0.05, double max_rate = 1.0, int initial_length = 10, double residual_tolerance = 0.005);
+    
+    /*!
+     * Updates the scheduler with a LocRequestTimestamp measurement.
+     * @param[in] initialized true if the software pll is initialized
+     * @param[in] residual difference in seconds between measured and estimated system time before updating the software pll (0 if not initialized)
+     * @param[in] round_trip_time round trip time of the LocRequestTimestamp request in seconds
+     * @param[in] divergence_cnt number of consecutive measurements rejected by the software pll
+     * @param[in] accepted false if the measurement has been rejected by its round trip time (residual not evaluated)
+     */
+    void update(bool initialized, double residual, double round_trip_time, int divergence_cnt, bool accepted = true);
+    
+    /*!
+     * Updates the scheduler with a failed LocRequestTimestamp request (f.e. timeout or lost connection).
+     * The next request is scheduled after the minimum interval (1/max_rate), like after divergent measurements.
+     */
+    void updateFailed(void);
+    
+    /*!
+     * Returns the interval in seconds until the next LocRequestTimestamp request.
+     */
+    double interval(void);
+    
+    /*!
+     * Returns the exponentially weighted residual rms in seconds.
+     */
+    double residualRms(void);
+  
+    /*!
+     * Returns the exponentially weighted round trip time jitter (standard deviation) in seconds.
+     */
+    double roundTripJitter(void);
+  
+  protected:
+    
+    bool m_adaptive;             ///< true: adaptive scheduling, false: constant rate after initial phase
+    double m_min_interval;       ///< interval during initial phase and after divergence (1/max_rate)
+    double m_max_interval;       ///< max. interval if adaptive (1/min_rate)
+    double m_default_interval;   ///< interval after initial phase if not adaptive (1/rate)
+    int m_initial_length;        ///< number of measurements with max. rate after start
+    double m_residual_tolerance; ///< tolerated residual rms and round trip time jitter in seconds
+    int m_measurement_cnt;       ///< number of measurements since start
+    int m_quality_cnt;           ///< number of measurements in the weighted averages
+    double m_residual_sq;        ///< exponentially weighted mean of squared residuals
+    double m_rtt_mean;           ///< exponentially weighted mean of round trip times
+    double m_rtt_var;            ///< exponentially weighted variance of round trip times
+    double m_interval;           ///< current interval until the next request
+    boost::mutex m_scheduler_mutex; ///< mutex to protect scheduler data, updated by service callback and read by time sync thread
+  
+  }; // class TimeSyncScheduler
+  
+} // namespace sick_lidar_localization
+#endif // __SIM_LOC_TIME_SYNC_SCHEDULER_H_INCLUDED
@@ -22,7 +22,7 @@
  * time_sync_service implements a time synchronization thread, running a software pll
  * to estimate system time from lidar timestamp ticks. This synchronization thread can
  * be started by function start() and stopped by function stop(). When running the
- * synchronization thread, ros services "SickLocRequestTimestamp" is called each 10 seconds.
+ * synchronization thread, LocRequestTimestamp is sent each 10 seconds.
  * The software pll is then updated to estimate the system time from lidar timestamp ticks.
  * The system timestamp of a vehicle pose can be queried using ros service
  * "SickLocTimeSync".
@@ -85,6 +85,18 @@
 #ifndef __SIM_LOC_TIME_SYNC_SERVICE_H_INCLUDED
 #define __SIM_LOC_TIME_SYNC_SERVICE_H_INCLUDED
 
+#include "sick_lidar_localization/cola_broker_client.h"
+#include "sick_lidar_localization/monotonic_clock.h"
+#include "sick_lidar_localization/persistent_service_client.h"
+#include "sick_lidar_localization/round_trip_filter.h"
+#include "sick_lidar_localization/seqlock.h"
+#include "sick_lidar_localization/SickLocTimeSyncModelMsg.h"
+#include "sick_lidar_localization/SickLocTimeSyncQualityMsg.h"
+#include "sick_lidar_localization/SickLocTimeSyncRttMsg.h"
+#include "sick_lidar_localization/time_sync_estimator.h"
+#include "sick_lidar_localization/time_sync_model.h"
+#include "sick_lidar_localization/time_sync_scheduler.h"
+#include "sick_lidar_localization/time_sync_state.h"
 #include "sick_lidar_localization/utils.h"
 
 namespace sick_lidar_localization
@@ -113,7 +125,7 @@ namespace sick_lidar_localization
      * Class TimeSyncService implements a time synchronization thread, running a software pll
      * to estimate system time from lidar timestamp ticks. This synchronization thread can
      * be started by function start() and stopped by function stop(). When running the
-     * synchronization thread, ros services "SickLocRequestTimestamp" is called each 10 seconds.
+     * synchronization thread, LocRequestTimestamp is sent each 10 seconds.
      * The software pll is then updated to estimate the system time from lidar timestamp ticks.
      * The system timestamp of a vehicle pose can be queried using ros service
      * "SickLocTimeSync".
@@ -151,39 +163,154 @@ namespace sick_lidar_localization
     virtual bool serviceCbTimeSync(sick_lidar_localization::SickLocTimeSyncSrv::Request & time_sync_request, sick_lidar_localization::SickLocTimeSyncSrv::Response & time_sync_response);
   
     /*!
-     * Thread callback, runs time synchronization, calls ros service "SickLocRequestTimestamp" each 10 seconds
-     * and updates the software pll.
+     * Callback for service messages (SickLocTimeSyncBatch). Calculates the system times of an array of lidar ticks
+     * by one service call, using the same software pll model as service SickLocTimeSync. Returns the model
+     * parameters used for the conversion, too.
+     * @param[in] time_sync_request ros service request (input: array of lidar ticks)
+     * @param[out] time_sync_response service response  (output: system times from ticks and software pll model)
+     * @return true on success, false in case of errors (software pll still in initialization phase).
+     */
+    virtual bool serviceCbTimeSyncBatch(sick_lidar_localization::SickLocTimeSyncBatchSrv::Request & time_sync_request, sick_lidar_localization::SickLocTimeSyncBatchSrv::Response & time_sync_response);
+  
+    /*!
+     * Thread callback, runs time synchronization, sends LocRequestTimestamp by serviceCbRequestTimestamp and updates the
+     * software pll. The interval between two requests is adapted by TimeSyncScheduler: requests are sent every
+     * second during the initial phase, after a failed request and when the software pll degrades, and every 20 seconds
+     * (time_sync_min_rate) while the software pll is stable.
      */
     virtual void runTimeSyncThreadCb(void);
+  
+    /*!
+     * Callback for result port telegrams (SickLocResultPortTelegramMsg) published by sim_loc_driver.
+     * Updates the software pll estimators with the telegram arrival (receive timestamp in the message header
+     * and lidar ticks of the pose). Telegram arrivals are used by time_sync_estimator "fusion" only.
+     * The serial number of the localization controller is saved with the time sync state.
+     * @param[in] msg result port telegram
+     */
+    virtual void messageCbResultPortTelegrams(const sick_lidar_localization::SickLocResultPortTelegramMsg & msg);
     
   protected:
 
     /*!
      * Update the software pll with lidar ticks and system time from response by "SickLocRequestTimestamp" servcice
+     * and updates the scheduler of LocRequestTimestamp requests with residual, round trip time and divergence.
+     * Measurements with a round trip time exceeding the minimum round trip time of recent measurements by more than
+     * time_sync_rtt_margin are rejected by the round trip filter and do not update the software pll.
      * @param[out] service_response service response by "SickLocRequestTimestamp" servcice
      */
     void updateSoftwarePll(sick_lidar_localization::SickLocRequestTimestampSrv::Response & service_response);
 
+    /*!
+     * Publishes the current model of the software pll estimators to m_model_snapshot.
+     * Called with m_software_pll_mutex locked after each update of the estimators.
+     */
+    void updateModelSnapshot(void);
+
     /*!
      * Returns true, if the initialization phase of the software pll is completed, otherwise false.
+     * Lock-free, reads the snapshot of the software pll model.
      * @return initialization phase of the software pll completed
      */
     bool isSoftwarePllInitialized(void);
+
+    /*!
+     * Returns the linear model of the software pll to calculate system time from lidar ticks.
+     * The model combines the software plls for send and receive timestamps, i.e. system time
+     * from ticks is the mean of the estimated send and receive time. The software pll runs on
+     * monotonic time, the returned model is mapped to system time by the current clock offset.
+     * Lock-free, reads the snapshot of the software pll model.
+     * @return software pll model (invalid during initialization phase of the software pll)
+     */
+    sick_lidar_localization::TimeSyncModel getSoftwarePllModel(void);
+  
+    /*!
+     * Updates the mapping between system time and monotonic time. If the system clock has been stepped
+     * (f.e. by NTP or chrony), the software pll model is not affected, but the published model is updated.
+     * @return true if the system clock has been stepped, false otherwise
+     */
+    bool updateClockMapping(void);
+
+    /*!
+     * Publishes the current software pll model (message type SickLocTimeSyncModelMsg).
+     * The model is evaluated by sim_loc_driver to calculate system time from lidar ticks
+     * without calling ros service "SickLocTimeSync". Called by the time sync thread and the
+     * ros spin thread (time_sync_estimator "fusion"), serialized by m_publish_mutex.
+     */
+    void publishSoftwarePllModel(void);
+  
+    /*!
+     * Returns true, if the published software pll model is outdated, i.e. its state (valid or invalid) or the
+     * clock offset changed since the last publication, or it has been published more than max_age seconds ago.
+     * @param[in] max_age max. age of the published model in seconds (0: ignore age)
+     * @return true if the model should be published again, false otherwise
+     */
+    bool publishedSoftwarePllModelOutdated(double max_age);
+  
+    /*!
+     * Validates the saved state against a new measurement and replays the saved measurements to the
+     * software pll, if the localization controller is still running (warm start). Otherwise the saved state
+     * is discarded (cold start). The warm start is deferred until the serial number of the localization
+     * controller has been received by result telegrams, max. software_pll_fifo_length measurements. Measurements
+     * received while the warm start is deferred are replayed after the saved measurements. Called with
+     * m_software_pll_mutex locked.
+     * @param[in] sample new LocRequestTimestamp measurement
+     * @return true if the saved state has been validated or discarded, false if the warm start is deferred
+     */
+    bool warmStart(const sick_lidar_localization::TimeSyncSample & sample);
+  
+    /*!
+     * Saves the current state (serial number, software pll model and recent measurements) to file time_sync_state_file.
+     * The software pll runs on monotonic time, the saved state is mapped to system time. Concurrent calls are
+     * serialized by m_state_file_mutex, i.e. the temporary state file is written by one thread at a time.
+     */
+    void saveState(void);
+  
+    /*!
+     * Publishes the round trip time statistics of LocRequestTimestamp measurements (message type SickLocTimeSyncRttMsg).
+     */
+    void publishRoundTripStatistics(void);
+  
+    /*!
+     * Publishes the quality of the time synchronization (message type SickLocTimeSyncQualityMsg):
+     * offset, drift, residuals, round trip times, acceptance ratio, divergence and initialization state.
+     */
+    void publishQuality(void);
     
     ros::ServiceServer m_timestamp_service_server; ///< provides ros service "SickLocRequestTimestamp" to send a LocRequestTimestamp, receive the response and to calculate the time offset
     ros::ServiceServer m_timesync_service_server;  ///< provides ros service "SickLocTimeSync" to calculate system time from ticks by software pll
-    ros::ServiceClient m_cola_service_client;      ///< client to call ros service "SickLocColaTelegram" to send cola telegrams and receive cola responses from localization controller
+    ros::ServiceServer m_timesync_batch_service_server; ///< provides ros service "SickLocTimeSyncBatch" to calculate system times from an array of ticks by software pll
+    sick_lidar_localization::PersistentServiceClient<sick_lidar_localization::SickLocColaTelegramSrv> m_cola_service_client; ///< client to call ros service "SickLocColaTimestampTelegram" to send timestamp requests and receive responses from localization controller (separate tcp connection, never queued behind other cola requests)
     bool m_time_sync_thread_running;               ///< true: m_time_sync_thread is running, otherwise false
     boost::thread* m_time_sync_thread;             ///< thread to synchronize timestamps, runs the software pll
     bool m_cola_binary;                            ///< false: send Cola-ASCII (default), true: send Cola-Binary
     int m_cola_binary_mode;                        ///< 0: send Cola-ASCII (default), 1: send Cola-Binary, 2: toggle between Cola-ASCII and Cola-Binary (test and development only!)
-    int m_software_pll_fifo_length;                ///< length of software pll fifo, default: 7
-    ros::Rate m_time_sync_rate;                    ///< frequency to request timestamps using ros service "SickLocRequestTimestamp" and to update software pll, default: 0.1 (LocRequestTimestamp queries every 10 seconds)
-    ros::Rate m_time_sync_initial_rate;            ///< frequency to request timestamps and to update software pll during initialization phase, default: 1.0 (LocRequestTimestamp queries every second)
-    int m_time_sync_initial_length;                ///< length of initialization phase with LocRequestTimestamps every second, default: 10 (i.e. 10 LocRequestTimestamp queries every second after start, otherwise LocRequestTimestamp queries every 10 seconds)
+    sick_lidar_localization::TimeSyncEstimatorConfig m_estimator_config; ///< configuration of the software pll estimators (estimator type, fifo length, etc.)
+    sick_lidar_localization::TimeSyncEstimator* m_send_time_estimator;    ///< software pll estimating system time from lidar ticks by send timestamps
+    sick_lidar_localization::TimeSyncEstimator* m_receive_time_estimator; ///< software pll estimating system time from lidar ticks by receive timestamps
+    sick_lidar_localization::TimeSyncScheduler* m_time_sync_scheduler; ///< schedules LocRequestTimestamp requests, adapts the rate to residuals, round trip time jitter and divergence of the software pll
     double m_cola_response_timeout;                ///< Timeout in seconds for cola responses from localization controller, default: 1
-    ros::ServiceClient m_request_timestamp_client; ///< client to call ros service "SickLocRequestTimestamp"
-    boost::mutex m_software_pll_mutex;             ///< mutex to protect access to software pll used in service "SickLocTimeSync
+    boost::shared_ptr<sick_lidar_localization::ColaBrokerClient> m_cola_broker_client; ///< client to send timestamp requests by the cola broker of the driver (local unix domain socket, ros service "SickLocColaTimestampTelegram" as fallback)
+    boost::mutex m_software_pll_mutex;             ///< mutex to serialize updates of the software pll estimators
+    sick_lidar_localization::SeqLock<sick_lidar_localization::TimeSyncModel> m_model_snapshot; ///< snapshot of the software pll model (monotonic time), published after each update and read lock-free by service "SickLocTimeSync"
+    ros::Publisher m_time_sync_model_publisher;    ///< ros publisher for the software pll model (type SickLocTimeSyncModelMsg, latched)
+    boost::mutex m_publish_mutex;                  ///< mutex to serialize publishing of the software pll model, protects m_time_sync_model_published, m_time_sync_model_published_valid and m_published_clock_offset
+    ros::Time m_time_sync_model_published;         ///< time of the last published software pll model
+    bool m_time_sync_model_published_valid;        ///< true if the last published software pll model was valid
+    sick_lidar_localization::RoundTripFilter m_round_trip_filter; ///< NTP-style filter, only measurements with round trip time close to the minimum update the software pll
+    ros::Publisher m_time_sync_rtt_publisher;      ///< ros publisher for round trip time statistics (type SickLocTimeSyncRttMsg)
+    ros::Subscriber m_result_telegrams_subscriber; ///< ros subscriber for result port telegrams (type SickLocResultPortTelegramMsg), time_sync_estimator "fusion" or time_sync_state_file only
+    sick_lidar_localization::ClockMapping m_clock_mapping; ///< mapping between system time and monotonic time, the software pll runs on monotonic time if time_sync_monotonic_clock is true (default)
+    double m_published_clock_offset;               ///< offset between system time and monotonic time of the last published model
+    uint32_t m_controller_serial_number;           ///< serial number of the localization controller from result port telegrams (0 if unknown)
+    boost::mutex m_state_file_mutex;               ///< mutex to serialize writing the state file
+    std::string m_state_file;                      ///< file to save the time sync state for a warm start after restart, default: "/tmp/sick_lidar_localization_time_sync_state.txt" (empty: no warm start)
+    double m_state_max_deviation;                  ///< max. deviation in seconds between system time by the saved model and the first new measurement for a warm start, default: 0.01
+    sick_lidar_localization::TimeSyncState m_time_sync_state;  ///< current time sync state, saved after each LocRequestTimestamp
+    sick_lidar_localization::TimeSyncState m_warm_start_state; ///< time sync state loaded at start, validated against a new measurement after the serial number is known
+    bool m_warm_start_pending;                     ///< true until the loaded state has been validated or discarded
+    ros::Publisher m_time_sync_quality_publisher;  ///< ros publisher for the time sync quality (type SickLocTimeSyncQualityMsg)
+    uint32_t m_sample_cnt;                         ///< number of LocRequestTimestamp measurements since start
+    uint32_t m_accepted_sample_cnt;                ///< number of LocRequestTimestamp measurements accepted by round trip filter and software pll since start
   
   
   }; // class TimeSyncService
@@ -0,0 +1,152 @@
+/*
+ * @brief time_sync_state saves and restores the state of the time synchronization (controller serial number,
+ * software pll model and recent LocRequestTimestamp measurements) to warm start sim_loc_time_sync after a restart.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#ifndef __SIM_LOC_TIME_SYNC_STATE_H_INCLUDED
+#define __SIM_LOC_TIME_SYNC_STATE_H_INCLUDED
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "sick_lidar_localization/time_sync_model.h"
+
+namespace sick_lidar_localization
+{
+  /*!
+   * class TimeSyncSample is a LocRequestTimestamp measurement, i.e. lidar ticks with send and receive time.
+   */
+  class TimeSyncSample
+  {
+  public:
+    TimeSyncSample(uint32_t _ticks = 0, double _send_time = 0, double _receive_time = 0) : ticks(_ticks), send_time(_send_time), receive_time(_receive_time) {} ///< Constructor
+    uint32_t ticks;      ///< lidar ticks in milliseconds
+    double send_time;    ///< system time in seconds when LocRequestTimestamp was sent
+    double receive_time; ///< system time in seconds when the LocRequestTimestamp response was received
+  };
+  
+  /*!
+   * class TimeSyncState contains the state of the time synchronization: the serial number of the localization
+   * controller, the software pll model and the most recent LocRequestTimestamp measurements. TimeSyncState is
+   * saved periodically to a file. After a restart of sim_loc_time_sync, the state is reloaded and validated
+   * against the first new measurement: if the localization controller is still running, the saved measurements
+   * are replayed to the software pll, and system time from ticks is available after the first LocRequestTimestamp.
+   * The state file contains system time, since monotonic time restarts after a reboot of the vehicle pc.
+   */
+  class TimeSyncState
+  {
+  public:
+    
+    /*!
+     * Constructor
+     * @param[in] max_samples max. number of measurements in the state (oldest measurements are removed)
+     */
+    TimeSyncState(int max_samples = 7);
+    
+    /*!
+     * Appends a measurement. The oldest measurement is removed if the state contains more than max_samples measurements.
+     * @param[in] sample LocRequestTimestamp measurement
+     */
+    void addSample(const TimeSyncSample & sample);
+    
+    /*!
+     * Clears the state.
+     */
+    void clear(void);
+  
+    /*!
+     * Shifts all times of the state (model and measurements) by an offset, f.e. to map monotonic time to system time.
+     * @param[in] offset time offset in seconds
+     */
+    void shiftTime(double offset);
+  
+    /*!
+     * Saves the state to file. The file is written to a temporary file and renamed, i.e. a restart while
+     * saving does not leave a corrupted state file.
+     * @param[in] filename state file
+     * @return true on success, false on error
+     */
+    bool save(const std::string & filename) const;
+  
+    /*!
+     * Loads the state from file.
+     * @param[in] filename state file
+     * @return true on success, false on error (file not found or invalid)
+     */
+    bool load(const std::string & filename);
+  
+    /*!
+     * Returns true, if the state is still valid for a new measurement, i.e. the saved model is valid,
+     * the serial numbers match (if known) and the system time estimated by the saved model deviates from
+     * the measured system time by max. max_deviation seconds.
+     * @param[in] serial_number serial number of the localization controller (0 if unknown)
+     * @param[in] sample new LocRequestTimestamp measurement
+     * @param[in] max_deviation max. time difference in seconds between estimated and measured system time
+     * @param[out] deviation time difference in seconds between estimated and measured system time
+     * @return true if the state is valid, false otherwise
+     */
+    bool validate(uint32_t serial_number, const TimeSyncSample & sample, double max_deviation, double & deviation) const;
+  
+    uint32_t serial_number;              ///< serial number of the localization controller (0 if unknown)
+    TimeSyncModel model;                 ///< software pll model
+    std::vector<TimeSyncSample> samples; ///< most recent measurements, oldest first
+    
+  protected:
+    
+    int m_max_samples; ///< max. number of measurements in the state
+  
+  }; // class TimeSyncState
+  
+} // namespace sick_lidar_localization
+#endif // __SIM_LOC_TIME_SYNC_STATE_H_INCLUDED
@@ -69,6 +69,7 @@
 #include "sick_lidar_localization/SickLocResultPortTestcaseMsg.h"
 #include "sick_lidar_localization/SickLocRequestTimestampSrv.h"
 #include "sick_lidar_localization/SickLocTimeSyncSrv.h"
+#include "sick_lidar_localization/SickLocTimeSyncBatchSrv.h"
 
 namespace sick_lidar_localization
 {
@@ -12,6 +12,7 @@ See https://github.com/michael1309/SoftwarePLL/blob/master/README.md for details
 // #include <chrono>
 // #include <thread>
 #include <math.h>
+#include <algorithm>
 #include <iterator>
 #include <iostream>
 #include <fstream>
@@ -51,24 +52,87 @@ SoftwarePLL::~SoftwarePLL()
 bool SoftwarePLL::PushIntoFifo(double curTimeStamp, uint32_t curtick)
 // update tick fifo and update clock (timestamp) fifo
 {
-	for (int i = 0; i < FifoSize_ - 1; i++)
+	// unwrap 32 bit tick overflow
+	if (!HasReference_)
 	{
-		TickFifo_[i] = TickFifo_[i + 1];
-		ClockFifo_[i] = ClockFifo_[i + 1];
+		HasReference_ = true;
+		ReferenceTick_ = curtick;
+		ReferenceTimeStamp_ = curTimeStamp;
+		LastUnwrappedTick_ = curtick;
 	}
-	TickFifo_[FifoSize_ - 1] = curtick; // push most recent tick and timestamp into fifo
-	ClockFifo_[FifoSize_ - 1] = curTimeStamp;
+	uint64_t unwrappedTick = LastUnwrappedTick_ + (int32_t)(curtick - (uint32_t)(0xFFFFFFFF & LastUnwrappedTick_));
+	LastUnwrappedTick_ = unwrappedTick;
 
-	if (NumberValInFifo_ < FifoSize_)
+	if (NumberValInFifo_ >= FifoSize_) // fifo full: replace the oldest measurement
+	{
+		RemoveFromRegression((double)(int64_t)(TickFifo_[FifoHead_] - ReferenceTick_), ClockFifo_[FifoHead_] - ReferenceTimeStamp_);
+	}
+	else
 	{
 		NumberValInFifo_++; // remember the number of valid number in fifo
 	}
-	FirstTick(TickFifo_[0]);
-	FirstTimeStamp(ClockFifo_[0]);
+	TickFifo_[FifoHead_] = unwrappedTick; // push most recent tick and timestamp into fifo
+	ClockFifo_[FifoHead_] = curTimeStamp;
+	AddToRegression((double)(int64_t)(unwrappedTick - ReferenceTick_), curTimeStamp - ReferenceTimeStamp_);
+	FifoHead_ = (FifoHead_ + 1) % FifoSize_;
 
+	if (FifoHead_ == 0 && NumberValInFifo_ >= FifoSize_)
+	{
+		RecomputeRegression(); // once per fifo cycle, i.e. amortized O(1)
+	}
 	return(true);
 }
 
+void SoftwarePLL::AddToRegression(double tick, double clock)
+{
+	int n = NumberValInFifo_; // number of values including tick and clock
+	double dTick = tick - MeanTick_;
+	double dClock = clock - MeanClock_;
+	MeanTick_ += dTick / n;
+	MeanClock_ += dClock / n;
+	SumSqTick_ += dTick * (tick - MeanTick_);
+	SumSqClock_ += dClock * (clock - MeanClock_);
+	SumCoTickClock_ += dTick * (clock - MeanClock_);
+}
+
+void SoftwarePLL::RemoveFromRegression(double tick, double clock)
+{
+	int n = NumberValInFifo_ - 1; // number of values excluding tick and clock
+	if (n <= 0)
+	{
+		MeanTick_ = MeanClock_ = SumSqTick_ = SumSqClock_ = SumCoTickClock_ = 0;
+		return;
+	}
+	double dTick = tick - MeanTick_;
+	double dClock = clock - MeanClock_;
+	MeanTick_ -= dTick / n;
+	MeanClock_ -= dClock / n;
+	SumSqTick_ -= dTick * (tick - MeanTick_);
+	SumSqClock_ -= dClock * (clock - MeanClock_);
+	SumCoTickClock_ -= dTick * (clock - MeanClock_);
+}
+
+void SoftwarePLL::RecomputeRegression()
+{
+	double sumTick = 0, sumClock = 0;
+	for (int i = 0; i < NumberValInFifo_; i++)
+	{
+		sumTick += (double)(int64_t)(TickFifo_[i] - ReferenceTick_);
+		sumClock += ClockFifo_[i] - ReferenceTimeStamp_;
+	}
+	MeanTick_ = sumTick / NumberValInFifo_;
+	MeanClock_ = sumClock / NumberValInFifo_;
+	SumSqTick_ = SumSqClock_ = SumCoTickClock_ = 0;
+	for (int i = 0; i < NumberValInFifo_; i++)
+	{
+		double dTick = (double)(int64_t)(TickFifo_[i] - ReferenceTick_) - MeanTick_;
+		double dClock = (ClockFifo_[i] - ReferenceTimeStamp_) - MeanClock_;
+		SumSqTick_ += dTick * dTick;
+		SumSqClock_ += dClock * dClock;
+		SumCoTickClock_ += dTick * dClock;
+	}
+}
+
 double SoftwarePLL::ExtraPolateRelativeTimeStamp(uint32_t tick)
 {
 	int32_t tempTick =0;
@@ -150,6 +214,18 @@ bool SoftwarePLL::GetCorrectedTimeStamp(uint32_t& sec, uint32_t& nanoSec, uint32
 	return(true);
 }
 
+bool SoftwarePLL::GetLinearModel(uint32_t& firstTick, double& firstTimeStamp, double& slope) const
+{
+  if (IsInitialized() == false)
+  {
+    return(false);
+  }
+	firstTick = (uint32_t)(0xFFFFFFFF & FirstTick());
+	firstTimeStamp = FirstTimeStamp();
+	slope = InterpolationSlope();
+	return(true);
+}
+
 bool SoftwarePLL::NearSameTimeStamp(double relTimeStamp1, double relTimeStamp2)
 {
 	double dTAbs = fabs(relTimeStamp1 - relTimeStamp2);
@@ -166,62 +242,27 @@ bool SoftwarePLL::NearSameTimeStamp(double relTimeStamp1, double relTimeStamp2)
 bool SoftwarePLL::UpdateInterpolationSlope() // fifo already updated
 {
 
-	if (NumberValInFifo_ < FifoSize_)
+	if (NumberValInFifo_ < FifoSize_ || SumSqTick_ <= 0)
 	{
 		return(false);
 	}
-	std::vector<uint64_t> tickFifoUnwrap;
-	std::vector<double> clockFifoUnwrap;
-	clockFifoUnwrap.resize(FifoSize_);
-	tickFifoUnwrap.resize(FifoSize_);
-	uint64_t tickOffset = 0;
-	clockFifoUnwrap[0] = 0.00;
-	tickFifoUnwrap[0] = 0;
-	FirstTimeStamp(this->ClockFifo_[0]);
-	FirstTick(this->TickFifo_[0]);
-
-	uint64_t tickDivisor = 0x100000000;
-
 
+	// slope of regression line by running sums, O(1)
+	double m = SumCoTickClock_ / SumSqTick_;
 
-	for (int i = 1; i < FifoSize_; i++)  // typical 643 for 20ms -> round about 32150 --> near to 32768 standard clock in many watches
-	{
-		if (TickFifo_[i] < TickFifo_[i - 1]) // Overflow
-		{
-			tickOffset += tickDivisor;
-		}
-		tickFifoUnwrap[i] = tickOffset + TickFifo_[i] - FirstTick();
-		clockFifoUnwrap[i] = (this->ClockFifo_[i] - FirstTimeStamp());
-	}
-
-	double sum_xy = 0.0;
-	double 	sum_x = 0.0;
-	double sum_y = 0.0;
-	double sum_xx = 0.0;
-	for (int i = 0; i < FifoSize_; i++)
-	{
-		sum_xy += tickFifoUnwrap[i] * clockFifoUnwrap[i];
-		sum_x += tickFifoUnwrap[i];
-		sum_y += clockFifoUnwrap[i];
-		sum_xx += tickFifoUnwrap[i] * tickFifoUnwrap[i];
-	}
-
-	// calculate slope of regression line, interception is 0 by construction
-	double m = (FifoSize_ * sum_xy - sum_x * sum_y) / (FifoSize_ * sum_xx - sum_x*sum_x);
-
-	int matchCnt = 0;
-	for (int i = 0; i < FifoSize_; i++)
-	{
-		double yesti = m * tickFifoUnwrap[i];
-		if (this->NearSameTimeStamp(yesti, clockFifoUnwrap[i]))
-		{
-			matchCnt++;
-		}
-	}
+	// residual standard deviation: sum of squared residuals = SumSqClock - m * SumCoTickClock
+	double sumSqResiduals = SumSqClock_ - m * SumCoTickClock_;
+	double residualStdDev = sqrt(std::max(0.0, sumSqResiduals) / NumberValInFifo_);
+	ResidualStdDev_ = residualStdDev;
 
 	bool retVal = false;
-	if (matchCnt == FifoSize_)
+	if (this->NearSameTimeStamp(residualStdDev, 0.0))
 	{
+		// regression line through (MeanTick_, MeanClock_), evaluated at the oldest tick in the fifo
+		uint64_t firstTick = TickFifo_[FifoHead_];
+		double firstTimeStamp = ReferenceTimeStamp_ + MeanClock_ + m * ((double)(int64_t)(firstTick - ReferenceTick_) - MeanTick_);
+		FirstTick(firstTick);
+		FirstTimeStamp(firstTimeStamp);
 		InterpolationSlope(m);
 		retVal = true;
 	}
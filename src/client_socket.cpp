@@ -149,7 +149,8 @@ bool sick_lidar_localization::ClientSocket::close(bool force_shutdown)
   {
     if (force_shutdown || m_tcp_socket.is_open())
     {
-      m_tcp_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both);
+      boost::system::error_code errorcode;
+      m_tcp_socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, errorcode); // fails if already shut down or disconnected, close anyway
       m_tcp_socket.close();
     }
     return true;
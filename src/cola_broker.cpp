@@ -0,0 +1,402 @@
+/*
+ * @brief cola_broker serves cola requests of other components (cola_service_node, sim_loc_time_sync) on a local unix domain socket with a compact binary framing. It forwards the requests to the driver monitor, which owns the tcp connections to the localization controller. ROS services remain as a compatibility interface.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#include <boost/bind.hpp>
+#include <ros/ros.h>
+#include <unistd.h>
+
+#include "sick_lidar_localization/cola_broker.h"
+
+/*!
+ * Constructor. The broker does not start automatically, call start() and stop() to start and stop.
+ * @param[in] cola_handler handler for cola requests, f.e. DriverMonitor::serviceCbColaTelegram
+ * @param[in] timestamp_handler handler for timestamp requests, f.e. DriverMonitor::serviceCbColaTimestampTelegram (default: cola_handler)
+ * @param[in] num_worker_threads number of cola requests processed concurrently, default: 4
+ */
+sick_lidar_localization::ColaBroker::ColaBroker(const RequestHandler & cola_handler, const RequestHandler & timestamp_handler, int num_worker_threads)
+: m_cola_handler(cola_handler), m_timestamp_handler(timestamp_handler ? timestamp_handler : cola_handler), m_num_worker_threads(std::max(1, num_worker_threads)),
+  m_io_work(0), m_io_thread(0), m_acceptor(m_io_service), m_request_work(0),
+  m_timestamp_work(0), m_timestamp_thread(0)
+{
+}
+
+/*!
+ * Destructor, stops the broker and removes the socket file.
+ */
+sick_lidar_localization::ColaBroker::~ColaBroker()
+{
+  stop();
+}
+
+/*!
+ * Creates the unix domain socket and starts to accept clients. An existing socket file (f.e. of a previous run) is replaced.
+ * @param[in] socket_path path of the unix domain socket, f.e. "/tmp/sick_lidar_localization_cola.sock"
+ * @return true on success, false on failure
+ */
+bool sick_lidar_localization::ColaBroker::start(const std::string & socket_path)
+{
+  stop();
+  try
+  {
+    ::unlink(socket_path.c_str());
+    boost::asio::local::stream_protocol::endpoint endpoint(socket_path);
+    m_acceptor.open(endpoint.protocol());
+    m_acceptor.bind(endpoint);
+    m_acceptor.listen();
+  }
+  catch(const std::exception & exc)
+  {
+    ROS_WARN_STREAM("## ERROR ColaBroker::start(): can't create unix domain socket \"" << socket_path << "\", exception " << exc.what());
+    boost::system::error_code error;
+    m_acceptor.close(error);
+    return false;
+  }
+  m_socket_path = socket_path;
+  m_io_service.reset();
+  m_request_service.reset();
+  m_timestamp_service.reset();
+  m_io_work = new boost::asio::io_service::work(m_io_service);
+  m_request_work = new boost::asio::io_service::work(m_request_service);
+  m_timestamp_work = new boost::asio::io_service::work(m_timestamp_service);
+  for(int n = 0; n < m_num_worker_threads; n++)
+    m_request_threads.create_thread([this](){ m_request_service.run(); });
+  m_timestamp_thread = new boost::thread([this](){ m_timestamp_service.run(); });
+  startAccept();
+  m_io_thread = new boost::thread([this](){ m_io_service.run(); });
+  ROS_INFO_STREAM("ColaBroker: serving cola requests on unix domain socket \"" << m_socket_path << "\"");
+  return true;
+}
+
+/*!
+ * Closes all client connections, stops the worker threads and removes the socket file.
+ * Requests in progress are completed, but their responses are discarded.
+ */
+void sick_lidar_localization::ColaBroker::stop(void)
+{
+  if(m_io_thread)
+  {
+    m_io_service.post(boost::bind(&sick_lidar_localization::ColaBroker::closeAll, this));
+    delete(m_io_work);
+    m_io_work = 0;
+    m_io_thread->join(); // returns after all connections are closed
+    delete(m_io_thread);
+    m_io_thread = 0;
+  }
+  if(m_request_work)
+  {
+    delete(m_request_work);
+    m_request_work = 0;
+    m_request_service.stop();
+    m_request_threads.join_all();
+  }
+  if(m_timestamp_thread)
+  {
+    delete(m_timestamp_work);
+    m_timestamp_work = 0;
+    m_timestamp_service.stop();
+    m_timestamp_thread->join();
+    delete(m_timestamp_thread);
+    m_timestamp_thread = 0;
+  }
+  if(!m_socket_path.empty())
+  {
+    ::unlink(m_socket_path.c_str());
+    m_socket_path.clear();
+  }
+}
+
+/*!
+ * Encodes a request frame (length, request id, channel, timeout and Cola-ASCII request).
+ * @param[in] request_id request id, returned with the response
+ * @param[in] channel cola or timestamp channel
+ * @param[in] cola_request cola request
+ * @return request frame
+ */
+std::vector<uint8_t> sick_lidar_localization::ColaBroker::encodeRequest(uint32_t request_id, COLA_CHANNEL channel, const sick_lidar_localization::SickLocColaTelegramSrv::Request & cola_request)
+{
+  std::vector<uint8_t> frame;
+  frame.reserve(4 + 9 + cola_request.cola_ascii_request.size());
+  appendValue(frame, (uint32_t)(9 + cola_request.cola_ascii_request.size()));
+  appendValue(frame, request_id);
+  appendValue(frame, (uint8_t)channel);
+  appendValue(frame, (uint32_t)(std::max(0.0, 1.0e6 * cola_request.wait_response_timeout)));
+  frame.insert(frame.end(), cola_request.cola_ascii_request.begin(), cola_request.cola_ascii_request.end());
+  return frame;
+}
+
+/*!
+ * Decodes the payload of a request frame (i.e. without length field).
+ * @param[in] payload payload of a request frame
+ * @param[out] request_id request id
+ * @param[out] channel cola or timestamp channel
+ * @param[out] cola_request cola request
+ * @return true on success, false on invalid payload
+ */
+bool sick_lidar_localization::ColaBroker::decodeRequest(const std::vector<uint8_t> & payload, uint32_t & request_id, COLA_CHANNEL & channel, sick_lidar_localization::SickLocColaTelegramSrv::Request & cola_request)
+{
+  size_t pos = 0;
+  uint8_t channel_value = 0;
+  uint32_t timeout_usec = 0;
+  if(!readValue(payload, pos, request_id) || !readValue(payload, pos, channel_value) || !readValue(payload, pos, timeout_usec)
+  || (channel_value != COLA_REQUEST_CHANNEL && channel_value != TIMESTAMP_REQUEST_CHANNEL))
+  {
+    return false;
+  }
+  channel = (COLA_CHANNEL)channel_value;
+  cola_request.wait_response_timeout = 1.0e-6 * timeout_usec;
+  cola_request.cola_ascii_request.assign(payload.begin() + pos, payload.end());
+  return true;
+}
+
+/*!
+ * Encodes a response frame (length, request id, success, timestamps and Cola-ASCII response).
+ * @param[in] request_id request id of the request
+ * @param[in] success true: request successfull, false: request failed
+ * @param[in] cola_response cola response
+ * @return response frame
+ */
+std::vector<uint8_t> sick_lidar_localization::ColaBroker::encodeResponse(uint32_t request_id, bool success, const sick_lidar_localization::SickLocColaTelegramSrv::Response & cola_response)
+{
+  std::vector<uint8_t> frame;
+  frame.reserve(4 + 21 + cola_response.cola_ascii_response.size());
+  appendValue(frame, (uint32_t)(21 + cola_response.cola_ascii_response.size()));
+  appendValue(frame, request_id);
+  appendValue(frame, (uint8_t)(success ? 1 : 0));
+  appendValue(frame, (uint32_t)cola_response.send_timestamp_sec);
+  appendValue(frame, (uint32_t)cola_response.send_timestamp_nsec);
+  appendValue(frame, (uint32_t)cola_response.receive_timestamp_sec);
+  appendValue(frame, (uint32_t)cola_response.receive_timestamp_nsec);
+  frame.insert(frame.end(), cola_response.cola_ascii_response.begin(), cola_response.cola_ascii_response.end());
+  return frame;
+}
+
+/*!
+ * Decodes the payload of a response frame (i.e. without length field).
+ * @param[in] payload payload of a response frame
+ * @param[out] request_id request id
+ * @param[out] success true: request successfull, false: request failed
+ * @param[out] cola_response cola response
+ * @return true on success, false on invalid payload
+ */
+bool sick_lidar_localization::ColaBroker::decodeResponse(const std::vector<uint8_t> & payload, uint32_t & request_id, bool & success, sick_lidar_localization::SickLocColaTelegramSrv::Response & cola_response)
+{
+  size_t pos = 0;
+  uint8_t success_value = 0;
+  uint32_t send_sec = 0, send_nsec = 0, receive_sec = 0, receive_nsec = 0;
+  if(!readValue(payload, pos, request_id) || !readValue(payload, pos, success_value)
+  || !readValue(payload, pos, send_sec) || !readValue(payload, pos, send_nsec) || !readValue(payload, pos, receive_sec) || !readValue(payload, pos, receive_nsec))
+  {
+    return false;
+  }
+  success = (success_value != 0);
+  cola_response.send_timestamp_sec = send_sec;
+  cola_response.send_timestamp_nsec = send_nsec;
+  cola_response.receive_timestamp_sec = receive_sec;
+  cola_response.receive_timestamp_nsec = receive_nsec;
+  cola_response.cola_ascii_response.assign(payload.begin() + pos, payload.end());
+  return true;
+}
+
+/*!
+ * Accepts the next client connection (asynchronous, io thread)
+ */
+void sick_lidar_localization::ColaBroker::startAccept(void)
+{
+  SessionPtr session(new Session(m_io_service));
+  m_acceptor.async_accept(session->socket, boost::bind(&sick_lidar_localization::ColaBroker::onAccept, this, session, boost::asio::placeholders::error));
+}
+
+/*!
+ * Callback after a client connected (io thread), starts to receive requests and to accept the next client
+ */
+void sick_lidar_localization::ColaBroker::onAccept(SessionPtr session, const boost::system::error_code & error)
+{
+  if(error == boost::asio::error::operation_aborted || !m_acceptor.is_open())
+    return; // broker stopped
+  if(error)
+  {
+    ROS_WARN_STREAM("## ERROR ColaBroker::onAccept(): accept failed, error " << error.message());
+  }
+  else
+  {
+    m_sessions.push_back(session);
+    startRead(session);
+  }
+  startAccept();
+}
+
+/*!
+ * Receives the length field of the next request frame (asynchronous, io thread)
+ */
+void sick_lidar_localization::ColaBroker::startRead(SessionPtr session)
+{
+  boost::asio::async_read(session->socket, boost::asio::buffer(&session->payload_length, sizeof(session->payload_length)),
+    boost::bind(&sick_lidar_localization::ColaBroker::onReadLength, this, session, boost::asio::placeholders::error));
+}
+
+/*!
+ * Callback after the length field of a request frame has been received (io thread), receives the payload
+ */
+void sick_lidar_localization::ColaBroker::onReadLength(SessionPtr session, const boost::system::error_code & error)
+{
+  if(error)
+  {
+    closeSession(session); // client disconnected or broker stopped
+    return;
+  }
+  if(session->payload_length > maxPayloadLength())
+  {
+    ROS_WARN_STREAM("## ERROR ColaBroker::onReadLength(): invalid frame length " << session->payload_length << ", connection closed");
+    closeSession(session);
+    return;
+  }
+  session->payload.resize(session->payload_length);
+  boost::asio::async_read(session->socket, boost::asio::buffer(session->payload),
+    boost::bind(&sick_lidar_localization::ColaBroker::onReadPayload, this, session, boost::asio::placeholders::error));
+}
+
+/*!
+ * Callback after the payload of a request frame has been received (io thread), passes the request to the worker threads
+ * and receives the next request
+ */
+void sick_lidar_localization::ColaBroker::onReadPayload(SessionPtr session, const boost::system::error_code & error)
+{
+  if(error)
+  {
+    closeSession(session);
+    return;
+  }
+  // Timestamp requests are processed by their own thread, cola requests by the pool of worker threads
+  bool timestamp_request = (session->payload.size() > sizeof(uint32_t) && session->payload[sizeof(uint32_t)] == TIMESTAMP_REQUEST_CHANNEL);
+  boost::asio::io_service & request_service = (timestamp_request ? m_timestamp_service : m_request_service);
+  request_service.post(boost::bind(&sick_lidar_localization::ColaBroker::runRequest, this, session, session->payload));
+  startRead(session);
+}
+
+/*!
+ * Processes a request by the cola or timestamp handler (worker or timestamp thread) and queues the response
+ */
+void sick_lidar_localization::ColaBroker::runRequest(SessionPtr session, const std::vector<uint8_t> & payload)
+{
+  uint32_t request_id = 0;
+  COLA_CHANNEL channel = COLA_REQUEST_CHANNEL;
+  sick_lidar_localization::SickLocColaTelegramSrv::Request cola_request;
+  sick_lidar_localization::SickLocColaTelegramSrv::Response cola_response;
+  if(!decodeRequest(payload, request_id, channel, cola_request))
+  {
+    ROS_WARN_STREAM("## ERROR ColaBroker::runRequest(): invalid request frame, connection closed");
+    m_io_service.post(boost::bind(&sick_lidar_localization::ColaBroker::closeSession, this, session));
+    return;
+  }
+  bool success = (channel == TIMESTAMP_REQUEST_CHANNEL) ? m_timestamp_handler(cola_request, cola_response) : m_cola_handler(cola_request, cola_response);
+  m_io_service.post(boost::bind(&sick_lidar_localization::ColaBroker::queueResponse, this, session, encodeResponse(request_id, success, cola_response)));
+}
+
+/*!
+ * Queues a response frame and starts sending, if not yet done (io thread)
+ */
+void sick_lidar_localization::ColaBroker::queueResponse(SessionPtr session, const std::vector<uint8_t> & frame)
+{
+  if(!session->socket.is_open())
+    return; // client disconnected, response discarded
+  session->write_queue.push_back(frame);
+  if(session->write_queue.size() == 1) // otherwise the response is sent by onWrite after the previous responses
+  {
+    boost::asio::async_write(session->socket, boost::asio::buffer(session->write_queue.front()),
+      boost::bind(&sick_lidar_localization::ColaBroker::onWrite, this, session, boost::asio::placeholders::error));
+  }
+}
+
+/*!
+ * Callback after a response frame has been sent (io thread), sends the next queued response
+ */
+void sick_lidar_localization::ColaBroker::onWrite(SessionPtr session, const boost::system::error_code & error)
+{
+  if(error)
+  {
+    closeSession(session);
+    return;
+  }
+  if(!session->socket.is_open() || session->write_queue.empty())
+    return; // session closed by closeSession() while this completion handler was already queued, write queue cleared
+  session->write_queue.pop_front();
+  if(!session->write_queue.empty())
+  {
+    boost::asio::async_write(session->socket, boost::asio::buffer(session->write_queue.front()),
+      boost::bind(&sick_lidar_localization::ColaBroker::onWrite, this, session, boost::asio::placeholders::error));
+  }
+}
+
+/*!
+ * Closes a client connection (io thread)
+ */
+void sick_lidar_localization::ColaBroker::closeSession(SessionPtr session)
+{
+  boost::system::error_code error;
+  session->socket.close(error);
+  session->write_queue.clear();
+  m_sessions.remove(session);
+}
+
+/*!
+ * Closes the acceptor and all client connections (io thread)
+ */
+void sick_lidar_localization::ColaBroker::closeAll(void)
+{
+  boost::system::error_code error;
+  m_acceptor.close(error);
+  for(std::list<SessionPtr>::iterator iter_session = m_sessions.begin(); iter_session != m_sessions.end(); iter_session++)
+    (*iter_session)->socket.close(error);
+  m_sessions.clear();
+}
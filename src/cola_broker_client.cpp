@@ -0,0 +1,193 @@
+/*
+ * @brief cola_broker_client sends cola requests to the cola broker of the driver on a local unix domain socket. It keeps a pool of connections to the broker, so concurrent requests don't block each other.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#include <ros/ros.h>
+
+#include "sick_lidar_localization/cola_broker_client.h"
+
+/*!
+ * Constructor
+ * @param[in] socket_path path of the unix domain socket of the cola broker (empty: broker disabled, all requests are sent by ros services)
+ */
+sick_lidar_localization::ColaBrokerClient::ColaBrokerClient(const std::string & socket_path)
+: m_socket_path(socket_path), m_request_id(0), m_broker_available(true)
+{
+}
+
+/*!
+ * Destructor, closes all connections and prints the statistics
+ */
+sick_lidar_localization::ColaBrokerClient::~ColaBrokerClient()
+{
+  m_idle_connections.clear();
+  if(m_statistics.calls > 0)
+    ROS_INFO_STREAM("ColaBrokerClient \"" << m_socket_path << "\": " << m_statistics.toString());
+}
+
+/*!
+ * Sends a cola request to the cola broker and waits for its response.
+ * @param[in] cola_request cola request
+ * @param[out] cola_response cola response
+ * @param[out] request_sent true, if the request has been sent to the broker, false if the broker is not available (request not sent)
+ * @param[in] channel cola or timestamp channel
+ * @return true on success, false in case of errors (broker not available, connection lost or request failed)
+ */
+bool sick_lidar_localization::ColaBrokerClient::call(sick_lidar_localization::SickLocColaTelegramSrv::Request & cola_request, sick_lidar_localization::SickLocColaTelegramSrv::Response & cola_response,
+  bool & request_sent, ColaBroker::COLA_CHANNEL channel)
+{
+  request_sent = false;
+  ros::WallTime start_time = ros::WallTime::now();
+  uint32_t request_id = 0;
+  {
+    boost::lock_guard<boost::mutex> connection_lockguard(m_connection_mutex);
+    request_id = ++m_request_id;
+  }
+  std::vector<uint8_t> frame = ColaBroker::encodeRequest(request_id, channel, cola_request);
+  boost::system::error_code error;
+  SocketPtr connection;
+  for(int retry_cnt = 0; !request_sent && retry_cnt < 2; retry_cnt++)
+  {
+    connection = acquireConnection();
+    if(!connection)
+      return false;
+    boost::asio::write(*connection, boost::asio::buffer(frame), error);
+    if(error) // broker restarted: idle connections are stale, the request has not been received, retry once with a new connection
+    {
+      connection->close(error);
+      boost::lock_guard<boost::mutex> connection_lockguard(m_connection_mutex);
+      m_idle_connections.clear();
+    }
+    else
+    {
+      request_sent = true;
+    }
+  }
+  if(!request_sent)
+    return false;
+  bool success = false, response_valid = false;
+  uint32_t response_id = 0, payload_length = 0;
+  boost::asio::read(*connection, boost::asio::buffer(&payload_length, sizeof(payload_length)), error);
+  if(!error && payload_length <= ColaBroker::maxPayloadLength())
+  {
+    std::vector<uint8_t> payload(payload_length);
+    boost::asio::read(*connection, boost::asio::buffer(payload), error);
+    response_valid = (!error && ColaBroker::decodeResponse(payload, response_id, success, cola_response) && response_id == request_id);
+  }
+  if(response_valid)
+  {
+    releaseConnection(connection);
+  }
+  else
+  {
+    ROS_WARN_STREAM("## ERROR ColaBrokerClient::call(): request \"" << cola_request.cola_ascii_request << "\" failed, "
+      << (error ? error.message() : std::string("invalid response")) << ", connection to cola broker closed");
+    connection->close(error);
+  }
+  boost::lock_guard<boost::mutex> connection_lockguard(m_connection_mutex);
+  m_statistics.update(response_valid && success, (ros::WallTime::now() - start_time).toSec());
+  return response_valid && success;
+}
+
+/*!
+ * Returns the statistics (number of calls and failures, latency) of all broker requests
+ */
+sick_lidar_localization::ServiceCallStatistics sick_lidar_localization::ColaBrokerClient::statistics(void)
+{
+  boost::lock_guard<boost::mutex> connection_lockguard(m_connection_mutex);
+  return m_statistics;
+}
+
+/*!
+ * Returns an idle connection to the broker or connects a new one.
+ * @return connection to the broker or empty pointer, if the broker is not available
+ */
+sick_lidar_localization::ColaBrokerClient::SocketPtr sick_lidar_localization::ColaBrokerClient::acquireConnection(void)
+{
+  if(m_socket_path.empty())
+    return SocketPtr();
+  {
+    boost::lock_guard<boost::mutex> connection_lockguard(m_connection_mutex);
+    if(!m_idle_connections.empty())
+    {
+      SocketPtr connection = m_idle_connections.front();
+      m_idle_connections.pop_front();
+      return connection;
+    }
+  }
+  SocketPtr connection(new boost::asio::local::stream_protocol::socket(m_io_service));
+  boost::system::error_code error;
+  connection->connect(boost::asio::local::stream_protocol::endpoint(m_socket_path), error);
+  boost::lock_guard<boost::mutex> connection_lockguard(m_connection_mutex);
+  if(error)
+  {
+    if(m_broker_available)
+      ROS_WARN_STREAM("ColaBrokerClient: cola broker \"" << m_socket_path << "\" not available (" << error.message() << "), using ros services");
+    m_broker_available = false;
+    return SocketPtr();
+  }
+  if(!m_broker_available)
+    ROS_INFO_STREAM("ColaBrokerClient: connected to cola broker \"" << m_socket_path << "\"");
+  m_broker_available = true;
+  return connection;
+}
+
+/*!
+ * Returns a connection after a successfull request to the pool of idle connections.
+ * @param[in] connection connection acquired by acquireConnection()
+ */
+void sick_lidar_localization::ColaBrokerClient::releaseConnection(const SocketPtr & connection)
+{
+  boost::lock_guard<boost::mutex> connection_lockguard(m_connection_mutex);
+  m_idle_connections.push_back(connection);
+}
@@ -1,6 +1,6 @@
 /*
  * @brief cola_configuration sets the initial SIM result output configuration
- * using ros cola services.
+ * using cola telegrams. Only settings different from the current controller settings are sent.
  * Configures the following result output settings from launch file:
  * LocSetResultPort, LocSetResultMode, LocSetResultPoseEnabled, LocSetResultEndianness, LocSetResultPoseInterval,
  * LocRequestResultData
@@ -57,14 +57,19 @@
  *
  */
 #include <ros/ros.h>
+#include <iomanip>
+#include <sstream>
 
 #include "sick_lidar_localization/cola_configuration.h"
+#include "sick_lidar_localization/monotonic_clock.h"
 
 /*!
  * Constructor
+ * @param[in] nh ros node handle
+ * @param[in] cola_services cola services to send cola telegrams asynchronously
  */
-sick_lidar_localization::ColaConfiguration::ColaConfiguration(ros::NodeHandle* nh)
-: m_nh(nh), m_configuration_thread_running(false), m_configuration_thread(0)
+sick_lidar_localization::ColaConfiguration::ColaConfiguration(ros::NodeHandle* nh, sick_lidar_localization::ColaServices* cola_services)
+: m_nh(nh), m_cola_services(cola_services), m_configuration_thread(0), m_configuration_thread_running(false), m_time_to_configured(-1)
 {
 }
 
@@ -85,6 +90,11 @@ sick_lidar_localization::ColaConfiguration::~ColaConfiguration()
  */
 bool sick_lidar_localization::ColaConfiguration::start(void)
 {
+  if(!m_cola_services)
+  {
+    ROS_WARN_STREAM("## ERROR ColaConfiguration::start(): ColaServices not initialized");
+    return false;
+  }
   m_configuration_thread_running = true;
   m_configuration_thread = new boost::thread(&sick_lidar_localization::ColaConfiguration::runConfigurationThreadCb, this);
   return true;
@@ -104,91 +114,196 @@ void sick_lidar_localization::ColaConfiguration::stop(void)
   }
 }
 
-
+/*!
+ * Returns the time in seconds from start() until the localization controller has been configured,
+ * or -1 if the configuration is still in progress (or has been cancelled).
+ */
+double sick_lidar_localization::ColaConfiguration::timeToConfigured(void)
+{
+  boost::lock_guard<boost::mutex> time_lockguard(m_time_to_configured_mutex);
+  return m_time_to_configured;
+}
 
 /*!
- * Thread callback, transmits the initial SIM result output configuration using ros cola services.
+ * Thread callback, transmits the initial SIM result output configuration using cola telegrams.
  * Configures the following result output settings from launch file:
  * LocSetResultPort, LocSetResultMode, LocSetResultPoseEnabled, LocSetResultEndianness, LocSetResultPoseInterval,
  * LocRequestResultData
  */
 void sick_lidar_localization::ColaConfiguration::runConfigurationThreadCb(void)
 {
-  // Get settings from launch file
-  std::map<std::string, int> sim_configuration_map = {
-    {"SickLocSetResultPort",         -1}, // "LocSetResultPort" value="2201": Set TCP-port for result output (default: 2201)
-    {"SickLocSetResultMode",         -1}, // "LocSetResultMode" value="0": Set mode of result output (0=stream or 1=poll, default:0)
-    {"SickLocSetResultPoseEnabled",  -1}, // "LocSetResultPoseEnabled" value="1": Disable (0) or enable (1) result output (default: 1, enabled)
-    {"SickLocSetResultEndianness",   -1}, // "LocSetResultEndianness" value="0": Set endianness of result output (0 = big endian, 1 = little endian, default: 0)
-    {"SickLocSetResultPoseInterval", -1}, // "LocSetResultPoseInterval" value="1": Set interval of result output (0-255, interval in number of scans, 1: result with each processed scan, default: 1)
-    {"SickLocRequestResultData",     -1}  // "LocRequestResultData" value="0": If in poll mode, trigger sending the localization result of the next processed scan via TCP interface (default: 0)
+  double start_time = sick_lidar_localization::MonotonicClock::now();
+  // Result output settings: launch file parameter, cola variable to read the current value, cola method to change the value
+  std::vector<ConfigurationItem> settings = {
+    ConfigurationItem("SickLocSetResultPort",         "LocResultPort",         "LocSetResultPort", sick_lidar_localization::ColaSchema::UINT16), // "LocSetResultPort" value="2201": Set TCP-port for result output (default: 2201)
+    ConfigurationItem("SickLocSetResultMode",         "LocResultMode",         "LocSetResultMode"),         // "LocSetResultMode" value="0": Set mode of result output (0=stream or 1=poll, default:0)
+    ConfigurationItem("SickLocSetResultPoseEnabled",  "LocResultState",        "LocSetResultPoseEnabled"),  // "LocSetResultPoseEnabled" value="1": Disable (0) or enable (1) result output (default: 1, enabled)
+    ConfigurationItem("SickLocSetResultEndianness",   "LocResultEndianness",   "LocSetResultEndianness"),   // "LocSetResultEndianness" value="0": Set endianness of result output (0 = big endian, 1 = little endian, default: 0)
+    ConfigurationItem("SickLocSetResultPoseInterval", "LocResultPoseInterval", "LocSetResultPoseInterval")  // "LocSetResultPoseInterval" value="1": Set interval of result output (0-255, interval in number of scans, 1: result with each processed scan, default: 1)
   };
+  int request_result_data = -1; // "LocRequestResultData" value="0": If in poll mode, trigger sending the localization result of the next processed scan via TCP interface (default: 0)
   double retry_delay = 1.0;
   ros::param::param<double>("/sick_lidar_localization/driver/tcp_connection_retry_delay", retry_delay, retry_delay);
   ROS_INFO_STREAM("ColaConfiguration: configuration thread started");
   if(ros::ok() && m_nh && m_configuration_thread_running)
   {
-    for(std::map<std::string, int>::iterator iter_config = sim_configuration_map.begin(); iter_config != sim_configuration_map.end(); iter_config++)
+    for(std::vector<ConfigurationItem>::iterator iter_config = settings.begin(); iter_config != settings.end(); iter_config++)
     {
-      ros::param::param<int>(std::string("/cola_service_node/") + iter_config->first, iter_config->second, iter_config->second);
-      if(iter_config->second >= 0)
-        ROS_INFO_STREAM("ColaConfiguration: \"" << iter_config->first << "\": " << iter_config->second);
+      ros::param::param<int>(std::string("/cola_service_node/") + iter_config->param_name, iter_config->configured_value, iter_config->configured_value);
+      if(iter_config->configured_value >= 0)
+        ROS_INFO_STREAM("ColaConfiguration: \"" << iter_config->param_name << "\": " << iter_config->configured_value);
     }
+    ros::param::param<int>("/cola_service_node/SickLocRequestResultData", request_result_data, request_result_data);
+    if(request_result_data >= 0)
+      ROS_INFO_STREAM("ColaConfiguration: \"SickLocRequestResultData\": " << request_result_data);
   }
   
-  // Transmit SickLocSetResultPort setting to localization
-  if(sim_configuration_map["SickLocSetResultPort"] >= 0 && ros::ok() && m_nh && m_configuration_thread_running)
+  // Read the current settings and send the settings different from the launch file, until all settings are configured.
+  // After failures, all settings are read and compared again, i.e. settings already applied are not sent twice.
+  std::vector<std::string> changed_settings;
+  size_t failed_settings = 1, retry_cnt = 0;
+  while(failed_settings > 0 && ros::ok() && m_nh && m_configuration_thread_running)
   {
-    ros::ServiceClient service_client = m_nh->serviceClient<sick_lidar_localization::SickLocSetResultPortSrv>("SickLocSetResultPort");
-    sick_lidar_localization::SickLocSetResultPortSrv service_telegram;
-    service_telegram.request.port = sim_configuration_map["SickLocSetResultPort"];
-    callService(service_telegram, service_client, retry_delay);
+    if(retry_cnt > 0)
+      ros::Duration(retry_delay).sleep();
+    readCurrentSettings(settings);
+    failed_settings = writeChangedSettings(settings, changed_settings);
+    if(failed_settings > 0)
+    {
+      ROS_WARN_STREAM("## ERROR ColaConfiguration: " << failed_settings << " settings failed, retrying");
+      retry_cnt++;
+    }
   }
   
-  // Transmit SickLocSetResultMode setting to localization
-  if(sim_configuration_map["SickLocSetResultMode"] >= 0 && ros::ok() && m_nh && m_configuration_thread_running)
+  // Trigger a result telegram in poll mode
+  while(request_result_data > 0 && ros::ok() && m_nh && m_configuration_thread_running)
   {
-    ros::ServiceClient service_client = m_nh->serviceClient<sick_lidar_localization::SickLocSetResultModeSrv>("SickLocSetResultMode");
-    sick_lidar_localization::SickLocSetResultModeSrv service_telegram;
-    service_telegram.request.mode = sim_configuration_map["SickLocSetResultMode"];
-    callService(service_telegram, service_client, retry_delay);
+    int64_t success = 0;
+    if(parseResponseValue(sendColaTelegrams({"sMN LocRequestResultData"})[0], "LocRequestResultData", sick_lidar_localization::ColaSchema::UINT8, success) && success > 0)
+      break;
+    ROS_WARN_STREAM("## ERROR ColaConfiguration: \"sMN LocRequestResultData\" failed, retrying");
+    ros::Duration(retry_delay).sleep();
   }
   
-  // Transmit SickLocSetResultPoseEnabled setting to localization
-  if(sim_configuration_map["SickLocSetResultPoseEnabled"] >= 0 && ros::ok() && m_nh && m_configuration_thread_running)
+  if(ros::ok() && m_nh && m_configuration_thread_running)
   {
-    ros::ServiceClient service_client = m_nh->serviceClient<sick_lidar_localization::SickLocSetResultPoseEnabledSrv>("SickLocSetResultPoseEnabled");
-    sick_lidar_localization::SickLocSetResultPoseEnabledSrv service_telegram;
-    service_telegram.request.enabled = sim_configuration_map["SickLocSetResultPoseEnabled"];
-    callService(service_telegram, service_client, retry_delay);
+    double time_to_configured = sick_lidar_localization::MonotonicClock::now() - start_time;
+    {
+      boost::lock_guard<boost::mutex> time_lockguard(m_time_to_configured_mutex);
+      m_time_to_configured = time_to_configured;
+    }
+    std::stringstream changed_settings_str;
+    for(size_t n = 0; n < changed_settings.size(); n++)
+      changed_settings_str << " " << changed_settings[n];
+    ROS_INFO_STREAM("ColaConfiguration: localization controller configured in " << std::fixed << std::setprecision(1) << (1000 * time_to_configured) << " ms, "
+      << retry_cnt << " retries, " << changed_settings.size() << " settings changed:" << changed_settings_str.str());
   }
-  
-  // Transmit SickLocSetResultEndianness setting to localization
-  if(sim_configuration_map["SickLocSetResultEndianness"] >= 0 && ros::ok() && m_nh && m_configuration_thread_running)
+  m_configuration_thread_running = false;
+  ROS_INFO_STREAM("ColaConfiguration: configuration thread finished");
+}
+
+/*!
+ * Reads the current value of all configured settings from the localization controller (pipelined "sRN" requests).
+ * The current value of a setting is -1, if it could not be read.
+ * @param[in,out] settings result output settings
+ */
+void sick_lidar_localization::ColaConfiguration::readCurrentSettings(std::vector<ConfigurationItem> & settings)
+{
+  std::vector<std::string> cola_requests;
+  std::vector<size_t> setting_indices;
+  for(size_t n = 0; n < settings.size(); n++)
   {
-    ros::ServiceClient service_client = m_nh->serviceClient<sick_lidar_localization::SickLocSetResultEndiannessSrv>("SickLocSetResultEndianness");
-    sick_lidar_localization::SickLocSetResultEndiannessSrv service_telegram;
-    service_telegram.request.endianness = sim_configuration_map["SickLocSetResultEndianness"];
-    callService(service_telegram, service_client, retry_delay);
+    settings[n].current_value = -1;
+    if(settings[n].configured_value >= 0)
+    {
+      cola_requests.push_back("sRN " + settings[n].variable_name);
+      setting_indices.push_back(n);
+    }
   }
-  
-  // Transmit SickLocSetResultEndianness setting to localization
-  if(sim_configuration_map["SickLocSetResultPoseInterval"] >= 0 && ros::ok() && m_nh && m_configuration_thread_running)
+  std::vector<sick_lidar_localization::SickLocColaTelegramMsg> cola_responses = sendColaTelegrams(cola_requests);
+  for(size_t n = 0; n < cola_responses.size(); n++)
   {
-    ros::ServiceClient service_client = m_nh->serviceClient<sick_lidar_localization::SickLocSetResultPoseIntervalSrv>("SickLocSetResultPoseInterval");
-    sick_lidar_localization::SickLocSetResultPoseIntervalSrv service_telegram;
-    service_telegram.request.interval = sim_configuration_map["SickLocSetResultPoseInterval"];
-    callService(service_telegram, service_client, retry_delay);
+    ConfigurationItem & setting = settings[setting_indices[n]];
+    int64_t value = -1;
+    if(parseResponseValue(cola_responses[n], setting.variable_name, setting.value_type, value))
+      setting.current_value = (int32_t)value;
+    else
+      ROS_WARN_STREAM("ColaConfiguration: could not read current value of \"" << setting.variable_name << "\", response " << sick_lidar_localization::Utils::flattenToString(cola_responses[n]));
   }
-  
-  // Transmit SickLocSetResultEndianness setting to localization
-  if(sim_configuration_map["SickLocRequestResultData"] > 0 && ros::ok() && m_nh && m_configuration_thread_running)
+}
+
+/*!
+ * Sends all configured settings different from the current value to the localization controller (pipelined "sMN" requests).
+ * The current value of a setting is updated after a successfull response.
+ * @param[in,out] settings result output settings
+ * @param[out] changed_settings names of the settings changed successfully
+ * @return number of failed settings (0: all settings configured)
+ */
+size_t sick_lidar_localization::ColaConfiguration::writeChangedSettings(std::vector<ConfigurationItem> & settings, std::vector<std::string> & changed_settings)
+{
+  std::vector<std::string> cola_requests;
+  std::vector<size_t> setting_indices;
+  for(size_t n = 0; n < settings.size(); n++)
   {
-    ros::ServiceClient service_client = m_nh->serviceClient<sick_lidar_localization::SickLocRequestResultDataSrv>("SickLocRequestResultData");
-    sick_lidar_localization::SickLocRequestResultDataSrv service_telegram;
-    callService(service_telegram, service_client, retry_delay);
+    if(settings[n].configured_value >= 0 && settings[n].current_value != settings[n].configured_value)
+    {
+      cola_requests.push_back("sMN " + settings[n].method_name + " +" + std::to_string(settings[n].configured_value));
+      setting_indices.push_back(n);
+    }
   }
-  
-  m_configuration_thread_running = false;
-  ROS_INFO_STREAM("ColaConfiguration: configuration thread finished");
+  std::vector<sick_lidar_localization::SickLocColaTelegramMsg> cola_responses = sendColaTelegrams(cola_requests);
+  size_t failed_settings = 0;
+  for(size_t n = 0; n < cola_responses.size(); n++)
+  {
+    ConfigurationItem & setting = settings[setting_indices[n]];
+    int64_t success = 0;
+    if(parseResponseValue(cola_responses[n], setting.method_name, sick_lidar_localization::ColaSchema::UINT8, success) && success > 0)
+    {
+      ROS_INFO_STREAM("ColaConfiguration: \"" << cola_requests[n] << "\" successfull (current value " << setting.current_value << ")");
+      setting.current_value = setting.configured_value;
+      changed_settings.push_back(setting.method_name);
+    }
+    else
+    {
+      ROS_WARN_STREAM("## ERROR ColaConfiguration: \"" << cola_requests[n] << "\" failed, response: " << sick_lidar_localization::Utils::flattenToString(cola_responses[n]));
+      failed_settings++;
+    }
+  }
+  return failed_settings;
+}
+
+/*!
+ * Sends cola requests pipelined and waits for all responses.
+ * @param[in] cola_requests cola requests (Cola-ASCII, f.e. "sRN LocResultPort")
+ * @return responses from localization controller (command_name empty in case of errors)
+ */
+std::vector<sick_lidar_localization::SickLocColaTelegramMsg> sick_lidar_localization::ColaConfiguration::sendColaTelegrams(const std::vector<std::string> & cola_requests)
+{
+  std::vector<boost::shared_future<sick_lidar_localization::SickLocColaTelegramMsg> > cola_futures;
+  std::vector<sick_lidar_localization::SickLocColaTelegramMsg> cola_responses(cola_requests.size());
+  for(size_t n = 0; n < cola_requests.size(); n++)
+    cola_futures.push_back(m_cola_services->sendColaTelegramAsync(cola_requests[n]));
+  for(size_t n = 0; n < cola_futures.size(); n++)
+  {
+    try
+    {
+      cola_responses[n] = cola_futures[n].get();
+    }
+    catch(const std::exception & exc) // request cancelled (boost::broken_promise)
+    {
+      ROS_WARN_STREAM("## ERROR ColaConfiguration: request \"" << cola_requests[n] << "\" cancelled, exception " << exc.what());
+    }
+  }
+  return cola_responses;
+}
+
+/*!
+ * Parses the first parameter of a cola response, returns true if the response matches the command name
+ * and the parameter is a valid value of the given type.
+ */
+bool sick_lidar_localization::ColaConfiguration::parseResponseValue(const sick_lidar_localization::SickLocColaTelegramMsg & cola_response, const std::string & command_name,
+  sick_lidar_localization::ColaSchema::COLA_TYPE value_type, int64_t & value)
+{
+  return cola_response.command_name == command_name && cola_response.parameter.size() > 0
+    && sick_lidar_localization::ColaSchema::parseColaAsciiValue(cola_response.parameter[0], value_type, value);
 }
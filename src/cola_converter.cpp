@@ -104,13 +104,9 @@ const std::map<std::string, uint8_t> sick_lidar_localization::ColaAsciiBinaryCon
  */
 std::string sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(const std::vector<uint8_t> & cola_telegram)
 {
-  std::stringstream cola_ascii;
-  for(std::vector<uint8_t>::const_iterator iter = cola_telegram.cbegin(); iter != cola_telegram.cend(); iter++)
-  {
-    // Convert binary to ascii by lookup table
-    cola_ascii << s_ascii_table[((*iter) & 0xFF)];
-  }
-  return cola_ascii.str();
+  std::string cola_ascii;
+  ConvertColaAscii(cola_telegram.data(), cola_telegram.size(), cola_ascii);
+  return cola_ascii;
 }
 
 /*!
@@ -121,23 +117,135 @@ std::string sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(
  */
 std::vector<uint8_t> sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(const std::string & cola_telegram)
 {
-  std::vector<uint8_t> cola_ascii;
-  cola_ascii.reserve(cola_telegram.size());
-  for(size_t char_cnt = 0; char_cnt < cola_telegram.size(); char_cnt++)
+  std::vector<uint8_t> cola_binary;
+  ConvertColaAscii(cola_telegram.data(), cola_telegram.size(), cola_binary);
+  return cola_binary;
+}
+
+/*!
+ * @brief Converts a Cola-ASCII telegram to string. The output string is resized and overwritten,
+ * i.e. its capacity is reused for repeated conversions.
+ * @param[in] cola_telegram Cola-ASCII telegram, starting with 0x02 and ending with 0x03
+ * @param[in] size number of bytes in cola_telegram
+ * @param[out] cola_ascii Cola-ASCII string, f.e. "<STX>sMN SetAccessMode 3 F4724744<ETX>"
+ */
+void sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(const uint8_t* cola_telegram, size_t size, std::string & cola_ascii)
+{
+  const LookupTable & lut = lookupTable();
+  // Compute the output length and convert into the preallocated string
+  size_t ascii_length = 0;
+  for(size_t n = 0; n < size; n++)
+    ascii_length += lut.binary_to_length[cola_telegram[n]];
+  cola_ascii.resize(ascii_length);
+  char* dst = &cola_ascii[0];
+  for(size_t n = 0; n < size; n++)
   {
-    cola_ascii.push_back(0); // default, overwrite by value converted from ascii
-    // Convert ascii string to binary by lookup table
-    for(std::map<std::string, uint8_t>::const_iterator map_iter = s_ascii_map.cbegin(); map_iter != s_ascii_map.cend(); map_iter++)
+    uint8_t length = lut.binary_to_length[cola_telegram[n]];
+    if(length == 1)
+      *dst = s_ascii_table[cola_telegram[n]][0];
+    else if(length > 1)
+      memcpy(dst, s_ascii_table[cola_telegram[n]].data(), length);
+    dst += length;
+  }
+}
+
+/*!
+ * @brief Converts a Cola telegram from Cola-ASCII string to binary. The output vector is resized and overwritten,
+ * i.e. its capacity is reused for repeated conversions.
+ * @param[in] cola_telegram Cola-ASCII string, f.e. "<STX>sMN SetAccessMode 3 F4724744<ETX>"
+ * @param[in] size number of characters in cola_telegram
+ * @param[out] cola_binary Cola-ASCII telegram, f.e. { 0x02, 0x73, 0x4D, 0x4E, ... , 0x03 }
+ */
+void sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(const char* cola_telegram, size_t size, std::vector<uint8_t> & cola_binary)
+{
+  const LookupTable & lut = lookupTable();
+  cola_binary.resize(size); // binary output is never longer than the ascii input
+  size_t binary_length = 0;
+  for(size_t char_cnt = 0; char_cnt < size; char_cnt++)
+  {
+    uint8_t value = lut.ascii_to_binary[(uint8_t)cola_telegram[char_cnt]];
+    if(cola_telegram[char_cnt] == '<') // tag like "<STX>" or "<ETX>"
     {
-      if(strncmp(map_iter->first.c_str(), cola_telegram.c_str() + char_cnt, map_iter->first.size()) == 0)
+      size_t tag_length = 0;
+      int tag_value = lut.findTag(cola_telegram + char_cnt, size - char_cnt, tag_length);
+      if(tag_value >= 0)
       {
-        cola_ascii.back() = map_iter->second;
-        char_cnt += (map_iter->first.size() - 1);
-        break;
+        value = (uint8_t)tag_value;
+        char_cnt += (tag_length - 1);
       }
     }
+    cola_binary[binary_length++] = value;
   }
-  return cola_ascii;
+  cola_binary.resize(binary_length);
+}
+
+/*!
+ * Constructor, generates the lookup tables from s_ascii_table and s_ascii_map.
+ */
+sick_lidar_localization::ColaAsciiBinaryConverter::LookupTable::LookupTable()
+{
+  memset(ascii_to_binary, 0, sizeof(ascii_to_binary));
+  memset(m_tag_keys, 0, sizeof(m_tag_keys));
+  memset(m_tag_values, 0, sizeof(m_tag_values));
+  for(size_t n = 0; n < 256; n++)
+    binary_to_length[n] = (uint8_t)s_ascii_table[n].size();
+  for(std::map<std::string, uint8_t>::const_iterator map_iter = s_ascii_map.cbegin(); map_iter != s_ascii_map.cend(); map_iter++)
+  {
+    const std::string & ascii = map_iter->first;
+    if(ascii.size() == 1)
+    {
+      ascii_to_binary[(uint8_t)ascii[0]] = map_iter->second;
+    }
+    else if((ascii.size() == 4 || ascii.size() == 5) && ascii.front() == '<' && ascii.back() == '>')
+    {
+      uint32_t tag_key = 0;
+      for(size_t m = ascii.size() - 2; m > 0; m--)
+        tag_key = ((tag_key << 8) | (uint8_t)ascii[m]);
+      size_t slot = tagHash(tag_key);
+      while(m_tag_keys[slot] != 0) // linear probing in case of hash collisions
+        slot = (slot + 1) % 64;
+      m_tag_keys[slot] = tag_key;
+      m_tag_values[slot] = map_iter->second;
+    }
+    else
+    {
+      ROS_ERROR_STREAM("## ERROR ColaAsciiBinaryConverter::LookupTable(): unsupported ascii mapping \"" << ascii << "\"");
+    }
+  }
+}
+
+/*!
+ * Returns the binary value of the tag starting at cola_telegram[0] (f.e. 0x02 for "<STX>"), or -1 if no tag found.
+ * @param[in] cola_telegram Cola-ASCII string starting with '<'
+ * @param[in] size number of characters in cola_telegram
+ * @param[out] tag_length number of characters of the tag found, f.e. 5 for "<STX>"
+ * @return binary value of the tag, or -1 if no tag found
+ */
+int sick_lidar_localization::ColaAsciiBinaryConverter::LookupTable::findTag(const char* cola_telegram, size_t size, size_t & tag_length) const
+{
+  for(tag_length = 4; tag_length <= 5 && tag_length <= size; tag_length++) // tags like "<HT>" or "<STX>"
+  {
+    if(cola_telegram[tag_length - 1] != '>')
+      continue;
+    uint32_t tag_key = 0;
+    for(size_t m = tag_length - 2; m > 0; m--)
+      tag_key = ((tag_key << 8) | (uint8_t)cola_telegram[m]);
+    for(size_t slot = tagHash(tag_key); m_tag_keys[slot] != 0; slot = (slot + 1) % 64)
+    {
+      if(m_tag_keys[slot] == tag_key)
+        return m_tag_values[slot];
+    }
+  }
+  return -1;
+}
+
+/*!
+ * @brief Returns the lookup tables, generated once at first call.
+ */
+const sick_lidar_localization::ColaAsciiBinaryConverter::LookupTable & sick_lidar_localization::ColaAsciiBinaryConverter::lookupTable(void)
+{
+  static const LookupTable s_lookup_table;
+  return s_lookup_table;
 }
 
 static uint8_t CRC8XOR(uint8_t* msgBlock, size_t len)
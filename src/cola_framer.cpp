@@ -0,0 +1,188 @@
+/*
+ * @brief cola_framer splits a tcp byte stream into Cola-ASCII and Cola-Binary telegrams.
+ * Data are appended in chunks as received, telegram boundaries (<STX>...<ETX> resp. 0x02020202 + length header)
+ * are searched incrementally, i.e. each byte is inspected once.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#include <algorithm>
+#include <ros/ros.h>
+#include <string.h>
+
+#include "sick_lidar_localization/cola_framer.h"
+
+/*!
+ * Constructor
+ * @param[in] max_telegram_size max. size of a telegram in byte, buffered data are discarded if a telegram exceeds this size, default: 1 MByte
+ */
+sick_lidar_localization::ColaFramer::ColaFramer(size_t max_telegram_size)
+: m_buffer(), m_head(0), m_scan_pos(0), m_max_telegram_size(max_telegram_size), m_chunk_timestamps()
+{
+  m_buffer.reserve(4096);
+}
+
+/*!
+ * Appends received data.
+ * @param[in] data data received
+ * @param[in] size number of bytes received
+ * @param[in] receive_timestamp receive timestamp (ros timestamp immediately after data received)
+ */
+void sick_lidar_localization::ColaFramer::push(const uint8_t* data, size_t size, const ros::Time & receive_timestamp)
+{
+  if(size == 0)
+    return;
+  // Remove data of telegrams already popped, i.e. move the start of the next telegram to m_buffer[0]
+  if(m_head > 0)
+  {
+    m_buffer.erase(m_buffer.begin(), m_buffer.begin() + m_head);
+    m_scan_pos -= m_head;
+    for(std::deque<std::pair<size_t, ros::Time> >::iterator iter = m_chunk_timestamps.begin(); iter != m_chunk_timestamps.end(); iter++)
+      iter->first = (iter->first > m_head) ? (iter->first - m_head) : 0;
+    m_head = 0;
+  }
+  m_chunk_timestamps.push_back(std::make_pair(m_buffer.size(), receive_timestamp));
+  m_buffer.insert(m_buffer.end(), data, data + size);
+}
+
+/*!
+ * Removes and returns the next complete telegram, if available.
+ * @param[out] telegram telegram received (Cola-Binary or Cola-Ascii)
+ * @param[out] receive_timestamp receive timestamp of the first telegram byte
+ * @return true if a complete telegram has been returned, false otherwise (telegram not yet completed)
+ */
+bool sick_lidar_localization::ColaFramer::pop(std::vector<uint8_t> & telegram, ros::Time & receive_timestamp)
+{
+  size_t telegram_end = 0;
+  if(!findTelegramEnd(telegram_end))
+    return false;
+  // Timestamp of the chunk containing the first telegram byte
+  while(m_chunk_timestamps.size() > 1 && m_chunk_timestamps[1].first <= m_head)
+    m_chunk_timestamps.pop_front();
+  receive_timestamp = m_chunk_timestamps.front().second;
+  telegram.assign(m_buffer.begin() + m_head, m_buffer.begin() + telegram_end);
+  m_head = telegram_end;
+  m_scan_pos = telegram_end;
+  if(m_head >= m_buffer.size()) // all buffered data popped
+    clear();
+  return true;
+}
+
+/*!
+ * Discards all buffered data, f.e. after reconnect.
+ */
+void sick_lidar_localization::ColaFramer::clear(void)
+{
+  m_buffer.clear();
+  m_head = 0;
+  m_scan_pos = 0;
+  m_chunk_timestamps.clear();
+}
+
+/*!
+ * Searches the end of the telegram starting at m_head.
+ * @param[out] telegram_end buffer index behind the last byte of the telegram
+ * @return true if the telegram is complete, false otherwise
+ */
+bool sick_lidar_localization::ColaFramer::findTelegramEnd(size_t & telegram_end)
+{
+  const uint8_t binary_stx = 0x02, ascii_etx = 0x03;
+  size_t buffered = m_buffer.size() - m_head;
+  if(buffered == 0)
+    return false;
+  // Cola-Binary telegrams start with 4 x <STX>, wait for 4 bytes until decided
+  size_t stx_cnt = 0;
+  while(stx_cnt < 4 && stx_cnt < buffered && m_buffer[m_head + stx_cnt] == binary_stx)
+    stx_cnt++;
+  if(stx_cnt == buffered && stx_cnt < 4)
+    return false;
+  if(stx_cnt == 4)
+  {
+    // Cola-Binary: 4 byte <STX>, 4 byte payload length, payload, 1 byte checksum
+    if(buffered < 8)
+      return false;
+    uint32_t payload_length = 0;
+    for(size_t n = m_head + 4; n < m_head + 8; n++)
+      payload_length = ((payload_length << 8) | m_buffer[n]);
+    uint64_t telegram_length = (uint64_t)payload_length + 9;
+    if(telegram_length > m_max_telegram_size)
+    {
+      resync("Cola-Binary telegram length " + std::to_string(telegram_length) + " exceeds max. telegram size " + std::to_string(m_max_telegram_size));
+      return false;
+    }
+    if(buffered < telegram_length)
+      return false;
+    telegram_end = m_head + (size_t)telegram_length;
+    return true;
+  }
+  // Cola-ASCII: search <ETX>, starting behind the bytes already searched
+  size_t scan_pos = std::max(m_scan_pos, m_head);
+  const uint8_t* etx = (const uint8_t*)memchr(m_buffer.data() + scan_pos, ascii_etx, m_buffer.size() - scan_pos);
+  if(etx)
+  {
+    telegram_end = (etx - m_buffer.data()) + 1;
+    return true;
+  }
+  m_scan_pos = m_buffer.size();
+  if(buffered > m_max_telegram_size)
+    resync("Cola-ASCII telegram exceeds max. telegram size " + std::to_string(m_max_telegram_size) + " without <ETX>");
+  return false;
+}
+
+/*!
+ * Discards all buffered data after an invalid telegram, telegrams are resynchronized with the next chunk.
+ * @param[in] reason error message
+ */
+void sick_lidar_localization::ColaFramer::resync(const std::string & reason)
+{
+  ROS_WARN_STREAM("## ERROR ColaFramer: " << reason << ", " << size() << " byte discarded.");
+  clear();
+}
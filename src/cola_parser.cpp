@@ -60,7 +60,8 @@
  */
 #include <ros/ros.h>
 #include <cassert>
-#include <boost/algorithm/string.hpp>
+#include <ctype.h>
+#include <sstream>
 
 #include "sick_lidar_localization/cola_parser.h"
 
@@ -129,48 +130,106 @@ sick_lidar_localization::SickLocColaTelegramMsg sick_lidar_localization::ColaPar
  */
 sick_lidar_localization::SickLocColaTelegramMsg sick_lidar_localization::ColaParser::decodeColaTelegram(const std::string & cola_ascii)
 {
+  ColaTelegramView telegram_view;
+  if(!tokenizeColaTelegram(cola_ascii, telegram_view))
+    return createColaTelegram(sINVALID, "");
+  sick_lidar_localization::SickLocColaTelegramMsg cola_telegram = createColaTelegram(telegram_view.command_type, telegram_view.command_name.to_string());
+  if(telegram_view.has_parameter)
+  {
+    cola_telegram.parameter.reserve(telegram_view.parameterCount());
+    size_t pos = 0;
+    boost::string_view parameter;
+    while(telegram_view.nextParameter(pos, parameter))
+      cola_telegram.parameter.push_back(parameter.to_string());
+  }
+  return cola_telegram;
+}
+
+/*!
+ * @brief Splits a Cola-ASCII telegram into command type, command name and parameter without copying or allocating.
+ * decodeColaTelegram() uses this tokenizer and copies the result into a SickLocColaTelegramMsg.
+ * @param[in] cola_ascii Cola-ASCII telegram, f.e. "<STX>sAN LocRequestTimestamp 1EAF3F4<ETX>"
+ * @param[out] telegram_view tokenized telegram with views into cola_ascii
+ * @return true on success, false on parse error (command_type of telegram_view will be sINVALID)
+ */
+bool sick_lidar_localization::ColaParser::tokenizeColaTelegram(const boost::string_view & cola_ascii, ColaTelegramView & telegram_view)
+{
+  telegram_view = ColaTelegramView();
   // Check and remove start and end tags ("<STX>" and "<ETX>")
-  std::string cola_ascii_cmd;
+  boost::string_view cola_ascii_cmd = cola_ascii;
   if (cola_ascii.size() > s_cola_ascii_start_tag.size() + s_cola_ascii_end_tag.size()
-    && cola_ascii.substr(0, s_cola_ascii_start_tag.size()) == s_cola_ascii_start_tag
-    && cola_ascii.substr(cola_ascii.size() - s_cola_ascii_end_tag.size()) == s_cola_ascii_end_tag)
+    && cola_ascii.starts_with(s_cola_ascii_start_tag) && cola_ascii.ends_with(s_cola_ascii_end_tag))
   {
     cola_ascii_cmd = cola_ascii.substr(s_cola_ascii_start_tag.size(), cola_ascii.size() - s_cola_ascii_start_tag.size() - s_cola_ascii_end_tag.size());
   }
-  else
-  {
-    cola_ascii_cmd = cola_ascii;
-  }
   // Split in command_type, command_name and optional parameter by spaces
-  std::vector<std::string> cola_parts;
-  boost::split(cola_parts, cola_ascii_cmd, boost::algorithm::is_space());
-  if(cola_parts.size() < 2) // at least command_type and command_name required
+  size_t type_end = 0, name_end = 0;
+  while(type_end < cola_ascii_cmd.size() && !isspace((unsigned char)cola_ascii_cmd[type_end]))
+    type_end++;
+  if(type_end >= cola_ascii_cmd.size()) // at least command_type and command_name required
   {
     ROS_WARN_STREAM("## ERROR Parse error in ColaParser::decodeColaTelegram(\"" << cola_ascii_cmd << "\"): to few arguments, at least command_type and command_name required");
-    return createColaTelegram(sINVALID, "");
+    return false;
   }
+  name_end = type_end + 1;
+  while(name_end < cola_ascii_cmd.size() && !isspace((unsigned char)cola_ascii_cmd[name_end]))
+    name_end++;
   // Convert command_type from string to COLA_SOPAS_COMMAND
-  sick_lidar_localization::ColaParser::COLA_SOPAS_COMMAND command_type = convertSopasCommand(cola_parts[0]);
-  if(command_type == sINVALID)
+  boost::string_view command_type = cola_ascii_cmd.substr(0, type_end);
+  if(findSopasCommand(command_type) == sINVALID)
   {
-    ROS_WARN_STREAM("## ERROR Parse error in ColaParser::decodeColaTelegram(\"" << cola_ascii_cmd << "\"): invalid command_type \"" << cola_parts[0] << "\"");
-    return createColaTelegram(sINVALID, "");
+    ROS_WARN_STREAM("## ERROR Parse error in ColaParser::decodeColaTelegram(\"" << cola_ascii_cmd << "\"): invalid command_type \"" << command_type << "\"");
+    return false;
   }
   // Check command_name
-  if(cola_parts[1].empty())
+  boost::string_view command_name = cola_ascii_cmd.substr(type_end + 1, name_end - type_end - 1);
+  if(command_name.empty())
   {
-    ROS_WARN_STREAM("## ERROR Parse error in ColaParser::decodeColaTelegram(\"" << cola_ascii_cmd << "\"): invalid command_name \"" << cola_parts[1] << "\"");
-    return createColaTelegram(sINVALID, "");
+    ROS_WARN_STREAM("## ERROR Parse error in ColaParser::decodeColaTelegram(\"" << cola_ascii_cmd << "\"): invalid command_name \"" << command_name << "\"");
+    return false;
   }
-  // Append command parameter
-  sick_lidar_localization::SickLocColaTelegramMsg cola_telegram = createColaTelegram(command_type, cola_parts[1]);
-  if(cola_parts.size() > 2)
+  telegram_view.command_type = findSopasCommand(command_type);
+  telegram_view.command_name = command_name;
+  // Optional parameter following the command_name
+  telegram_view.has_parameter = (name_end < cola_ascii_cmd.size());
+  if(telegram_view.has_parameter)
+    telegram_view.parameter_list = cola_ascii_cmd.substr(name_end + 1);
+  return true;
+}
+
+/*!
+ * @brief Returns the next parameter starting at parameter_list[pos] and moves pos behind the parameter.
+ * Parameter are separated by single spaces, i.e. consecutive spaces result in empty parameter.
+ * @param[in,out] pos start position in parameter_list, initially 0
+ * @param[out] parameter next parameter
+ * @return true if a parameter has been returned, false if no more parameter
+ */
+bool sick_lidar_localization::ColaParser::ColaTelegramView::nextParameter(size_t & pos, boost::string_view & parameter) const
+{
+  if(!has_parameter || pos > parameter_list.size())
+    return false;
+  size_t end = pos;
+  while(end < parameter_list.size() && !isspace((unsigned char)parameter_list[end]))
+    end++;
+  parameter = parameter_list.substr(pos, end - pos);
+  pos = end + 1;
+  return true;
+}
+
+/*!
+ * @brief Returns the number of parameter.
+ */
+size_t sick_lidar_localization::ColaParser::ColaTelegramView::parameterCount(void) const
+{
+  if(!has_parameter)
+    return 0;
+  size_t parameter_cnt = 1;
+  for(size_t n = 0; n < parameter_list.size(); n++)
   {
-    cola_telegram.parameter.reserve(cola_parts.size() - 2);
-    for(size_t n = 2; n < cola_parts.size(); n++)
-      cola_telegram.parameter.push_back(cola_parts[n]);
+    if(isspace((unsigned char)parameter_list[n]))
+      parameter_cnt++;
   }
-  return cola_telegram;
+  return parameter_cnt;
 }
 
 /*!
@@ -229,3 +288,18 @@ sick_lidar_localization::ColaParser::COLA_SOPAS_COMMAND sick_lidar_localization:
   return command_type;
 }
 
+/*!
+ * @brief Converts and returns a COLA_SOPAS_COMMAND from a string view without allocating.
+ * @param[in] sopas_command One of the SOPAS commands ("sRN", "sRA", "sMN", "sMA", or "sWN")
+ * @return COLA_SOPAS_COMMAND, or sINVALID for unknown commands
+ */
+sick_lidar_localization::ColaParser::COLA_SOPAS_COMMAND sick_lidar_localization::ColaParser::findSopasCommand(const boost::string_view & sopas_command)
+{
+  for(int command_type = sINVALID + 1; command_type < MAX_COLA_COMMAND_NUMBER; command_type++)
+  {
+    if(sopas_command == s_command_type_string[command_type])
+      return (COLA_SOPAS_COMMAND)command_type;
+  }
+  return sINVALID;
+}
+
@@ -0,0 +1,413 @@
+/*
+ * @brief cola_request_engine sends cola requests to the localization controller and matches the responses to the
+ * outstanding requests, i.e. several cola requests can be in flight on one tcp connection at the same time.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <ros/ros.h>
+
+#include "sick_lidar_localization/cola_converter.h"
+#include "sick_lidar_localization/cola_request_engine.h"
+#include "sick_lidar_localization/utils.h"
+
+/*!
+ * Constructor. The engine does not connect automatically, call start() and stop() to start and stop.
+ * @param[in] server_adress ip adress of the localization controller, default: 192.168.0.1
+ * @param[in] tcp_port tcp port for command requests, default: 2111
+ * @param[in] max_outstanding_requests max. number of requests in flight at the same time, default: 4 (1: one request at a time)
+ */
+sick_lidar_localization::ColaRequestEngine::ColaRequestEngine(const std::string & server_adress, int tcp_port, int max_outstanding_requests)
+: m_transmitter(server_adress, tcp_port), m_max_outstanding_requests(std::max(1, max_outstanding_requests)), m_running(false), m_link_error(false),
+  m_last_receive_timestamp(), m_timer_work(0), m_timer_thread(0), m_receiver_thread(0)
+{
+}
+
+/*!
+ * Destructor, stops the engine and closes the tcp connection.
+ */
+sick_lidar_localization::ColaRequestEngine::~ColaRequestEngine()
+{
+  stop();
+}
+
+/*!
+ * Connects to the localization controller and starts the receiver and timer threads. The engine can be restarted after stop().
+ * @return true on success, false on failure (localization controller unknown or unreachable)
+ */
+bool sick_lidar_localization::ColaRequestEngine::start(void)
+{
+  if(!m_transmitter.connect())
+  {
+    ROS_WARN_STREAM("## ERROR ColaRequestEngine::start(): can't connect to localization controller");
+    return false;
+  }
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_running = true;
+    m_link_error = false;
+    m_timed_out_requests.clear();
+  }
+  m_timer_service.reset(); // restart after stop()
+  m_timer_work = new boost::asio::io_service::work(m_timer_service);
+  m_timer_thread = new boost::thread([this](){ m_timer_service.run(); });
+  m_receiver_thread = new boost::thread(&sick_lidar_localization::ColaRequestEngine::runReceiverThreadCb, this);
+  return true;
+}
+
+/*!
+ * Stops the receiver and timer threads and closes the tcp connection. Outstanding requests fail immediately.
+ * Can be called by any thread, also while other threads call transmit().
+ */
+void sick_lidar_localization::ColaRequestEngine::stop(void)
+{
+  {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_running = false;
+    while(!m_pending_requests.empty())
+      completeRequest(m_pending_requests.begin(), false);
+  }
+  // Shutdown wakes up the receiver thread and fails concurrent sends, the socket is closed after the receiver thread
+  // has finished and no thread is sending, i.e. the socket handle is never closed while in use by another thread
+  m_transmitter.shutdown();
+  if(m_receiver_thread)
+  {
+    m_receiver_thread->join();
+    delete(m_receiver_thread);
+    m_receiver_thread = 0;
+  }
+  {
+    boost::lock_guard<boost::mutex> send_lock(m_send_mutex);
+    m_transmitter.close();
+  }
+  if(m_timer_thread)
+  {
+    delete(m_timer_work);
+    m_timer_work = 0;
+    m_timer_service.stop();
+    m_timer_thread->join();
+    delete(m_timer_thread);
+    m_timer_thread = 0;
+  }
+}
+
+/*!
+ * Sends a request and waits for the matching response with timeout.
+ * @param[in] request Cola-ASCII or Cola-Binary request telegram
+ * @param[in] timeout timeout in seconds for the response
+ * @param[out] response response telegram received (Cola-Binary or Cola-Ascii)
+ * @param[out] send_timestamp send timestamp (ros timestamp immediately before tcp send)
+ * @param[out] receive_timestamp receive timestamp (ros timestamp immediately after first response byte received)
+ * @return true on success, false on failure (connection error or timeout)
+ */
+bool sick_lidar_localization::ColaRequestEngine::transmit(const std::vector<uint8_t> & request, double timeout, std::vector<uint8_t> & response, ros::Time & send_timestamp, ros::Time & receive_timestamp)
+{
+  response.clear();
+  PendingRequestPtr pending_request(new PendingRequest(m_timer_service));
+  if(!parseCommand(request, pending_request->command_type, pending_request->command_name))
+  {
+    ROS_WARN_STREAM("## ERROR ColaRequestEngine::transmit(): invalid cola request " << sick_lidar_localization::Utils::toHexString(request));
+    return false;
+  }
+  boost::posix_time::microseconds timeout_usec((int64_t)(1.0e6 * std::max(0.0, timeout)));
+  {
+    // Wait until less than m_max_outstanding_requests requests in flight
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    boost::system_time wait_end = boost::get_system_time() + timeout_usec;
+    while(m_running && !m_link_error && m_pending_requests.size() >= m_max_outstanding_requests && m_condition.timed_wait(lock, wait_end))
+    {
+    }
+    if(!m_running || m_link_error || m_pending_requests.size() >= m_max_outstanding_requests)
+    {
+      ROS_WARN_STREAM("## ERROR ColaRequestEngine::transmit(): " << (!m_running ? "engine not running" : (m_link_error ? "link error" : "too many outstanding requests")) << ", request \""
+        << pending_request->command_type << " " << pending_request->command_name << "\" not sent");
+      return false;
+    }
+    m_pending_requests.push_back(pending_request); // registered before sending, the response can be received immediately after send
+  }
+  bool send_ok = false;
+  {
+    boost::lock_guard<boost::mutex> send_lock(m_send_mutex);
+    send_ok = m_transmitter.send(request, pending_request->send_timestamp);
+  }
+  boost::unique_lock<boost::mutex> lock(m_mutex);
+  if(!pending_request->completed)
+  {
+    std::list<PendingRequestPtr>::iterator iter_request = std::find(m_pending_requests.begin(), m_pending_requests.end(), pending_request);
+    if(!send_ok)
+    {
+      ROS_WARN_STREAM("## ERROR ColaRequestEngine::transmit(): send() failed, request \"" << pending_request->command_type << " " << pending_request->command_name << "\"");
+      m_link_error = true;
+      completeRequest(iter_request, false);
+    }
+    else
+    {
+      // Start the timer for the response timeout
+      pending_request->timer.expires_from_now(timeout_usec);
+      pending_request->timer.async_wait(boost::bind(&sick_lidar_localization::ColaRequestEngine::onTimeout, this, pending_request, boost::asio::placeholders::error));
+    }
+  }
+  while(!pending_request->completed)
+    m_condition.wait(lock);
+  if(pending_request->success)
+  {
+    response.swap(pending_request->response);
+    send_timestamp = pending_request->send_timestamp;
+    receive_timestamp = pending_request->receive_timestamp;
+  }
+  return pending_request->success;
+}
+
+/*!
+ * Returns true after a connection error, i.e. if the connection has been closed by the localization controller,
+ * receiving or sending failed, a request timed out without any response received since the request was sent,
+ * or a request timed out again before the late response of its previous timeout arrived. The engine should be
+ * stopped and restarted in this case.
+ */
+bool sick_lidar_localization::ColaRequestEngine::linkError(void)
+{
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  return m_link_error;
+}
+
+/*!
+ * Sets the callback for event telegrams ("sSN"). Event telegrams are discarded, if no callback is set.
+ * @param[in] event_callback callback for event telegrams
+ */
+void sick_lidar_localization::ColaRequestEngine::setEventCallback(const EventCallback & event_callback)
+{
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  m_event_callback = event_callback;
+}
+
+/*!
+ * Splits a Cola-ASCII or Cola-Binary telegram into command type and command name,
+ * f.e. "sRA" and "LocState" for "<STX>sRA LocState 2<ETX>"
+ * @param[in] telegram Cola-ASCII or Cola-Binary telegram
+ * @param[out] command_type command type, f.e. "sRA"
+ * @param[out] command_name command name, f.e. "LocState" (empty for error responses "sFA")
+ * @return true on success, false if telegram is not a valid cola telegram
+ */
+bool sick_lidar_localization::ColaRequestEngine::parseCommand(const std::vector<uint8_t> & telegram, std::string & command_type, std::string & command_name)
+{
+  const uint8_t ascii_stx = 0x02, ascii_etx = 0x03, separator = 0x20;
+  command_type.clear();
+  command_name.clear();
+  // Payload without header and trailer: Cola-Binary: 8 byte header (0x02020202 + length) and 1 byte checksum, Cola-ASCII: <STX> and <ETX>
+  size_t start = 0, end = telegram.size();
+  if(sick_lidar_localization::ColaAsciiBinaryConverter::IsColaBinary(telegram))
+  {
+    start = 8;
+    end = std::max(start, std::min(end, (size_t)sick_lidar_localization::ColaAsciiBinaryConverter::ColaBinaryTelegramLength(telegram)) - 1);
+  }
+  else
+  {
+    if(start < end && telegram[start] == ascii_stx)
+      start++;
+    if(start < end && telegram[end - 1] == ascii_etx)
+      end--;
+  }
+  size_t pos = start;
+  while(pos < end && telegram[pos] != separator)
+    command_type.push_back((char)telegram[pos++]);
+  for(pos++; pos < end && telegram[pos] != separator; pos++)
+    command_name.push_back((char)telegram[pos]);
+  return !command_type.empty() && (!command_name.empty() || command_type == "sFA");
+}
+
+/*!
+ * Returns true, if a response with the given command type and name answers a request with the given command type and name.
+ */
+bool sick_lidar_localization::ColaRequestEngine::responseMatchesRequest(const std::string & response_type, const std::string & response_name, const std::string & request_type, const std::string & request_name)
+{
+  if(response_name != request_name)
+    return false;
+  if(request_type == "sRN")
+    return response_type == "sRA";
+  if(request_type == "sWN")
+    return response_type == "sWA";
+  if(request_type == "sMN")
+    return response_type == "sAN" || response_type == "sMA";
+  if(request_type == "sEN")
+    return response_type == "sEA";
+  return true; // unknown request type: match by command name
+}
+
+/*!
+ * Completes a pending request and removes it from the list of outstanding requests. Must be called with m_mutex locked.
+ */
+void sick_lidar_localization::ColaRequestEngine::completeRequest(std::list<PendingRequestPtr>::iterator iter_request, bool success)
+{
+  if(iter_request == m_pending_requests.end())
+    return;
+  PendingRequestPtr request = *iter_request;
+  boost::system::error_code error;
+  request->timer.cancel(error);
+  request->completed = true;
+  request->success = success;
+  m_pending_requests.erase(iter_request);
+  m_condition.notify_all();
+}
+
+/*!
+ * Discards a late response to a timed out request. Must be called with m_mutex locked.
+ * @param[in] response_type command type of the response
+ * @param[in] response_name command name of the response
+ * @return true if the response answers a timed out request (response discarded), false otherwise
+ */
+bool sick_lidar_localization::ColaRequestEngine::discardLateResponse(const std::string & response_type, const std::string & response_name)
+{
+  std::list<CommandId>::iterator iter_timed_out = m_timed_out_requests.begin();
+  while(iter_timed_out != m_timed_out_requests.end() && !responseMatchesRequest(response_type, response_name, iter_timed_out->first, iter_timed_out->second))
+    iter_timed_out++;
+  if(iter_timed_out == m_timed_out_requests.end() && response_type == "sFA")
+    iter_timed_out = m_timed_out_requests.begin(); // error response without command name: assigned to the oldest timed out request
+  if(iter_timed_out == m_timed_out_requests.end())
+    return false;
+  ROS_WARN_STREAM("## ERROR ColaRequestEngine: late response \"" << response_type << " " << response_name << "\" to timed out request \""
+    << iter_timed_out->first << " " << iter_timed_out->second << "\", response discarded");
+  m_timed_out_requests.erase(iter_timed_out);
+  return true;
+}
+
+/*!
+ * Timer callback, completes a request with timeout error.
+ */
+void sick_lidar_localization::ColaRequestEngine::onTimeout(PendingRequestPtr request, const boost::system::error_code & error)
+{
+  if(error == boost::asio::error::operation_aborted)
+    return; // timer cancelled, response received
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  if(request->completed)
+    return;
+  CommandId command_id(request->command_type, request->command_name);
+  if(m_last_receive_timestamp < request->send_timestamp)
+    m_link_error = true; // nothing received since the request was sent
+  else if(std::find(m_timed_out_requests.begin(), m_timed_out_requests.end(), command_id) != m_timed_out_requests.end())
+    m_link_error = true; // still no late response to a previous timeout of this request, responses can't be assigned reliably
+  else
+    m_timed_out_requests.push_back(command_id); // connection alive, discard the late response of this request
+  ROS_WARN_STREAM("## ERROR ColaRequestEngine: timeout while waiting for response to \"" << request->command_type << " " << request->command_name << "\""
+    << (m_link_error ? ", link error" : ""));
+  completeRequest(std::find(m_pending_requests.begin(), m_pending_requests.end(), request), false);
+}
+
+/*!
+ * Thread callback, receives response telegrams and dispatches them to the outstanding requests resp. event telegrams to the event callback.
+ */
+void sick_lidar_localization::ColaRequestEngine::runReceiverThreadCb(void)
+{
+  std::vector<uint8_t> telegram;
+  std::string command_type, command_name;
+  while(ros::ok())
+  {
+    {
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      if(!m_running)
+        break;
+    }
+    ros::Time receive_timestamp;
+    bool connection_error = false;
+    if(!m_transmitter.receive(telegram, 0.1, receive_timestamp, connection_error))
+    {
+      if(!connection_error)
+        continue; // no response received within 0.1 seconds, check m_running and retry
+      // Connection closed by the localization controller or socket error: outstanding requests fail immediately
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      if(m_running)
+      {
+        ROS_WARN_STREAM("## ERROR ColaRequestEngine: connection to localization controller closed or failed, link error");
+        m_link_error = true;
+        while(!m_pending_requests.empty())
+          completeRequest(m_pending_requests.begin(), false);
+      }
+      break; // no more telegrams on this connection
+    }
+    if(!parseCommand(telegram, command_type, command_name))
+    {
+      ROS_WARN_STREAM("## ERROR ColaRequestEngine: invalid cola telegram " << sick_lidar_localization::Utils::toHexString(telegram) << " received, telegram discarded");
+      continue;
+    }
+    if(command_type == "sSN") // event telegram, no response to a request
+    {
+      EventCallback event_callback;
+      {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        m_last_receive_timestamp = receive_timestamp;
+        event_callback = m_event_callback;
+      }
+      if(event_callback)
+        event_callback(telegram, receive_timestamp); // called without m_mutex locked
+      else
+        ROS_DEBUG_STREAM("ColaRequestEngine: event \"" << command_type << " " << command_name << "\" without event callback, event discarded");
+      continue;
+    }
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_last_receive_timestamp = receive_timestamp;
+    if(discardLateResponse(command_type, command_name)) // requests with identical names are answered in order, i.e. the late response arrives first
+      continue;
+    std::list<PendingRequestPtr>::iterator iter_request = m_pending_requests.begin();
+    while(iter_request != m_pending_requests.end() && !responseMatchesRequest(command_type, command_name, (*iter_request)->command_type, (*iter_request)->command_name))
+      iter_request++;
+    if(iter_request == m_pending_requests.end() && command_type == "sFA")
+      iter_request = m_pending_requests.begin(); // error response without command name: assigned to the oldest request
+    if(iter_request == m_pending_requests.end())
+    {
+      ROS_WARN_STREAM("## ERROR ColaRequestEngine: unexpected response \"" << command_type << " " << command_name << "\" without request, response discarded");
+      continue;
+    }
+    (*iter_request)->response = telegram;
+    (*iter_request)->receive_timestamp = receive_timestamp;
+    completeRequest(iter_request, true);
+  }
+}
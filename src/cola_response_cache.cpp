@@ -0,0 +1,202 @@
+/*
+ * @brief cola_response_cache caches responses to read-only Cola variables with a time to live per variable.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#include <ros/ros.h>
+#include <sstream>
+
+#include "sick_lidar_localization/cola_response_cache.h"
+#include "sick_lidar_localization/monotonic_clock.h"
+
+/*!
+ * @brief methods which never change any variable, i.e. they do not invalidate cached responses
+ */
+const std::set<std::string> sick_lidar_localization::ColaResponseCache::s_read_only_methods = { "IsSystemReady", "LocRequestTimestamp", "LocRequestResultData" };
+
+/*!
+ * Constructor
+ * @param[in] time_to_live time to live in seconds for each cached variable, f.e. { {"LocState", 0.5}, {"LocResultState", 0.5} }
+ */
+sick_lidar_localization::ColaResponseCache::ColaResponseCache(const std::map<std::string, double> & time_to_live)
+: m_time_to_live(time_to_live), m_generation(0), m_hits(0), m_misses(0)
+{
+}
+
+/*!
+ * Sets the time to live in seconds for each cached variable. Variables not listed (or with time to live <= 0) are not cached.
+ * @param[in] time_to_live time to live in seconds for each cached variable, f.e. { {"LocState", 0.5}, {"LocResultState", 0.5} }
+ */
+void sick_lidar_localization::ColaResponseCache::setTimeToLive(const std::map<std::string, double> & time_to_live)
+{
+  boost::lock_guard<boost::mutex> cache_lockguard(m_cache_mutex);
+  m_time_to_live = time_to_live;
+  m_cache.clear();
+  m_generation++;
+}
+
+/*!
+ * Returns the type of a cola request and the time to live of cacheable requests (m_cache_mutex must be locked).
+ * @param[in] cola_ascii_request Cola-ASCII request, f.e. "sRN LocState"
+ * @param[out] time_to_live time to live in seconds of cacheable requests
+ * @return type of request
+ */
+sick_lidar_localization::ColaResponseCache::REQUEST_TYPE sick_lidar_localization::ColaResponseCache::requestType(const std::string & cola_ascii_request, double & time_to_live)
+{
+  time_to_live = 0;
+  sick_lidar_localization::ColaParser::ColaTelegramView telegram_view;
+  if(!sick_lidar_localization::ColaParser::tokenizeColaTelegram(cola_ascii_request, telegram_view))
+    return UNCACHED;
+  std::string command_name = telegram_view.command_name.to_string();
+  bool read_only_method = (telegram_view.command_type == sick_lidar_localization::ColaParser::sMN && s_read_only_methods.find(command_name) != s_read_only_methods.end());
+  if(telegram_view.command_type == sick_lidar_localization::ColaParser::sRN || read_only_method)
+  {
+    std::map<std::string, double>::const_iterator iter_ttl = m_time_to_live.find(command_name);
+    if(iter_ttl != m_time_to_live.end() && iter_ttl->second > 0)
+    {
+      time_to_live = iter_ttl->second;
+      return CACHEABLE;
+    }
+    return UNCACHED;
+  }
+  if(telegram_view.command_type == sick_lidar_localization::ColaParser::sWN || telegram_view.command_type == sick_lidar_localization::ColaParser::sMN)
+    return INVALIDATES;
+  return UNCACHED;
+}
+
+/*!
+ * Returns a cached response for a cola request, if the request is cacheable and the cached response has not
+ * yet expired. If the request is a write or method, all cached responses are invalidated.
+ * @param[in] cola_ascii_request Cola-ASCII request, f.e. "sRN LocState"
+ * @param[out] cola_response cached response (if true returned)
+ * @param[out] generation generation of the cache, to be passed to update() after transmitting the request
+ * @return true if a cached response is returned, false otherwise (request must be sent to the localization controller)
+ */
+bool sick_lidar_localization::ColaResponseCache::lookup(const std::string & cola_ascii_request, sick_lidar_localization::SickLocColaTelegramSrv::Response & cola_response, uint64_t & generation)
+{
+  boost::lock_guard<boost::mutex> cache_lockguard(m_cache_mutex);
+  double time_to_live = 0;
+  REQUEST_TYPE request_type = requestType(cola_ascii_request, time_to_live);
+  if(request_type == INVALIDATES)
+  {
+    m_cache.clear();
+    m_generation++;
+  }
+  generation = m_generation;
+  if(request_type != CACHEABLE)
+    return false;
+  std::map<std::string, CacheEntry>::iterator iter_cache = m_cache.find(cola_ascii_request);
+  if(iter_cache != m_cache.end() && sick_lidar_localization::MonotonicClock::now() < iter_cache->second.expiration_time)
+  {
+    cola_response = iter_cache->second.cola_response;
+    m_hits++;
+    return true;
+  }
+  m_misses++;
+  return false;
+}
+
+/*!
+ * Updates the cache after a request has been transmitted: a successful response to a cacheable request is
+ * cached, a write or method invalidates all cached responses.
+ * @param[in] cola_ascii_request Cola-ASCII request, f.e. "sRN LocState"
+ * @param[in] success true if the request has been successfully transmitted
+ * @param[in] cola_response response from localization controller
+ * @param[in] generation generation returned by lookup()
+ */
+void sick_lidar_localization::ColaResponseCache::update(const std::string & cola_ascii_request, bool success, const sick_lidar_localization::SickLocColaTelegramSrv::Response & cola_response, uint64_t generation)
+{
+  boost::lock_guard<boost::mutex> cache_lockguard(m_cache_mutex);
+  double time_to_live = 0;
+  REQUEST_TYPE request_type = requestType(cola_ascii_request, time_to_live);
+  if(request_type == INVALIDATES) // invalidate again, reads during the write may have returned the previous value
+  {
+    m_cache.clear();
+    m_generation++;
+  }
+  else if(request_type == CACHEABLE && success && generation == m_generation)
+  {
+    CacheEntry & cache_entry = m_cache[cola_ascii_request];
+    cache_entry.cola_response = cola_response;
+    cache_entry.expiration_time = sick_lidar_localization::MonotonicClock::now() + time_to_live;
+  }
+}
+
+/*!
+ * Invalidates all cached responses.
+ */
+void sick_lidar_localization::ColaResponseCache::invalidate(void)
+{
+  boost::lock_guard<boost::mutex> cache_lockguard(m_cache_mutex);
+  m_cache.clear();
+  m_generation++;
+}
+
+/*!
+ * Returns the default time to live of cached variables: 0.5 seconds for "LocState", "LocResultState" and "IsSystemReady".
+ */
+std::map<std::string, double> sick_lidar_localization::ColaResponseCache::defaultTimeToLive(void)
+{
+  std::map<std::string, double> time_to_live = { {"LocState", 0.5}, {"LocResultState", 0.5}, {"IsSystemReady", 0.5} };
+  return time_to_live;
+}
+
+/*!
+ * Returns the number of cache hits and misses in a readable format, f.e. for logging
+ */
+std::string sick_lidar_localization::ColaResponseCache::statistics(void)
+{
+  boost::lock_guard<boost::mutex> cache_lockguard(m_cache_mutex);
+  std::stringstream s;
+  s << m_hits << " hits, " << m_misses << " misses";
+  return s.str();
+}
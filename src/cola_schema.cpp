@@ -0,0 +1,428 @@
+/*
+ * @brief cola_schema encodes and decodes Cola-Binary telegrams directly from native values.
+ * Parameter types of the supported commands are given by a command schema, f.e. LocSetPose(int32,int32,int32,uint16),
+ * i.e. Cola-Binary parameter are not converted from and to hex strings.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#include <ros/ros.h>
+#include <stdio.h>
+
+#include "sick_lidar_localization/cola_converter.h"
+#include "sick_lidar_localization/cola_schema.h"
+
+/*!
+ * Returns the command schema table (parameter types of requests and responses), see Telegram-Listing-v1.1.0.241R.pdf
+ */
+const std::vector<sick_lidar_localization::ColaSchema::CommandSchema> & sick_lidar_localization::ColaSchema::commandSchemaTable(void)
+{
+  static const std::vector<CommandSchema> s_command_schema_table =
+    {
+      // command_name             request_types                  response_types
+      { "IsSystemReady",            {},                            {UINT8} },
+      { "LocState",                 {},                            {UINT8} },
+      { "LocResultState",           {},                            {UINT8} },
+      { "LocMapState",              {},                            {UINT8} },
+      { "LocResultPort",            {},                            {UINT16} },
+      { "LocResultMode",            {},                            {UINT8} },
+      { "LocResultEndianness",      {},                            {UINT8} },
+      { "LocResultPoseInterval",    {},                            {UINT8} },
+      { "LocStartLocalizing",       {},                            {UINT8} },
+      { "LocStop",                  {},                            {UINT8} },
+      { "LocStopAndSave",           {},                            {UINT8} },
+      { "LocSetResultPort",         {UINT16},                      {UINT8} },
+      { "LocSetResultMode",         {UINT8},                       {UINT8} },
+      { "LocSetResultPoseEnabled",  {UINT8},                       {UINT8} },
+      { "LocSetResultEndianness",   {UINT8},                       {UINT8} },
+      { "LocSetResultPoseInterval", {UINT8},                       {UINT8} },
+      { "LocRequestResultData",     {},                            {UINT8} },
+      { "LocSetPose",               {INT32, INT32, INT32, UINT16}, {UINT8} },
+      { "LocRequestTimestamp",      {},                            {UINT32} },
+      { "SetAccessMode",            {INT8, UINT32},                {UINT8} },
+      { "Run",                      {},                            {UINT8} }
+    };
+  return s_command_schema_table;
+}
+
+/*!
+ * Returns true for request command types (sRN, sMN, sWN, sEN)
+ */
+bool sick_lidar_localization::ColaSchema::isRequest(sick_lidar_localization::ColaParser::COLA_SOPAS_COMMAND command_type)
+{
+  return command_type == sick_lidar_localization::ColaParser::sRN || command_type == sick_lidar_localization::ColaParser::sMN
+    || command_type == sick_lidar_localization::ColaParser::sWN || command_type == sick_lidar_localization::ColaParser::sEN;
+}
+
+/*!
+ * Returns true if value is in range of a parameter type
+ */
+bool sick_lidar_localization::ColaSchema::inRange(COLA_TYPE type, int64_t value)
+{
+  int bits = 8 * (int)typeSize(type);
+  if(typeSigned(type))
+    return value >= -((int64_t)1 << (bits - 1)) && value < ((int64_t)1 << (bits - 1));
+  return value >= 0 && value < ((int64_t)1 << bits);
+}
+
+/*!
+ * Returns the parameter types of a command, or 0 if the command is not listed in the schema.
+ * Method and write answers sMA and sWA have no parameter. Event registrations sEN and sEA have one uint8 parameter
+ * (1: subscribe, 0: unsubscribe), event telegrams sSN have the parameter types of the response to the variable.
+ * @param[in] command_type command type (sRN, sRA, sMN, sAN, sMA, sWN, sWA, sEN, sEA or sSN)
+ * @param[in] command_name command name, f.e. "LocSetPose"
+ * @return parameter types or 0 if not found
+ */
+const std::vector<sick_lidar_localization::ColaSchema::COLA_TYPE>* sick_lidar_localization::ColaSchema::findParameterTypes(sick_lidar_localization::ColaParser::COLA_SOPAS_COMMAND command_type, const boost::string_view & command_name)
+{
+  static const std::vector<COLA_TYPE> s_no_parameter;
+  static const std::vector<COLA_TYPE> s_event_registration = { UINT8 };
+  if(command_type == sick_lidar_localization::ColaParser::sMA || command_type == sick_lidar_localization::ColaParser::sWA)
+    return &s_no_parameter;
+  if(command_type != sick_lidar_localization::ColaParser::sRA && command_type != sick_lidar_localization::ColaParser::sAN
+    && command_type != sick_lidar_localization::ColaParser::sEA && command_type != sick_lidar_localization::ColaParser::sSN && !isRequest(command_type))
+    return 0; // sFA, sINVALID: not listed in the schema
+  const std::vector<CommandSchema> & schema_table = commandSchemaTable();
+  for(std::vector<CommandSchema>::const_iterator iter_schema = schema_table.begin(); iter_schema != schema_table.end(); iter_schema++)
+  {
+    if(command_name == iter_schema->command_name)
+    {
+      if(command_type == sick_lidar_localization::ColaParser::sEN || command_type == sick_lidar_localization::ColaParser::sEA)
+        return &s_event_registration;
+      return isRequest(command_type) ? (&iter_schema->request_types) : (&iter_schema->response_types);
+    }
+  }
+  return 0;
+}
+
+/*!
+ * Encodes a Cola-Binary telegram: 4 byte STX, 4 byte payload length, payload (command type, command name, parameter) and checksum.
+ * @param[in] command_type command type, f.e. sMN
+ * @param[in] command_name command name, f.e. "LocSetPose"
+ * @param[in] parameter_types parameter types
+ * @param[in] values parameter values
+ * @param[out] cola_binary Cola-Binary telegram incl. header and checksum
+ * @return true on success, false if the values do not match the parameter types
+ */
+bool sick_lidar_localization::ColaSchema::encode(sick_lidar_localization::ColaParser::COLA_SOPAS_COMMAND command_type, const boost::string_view & command_name,
+  const std::vector<COLA_TYPE> & parameter_types, const std::vector<int64_t> & values, std::vector<uint8_t> & cola_binary)
+{
+  cola_binary.clear();
+  if(values.size() != parameter_types.size())
+    return false;
+  size_t parameter_size = 0;
+  for(size_t n = 0; n < parameter_types.size(); n++)
+  {
+    if(!inRange(parameter_types[n], values[n]))
+      return false;
+    parameter_size += typeSize(parameter_types[n]);
+  }
+  const std::string & command_type_str = sick_lidar_localization::ColaParser::convertSopasCommand(command_type);
+  uint32_t payload_length = command_type_str.size() + 1 + command_name.size() + (parameter_types.empty() ? 0 : (1 + parameter_size));
+  cola_binary.reserve(8 + payload_length + 1);
+  cola_binary.insert(cola_binary.end(), 4, 0x02); // 4 byte STX
+  for(int shift = 24; shift >= 0; shift -= 8)
+    cola_binary.push_back((payload_length >> shift) & 0xFF); // 4 byte payload length, big endian
+  cola_binary.insert(cola_binary.end(), command_type_str.begin(), command_type_str.end());
+  cola_binary.push_back(0x20);
+  cola_binary.insert(cola_binary.end(), command_name.begin(), command_name.end());
+  if(!parameter_types.empty())
+  {
+    cola_binary.push_back(0x20);
+    for(size_t n = 0; n < parameter_types.size(); n++)
+    {
+      uint64_t value = (uint64_t)values[n]; // two's complement for negative values
+      for(int shift = 8 * ((int)typeSize(parameter_types[n]) - 1); shift >= 0; shift -= 8)
+        cola_binary.push_back((value >> shift) & 0xFF); // big endian
+    }
+  }
+  uint8_t checksum = 0;
+  for(size_t n = 8; n < cola_binary.size(); n++)
+    checksum ^= cola_binary[n]; // CRC8XOR checksum of the payload
+  cola_binary.push_back(checksum);
+  return true;
+}
+
+/*!
+ * Encodes a Cola-Binary telegram from native parameter values.
+ * @param[in] command_type command type, f.e. sMN
+ * @param[in] command_name command name, f.e. "LocSetPose"
+ * @param[in] values parameter values, f.e. { 10300, -5200, 30000, 1000 }
+ * @param[out] cola_binary Cola-Binary telegram incl. header and checksum
+ * @return true on success, false if the command is not listed in the schema or the values do not match the parameter types
+ */
+bool sick_lidar_localization::ColaSchema::encodeColaBinary(sick_lidar_localization::ColaParser::COLA_SOPAS_COMMAND command_type, const boost::string_view & command_name,
+  const std::vector<int64_t> & values, std::vector<uint8_t> & cola_binary)
+{
+  const std::vector<COLA_TYPE>* parameter_types = findParameterTypes(command_type, command_name);
+  return parameter_types != 0 && encode(command_type, command_name, *parameter_types, values, cola_binary);
+}
+
+/*!
+ * Encodes a Cola-Binary telegram from a Cola-ASCII telegram, each parameter is parsed once by its schema type.
+ * @param[in] cola_ascii Cola-ASCII telegram with or without "<STX>" and "<ETX>", f.e. "sMN LocSetPose +10300 -5200 +30000 +1000"
+ * @param[out] cola_binary Cola-Binary telegram incl. header and checksum
+ * @return true on success, false if the command is not listed in the schema or the parameter do not match the parameter types
+ */
+bool sick_lidar_localization::ColaSchema::encodeColaBinary(const boost::string_view & cola_ascii, std::vector<uint8_t> & cola_binary)
+{
+  sick_lidar_localization::ColaParser::ColaTelegramView telegram_view;
+  if(!sick_lidar_localization::ColaParser::tokenizeColaTelegram(cola_ascii, telegram_view))
+    return false;
+  const std::vector<COLA_TYPE>* parameter_types = findParameterTypes(telegram_view.command_type, telegram_view.command_name);
+  if(parameter_types == 0 || (telegram_view.has_parameter ? telegram_view.parameterCount() : 0) != parameter_types->size())
+    return false;
+  std::vector<int64_t> values(parameter_types->size(), 0);
+  size_t pos = 0;
+  boost::string_view parameter;
+  for(size_t n = 0; n < values.size() && telegram_view.nextParameter(pos, parameter); n++)
+  {
+    if(!parseColaAsciiValue(parameter, (*parameter_types)[n], values[n]))
+      return false;
+  }
+  return encode(telegram_view.command_type, telegram_view.command_name, *parameter_types, values, cola_binary);
+}
+
+/*!
+ * Encodes a Cola-Binary telegram from a cola telegram message, each parameter is parsed once by its schema type.
+ * @param[in] cola_telegram cola telegram message
+ * @param[out] cola_binary Cola-Binary telegram incl. header and checksum
+ * @return true on success, false if the command is not listed in the schema or the parameter do not match the parameter types
+ */
+bool sick_lidar_localization::ColaSchema::encodeColaBinary(const sick_lidar_localization::SickLocColaTelegramMsg & cola_telegram, std::vector<uint8_t> & cola_binary)
+{
+  if(cola_telegram.command_type <= sick_lidar_localization::ColaParser::sINVALID || cola_telegram.command_type >= sick_lidar_localization::ColaParser::MAX_COLA_COMMAND_NUMBER)
+    return false;
+  sick_lidar_localization::ColaParser::COLA_SOPAS_COMMAND command_type = (sick_lidar_localization::ColaParser::COLA_SOPAS_COMMAND)cola_telegram.command_type;
+  const std::vector<COLA_TYPE>* parameter_types = findParameterTypes(command_type, cola_telegram.command_name);
+  if(parameter_types == 0 || cola_telegram.parameter.size() != parameter_types->size())
+    return false;
+  std::vector<int64_t> values(parameter_types->size(), 0);
+  for(size_t n = 0; n < values.size(); n++)
+  {
+    if(!parseColaAsciiValue(cola_telegram.parameter[n], (*parameter_types)[n], values[n]))
+      return false;
+  }
+  return encode(command_type, cola_telegram.command_name, *parameter_types, values, cola_binary);
+}
+
+/*!
+ * Decodes a Cola-Binary telegram into native parameter values.
+ * @param[in] cola_binary Cola-Binary telegram incl. header and checksum
+ * @param[out] command_type command type, f.e. sAN
+ * @param[out] command_name command name, f.e. "LocRequestTimestamp"
+ * @param[out] values parameter values, f.e. { 0x1EF6B06E }
+ * @return true on success, false if the telegram is invalid, the command is not listed in the schema or the payload does not match the parameter types
+ */
+bool sick_lidar_localization::ColaSchema::decodeColaBinary(const std::vector<uint8_t> & cola_binary, sick_lidar_localization::ColaParser::COLA_SOPAS_COMMAND & command_type,
+  std::string & command_name, std::vector<int64_t> & values)
+{
+  command_type = sick_lidar_localization::ColaParser::sINVALID;
+  command_name.clear();
+  values.clear();
+  // Check header, length and checksum
+  if(sick_lidar_localization::ColaAsciiBinaryConverter::ColaBinaryTelegramLength(cola_binary) != cola_binary.size() || cola_binary.size() < 9)
+    return false;
+  uint8_t checksum = 0;
+  for(size_t n = 8; n < cola_binary.size() - 1; n++)
+    checksum ^= cola_binary[n];
+  if(checksum != cola_binary.back())
+    return false;
+  // Decode command type and name
+  const char* payload = (const char*)(cola_binary.data() + 8);
+  size_t payload_length = cola_binary.size() - 9;
+  size_t type_end = 0, name_end = 0;
+  while(type_end < payload_length && payload[type_end] != 0x20)
+    type_end++;
+  name_end = type_end + 1;
+  while(name_end < payload_length && payload[name_end] != 0x20)
+    name_end++;
+  if(type_end >= payload_length || name_end <= type_end + 1)
+    return false;
+  command_type = sick_lidar_localization::ColaParser::convertSopasCommand(std::string(payload, type_end));
+  boost::string_view name(payload + type_end + 1, name_end - type_end - 1);
+  const std::vector<COLA_TYPE>* parameter_types = findParameterTypes(command_type, name);
+  if(parameter_types == 0)
+    return false;
+  // Decode parameter, big endian without separators
+  size_t parameter_size = 0;
+  for(size_t n = 0; n < parameter_types->size(); n++)
+    parameter_size += typeSize((*parameter_types)[n]);
+  if((parameter_types->empty() && name_end != payload_length) || (!parameter_types->empty() && name_end + 1 + parameter_size != payload_length))
+    return false;
+  const uint8_t* parameter = (const uint8_t*)payload + name_end + 1;
+  values.reserve(parameter_types->size());
+  for(size_t n = 0; n < parameter_types->size(); n++)
+  {
+    size_t type_size = typeSize((*parameter_types)[n]);
+    uint64_t value = 0;
+    for(size_t m = 0; m < type_size; m++)
+      value = (value << 8) | (*parameter++);
+    if(typeSigned((*parameter_types)[n]) && (value >> (8 * type_size - 1)) != 0)
+      value |= ~(uint64_t)0 << (8 * type_size); // sign extension
+    values.push_back((int64_t)value);
+  }
+  command_name.assign(name.data(), name.size());
+  return true;
+}
+
+/*!
+ * Decodes a Cola-Binary telegram into a cola telegram message. Parameter of requests are formatted as decimal values
+ * with sign (f.e. "+2201"), unsigned parameter of responses as hex values (f.e. "1EF6B06E", like the localization controller responds in Cola-ASCII).
+ * @param[in] cola_binary Cola-Binary telegram incl. header and checksum
+ * @param[out] cola_telegram cola telegram message
+ * @return true on success, false if the telegram is invalid, the command is not listed in the schema or the payload does not match the parameter types
+ */
+bool sick_lidar_localization::ColaSchema::decodeColaBinary(const std::vector<uint8_t> & cola_binary, sick_lidar_localization::SickLocColaTelegramMsg & cola_telegram)
+{
+  sick_lidar_localization::ColaParser::COLA_SOPAS_COMMAND command_type = sick_lidar_localization::ColaParser::sINVALID;
+  std::string command_name;
+  std::vector<int64_t> values;
+  if(!decodeColaBinary(cola_binary, command_type, command_name, values))
+    return false;
+  const std::vector<COLA_TYPE>* parameter_types = findParameterTypes(command_type, command_name);
+  cola_telegram = sick_lidar_localization::ColaParser::createColaTelegram(command_type, command_name);
+  cola_telegram.parameter.resize(values.size());
+  for(size_t n = 0; n < values.size(); n++)
+    appendColaAsciiValue((*parameter_types)[n], values[n], isRequest(command_type), cola_telegram.parameter[n]);
+  return true;
+}
+
+/*!
+ * Decodes a Cola-Binary telegram into a Cola-ASCII telegram without "<STX>" and "<ETX>", see decodeColaBinary(cola_binary, cola_telegram).
+ * @param[in] cola_binary Cola-Binary telegram incl. header and checksum
+ * @param[out] cola_ascii Cola-ASCII telegram, f.e. "sAN LocRequestTimestamp 1EF6B06E"
+ * @return true on success, false if the telegram is invalid, the command is not listed in the schema or the payload does not match the parameter types
+ */
+bool sick_lidar_localization::ColaSchema::decodeColaBinary(const std::vector<uint8_t> & cola_binary, std::string & cola_ascii)
+{
+  sick_lidar_localization::ColaParser::COLA_SOPAS_COMMAND command_type = sick_lidar_localization::ColaParser::sINVALID;
+  std::string command_name;
+  std::vector<int64_t> values;
+  cola_ascii.clear();
+  if(!decodeColaBinary(cola_binary, command_type, command_name, values))
+    return false;
+  const std::vector<COLA_TYPE>* parameter_types = findParameterTypes(command_type, command_name);
+  cola_ascii.reserve(4 + command_name.size() + 12 * values.size());
+  cola_ascii.append(sick_lidar_localization::ColaParser::convertSopasCommand(command_type));
+  cola_ascii.push_back(' ');
+  cola_ascii.append(command_name);
+  for(size_t n = 0; n < values.size(); n++)
+  {
+    cola_ascii.push_back(' ');
+    appendColaAsciiValue((*parameter_types)[n], values[n], isRequest(command_type), cola_ascii);
+  }
+  return true;
+}
+
+/*!
+ * Parses a Cola-ASCII parameter: a leading sign denotes a decimal value ("+2201", "-5200"), otherwise the value is hex ("1EF6B06E").
+ * Hex values of signed types are two's complement ("FFFFEBB0" is -5200 for INT32).
+ * @param[in] parameter Cola-ASCII parameter
+ * @param[in] type parameter type
+ * @param[out] value parsed value
+ * @return true on success, false on parse error or if the value is out of range of the parameter type
+ */
+bool sick_lidar_localization::ColaSchema::parseColaAsciiValue(const boost::string_view & parameter, COLA_TYPE type, int64_t & value)
+{
+  value = 0;
+  if(parameter.empty())
+    return false;
+  bool decimal = (parameter[0] == '+' || parameter[0] == '-');
+  bool negative = (parameter[0] == '-');
+  size_t max_digits = (decimal ? 10 : (2 * typeSize(type)));
+  if(parameter.size() < (decimal ? 2 : 1) || parameter.size() - (decimal ? 1 : 0) > max_digits)
+    return false;
+  uint64_t magnitude = 0;
+  for(size_t n = (decimal ? 1 : 0); n < parameter.size(); n++)
+  {
+    char c = parameter[n];
+    int digit = -1;
+    if(c >= '0' && c <= '9')
+      digit = c - '0';
+    else if(!decimal && c >= 'A' && c <= 'F')
+      digit = c - 'A' + 10;
+    else if(!decimal && c >= 'a' && c <= 'f')
+      digit = c - 'a' + 10;
+    if(digit < 0)
+      return false;
+    magnitude = magnitude * (decimal ? 10 : 16) + digit;
+  }
+  if(decimal)
+  {
+    value = (negative ? (-(int64_t)magnitude) : ((int64_t)magnitude));
+  }
+  else
+  {
+    value = (int64_t)magnitude;
+    size_t bits = 8 * typeSize(type);
+    if(typeSigned(type) && (magnitude >> (bits - 1)) != 0)
+      value = (int64_t)magnitude - ((int64_t)1 << bits); // two's complement
+  }
+  return inRange(type, value);
+}
+
+/*!
+ * Formats a parameter value as Cola-ASCII and appends it to cola_ascii.
+ * @param[in] type parameter type
+ * @param[in] value parameter value
+ * @param[in] decimal_with_sign true: format decimal with sign ("+2201"), false: format unsigned types hex ("899") and signed types decimal with sign
+ * @param[in,out] cola_ascii formatted value appended
+ */
+void sick_lidar_localization::ColaSchema::appendColaAsciiValue(COLA_TYPE type, int64_t value, bool decimal_with_sign, std::string & cola_ascii)
+{
+  char buffer[32];
+  if(decimal_with_sign || typeSigned(type))
+    snprintf(buffer, sizeof(buffer), "%+lld", (long long)value);
+  else
+    snprintf(buffer, sizeof(buffer), "%llX", (unsigned long long)value);
+  cola_ascii.append(buffer);
+}
@@ -69,6 +69,7 @@
  *
  */
 #include <ros/ros.h>
+#include <algorithm>
 
 #include "sick_lidar_localization/cola_configuration.h"
 #include "sick_lidar_localization/cola_services.h"
@@ -84,11 +85,17 @@ int main(int argc, char** argv)
   sick_lidar_localization::ColaServices cola_services(&nh);
   
   // Initial configuration from launch file
-  sick_lidar_localization::ColaConfiguration cola_configuration(&nh);
+  sick_lidar_localization::ColaConfiguration cola_configuration(&nh, &cola_services);
   cola_configuration.start();
   
-  // Run ros event loop
-  ros::spin();
+  // Run ros event loop with cola_pipeline_depth spinner threads, i.e. a slow response of the localization controller
+  // does not stall the other services, concurrent service calls overlap instead of queueing.
+  int cola_pipeline_depth = 4;
+  ros::param::param<int>("/sick_lidar_localization/driver/cola_pipeline_depth", cola_pipeline_depth, cola_pipeline_depth);
+  ros::AsyncSpinner spinner(std::max(1, cola_pipeline_depth));
+  spinner.start();
+  ros::waitForShutdown();
+  spinner.stop();
   
   // Cleanup and exit
   std::cout << "cola_service_node finished." << std::endl;
@@ -69,17 +69,28 @@
  *
  */
 #include <ros/ros.h>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
 
 #include "sick_lidar_localization/cola_services.h"
 
 /*!
  * Constructor
  */
-sick_lidar_localization::ColaServices::ColaServices(ros::NodeHandle *nh) : m_cola_response_timeout(1.0)
+sick_lidar_localization::ColaServices::ColaServices(ros::NodeHandle *nh) : m_nh(nh), m_cola_response_timeout(1.0), m_cola_pipeline_depth(4), m_async_work(0)
 {
   if(nh)
   {
     ros::param::param<double>("/sick_lidar_localization/time_sync/cola_response_timeout", m_cola_response_timeout, m_cola_response_timeout);
+    ros::param::param<int>("/sick_lidar_localization/driver/cola_pipeline_depth", m_cola_pipeline_depth, m_cola_pipeline_depth);
+    std::string cola_broker_socket = "/tmp/sick_lidar_localization_cola.sock";
+    ros::param::param<std::string>("/sick_lidar_localization/driver/cola_broker_socket", cola_broker_socket, cola_broker_socket);
+    m_cola_broker_client = boost::make_shared<sick_lidar_localization::ColaBrokerClient>(cola_broker_socket);
+    // Start worker threads for asynchronous cola requests
+    m_async_work = new boost::asio::io_service::work(m_async_service);
+    for(int n = 0; n < std::max(1, m_cola_pipeline_depth); n++)
+      m_async_threads.create_thread(boost::bind(&boost::asio::io_service::run, &m_async_service));
     // Advertise ros services
     m_service_server.push_back(nh->advertiseService("SickLocIsSystemReady", &sick_lidar_localization::ColaServices::serviceCbIsSystemReady, this));
     m_service_server.push_back(nh->advertiseService("SickLocState", &sick_lidar_localization::ColaServices::serviceCbLocState, this));
@@ -93,8 +104,6 @@ sick_lidar_localization::ColaServices::ColaServices(ros::NodeHandle *nh) : m_col
     m_service_server.push_back(nh->advertiseService("SickLocSetResultPoseInterval", &sick_lidar_localization::ColaServices::serviceCbLocSetResultPoseInterval, this));
     m_service_server.push_back(nh->advertiseService("SickLocRequestResultData", &sick_lidar_localization::ColaServices::serviceCbLocRequestResultData, this));
     m_service_server.push_back(nh->advertiseService("SickLocSetPose", &sick_lidar_localization::ColaServices::serviceCbLocSetPose, this));
-    // Clients for ros services "SickLocColaTelegram"
-    m_service_client = nh->serviceClient<sick_lidar_localization::SickLocColaTelegramSrv>("SickLocColaTelegram");
   }
 }
 
@@ -103,11 +112,104 @@ sick_lidar_localization::ColaServices::ColaServices(ros::NodeHandle *nh) : m_col
  */
 sick_lidar_localization::ColaServices::~ColaServices()
 {
+  if(m_async_work)
+  {
+    delete m_async_work;
+    m_async_work = 0;
+  }
+  m_async_service.stop(); // requests not yet started are cancelled, futures of cancelled requests throw boost::broken_promise
+  m_async_threads.join_all();
+}
 
+/*!
+ * Sends a cola telegram asynchronously using ros service "SickLocColaTelegram". Returns immediately,
+ * the decoded response from localization controller is available by the returned future.
+ * @param[in] cola_ascii_request request (Cola-ASCII, f.e. "sRN LocState")
+ * @return future of the response from localization controller (command_name empty in case of errors)
+ */
+boost::shared_future<sick_lidar_localization::SickLocColaTelegramMsg> sick_lidar_localization::ColaServices::sendColaTelegramAsync(const std::string & cola_ascii_request)
+{
+  boost::shared_ptr<boost::promise<sick_lidar_localization::SickLocColaTelegramMsg> > response_promise(new boost::promise<sick_lidar_localization::SickLocColaTelegramMsg>());
+  boost::shared_future<sick_lidar_localization::SickLocColaTelegramMsg> response_future(response_promise->get_future());
+  sendColaTelegramAsync(cola_ascii_request, boost::bind(&sick_lidar_localization::ColaServices::setResponsePromise, response_promise, _1));
+  return response_future;
 }
 
 /*!
- * Sends a cola telegram using ros service "SickLocColaTelegram", receives and returns the response from localization controller
+ * Sends a cola telegram asynchronously using ros service "SickLocColaTelegram". Returns immediately,
+ * completion_callback is called by a worker thread after the response has been received (or the request failed).
+ * @param[in] cola_ascii_request request (Cola-ASCII, f.e. "sRN LocState")
+ * @param[in] completion_callback callback with the response from localization controller (command_name empty in case of errors)
+ */
+void sick_lidar_localization::ColaServices::sendColaTelegramAsync(const std::string & cola_ascii_request, ColaResponseCallback completion_callback)
+{
+  if(!m_async_work)
+  {
+    ROS_WARN_STREAM("## ERROR ColaServices::sendColaTelegramAsync(\"" << cola_ascii_request << "\"): ColaServices not initialized");
+    if(completion_callback)
+      completion_callback(sick_lidar_localization::SickLocColaTelegramMsg());
+    return;
+  }
+  m_async_service.post(boost::bind(&sick_lidar_localization::ColaServices::runAsyncRequestCb, this, cola_ascii_request, completion_callback));
+}
+
+/*!
+ * Runs an asynchronous cola request in a worker thread, calls sendColaTelegram and the completion callback.
+ * @param[in] cola_ascii_request request (Cola-ASCII, f.e. "sRN LocState")
+ * @param[in] completion_callback callback with the response from localization controller
+ */
+void sick_lidar_localization::ColaServices::runAsyncRequestCb(const std::string & cola_ascii_request, ColaResponseCallback completion_callback)
+{
+  sick_lidar_localization::SickLocColaTelegramMsg cola_response = sendColaTelegram(cola_ascii_request);
+  try
+  {
+    if(completion_callback)
+      completion_callback(cola_response);
+  }
+  catch(const std::exception & exc)
+  {
+    ROS_WARN_STREAM("## ERROR ColaServices::runAsyncRequestCb(\"" << cola_ascii_request << "\"): exception in completion callback: " << exc.what());
+  }
+}
+
+/*!
+ * Completion callback of sendColaTelegramAsync returning a future, sets the response as value of the promise.
+ * @param[in] response_promise promise of the response
+ * @param[in] cola_response response from localization controller
+ */
+void sick_lidar_localization::ColaServices::setResponsePromise(boost::shared_ptr<boost::promise<sick_lidar_localization::SickLocColaTelegramMsg> > response_promise, const sick_lidar_localization::SickLocColaTelegramMsg & cola_response)
+{
+  response_promise->set_value(cola_response);
+}
+
+/*!
+ * Returns an idle service client from m_idle_service_clients, or creates a new one if all service clients are busy.
+ * A ros service connection handles one call at a time, therefore each concurrent call needs its own service client.
+ */
+sick_lidar_localization::ColaServices::ColaServiceClientPtr sick_lidar_localization::ColaServices::acquireServiceClient(void)
+{
+  boost::lock_guard<boost::mutex> service_client_lockguard(m_service_client_mutex);
+  if(m_idle_service_clients.empty())
+    return ColaServiceClientPtr(new ColaServiceClient(m_nh, "SickLocColaTelegram"));
+  ColaServiceClientPtr service_client = m_idle_service_clients.front();
+  m_idle_service_clients.pop_front();
+  return service_client;
+}
+
+/*!
+ * Returns a service client to m_idle_service_clients after a service call.
+ * @param[in] service_client service client acquired by acquireServiceClient()
+ */
+void sick_lidar_localization::ColaServices::releaseServiceClient(const ColaServiceClientPtr & service_client)
+{
+  boost::lock_guard<boost::mutex> service_client_lockguard(m_service_client_mutex);
+  m_idle_service_clients.push_front(service_client); // most recently used client first, its connection is known to be alive
+}
+
+/*!
+ * Sends a cola telegram using the cola broker or ros service "SickLocColaTelegram", receives and returns the response from localization controller.
+ * Thread-safe, concurrent calls use different broker connections resp. service clients and overlap. Responses to read-only variables
+ * like "sRN LocState" are cached by sim_loc_driver only, which receives all cola requests and events.
  * @param[in] cola_ascii_request request (Cola-ASCII, f.e. "sMN IsSystemReady")
  * @return response from localization controller
  */
@@ -119,10 +221,19 @@ sick_lidar_localization::SickLocColaTelegramMsg sick_lidar_localization::ColaSer
   cola_telegram.request.wait_response_timeout = m_cola_response_timeout;
   try
   {
-    // Send cola telegram using ros service "SickLocColaTelegram", receive response from localization server
-    if (!m_service_client.call(cola_telegram) || cola_telegram.response.cola_ascii_response.empty())
+    // Send cola telegram using the cola broker or ros service "SickLocColaTelegram", receive response from localization server
+    bool service_call_success = false, request_sent = false;
+    if(m_cola_broker_client)
+      service_call_success = m_cola_broker_client->call(cola_telegram.request, cola_telegram.response, request_sent);
+    if(!request_sent) // broker not available, fallback to ros service
+    {
+      ColaServiceClientPtr service_client = acquireServiceClient();
+      service_call_success = service_client->call(cola_telegram);
+      releaseServiceClient(service_client);
+    }
+    if (!service_call_success || cola_telegram.response.cola_ascii_response.empty())
     {
-      ROS_WARN_STREAM("## ERROR ColaServices::sendColaTelegram(): calling ros service \"SickLocColaTelegram\" failed with request: "
+      ROS_WARN_STREAM("## ERROR ColaServices::sendColaTelegram(): calling cola broker or ros service \"SickLocColaTelegram\" failed with request: "
         << sick_lidar_localization::Utils::flattenToString(cola_telegram.request) << " response: " << sick_lidar_localization::Utils::flattenToString(cola_telegram.response));
       return cola_response;
     }
@@ -54,6 +54,8 @@
  *
  */
 
+#include <algorithm>
+#include <poll.h>
 #include <ros/ros.h>
 
 #include "sick_lidar_localization/cola_parser.h"
@@ -89,6 +91,7 @@ sick_lidar_localization::ColaTransmitter::~ColaTransmitter()
  */
 bool sick_lidar_localization::ColaTransmitter::connect(void)
 {
+  m_framer.clear(); // discard data of a previous connection
   return m_tcp_socket.connect(m_ioservice, m_server_adress, m_tcp_port);
 }
 
@@ -111,6 +114,18 @@ bool sick_lidar_localization::ColaTransmitter::close(void)
   return false;
 }
 
+/*!
+ * Shuts down the tcp connection to the localization server without closing the socket, i.e. a thread blocked
+ * in receive() returns and a concurrent send() fails, but the socket handle remains valid until close().
+ * @return true on success, false on failure (f.e. not connected)
+ */
+bool sick_lidar_localization::ColaTransmitter::shutdown(void)
+{
+  boost::system::error_code errorcode;
+  m_tcp_socket.socket().shutdown(boost::asio::ip::tcp::socket::shutdown_both, errorcode);
+  return !errorcode;
+}
+
 /*!
  * Send data to the localization server.
  * @param[in] data data to be send
@@ -159,11 +174,26 @@ bool sick_lidar_localization::ColaTransmitter::send(boost::asio::ip::tcp::socket
  */
 bool sick_lidar_localization::ColaTransmitter::receive(std::vector<uint8_t> & telegram, double timeout, ros::Time & receive_timestamp)
 {
-  return receive(m_tcp_socket.socket(), telegram, timeout, receive_timestamp);
+  return receive(m_tcp_socket.socket(), m_framer, telegram, timeout, receive_timestamp);
+}
+
+/*!
+ * Receive a cola telegram from the localization server. Returns immediately, if the connection has been closed
+ * by peer or a socket error occured.
+ * @param[out] telegram telegram received (Cola-Binary or Cola-Ascii)
+ * @param[in] timeout timeout in seconds
+ * @param[out] receive_timestamp receive timestamp in seconds (ros timestamp immediately after first response byte received)
+ * @param[out] connection_error true if the connection has been closed by peer (end of file), on socket errors or if the socket is closed, false otherwise
+ * @return true on success, false on failure (connection error or timeout)
+ */
+bool sick_lidar_localization::ColaTransmitter::receive(std::vector<uint8_t> & telegram, double timeout, ros::Time & receive_timestamp, bool & connection_error)
+{
+  return receive(m_tcp_socket.socket(), m_framer, telegram, timeout, receive_timestamp, connection_error);
 }
 
 /*!
- * Receive a cola telegram from a socket.
+ * Receive a cola telegram from a socket. Note: Data received after the first telegram are discarded,
+ * use receive() with a ColaFramer to receive a stream of telegrams.
  * @param[in] socket socket to read from
  * @param[out] telegram telegram received (Cola-Binary or Cola-Ascii)
  * @param[in] timeout timeout in seconds
@@ -171,73 +201,94 @@ bool sick_lidar_localization::ColaTransmitter::receive(std::vector<uint8_t> & te
  * @return true on success, false on failure
  */
 bool sick_lidar_localization::ColaTransmitter::receive(boost::asio::ip::tcp::socket & socket, std::vector<uint8_t> & telegram, double timeout, ros::Time & receive_timestamp)
+{
+  sick_lidar_localization::ColaFramer framer;
+  return receive(socket, framer, telegram, timeout, receive_timestamp);
+}
+
+/*!
+ * Receive a cola telegram from a socket. All bytes available are read at once and appended to a framer,
+ * which splits them into telegrams. Telegrams already buffered by the framer are returned without reading.
+ * @param[in] socket socket to read from
+ * @param[in,out] framer buffers the data received, must be used for all reads from this socket
+ * @param[out] telegram telegram received (Cola-Binary or Cola-Ascii)
+ * @param[in] timeout timeout in seconds
+ * @param[out] receive_timestamp receive timestamp in seconds (ros timestamp immediately after first response byte received)
+ * @return true on success, false on failure
+ */
+bool sick_lidar_localization::ColaTransmitter::receive(boost::asio::ip::tcp::socket & socket, sick_lidar_localization::ColaFramer & framer, std::vector<uint8_t> & telegram, double timeout, ros::Time & receive_timestamp)
+{
+  ros::Time start_time = ros::Time::now();
+  bool connection_error = false;
+  if(receive(socket, framer, telegram, timeout, receive_timestamp, connection_error))
+    return true;
+  if(connection_error)
+  {
+    // Connection closed by peer or socket error: no more data until timeout
+    double remaining_time = timeout - (ros::Time::now() - start_time).toSec();
+    if(remaining_time > 0)
+      ros::Duration(remaining_time).sleep();
+  }
+  return false; // no tcp connection or timeout
+}
+
+/*!
+ * Receive a cola telegram from a socket. All bytes available are read at once and appended to a framer,
+ * which splits them into telegrams. Telegrams already buffered by the framer are returned without reading.
+ * Returns immediately, if the connection has been closed by peer or a socket error occured.
+ * @param[in] socket socket to read from
+ * @param[in,out] framer buffers the data received, must be used for all reads from this socket
+ * @param[out] telegram telegram received (Cola-Binary or Cola-Ascii)
+ * @param[in] timeout timeout in seconds
+ * @param[out] receive_timestamp receive timestamp in seconds (ros timestamp immediately after first response byte received)
+ * @param[out] connection_error true if the connection has been closed by peer (end of file), on socket errors or if the socket is closed, false otherwise
+ * @return true on success, false on failure (connection error or timeout)
+ */
+bool sick_lidar_localization::ColaTransmitter::receive(boost::asio::ip::tcp::socket & socket, sick_lidar_localization::ColaFramer & framer, std::vector<uint8_t> & telegram, double timeout, ros::Time & receive_timestamp, bool & connection_error)
 {
   telegram.clear();
-  telegram.reserve(1024);
+  connection_error = false;
   try
   {
-    std::vector<uint8_t> binETX = sick_lidar_localization::ColaParser::binaryETX();
+    uint8_t chunk[4096];
     ros::Time start_time = ros::Time::now();
     while (ros::ok() && socket.is_open())
     {
-      // Read 1 byte
-      uint8_t byte_received = 0;
+      // Return the next telegram, if already buffered (one read can contain several telegrams)
+      if(framer.pop(telegram, receive_timestamp))
+        return true;
+      // Wait for data (max. 0.1 seconds, so that ros::ok() and socket.is_open() are checked regularly)
+      double remaining_time = timeout - (ros::Time::now() - start_time).toSec();
+      if(remaining_time <= 0)
+        return false; // timeout
+      struct pollfd poll_fd;
+      poll_fd.fd = socket.native_handle();
+      poll_fd.events = POLLIN;
+      poll_fd.revents = 0;
+      int poll_timeout_ms = (int)(1000 * std::min(remaining_time, 0.1)) + 1;
+      if(poll(&poll_fd, 1, poll_timeout_ms) <= 0)
+        continue; // no data received
+      // Read all bytes available
       boost::system::error_code errorcode;
-      // Possibly better than receiving byte for byte: use boost::asio::read_until to read until <ETX> received
-      if (socket.available() > 0 && boost::asio::read(socket, boost::asio::buffer(&byte_received, 1), boost::asio::transfer_exactly(1), errorcode) > 0 && !errorcode)
-      {
-        if (telegram.empty())
-          receive_timestamp = ros::Time::now(); // timestamp after first byte received
-        telegram.push_back(byte_received);
-      }
-      else
-        ros::Duration(0.0001).sleep();
-      // Check for "<ETX>" (message completed) and return if received data ends with "<ETX>"
-      bool is_binary_cola = sick_lidar_localization::ColaAsciiBinaryConverter::IsColaBinary(telegram);
-      if(is_binary_cola)
+      size_t bytes_received = socket.read_some(boost::asio::buffer(chunk, sizeof(chunk)), errorcode);
+      ros::Time chunk_timestamp = ros::Time::now(); // timestamp immediately after read, i.e. after first byte received
+      if(errorcode || bytes_received == 0)
       {
-        // Cola-Binary: Check telegram length and return if all bytes received
-        uint32_t telegram_length = sick_lidar_localization::ColaAsciiBinaryConverter::ColaBinaryTelegramLength(telegram);
-        if(telegram_length > 0 && telegram.size() >= telegram_length)
-          return true; // all bytes received, telegram completed
-      }
-      else
-      {
-        // Cola-ASCII: Check for "<ETX>" (message completed) and return if received data ends with "<ETX>"
-        if (dataEndWithETX(telegram, binETX))
-          return true; // <ETX> received, telegram completed
-      }
-      // Check for timeout
-      if ((ros::Time::now() - start_time).toSec() >= timeout)
-      {
-        // ROS_DEBUG_STREAM("ColaTransmitter::receive(): timeout, " << telegram.size() << " byte received: " << sick_lidar_localization::Utils::toHexString(telegram));
-        break;
+        // Connection closed by peer or socket error
+        ROS_DEBUG_STREAM("ColaTransmitter::receive(): tcp socket read error " << errorcode.value() << " \"" << errorcode.message() << "\"");
+        connection_error = true;
+        return false;
       }
+      framer.push(chunk, bytes_received, chunk_timestamp);
     }
+    connection_error = ros::ok(); // socket closed
   }
   catch(std::exception & exc)
   {
     ROS_WARN_STREAM("## ERROR ColaTransmitter::receive(): exception " << exc.what());
+    connection_error = true;
   }
-  return false; // no tcp connection or timeout
-}
-
-/*!
- * Returns true, if data end with etx, i.e. the trailing (etx.size()) byte in data are identical to etx.
- * @param[in] data data received
- * @param[in] etx ETX tag (binary or ascii)
- * @return true if data end with etx, false otherwise
- */
-bool sick_lidar_localization::ColaTransmitter::dataEndWithETX(const std::vector<uint8_t> & data, const std::vector<uint8_t> & etx)
-{
-  if(data.size() < etx.size())
-    return false;
-  for(size_t n = data.size() - etx.size(), m = 0; m <  etx.size(); n++, m++)
-  {
-    if(data[n] != etx[m])
-      return false;
-  }
-  return true;
+  return false; // no tcp connection
 }
 
 /*!
@@ -56,9 +56,13 @@
  *
  */
 #include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <boost/bind.hpp>
 #include <string>
 #include <vector>
+#include <algorithm>
 
+#include "sick_lidar_localization/cola_broker.h"
 #include "sick_lidar_localization/driver_monitor.h"
 
 int main(int argc, char** argv)
@@ -98,10 +102,39 @@ int main(int argc, char** argv)
   ros::param::param<std::string>("/sick_lidar_localization/driver/result_telegrams_topic", result_telegrams_topic, result_telegrams_topic);
   ros::Subscriber result_telegram_subscriber = nh.subscribe(result_telegrams_topic, 1, &sick_lidar_localization::DriverMonitor::messageCbResultPortTelegrams, &driver_monitor);
   
-  // Advertise service "SickLocColaTelegram" to send and receive Cola-ASCII telegrams to resp. from the localization server (request and response)
-  ros::ServiceServer service = nh.advertiseService("SickLocColaTelegram", &sick_lidar_localization::DriverMonitor::serviceCbColaTelegram, &driver_monitor);
+  // Advertise service "SickLocColaTelegram" to send and receive Cola-ASCII telegrams to resp. from the localization server (request and response).
+  // The service runs in its own callback queue with cola_pipeline_depth spinner threads, i.e. up to cola_pipeline_depth requests are pipelined
+  // on one tcp connection and a slow request does not block other cola requests.
+  int cola_pipeline_depth = 4;
+  ros::param::param<int>("/sick_lidar_localization/driver/cola_pipeline_depth", cola_pipeline_depth, cola_pipeline_depth);
+  ros::CallbackQueue cola_callback_queue;
+  ros::NodeHandle cola_nh;
+  cola_nh.setCallbackQueue(&cola_callback_queue);
+  ros::ServiceServer service = cola_nh.advertiseService("SickLocColaTelegram", &sick_lidar_localization::DriverMonitor::serviceCbColaTelegram, &driver_monitor);
+  ros::AsyncSpinner cola_spinner(std::max(1, cola_pipeline_depth), &cola_callback_queue);
+  cola_spinner.start();
   ROS_INFO_STREAM("sim_loc_driver advertising service \"SickLocColaTelegram\" for Cola commands, message type SickLocColaTelegramSrv");
   
+  // Advertise service "SickLocColaTimestampTelegram" for timestamp requests (time synchronization). The service runs in its own callback queue and spinner
+  // thread and uses a separate tcp connection to the localization controller, i.e. timestamp requests never wait behind other cola requests or callbacks.
+  ros::CallbackQueue timestamp_callback_queue;
+  ros::NodeHandle timestamp_nh;
+  timestamp_nh.setCallbackQueue(&timestamp_callback_queue);
+  ros::ServiceServer timestamp_service = timestamp_nh.advertiseService("SickLocColaTimestampTelegram", &sick_lidar_localization::DriverMonitor::serviceCbColaTimestampTelegram, &driver_monitor);
+  ros::AsyncSpinner timestamp_spinner(1, &timestamp_callback_queue);
+  timestamp_spinner.start();
+  ROS_INFO_STREAM("sim_loc_driver advertising service \"SickLocColaTimestampTelegram\" for timestamp requests, message type SickLocColaTelegramSrv");
+  
+  // Start the cola broker: other components (cola_service_node, sim_loc_time_sync) send cola and timestamp requests on a local unix domain
+  // socket with a compact binary framing, i.e. without master lookup, ros serialization and service hops. The ros services above remain
+  // as compatibility interface and as fallback, if the broker is disabled (empty cola_broker_socket) or not available.
+  std::string cola_broker_socket = "/tmp/sick_lidar_localization_cola.sock";
+  ros::param::param<std::string>("/sick_lidar_localization/driver/cola_broker_socket", cola_broker_socket, cola_broker_socket);
+  sick_lidar_localization::ColaBroker cola_broker(boost::bind(&sick_lidar_localization::DriverMonitor::serviceCbColaTelegram, &driver_monitor, _1, _2),
+    boost::bind(&sick_lidar_localization::DriverMonitor::serviceCbColaTimestampTelegram, &driver_monitor, _1, _2), cola_pipeline_depth);
+  if(!cola_broker_socket.empty() && !cola_broker.start(cola_broker_socket))
+    ROS_WARN_STREAM("## ERROR sim_loc_driver: could not start cola broker on \"" << cola_broker_socket << "\", cola requests are served by ros services only");
+  
   // Start driver threads to connect to localization controller and to monitor driver messages
   if(!driver_monitor.start())
   {
@@ -115,6 +148,9 @@ int main(int argc, char** argv)
   // Cleanup and exit
   std::cout << "sim_loc_driver finished." << std::endl;
   ROS_INFO_STREAM("sim_loc_driver finished.");
+  cola_spinner.stop();
+  timestamp_spinner.stop();
+  cola_broker.stop();
   driver_monitor.stop();
   std::cout << "sim_loc_driver exits." << std::endl;
   ROS_INFO_STREAM("sim_loc_driver exits.");
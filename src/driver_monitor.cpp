@@ -53,9 +53,11 @@
  *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
  *
  */
+#include <boost/bind.hpp>
 #include <ros/ros.h>
 
 #include "sick_lidar_localization/cola_parser.h"
+#include "sick_lidar_localization/cola_schema.h"
 #include "sick_lidar_localization/driver_monitor.h"
 
 /*!
@@ -76,8 +78,12 @@
  */
 sick_lidar_localization::DriverMonitor::DriverMonitor(ros::NodeHandle * nh, const std::string & server_adress, int ip_port_results, int ip_port_cola)
 : m_initialized(false), m_nh(nh), m_server_adress(server_adress), m_ip_port_results(ip_port_results), m_ip_port_cola(ip_port_cola), m_cola_binary(false),
-  m_monitoring_thread_running(false), m_monitoring_thread(0), m_monitoring_rate(1.0), m_receive_telegrams_timeout(1.0), m_cola_transmitter(0)
+  m_monitoring_thread_running(false), m_monitoring_thread(0), m_monitoring_rate(1.0), m_receive_telegrams_timeout(1.0), m_cola_pipeline_depth(4),
+  m_ip_port_cola_timestamp(ip_port_cola), m_cola_events_enabled(true), m_cola_events_subscribed(false), m_cola_liveness_interval(10.0)
 {
+  m_controller_state.loc_state = -1;        // unknown until subscribed or polled
+  m_controller_state.loc_result_state = -1; // unknown until subscribed or polled
+  m_controller_state.loc_map_state = -1;    // unknown until subscribed or polled
   if(m_nh)
   {
     // Query configuration
@@ -87,6 +93,16 @@ sick_lidar_localization::DriverMonitor::DriverMonitor(ros::NodeHandle * nh, cons
     ros::param::param<double>("/sick_lidar_localization/driver/monitoring_rate", m_monitoring_rate, m_monitoring_rate); // frequency to monitor driver messages, default: once per second
     ros::param::param<double>("/sick_lidar_localization/driver/monitoring_message_timeout", m_receive_telegrams_timeout, m_receive_telegrams_timeout); // timeout for driver messages, shutdown tcp-sockets and reconnect after message timeout, default: 1 second
     ros::param::param<double>("/sick_lidar_localization/time_sync/cola_response_timeout", m_cola_response_timeout, m_cola_response_timeout);
+    ros::param::param<int>("/sick_lidar_localization/driver/cola_timestamp_tcp_port", m_ip_port_cola_timestamp, m_ip_port_cola_timestamp); // ip port for timestamp requests on a separate tcp connection (0: disabled)
+    ros::param::param<int>("/sick_lidar_localization/driver/cola_pipeline_depth", m_cola_pipeline_depth, m_cola_pipeline_depth); // max. number of cola requests in flight on one tcp connection (1: one request at a time)
+    std::map<std::string, double> cola_cache_ttl = sick_lidar_localization::ColaResponseCache::defaultTimeToLive();
+    ros::param::param<std::map<std::string, double> >("/sick_lidar_localization/driver/cola_cache_ttl", cola_cache_ttl, cola_cache_ttl); // time to live in seconds of cached responses to read-only variables
+    m_cola_response_cache.setTimeToLive(cola_cache_ttl);
+    ros::param::param<bool>("/sick_lidar_localization/driver/cola_event_subscriptions", m_cola_events_enabled, m_cola_events_enabled); // true: subscribe controller state by cola events (sEN), false: poll controller state
+    ros::param::param<double>("/sick_lidar_localization/driver/cola_liveness_interval", m_cola_liveness_interval, m_cola_liveness_interval); // interval in seconds to check the cola connection by "sRN LocState" while the controller state is subscribed by events (0: disabled)
+    std::string controller_state_topic = "/sick_lidar_localization/driver/controller_state"; // default topic to publish the controller state (type SickLocControllerStateMsg)
+    ros::param::param<std::string>("/sick_lidar_localization/driver/controller_state_topic", controller_state_topic, controller_state_topic);
+    m_controller_state_publisher = m_nh->advertise<sick_lidar_localization::SickLocControllerStateMsg>(controller_state_topic, 1, true); // latched, subscribers receive the current state immediately
     m_initialized = true;
   }
 }
@@ -129,45 +145,51 @@ bool sick_lidar_localization::DriverMonitor::stop(void)
     delete(m_monitoring_thread);
     m_monitoring_thread = 0;
   }
-  stopColaTransmitter();
+  boost::lock_guard<boost::mutex> cola_engine_lockguard(m_cola_engine_mutex);
+  if(m_cola_engine)
+    m_cola_engine->stop(); // outstanding requests fail immediately
+  if(m_cola_timestamp_engine)
+    m_cola_timestamp_engine->stop();
+  m_cola_engine.reset();
+  m_cola_timestamp_engine.reset();
   return true;
 }
 
 /*!
- * Initializes cola sender and receiver for cola requests and responses
- * @param[in] server_adress ip adress of the localization controller, default: 192.168.0.1
- * @param[in] ip_port_cola ip port for command requests and responses, default: 2111
- * @param[in] receive_timeout timeout in seconds for receive functions
+ * Returns the cola request engine for a tcp port, creates and starts the engine if not yet done.
+ * @param[in,out] cola_engine cola request engine, created and started if not yet done (m_cola_engine_mutex locked by this function)
+ * @param[in] ip_port_cola ip port for command requests and responses
+ * @return cola request engine, or an empty pointer if the localization controller is not reachable
  */
-bool sick_lidar_localization::DriverMonitor::initColaTransmitter(const std::string & server_adress, int ip_port_cola, double receive_timeout)
+boost::shared_ptr<sick_lidar_localization::ColaRequestEngine> sick_lidar_localization::DriverMonitor::getColaEngine(boost::shared_ptr<sick_lidar_localization::ColaRequestEngine> & cola_engine, int ip_port_cola)
 {
-  if(!m_cola_transmitter)
+  boost::lock_guard<boost::mutex> cola_engine_lockguard(m_cola_engine_mutex);
+  if(!cola_engine)
   {
-    m_cola_transmitter = new sick_lidar_localization::ColaTransmitter(server_adress, ip_port_cola, receive_timeout);
-    if (!m_cola_transmitter->connect())
-    {
-      ROS_WARN_STREAM("## ERROR DriverMonitor::serviceCbColaTelegram: can't connect to localization server " << server_adress << ":" << ip_port_cola);
-      return false;
-    }
-    if (!m_cola_transmitter->startReceiverThread())
+    boost::shared_ptr<sick_lidar_localization::ColaRequestEngine> engine(new sick_lidar_localization::ColaRequestEngine(m_server_adress, ip_port_cola, m_cola_pipeline_depth));
+    engine->setEventCallback(boost::bind(&sick_lidar_localization::DriverMonitor::eventCbColaTelegram, this, _1, _2));
+    if (!engine->start())
     {
-      ROS_WARN_STREAM("## ERROR DriverMonitor::serviceCbColaTelegram: can't start receiver thread");
-      return false;
+      ROS_WARN_STREAM("## ERROR DriverMonitor::getColaEngine: can't connect to localization server " << m_server_adress << ":" << ip_port_cola);
+      return boost::shared_ptr<sick_lidar_localization::ColaRequestEngine>();
     }
+    cola_engine = engine;
   }
-  return true;
+  return cola_engine;
 }
 
 /*!
- * Stops cola sender and receiver for cola requests and responses
- * (if started by a cola service request "SickLocColaTelegram")
+ * Stops and removes a cola request engine after a connection error. The engine is restarted by the next request.
+ * @param[in,out] cola_engine cola request engine (m_cola_engine_mutex locked by this function)
+ * @param[in] failed_engine engine with connection error, cola_engine is reset only if still identical to failed_engine
  */
-void sick_lidar_localization::DriverMonitor::stopColaTransmitter(void)
+void sick_lidar_localization::DriverMonitor::resetColaEngine(boost::shared_ptr<sick_lidar_localization::ColaRequestEngine> & cola_engine, const boost::shared_ptr<sick_lidar_localization::ColaRequestEngine> & failed_engine)
 {
-  if(m_cola_transmitter)
+  boost::lock_guard<boost::mutex> cola_engine_lockguard(m_cola_engine_mutex);
+  if(cola_engine && cola_engine == failed_engine)
   {
-    delete(m_cola_transmitter);
-    m_cola_transmitter = 0;
+    cola_engine->stop(); // outstanding requests on the failed connection fail immediately
+    cola_engine.reset();
   }
 }
 
@@ -182,51 +204,91 @@ void sick_lidar_localization::DriverMonitor::messageCbResultPortTelegrams(const
 
 /*!
  * Callback for service messages (SickLocColaTelegramSrv). Handles Cola requests and responses, sends and receives Cola-ASCII telegrams to resp. from
- * the localization controller
+ * the localization controller. Read-only variables like "sRN LocState" are answered from m_cola_response_cache within their time to live.
  * @param[in] cola_request Cola command request, will be encoded and send to the localization controller
  * @param[out] cola_response Cola command response from localization controller
  */
 bool sick_lidar_localization::DriverMonitor::serviceCbColaTelegram(sick_lidar_localization::SickLocColaTelegramSrv::Request & cola_request, sick_lidar_localization::SickLocColaTelegramSrv::Response & cola_response)
 {
+  uint64_t cache_generation = 0;
+  if(m_cola_response_cache.lookup(cola_request.cola_ascii_request, cola_response, cache_generation))
+  {
+    ROS_DEBUG_STREAM("DriverMonitor::serviceCbColaTelegram: Cola request { " << sick_lidar_localization::Utils::flattenToString(cola_request) << " } answered from cache");
+    return true; // cached response to a read-only variable
+  }
   ROS_INFO_STREAM("DriverMonitor::serviceCbColaTelegram: starting Cola request { " << sick_lidar_localization::Utils::flattenToString(cola_request) << " }");
-  boost::lock_guard<boost::mutex> service_cb_lockguard(m_service_cb_mutex); // one service request at a time
+  bool success = transmitColaTelegram(m_cola_engine, m_ip_port_cola, cola_request, cola_response);
+  m_cola_response_cache.update(cola_request.cola_ascii_request, success, cola_response, cache_generation);
+  return success;
+}
+
+/*!
+ * Callback for service messages (SickLocColaTelegramSrv) for timestamp requests ("sMN LocRequestTimestamp").
+ * Timestamp requests are sent on a separate tcp connection to the localization controller (port cola_timestamp_tcp_port),
+ * reserved for time synchronization. They never wait behind other cola requests (f.e. a slow "sMN LocStopAndSave"),
+ * which would increase their round trip time. If the separate connection is disabled (cola_timestamp_tcp_port = 0)
+ * or fails, the request is sent by serviceCbColaTelegram.
+ * @param[in] cola_request Cola command request, will be encoded and send to the localization controller
+ * @param[out] cola_response Cola command response from localization controller
+ */
+bool sick_lidar_localization::DriverMonitor::serviceCbColaTimestampTelegram(sick_lidar_localization::SickLocColaTelegramSrv::Request & cola_request, sick_lidar_localization::SickLocColaTelegramSrv::Response & cola_response)
+{
+  if(m_ip_port_cola_timestamp > 0)
+  {
+    if(transmitColaTelegram(m_cola_timestamp_engine, m_ip_port_cola_timestamp, cola_request, cola_response))
+      return true;
+    ROS_WARN_STREAM("## ERROR DriverMonitor::serviceCbColaTimestampTelegram: Cola request { " << sick_lidar_localization::Utils::flattenToString(cola_request) << " } failed on port "
+      << m_ip_port_cola_timestamp << ", retrying on port " << m_ip_port_cola);
+  }
+  return serviceCbColaTelegram(cola_request, cola_response);
+}
+
+/*!
+ * Sends a Cola request and receives the response using a given cola request engine.
+ * Called concurrently by serviceCbColaTelegram and serviceCbColaTimestampTelegram, several requests
+ * can be outstanding at the same time.
+ * @param[in,out] cola_engine cola request engine, created and started if not yet done, restarted after connection errors
+ * @param[in] ip_port_cola ip port for command requests and responses
+ * @param[in] cola_request Cola command request, will be encoded and send to the localization controller
+ * @param[out] cola_response Cola command response from localization controller
+ */
+bool sick_lidar_localization::DriverMonitor::transmitColaTelegram(boost::shared_ptr<sick_lidar_localization::ColaRequestEngine> & cola_engine, int ip_port_cola,
+  sick_lidar_localization::SickLocColaTelegramSrv::Request & cola_request, sick_lidar_localization::SickLocColaTelegramSrv::Response & cola_response)
+{
   // initialize cola_response with default values
   cola_response.cola_ascii_response = "";
   const std::string & asciiSTX = sick_lidar_localization::ColaParser::asciiSTX();
   const std::string & asciiETX = sick_lidar_localization::ColaParser::asciiETX();
-  // Convert to binary (optional, default: false)
-  std::string ascii_request = asciiSTX + cola_request.cola_ascii_request + asciiETX;
-  std::vector<uint8_t> binary_request = sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(ascii_request);
-  if(m_cola_binary)  // cola_request.send_binary
-    binary_request = sick_lidar_localization::ColaAsciiBinaryConverter::ColaAsciiToColaBinary(binary_request);
-  // Initialize cola sender and receiver, connect to localization controlle
-  if(!initColaTransmitter(m_server_adress, m_ip_port_cola, cola_request.wait_response_timeout))
+  // Convert to binary (optional, default: false). Commands listed in the ColaSchema are encoded directly from their typed parameter.
+  std::vector<uint8_t> binary_request;
+  if(!m_cola_binary || !sick_lidar_localization::ColaSchema::encodeColaBinary(cola_request.cola_ascii_request, binary_request))
+  {
+    std::string ascii_request = asciiSTX + cola_request.cola_ascii_request + asciiETX;
+    binary_request = sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(ascii_request);
+    if(m_cola_binary)  // cola_request.send_binary
+      binary_request = sick_lidar_localization::ColaAsciiBinaryConverter::ColaAsciiToColaBinary(binary_request);
+  }
+  // Get the request engine, connect to localization controller if not yet done
+  boost::shared_ptr<sick_lidar_localization::ColaRequestEngine> engine = getColaEngine(cola_engine, ip_port_cola);
+  if(!engine)
   {
     ROS_WARN_STREAM("## ERROR DriverMonitor::serviceCbColaTelegram: can't initialize cola transmission to localization server " << m_server_adress);
-    stopColaTransmitter();
     return false;
   }
-  // Send request and wait for response with timeout
+  // Send request and wait for the matching response with timeout
   std::vector<uint8_t> binary_response;
   ros::Time send_timestamp, receive_timestamp;
-  if(!m_cola_transmitter->send(binary_request, send_timestamp))
-  {
-    ROS_WARN_STREAM("## ERROR DriverMonitor::serviceCbColaTelegram: send() failed to localization server " << m_server_adress << ":" << m_ip_port_cola);
-    stopColaTransmitter();
-    return false;
-  }
-  if(!m_cola_transmitter->waitPopResponse(binary_response, cola_request.wait_response_timeout, receive_timestamp) || binary_response.size() < 2) // at least 2 byte stx and etx
+  if(!engine->transmit(binary_request, cola_request.wait_response_timeout, binary_response, send_timestamp, receive_timestamp) || binary_response.size() < 2) // at least 2 byte stx and etx
   {
-    ROS_WARN_STREAM("## ERROR DriverMonitor::serviceCbColaTelegram: receive() failed by localization server " << m_server_adress << ":" << m_ip_port_cola);
-    stopColaTransmitter();
+    ROS_WARN_STREAM("## ERROR DriverMonitor::serviceCbColaTelegram: request { " << sick_lidar_localization::Utils::flattenToString(cola_request) << " } failed by localization server " << m_server_adress << ":" << ip_port_cola);
+    if(engine->linkError())
+      resetColaEngine(cola_engine, engine);
     return false;
   }
   // Convert reponse from controller to Cola-ASCII telegram
   bool is_binary_cola = sick_lidar_localization::ColaAsciiBinaryConverter::IsColaBinary(binary_response);
   ROS_INFO_STREAM("DriverMonitor::serviceCbColaTelegram: " << (is_binary_cola?"cola-binary":"cola-ascii") << " response received (hex): " << sick_lidar_localization::Utils::toHexString(binary_response));
-  if(m_cola_binary && is_binary_cola) // if(cola_request.send_binary)
-    binary_response = sick_lidar_localization::ColaAsciiBinaryConverter::ColaBinaryToColaAscii(binary_response);
-  cola_response.cola_ascii_response = sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(binary_response);
+  cola_response.cola_ascii_response = decodeColaResponse(binary_response);
   if (cola_response.cola_ascii_response.size() > asciiSTX.size() + asciiETX.size()
     && cola_response.cola_ascii_response.substr(0, asciiSTX.size()) == asciiSTX
     && cola_response.cola_ascii_response.substr(cola_response.cola_ascii_response.size() - asciiETX.size()) == asciiETX)
@@ -244,14 +306,198 @@ bool sick_lidar_localization::DriverMonitor::serviceCbColaTelegram(sick_lidar_lo
   {
     ROS_WARN_STREAM("## ERROR DriverMonitor::serviceCbColaTelegram: parse error, response from localization server \"" << cola_response.cola_ascii_response << "\" not enclosed with \"" << asciiSTX << "\" and \"" << asciiETX << "\"");
   }
-  stopColaTransmitter();
   return false;
 }
 
+/*!
+ * Converts a Cola-Binary or Cola-ASCII response or event telegram from the localization controller to a Cola-ASCII string
+ * including "<STX>" and "<ETX>". Typed Cola-Binary telegrams are decoded by the ColaSchema.
+ * @param[in] binary_response response or event telegram received from the localization controller
+ * @return Cola-ASCII telegram, f.e. "<STX>sRA LocState 2<ETX>"
+ */
+std::string sick_lidar_localization::DriverMonitor::decodeColaResponse(const std::vector<uint8_t> & binary_response)
+{
+  bool is_binary_cola = sick_lidar_localization::ColaAsciiBinaryConverter::IsColaBinary(binary_response);
+  std::string typed_response;
+  if(m_cola_binary && is_binary_cola && sick_lidar_localization::ColaSchema::decodeColaBinary(binary_response, typed_response))
+    return sick_lidar_localization::ColaParser::asciiSTX() + typed_response + sick_lidar_localization::ColaParser::asciiETX(); // decoded from typed parameter
+  if(m_cola_binary && is_binary_cola) // if(cola_request.send_binary)
+    return sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(sick_lidar_localization::ColaAsciiBinaryConverter::ColaBinaryToColaAscii(binary_response));
+  return sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(binary_response);
+}
+
+/*!
+ * Subscribes the state variables of the localization controller by cola event registrations ("sEN <variable> 1") and
+ * queries their initial values. Subscriptions are sent once per tcp connection, i.e. again after a reconnect.
+ * A failed registration of a required variable is retried after 5 seconds, the state is polled meanwhile.
+ * @return true, if LocState and LocResultState are subscribed on the current connection, otherwise false (state is polled)
+ */
+bool sick_lidar_localization::DriverMonitor::subscribeColaEvents(void)
+{
+  static const std::vector<std::pair<std::string, bool> > s_event_variables = { {"LocState", true}, {"LocResultState", true}, {"LocMapState", false} }; // variable name, required for monitoring
+  if(!m_cola_events_enabled)
+    return false;
+  boost::shared_ptr<sick_lidar_localization::ColaRequestEngine> engine = getColaEngine(m_cola_engine, m_ip_port_cola);
+  if(engine && engine->linkError())
+  {
+    // Connection closed or failed, no more events on this connection: reconnect and subscribe again
+    ROS_WARN_STREAM("DriverMonitor::subscribeColaEvents(): cola connection with event subscriptions failed, reconnecting");
+    resetColaEngine(m_cola_engine, engine);
+    engine = getColaEngine(m_cola_engine, m_ip_port_cola);
+  }
+  if(!engine)
+    return false;
+  {
+    boost::lock_guard<boost::mutex> controller_state_lockguard(m_controller_state_mutex);
+    if(m_cola_event_engine.lock() == engine && (m_cola_events_subscribed || ros::Time::now() < m_cola_event_retry))
+      return m_cola_events_subscribed; // event registration already done on this connection, or failed and retried after a delay
+  }
+  bool required_events_subscribed = true;
+  for(std::vector<std::pair<std::string, bool> >::const_iterator iter_variable = s_event_variables.begin(); iter_variable != s_event_variables.end(); iter_variable++)
+  {
+    const std::string & variable_name = iter_variable->first;
+    // Register the event first and query the initial value afterwards, i.e. no change is lost in between
+    sick_lidar_localization::SickLocColaTelegramSrv::Request cola_request;
+    sick_lidar_localization::SickLocColaTelegramSrv::Response cola_response;
+    cola_request.cola_ascii_request = "sEN " + variable_name + " 1";
+    cola_request.wait_response_timeout = m_cola_response_timeout;
+    sick_lidar_localization::SickLocColaTelegramMsg event_response, variable_response;
+    if(transmitColaTelegram(m_cola_engine, m_ip_port_cola, cola_request, cola_response))
+      event_response = sick_lidar_localization::ColaParser::decodeColaTelegram(cola_response.cola_ascii_response);
+    if(event_response.command_type == sick_lidar_localization::ColaParser::sEA && event_response.command_name == variable_name)
+    {
+      cola_request.cola_ascii_request = "sRN " + variable_name;
+      if(transmitColaTelegram(m_cola_engine, m_ip_port_cola, cola_request, cola_response))
+        variable_response = sick_lidar_localization::ColaParser::decodeColaTelegram(cola_response.cola_ascii_response);
+    }
+    if(variable_response.command_type != sick_lidar_localization::ColaParser::sRA || variable_response.command_name != variable_name || variable_response.parameter.size() != 1)
+    {
+      ROS_WARN_STREAM("## ERROR DriverMonitor::subscribeColaEvents(): event registration of \"" << variable_name << "\" failed, cola request: "
+        << sick_lidar_localization::Utils::flattenToString(cola_request) << ", cola response: " << sick_lidar_localization::Utils::flattenToString(cola_response));
+      required_events_subscribed = required_events_subscribed && !iter_variable->second;
+      continue;
+    }
+    updateControllerState(variable_name, std::strtol(variable_response.parameter[0].c_str(), 0, 16));
+  }
+  m_cola_response_cache.invalidate(); // responses cached before the subscription might be outdated
+  boost::lock_guard<boost::mutex> controller_state_lockguard(m_controller_state_mutex);
+  m_cola_event_engine = engine;
+  m_cola_events_subscribed = required_events_subscribed;
+  m_cola_event_retry = ros::Time::now() + ros::Duration(5.0); // retry a failed event registration after 5 seconds, poll the controller state meanwhile
+  ROS_INFO_STREAM("DriverMonitor: controller state " << (required_events_subscribed ? "subscribed by cola events" : "not subscribed, polling controller state and retrying in 5 seconds"));
+  m_cola_liveness_check = ros::Time::now();
+  return m_cola_events_subscribed;
+}
+
+/*!
+ * Checks the cola connection with event subscriptions by "sRN LocState" every cola_liveness_interval seconds.
+ * Events are sent after changes only, i.e. a half-open tcp connection (f.e. after a power loss of the localization
+ * controller or a disconnected cable) is not detected by missing events. A failed request resets the connection,
+ * and events are subscribed again on the new connection. The response updates LocState, if an event has been lost.
+ */
+void sick_lidar_localization::DriverMonitor::checkColaLiveness(void)
+{
+  sick_lidar_localization::SickLocControllerStateMsg controller_state;
+  if(m_cola_liveness_interval <= 0 || (ros::Time::now() - m_cola_liveness_check).toSec() < m_cola_liveness_interval || !getSubscribedControllerState(controller_state))
+    return; // liveness check disabled, not yet due or controller state not subscribed (i.e. polled)
+  m_cola_liveness_check = ros::Time::now();
+  sick_lidar_localization::SickLocColaTelegramSrv::Request cola_request;
+  sick_lidar_localization::SickLocColaTelegramSrv::Response cola_response;
+  cola_request.cola_ascii_request = "sRN LocState";
+  cola_request.wait_response_timeout = m_cola_response_timeout;
+  sick_lidar_localization::SickLocColaTelegramMsg variable_response;
+  if(transmitColaTelegram(m_cola_engine, m_ip_port_cola, cola_request, cola_response)) // not cached, request sent to the localization controller
+    variable_response = sick_lidar_localization::ColaParser::decodeColaTelegram(cola_response.cola_ascii_response);
+  if(variable_response.command_type != sick_lidar_localization::ColaParser::sRA || variable_response.command_name != "LocState" || variable_response.parameter.size() != 1)
+  {
+    ROS_WARN_STREAM("## ERROR DriverMonitor::checkColaLiveness(): cola request: " << sick_lidar_localization::Utils::flattenToString(cola_request)
+      << " failed, cola response: " << sick_lidar_localization::Utils::flattenToString(cola_response));
+    return; // connection reset by transmitColaTelegram after a link error, events are subscribed again
+  }
+  updateControllerState(variable_response.command_name, std::strtol(variable_response.parameter[0].c_str(), 0, 16));
+}
+
+/*!
+ * Callback for cola event telegrams ("sSN"), called by the receiver thread of the cola request engine.
+ * Updates and publishes the controller state and invalidates the cached cola responses.
+ * @param[in] event_telegram event telegram (Cola-Binary or Cola-ASCII), f.e. "sSN LocState 2"
+ * @param[in] receive_timestamp receive timestamp of the event telegram
+ */
+void sick_lidar_localization::DriverMonitor::eventCbColaTelegram(const std::vector<uint8_t> & event_telegram, const ros::Time & receive_timestamp)
+{
+  sick_lidar_localization::SickLocColaTelegramMsg cola_event = sick_lidar_localization::ColaParser::decodeColaTelegram(decodeColaResponse(event_telegram));
+  if(cola_event.command_type != sick_lidar_localization::ColaParser::sSN || cola_event.parameter.size() != 1)
+  {
+    ROS_WARN_STREAM("## ERROR DriverMonitor::eventCbColaTelegram(): unexpected cola event " << sick_lidar_localization::Utils::toHexString(event_telegram) << " received, event discarded");
+    return;
+  }
+  ROS_INFO_STREAM("DriverMonitor: cola event { " << sick_lidar_localization::Utils::flattenToString(cola_event) << " } received");
+  m_cola_response_cache.invalidate(); // cached variables have changed
+  updateControllerState(cola_event.command_name, std::strtol(cola_event.parameter[0].c_str(), 0, 16));
+}
+
+/*!
+ * Sets a state variable of the localization controller and publishes the controller state, if the value changed.
+ * The timeout for result telegrams restarts, when localization or result output has been enabled.
+ * @param[in] variable_name name of the state variable: "LocState", "LocResultState" or "LocMapState"
+ * @param[in] value new value of the state variable
+ */
+void sick_lidar_localization::DriverMonitor::updateControllerState(const std::string & variable_name, int32_t value)
+{
+  sick_lidar_localization::SickLocControllerStateMsg controller_state;
+  {
+    boost::lock_guard<boost::mutex> controller_state_lockguard(m_controller_state_mutex);
+    int32_t* state_value = 0;
+    if(variable_name == "LocState")
+      state_value = &m_controller_state.loc_state;
+    else if(variable_name == "LocResultState")
+      state_value = &m_controller_state.loc_result_state;
+    else if(variable_name == "LocMapState")
+      state_value = &m_controller_state.loc_map_state;
+    if(!state_value || *state_value == value)
+      return; // unknown variable or value unchanged
+    *state_value = value;
+    m_controller_state.header.stamp = ros::Time::now();
+    controller_state = m_controller_state;
+  }
+  if((variable_name == "LocState" && value == 2) || (variable_name == "LocResultState" && value > 0))
+    m_driver_message_recv_timestamp.set(ros::Time::now()); // localization resp. result output enabled, result telegrams expected within timeout from now
+  ROS_INFO_STREAM("DriverMonitor: controller state changed: " << variable_name << " = " << value);
+  if(m_nh)
+    m_controller_state_publisher.publish(controller_state);
+}
+
+/*!
+ * Returns the controller state as received by cola events, if LocState and LocResultState are subscribed on the current connection.
+ * @param[out] controller_state controller state
+ * @return true, if the controller state is up to date by cola events, false otherwise (state has to be polled)
+ */
+bool sick_lidar_localization::DriverMonitor::getSubscribedControllerState(sick_lidar_localization::SickLocControllerStateMsg & controller_state)
+{
+  boost::shared_ptr<sick_lidar_localization::ColaRequestEngine> event_engine;
+  {
+    boost::lock_guard<boost::mutex> controller_state_lockguard(m_controller_state_mutex);
+    if(!m_cola_events_subscribed)
+      return false;
+    event_engine = m_cola_event_engine.lock();
+    controller_state = m_controller_state;
+  }
+  if(!event_engine || event_engine->linkError())
+    return false; // connection with event subscriptions closed or failed
+  {
+    boost::lock_guard<boost::mutex> cola_engine_lockguard(m_cola_engine_mutex);
+    if(event_engine != m_cola_engine)
+      return false; // reconnected, events not yet subscribed on the new connection
+  }
+  return controller_state.loc_state >= 0 && controller_state.loc_result_state >= 0;
+}
+
 /*!
  * Returns true, if result telegrams have been received within configured timeout "monitoring_message_timeout".
- * If no result telegrams have been received within the timeout, the localization status is queried by ros service
- * "SickLocState". If localization is not activated (LocState != 2), this function returns true (no error).
+ * If no result telegrams have been received within the timeout, the localization state is checked: if LocState and
+ * LocResultState are subscribed by cola events, their last values are used without any request. Otherwise the state
+ * is polled by "sRN LocState" and "sRN LocResultState". If localization is not activated (LocState != 2)
+ * or result output is disabled, this function returns true (no error).
  * Otherwise, result telegrams are missing and false is returned (error).
  */
 bool sick_lidar_localization::DriverMonitor::resultTelegramsReceiveStatusIsOk(void)
@@ -260,6 +506,24 @@ bool sick_lidar_localization::DriverMonitor::resultTelegramsReceiveStatusIsOk(vo
   if((ros::Time::now() - m_driver_message_recv_timestamp.get()).toSec() <= m_receive_telegrams_timeout)
     return true; // OK: result telegram received within timeout
 
+  // Check the state of localization and result output by cola events, if subscribed
+  sick_lidar_localization::SickLocControllerStateMsg controller_state;
+  if(getSubscribedControllerState(controller_state))
+  {
+    if(controller_state.loc_state != 2)
+    {
+      ROS_INFO_STREAM("DriverMonitor: localization deactivated, no result telegrams received (LocState: " << controller_state.loc_state << ")");
+      return true; // OK: LocState != 2: localization deactivated, no result telegrams send or received
+    }
+    if(controller_state.loc_result_state == 0)
+    {
+      ROS_INFO_STREAM("DriverMonitor: result telegrams deactivated, no result telegrams received (LocResultState: " << controller_state.loc_result_state << ")");
+      return true; // OK: LocResultState == 0: Result telegrams deactivated
+    }
+    ROS_WARN_STREAM("## ERROR DriverMonitor: Localization and result telegrams activated, timeout while waiting for result telegrams");
+    return false;
+  }
+
   // Call "sRN LocState" and check state of localization (no result telegrams when localization deactivated)
   sick_lidar_localization::SickLocColaTelegramSrv::Request cola_telegram_request;
   sick_lidar_localization::SickLocColaTelegramSrv::Response cola_telegram_response;
@@ -276,6 +540,7 @@ bool sick_lidar_localization::DriverMonitor::resultTelegramsReceiveStatusIsOk(vo
     ROS_WARN_STREAM("## ERROR DriverMonitor: unexpected cola response from localization controller, cola request: " << sick_lidar_localization::Utils::flattenToString(cola_telegram_request) << ", cola response: " << sick_lidar_localization::Utils::flattenToString(cola_telegram_response));
     return false; // Error decoding response from localization
   }
+  updateControllerState(cola_response.command_name, std::strtol(cola_response.parameter[0].c_str(), 0, 16));
   if(cola_response.parameter[0] != "2")
   {
     ROS_INFO_STREAM("DriverMonitor: localization deactivated, no result telegrams received (cola response: " << sick_lidar_localization::Utils::flattenToString(cola_response) << ")");
@@ -296,6 +561,7 @@ bool sick_lidar_localization::DriverMonitor::resultTelegramsReceiveStatusIsOk(vo
     ROS_WARN_STREAM("## ERROR DriverMonitor: unexpected cola response from localization controller, cola request: " << sick_lidar_localization::Utils::flattenToString(cola_telegram_request) << ", cola response: " << sick_lidar_localization::Utils::flattenToString(cola_telegram_response));
     return false; // Error decoding response from localization
   }
+  updateControllerState(cola_response.command_name, std::strtol(cola_response.parameter[0].c_str(), 0, 16));
   if(cola_response.parameter[0] == "0")
   {
     ROS_INFO_STREAM("DriverMonitor: result telegrams deactivated, no result telegrams received (cola response: " << sick_lidar_localization::Utils::flattenToString(cola_response) << ")");
@@ -341,6 +607,8 @@ void sick_lidar_localization::DriverMonitor::runMonitorThreadCb(void)
     && driver_thread->isConnected()
     && resultTelegramsReceiveStatusIsOk())
     {
+      subscribeColaEvents(); // subscribes the controller state once per cola connection, i.e. again after a reconnect
+      checkColaLiveness();   // detects half-open cola connections while the controller state is subscribed by events
       monitoring_delay.sleep();
     }
     if(ros::ok() && m_monitoring_thread_running) // timeout, telegram messages from driver missing
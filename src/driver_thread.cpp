@@ -103,7 +103,10 @@ sick_lidar_localization::DriverThread::DriverThread(ros::NodeHandle * nh, const
     m_result_telegrams_publisher = nh->advertise<sick_lidar_localization::SickLocResultPortTelegramMsg>(result_telegrams_topic, 1);
     // ros publisher for diagnostic messages (type SickLocDiagnosticMsg)
     m_diagnostic_publisher  = nh->advertise<sick_lidar_localization::SickLocDiagnosticMsg>(diagnostic_topic, 1);
-    m_timesync_service_client = nh->serviceClient<sick_lidar_localization::SickLocTimeSyncSrv>("SickLocTimeSync");
+    // ros subscriber for the software pll model published by sim_loc_time_sync (latched topic)
+    std::string time_sync_model_topic = "/sick_lidar_localization/time_sync/model"; // default topic of the software pll model (type SickLocTimeSyncModelMsg)
+    ros::param::param<std::string>("/sick_lidar_localization/time_sync/time_sync_model_topic", time_sync_model_topic, time_sync_model_topic);
+    m_time_sync_model_subscriber = nh->subscribe(time_sync_model_topic, 1, &sick_lidar_localization::DriverThread::messageCbTimeSyncModel, this);
     m_initialized = true;
   }
 }
@@ -212,6 +215,19 @@ bool sick_lidar_localization::DriverThread::isRunning(void)
   return m_tcp_receiver_thread_running && m_converter_thread_running;
 }
 
+/*
+ * Callback for software pll model messages (SickLocTimeSyncModelMsg) from sim_loc_time_sync.
+ * The software pll model is shared with the converter thread, which calculates the system time
+ * of vehicle poses from lidar ticks without calling ros service "SickLocTimeSync".
+ * @param[in] msg software pll model (SickLocTimeSyncModelMsg)
+ */
+void sick_lidar_localization::DriverThread::messageCbTimeSyncModel(const sick_lidar_localization::SickLocTimeSyncModelMsg & msg)
+{
+  double reference_time = msg.reference_time_sec + 1.0e-9 * msg.reference_time_nsec;
+  m_time_sync_model.set(sick_lidar_localization::TimeSyncModel(msg.valid, msg.reference_tick_ms, reference_time, msg.slope));
+  ROS_DEBUG_STREAM("DriverThread: software pll model received: " << sick_lidar_localization::Utils::flattenToString(msg));
+}
+
 /*
  * Closes all tcp connections
  * @param[in] force_shutdown if true, sockets are immediately forced to shutdown
@@ -279,10 +295,10 @@ void sick_lidar_localization::DriverThread::runReceiverThreadCb(void)
         if(bytes_received < bytes_required)
           ros::Duration(0.0001).sleep();
       }
-      // Copy received telegram to fifo
+      // Copy received telegram and its receive timestamp to fifo
       if(bytes_received >= bytes_required)
       {
-        m_fifo_buffer.push(receive_buffer);
+        m_fifo_buffer.push(ReceivedTelegram(receive_buffer, ros::Time::now()));
         ROS_DEBUG_STREAM("DriverThread: received " << bytes_received << " byte telegram (hex): " << sick_lidar_localization::Utils::toHexString(receive_buffer));
         ros::Duration(0.0001).sleep();
       }
@@ -315,7 +331,8 @@ void sick_lidar_localization::DriverThread::runConverterThreadCb(void)
     if(!m_fifo_buffer.empty())
     {
       // Get binary telegram from fifo buffer
-      std::vector<uint8_t> binary_telegram = m_fifo_buffer.pop();
+      ReceivedTelegram received_telegram = m_fifo_buffer.pop();
+      std::vector<uint8_t> & binary_telegram = received_telegram.data;
       if(!binary_telegram.empty())
       {
         // Decode binary telegram to SickLocResultPortTelegramMsg
@@ -329,25 +346,26 @@ void sick_lidar_localization::DriverThread::runConverterThreadCb(void)
         else
         {
           sick_lidar_localization::SickLocResultPortTelegramMsg & result_telegram = result_port_parser.getTelegramMsg();
-          // Query system time of vehicle pose from lidar tick, using software pll with ros service "SickLocTimeSync"
+          result_telegram.header.stamp = received_telegram.receive_time; // system time when the telegram has been received
+          result_telegram.timestamp_ticks_64 = m_tick_unwrapper.update(result_telegram.telegram_payload.Timestamp, sick_lidar_localization::MonotonicClock::now()); // lidar ticks continued across 32 bit overflows
+          // Calculate system time of vehicle pose from lidar tick, using the software pll model published by sim_loc_time_sync
           result_telegram.vehicle_time_valid = false;
           result_telegram.vehicle_time_sec = 0;
           result_telegram.vehicle_time_nsec = 0;
           if(timestamp_first_telegram.sec <= 0)
             timestamp_first_telegram = ros::Time::now();
-          sick_lidar_localization::SickLocTimeSyncSrv time_sync_msg;
-          time_sync_msg.request.timestamp_lidar_ms = result_telegram.telegram_payload.Timestamp;
-          if (m_timesync_service_client.call(time_sync_msg) && time_sync_msg.response.vehicle_time_valid)
+          uint32_t vehicle_time_sec = 0, vehicle_time_nsec = 0;
+          if (m_time_sync_model.get().tickToTime(result_telegram.telegram_payload.Timestamp, vehicle_time_sec, vehicle_time_nsec))
           {
-            result_telegram.vehicle_time_valid = time_sync_msg.response.vehicle_time_valid;
-            result_telegram.vehicle_time_sec = time_sync_msg.response.vehicle_time_sec;
-            result_telegram.vehicle_time_nsec = time_sync_msg.response.vehicle_time_nsec;
-            ROS_DEBUG_STREAM("sim_loc_driver: Lidar ticks: " << result_telegram.telegram_payload.Timestamp << ", Systemtime by pll: " << result_telegram.vehicle_time_sec << "." << result_telegram.vehicle_time_sec);
+            result_telegram.vehicle_time_valid = true;
+            result_telegram.vehicle_time_sec = vehicle_time_sec;
+            result_telegram.vehicle_time_nsec = vehicle_time_nsec;
+            ROS_DEBUG_STREAM("sim_loc_driver: Lidar ticks: " << result_telegram.telegram_payload.Timestamp << ", Systemtime by pll: " << result_telegram.vehicle_time_sec << "." << result_telegram.vehicle_time_nsec);
           }
           else if((ros::Time::now() - timestamp_first_telegram).toSec() <= m_software_pll_expected_initialization_duration) // software pll still initializing
             ROS_DEBUG_STREAM("sim_loc_driver: no system time from ticks, software pll still initializing");
           else // time sync error
-            ROS_WARN_STREAM("## ERROR sim_loc_driver: service \"SickLocTimeSync\" failed, could not get system time from ticks");
+            ROS_WARN_STREAM("## ERROR sim_loc_driver: no valid software pll model received from sim_loc_time_sync, could not get system time from ticks");
           // Publish the decoded result port telegram (type SickLocResultPortTelegramMsg)
           m_result_telegrams_publisher.publish(result_telegram);
           ROS_INFO_STREAM("DriverThread: result telegram received " << sick_lidar_localization::Utils::toHexString(binary_telegram) << ", published " << sick_lidar_localization::Utils::flattenToString(result_telegram));
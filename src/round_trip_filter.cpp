@@ -0,0 +1,145 @@
+/*
+ * @brief round_trip_filter implements an NTP-style filter for LocRequestTimestamp round trip times:
+ * only measurements within a margin of the minimum round trip time of recent measurements are used
+ * to update the software pll.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#include <algorithm>
+#include <math.h>
+
+#include "sick_lidar_localization/round_trip_filter.h"
+
+/*!
+ * Constructor
+ * @param[in] window_size number of recent measurements to determine the minimum round trip time, default: 16
+ * @param[in] margin max. difference in seconds between round trip time and minimum round trip time of accepted measurements, default: 0.002
+ * @param[in] max_round_trip_time max. round trip time in seconds, default: 1.0
+ */
+sick_lidar_localization::RoundTripFilter::RoundTripFilter(int window_size, double margin, double max_round_trip_time)
+: m_window(std::max(1, window_size), 0), m_window_cnt(0), m_window_head(0), m_margin(margin), m_max_round_trip_time(max_round_trip_time),
+  m_last(0), m_last_accepted(false), m_accepted_cnt(0), m_rejected_cnt(0), m_workspace(std::max(1, window_size), 0)
+{
+}
+
+/*!
+ * Adds the round trip time of a measurement to the filter window and returns true, if the measurement is accepted.
+ * @param[in] round_trip_time round trip time in seconds (receive time - send time)
+ * @return true if the measurement is accepted, false if the measurement should not update the software pll
+ */
+bool sick_lidar_localization::RoundTripFilter::update(double round_trip_time)
+{
+  m_last = round_trip_time;
+  m_last_accepted = false;
+  if(round_trip_time > 0 && round_trip_time <= m_max_round_trip_time) // otherwise invalid timestamps, not added to the window
+  {
+    m_window[m_window_head] = round_trip_time;
+    m_window_head = (m_window_head + 1) % (int)m_window.size();
+    m_window_cnt = std::min(m_window_cnt + 1, (int)m_window.size());
+    m_last_accepted = (round_trip_time <= minimum() + m_margin);
+  }
+  if(m_last_accepted)
+    m_accepted_cnt++;
+  else
+    m_rejected_cnt++;
+  return m_last_accepted;
+}
+
+/*!
+ * Returns the minimum round trip time in seconds of the measurements in the filter window.
+ */
+double sick_lidar_localization::RoundTripFilter::minimum(void) const
+{
+  if(m_window_cnt <= 0)
+    return 0;
+  return *std::min_element(m_window.begin(), m_window.begin() + m_window_cnt);
+}
+
+/*!
+ * Returns the median round trip time in seconds of the measurements in the filter window.
+ */
+double sick_lidar_localization::RoundTripFilter::median(void) const
+{
+  return percentile(0.5);
+}
+
+/*!
+ * Returns the p-quantile (0 <= p <= 1) of the round trip times in seconds of the measurements in the filter window,
+ * f.e. percentile(0.99) returns the 99th percentile.
+ * @param[in] p quantile, 0 <= p <= 1
+ */
+double sick_lidar_localization::RoundTripFilter::percentile(double p) const
+{
+  if(m_window_cnt <= 0)
+    return 0;
+  int idx = std::max(0, std::min(m_window_cnt - 1, (int)(p * m_window_cnt)));
+  std::copy(m_window.begin(), m_window.begin() + m_window_cnt, m_workspace.begin());
+  std::nth_element(m_workspace.begin(), m_workspace.begin() + idx, m_workspace.begin() + m_window_cnt);
+  return m_workspace[idx];
+}
+
+/*!
+ * Returns the standard deviation of round trip times in seconds of the measurements in the filter window.
+ */
+double sick_lidar_localization::RoundTripFilter::stddev(void) const
+{
+  if(m_window_cnt <= 1)
+    return 0;
+  double sum = 0, sum_sq = 0;
+  for(int n = 0; n < m_window_cnt; n++)
+  {
+    sum += m_window[n];
+    sum_sq += m_window[n] * m_window[n];
+  }
+  double mean = sum / m_window_cnt;
+  return sqrt(std::max(0.0, sum_sq / m_window_cnt - mean * mean));
+}
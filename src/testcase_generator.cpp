@@ -76,6 +76,7 @@ std::map<std::string, int32_t> sick_lidar_localization::TestcaseGenerator::s_con
   {"LocResultMode", 0},        // 0:stream (default), 1:poll
   {"LocResultState", 1},       // result output: 0: disabled, 1: enabled
   {"LocResultEndianness", 0},  // 0: big endian (default), 1: little endian
+  {"LocResultPoseInterval", 1}, // interval of result telegrams in number of scans (default: 1)
   {"LocMapState", 1},          // map state: 0:not active, 1:active
   {"LocRequestResultData", 1}  // in poll mode, trigger sending the localization result of the next processed scan via TCP interface.
 };
@@ -309,9 +310,18 @@ sick_lidar_localization::SickLocColaTelegramMsg sick_lidar_localization::Testcas
   if(cola_request.command_type == sick_lidar_localization::ColaParser::sMN && cola_request.command_name == "LocSetResultPoseInterval" && cola_request.parameter.size() == 1)
   {
     s_u32ResultPoseInterval = std::strtoul(cola_request.parameter[0].c_str(), 0, 0);
+    s_controller_settings["LocResultPoseInterval"] = s_u32ResultPoseInterval;
     return sick_lidar_localization::ColaParser::createColaTelegram(sick_lidar_localization::ColaParser::sAN, cola_request.command_name, {decstr(1)});
   }
   
+  // Create sEA responses to event registrations "sEN <variable_name> 1" (subscribe) resp. "sEN <variable_name> 0" (unsubscribe)
+  if(cola_request.command_type == sick_lidar_localization::ColaParser::sEN && cola_request.parameter.size() == 1
+    && s_controller_settings.find(cola_request.command_name) != s_controller_settings.end())
+  {
+    bool subscribe = (std::strtol(cola_request.parameter[0].c_str(), 0, 0) != 0);
+    return sick_lidar_localization::ColaParser::createColaTelegram(sick_lidar_localization::ColaParser::sEA, cola_request.command_name, {decstr(subscribe?1:0)});
+  }
+  
   // Create sAN responses to sMN requests resp. sRA responses to sRN requests
   if(cola_request.command_type == sick_lidar_localization::ColaParser::sMN || cola_request.command_type == sick_lidar_localization::ColaParser::sRN)
   {
@@ -333,6 +343,24 @@ sick_lidar_localization::SickLocColaTelegramMsg sick_lidar_localization::Testcas
   return sick_lidar_localization::ColaParser::createColaTelegram(sick_lidar_localization::ColaParser::sAN, cola_request.command_name);
 }
 
+/*!
+ * Creates and returns a synthetical cola event telegram "sSN <variable_name> <value>" with the current value of a
+ * controller setting, f.e. "sSN LocState 2". Events are registered by "sEN <variable_name> 1" requests.
+ * @param[in] variable_name name of the controller setting, f.e. "LocState"
+ * @param[out] value current value of the controller setting
+ * @param[out] cola_event synthetical cola event telegram
+ * @return true on success, false if variable_name is not a controller setting
+ */
+bool sick_lidar_localization::TestcaseGenerator::createColaEvent(const std::string & variable_name, int32_t & value, sick_lidar_localization::SickLocColaTelegramMsg & cola_event)
+{
+  std::map<std::string, int32_t>::const_iterator iter_settings = s_controller_settings.find(variable_name);
+  if(iter_settings == s_controller_settings.end())
+    return false;
+  value = iter_settings->second;
+  cola_event = sick_lidar_localization::ColaParser::createColaTelegram(sick_lidar_localization::ColaParser::sSN, variable_name, {hexstr(value)});
+  return true;
+}
+
 /*!
  * Creates and returns a timestamp in milliseconds ticks.
  * To simulate time jitter, network latency and time drift,
@@ -0,0 +1,447 @@
+/*
+ * @brief sim_loc_time_sync_estimator implements estimators for the linear model between lidar ticks and system time.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#include <algorithm>
+#include <math.h>
+
+#include "sick_lidar_localization/SoftwarePLL.h"
+#include "sick_lidar_localization/tick_unwrapper.h"
+#include "sick_lidar_localization/time_sync_estimator.h"
+
+/*!
+ * Creates and returns a new estimator configured by config.estimator, or 0 in case of an unknown estimator type.
+ * @param[in] config estimator configuration
+ * @param[in] id identifier of the estimator (used for SoftwarePLL instances)
+ * @return new estimator (delete after use), or 0 in case of an invalid configuration
+ */
+sick_lidar_localization::TimeSyncEstimator* sick_lidar_localization::TimeSyncEstimator::create(const TimeSyncEstimatorConfig & config, const std::string & id)
+{
+  if(config.estimator == "software_pll")
+    return new sick_lidar_localization::SoftwarePllEstimator(config, id);
+  if(config.estimator == "kalman")
+    return new sick_lidar_localization::KalmanEstimator(config);
+  if(config.estimator == "theil_sen")
+    return new sick_lidar_localization::TheilSenEstimator(config);
+  if(config.estimator == "fusion")
+    return new sick_lidar_localization::FusionEstimator(config);
+  return 0;
+}
+
+/*
+ * SoftwarePllEstimator: least squares fit by SoftwarePLL
+ */
+
+sick_lidar_localization::SoftwarePllEstimator::SoftwarePllEstimator(const TimeSyncEstimatorConfig & config, const std::string & id)
+: m_software_pll(SoftwarePLL::Instance(id, config.fifo_length))
+{
+}
+
+bool sick_lidar_localization::SoftwarePllEstimator::update(double system_time, uint32_t ticks)
+{
+  uint32_t sec = (uint32_t)system_time;
+  uint32_t nsec = (uint32_t)(1.0e9 * (system_time - sec));
+  return m_software_pll.UpdatePLL(sec, nsec, ticks);
+}
+
+int sick_lidar_localization::SoftwarePllEstimator::divergenceCount(void) const
+{
+  return (int)m_software_pll.ExtrapolationDivergenceCounter();
+}
+
+double sick_lidar_localization::SoftwarePllEstimator::residualRms(void) const
+{
+  return m_software_pll.ResidualStdDev();
+}
+
+sick_lidar_localization::TimeSyncModel sick_lidar_localization::SoftwarePllEstimator::model(void) const
+{
+  sick_lidar_localization::TimeSyncModel model;
+  model.valid = m_software_pll.GetLinearModel(model.reference_tick, model.reference_time, model.slope);
+  return model;
+}
+
+/*
+ * KalmanEstimator: two-state (offset, drift) kalman filter
+ */
+
+sick_lidar_localization::KalmanEstimator::KalmanEstimator(const TimeSyncEstimatorConfig & config)
+: m_config(config), m_has_reference(false), m_reference_tick(0), m_reference_time(0), m_last_tick(0), m_time(0), m_slope(0.001),
+  m_accepted_cnt(0), m_divergence_cnt(0), m_innovation_sq(0)
+{
+  m_covariance[0][0] = m_covariance[0][1] = m_covariance[1][0] = m_covariance[1][1] = 0;
+}
+
+void sick_lidar_localization::KalmanEstimator::reset(double system_time, uint32_t ticks)
+{
+  m_has_reference = true;
+  m_reference_tick = ticks;
+  m_reference_time = system_time;
+  m_last_tick = ticks;
+  m_time = 0;
+  m_slope = 0.001; // lidar ticks in milliseconds
+  m_covariance[0][0] = m_config.kalman_measurement_noise * m_config.kalman_measurement_noise;
+  m_covariance[0][1] = m_covariance[1][0] = 0;
+  m_covariance[1][1] = (0.001 * 100.0e-6) * (0.001 * 100.0e-6); // initial drift uncertainty 100 ppm
+  m_accepted_cnt = 1;
+  m_divergence_cnt = 0;
+  m_innovation_sq = 0;
+}
+
+bool sick_lidar_localization::KalmanEstimator::update(double system_time, uint32_t ticks)
+{
+  if(!m_has_reference)
+  {
+    reset(system_time, ticks);
+    return true;
+  }
+  uint64_t tick = sick_lidar_localization::TickUnwrapper::unwrap(m_last_tick, ticks);
+  double delta_ticks = (double)(int64_t)(tick - m_last_tick);
+  if(delta_ticks <= 0) // duplicated or outdated measurement
+    return false;
+  // Prediction
+  double delta_time = fabs(delta_ticks * m_slope);
+  double drift_noise = 0.001 * 1.0e-6 * m_config.kalman_drift_noise; // random walk of the slope in seconds per tick per sqrt(second)
+  double offset_noise = 1.0e-6;                                      // random walk of the offset in seconds per sqrt(second)
+  double time_pred = m_time + delta_ticks * m_slope;
+  double p00 = m_covariance[0][0] + delta_ticks * (m_covariance[0][1] + m_covariance[1][0]) + delta_ticks * delta_ticks * m_covariance[1][1] + offset_noise * offset_noise * delta_time;
+  double p01 = m_covariance[0][1] + delta_ticks * m_covariance[1][1];
+  double p10 = m_covariance[1][0] + delta_ticks * m_covariance[1][1];
+  double p11 = m_covariance[1][1] + drift_noise * drift_noise * delta_time;
+  // Innovation and outlier rejection
+  double innovation = (system_time - m_reference_time) - time_pred;
+  double innovation_var = p00 + m_config.kalman_measurement_noise * m_config.kalman_measurement_noise;
+  if(m_accepted_cnt >= 2 && (fabs(innovation) > m_config.max_time_deviation || innovation * innovation > 25 * innovation_var))
+  {
+    m_divergence_cnt++;
+    if(m_divergence_cnt >= m_config.max_divergence_count)
+      reset(system_time, ticks); // reset filter, maybe due to abrupt change of time base
+    return false;
+  }
+  // Update
+  double gain0 = p00 / innovation_var, gain1 = p10 / innovation_var;
+  m_time = time_pred + gain0 * innovation;
+  m_slope += gain1 * innovation;
+  m_covariance[0][0] = (1 - gain0) * p00;
+  m_covariance[0][1] = (1 - gain0) * p01;
+  m_covariance[1][0] = p10 - gain1 * p00;
+  m_covariance[1][1] = p11 - gain1 * p01;
+  m_last_tick = tick;
+  m_accepted_cnt++;
+  m_divergence_cnt = 0;
+  m_innovation_sq += (innovation * innovation - m_innovation_sq) / std::min(m_accepted_cnt - 1, 8); // exponentially weighted, weight 1/8 after 8 measurements
+  return true;
+}
+
+sick_lidar_localization::TimeSyncModel sick_lidar_localization::KalmanEstimator::model(void) const
+{
+  return sick_lidar_localization::TimeSyncModel(m_has_reference && m_accepted_cnt >= 3, (uint32_t)(m_last_tick & 0xFFFFFFFF), m_reference_time + m_time, m_slope);
+}
+
+/*
+ * TheilSenEstimator: robust fit by median of pairwise slopes
+ */
+
+sick_lidar_localization::TheilSenEstimator::TheilSenEstimator(const TimeSyncEstimatorConfig & config)
+: m_config(config), m_ticks(std::max(2, config.fifo_length), 0), m_times(std::max(2, config.fifo_length), 0),
+  m_workspace(std::max(3, config.fifo_length) * (std::max(3, config.fifo_length) - 1) / 2, 0),
+  m_fifo_cnt(0), m_fifo_head(0), m_has_reference(false), m_reference_tick(0), m_reference_time(0), m_last_tick(0), m_divergence_cnt(0), m_residual_rms(0)
+{
+}
+
+bool sick_lidar_localization::TheilSenEstimator::update(double system_time, uint32_t ticks)
+{
+  if(!m_has_reference)
+  {
+    m_has_reference = true;
+    m_reference_tick = ticks;
+    m_reference_time = system_time;
+    m_last_tick = ticks;
+  }
+  uint64_t tick = sick_lidar_localization::TickUnwrapper::unwrap(m_last_tick, ticks);
+  if(m_fifo_cnt > 0 && tick <= m_last_tick) // duplicated or outdated measurement
+    return false;
+  if(m_model.valid)
+  {
+    uint32_t sec = 0, nsec = 0;
+    m_model.tickToTime(ticks, sec, nsec);
+    if(fabs(sec + 1.0e-9 * nsec - system_time) > m_config.max_time_deviation) // outlier
+    {
+      m_divergence_cnt++;
+      if(m_divergence_cnt < m_config.max_divergence_count)
+        return false;
+      m_fifo_cnt = 0; // reset fifo, maybe due to abrupt change of time base
+      m_fifo_head = 0;
+      m_model = TimeSyncModel();
+    }
+  }
+  m_divergence_cnt = 0;
+  m_last_tick = tick;
+  m_ticks[m_fifo_head] = tick;
+  m_times[m_fifo_head] = system_time - m_reference_time;
+  m_fifo_head = (m_fifo_head + 1) % (int)m_ticks.size();
+  m_fifo_cnt = std::min(m_fifo_cnt + 1, (int)m_ticks.size());
+  if(m_fifo_cnt >= (int)m_ticks.size())
+    fit();
+  return true;
+}
+
+void sick_lidar_localization::TheilSenEstimator::fit(void)
+{
+  // Slope: median of pairwise slopes
+  size_t slope_cnt = 0;
+  for(int i = 0; i < m_fifo_cnt; i++)
+  {
+    for(int j = i + 1; j < m_fifo_cnt; j++)
+    {
+      double delta_ticks = (double)(int64_t)(m_ticks[j] - m_ticks[i]);
+      if(delta_ticks != 0)
+        m_workspace[slope_cnt++] = (m_times[j] - m_times[i]) / delta_ticks;
+    }
+  }
+  if(slope_cnt == 0)
+    return;
+  std::nth_element(m_workspace.begin(), m_workspace.begin() + slope_cnt / 2, m_workspace.begin() + slope_cnt);
+  double slope = m_workspace[slope_cnt / 2];
+  // Offset: median of residuals at the last tick
+  for(int i = 0; i < m_fifo_cnt; i++)
+    m_workspace[i] = m_times[i] + slope * (double)(int64_t)(m_last_tick - m_ticks[i]);
+  std::nth_element(m_workspace.begin(), m_workspace.begin() + m_fifo_cnt / 2, m_workspace.begin() + m_fifo_cnt);
+  double offset = m_workspace[m_fifo_cnt / 2];
+  double sum_sq_residuals = 0;
+  for(int i = 0; i < m_fifo_cnt; i++)
+    sum_sq_residuals += (m_workspace[i] - offset) * (m_workspace[i] - offset);
+  m_residual_rms = sqrt(sum_sq_residuals / m_fifo_cnt);
+  m_model = TimeSyncModel(true, (uint32_t)(m_last_tick & 0xFFFFFFFF), m_reference_time + offset, slope);
+}
+
+/*
+ * FusionEstimator: lower envelope of result telegram arrivals, calibrated by LocRequestTimestamp measurements
+ */
+
+sick_lidar_localization::FusionEstimator::FusionEstimator(const TimeSyncEstimatorConfig & config)
+: m_config(config), m_has_reference(false), m_reference_tick(0), m_reference_time(0), m_last_tick(0),
+  m_envelope_ticks(std::max(2, (int)ceil(config.fusion_window)), 0), m_envelope_times(std::max(2, (int)ceil(config.fusion_window)), 0),
+  m_envelope_cnt(0), m_envelope_head(0), m_current_valid(false), m_current_start(0), m_current_tick(0), m_current_time(0),
+  m_request_ticks(std::max(1, config.fifo_length), 0), m_request_times(std::max(1, config.fifo_length), 0), m_request_cnt(0), m_request_head(0),
+  m_workspace(std::max(1, config.fifo_length), 0), m_latency(0), m_divergence_cnt(0), m_residual_rms(0)
+{
+}
+
+void sick_lidar_localization::FusionEstimator::setReference(double system_time, uint32_t ticks)
+{
+  if(!m_has_reference)
+  {
+    m_has_reference = true;
+    m_reference_tick = ticks;
+    m_reference_time = system_time;
+    m_last_tick = ticks;
+  }
+}
+
+void sick_lidar_localization::FusionEstimator::reset(void)
+{
+  m_envelope_cnt = 0;
+  m_envelope_head = 0;
+  m_current_valid = false;
+  m_request_cnt = 0;
+  m_request_head = 0;
+  m_latency = 0;
+  m_divergence_cnt = 0;
+  m_residual_rms = 0;
+  m_model = TimeSyncModel();
+}
+
+bool sick_lidar_localization::FusionEstimator::update(double system_time, uint32_t ticks)
+{
+  setReference(system_time, ticks);
+  uint64_t tick = sick_lidar_localization::TickUnwrapper::unwrap(m_last_tick, ticks);
+  int last_request = (m_request_head + (int)m_request_ticks.size() - 1) % (int)m_request_ticks.size();
+  if(m_request_cnt > 0 && tick <= m_request_ticks[last_request]) // duplicated or outdated measurement
+    return false;
+  if(m_model.valid)
+  {
+    uint32_t sec = 0, nsec = 0;
+    m_model.tickToTime(ticks, sec, nsec);
+    if(fabs(sec + 1.0e-9 * nsec - system_time) > m_config.max_time_deviation) // outlier
+    {
+      m_divergence_cnt++;
+      if(m_divergence_cnt < m_config.max_divergence_count)
+        return false;
+      reset(); // maybe due to abrupt change of time base
+    }
+  }
+  m_divergence_cnt = 0;
+  m_request_ticks[m_request_head] = tick;
+  m_request_times[m_request_head] = system_time - m_reference_time;
+  m_request_head = (m_request_head + 1) % (int)m_request_ticks.size();
+  m_request_cnt = std::min(m_request_cnt + 1, (int)m_request_ticks.size());
+  m_last_tick = std::max(m_last_tick, tick);
+  fit();
+  return true;
+}
+
+bool sick_lidar_localization::FusionEstimator::updateArrival(double arrival_time, uint32_t ticks)
+{
+  setReference(arrival_time, ticks);
+  uint64_t tick = sick_lidar_localization::TickUnwrapper::unwrap(m_last_tick, ticks);
+  double time = arrival_time - m_reference_time;
+  if(m_model.valid)
+  {
+    // Telegrams can not arrive before their lidar timestamp, otherwise the time base has changed (rejected until reset by LocRequestTimestamp measurements)
+    uint32_t sec = 0, nsec = 0;
+    m_model.tickToTime(ticks, sec, nsec);
+    if(arrival_time < sec + 1.0e-9 * nsec + m_latency - m_config.max_time_deviation)
+      return false;
+  }
+  if(m_current_valid && tick < m_current_start) // outdated telegram
+    return false;
+  if(!m_current_valid || tick >= m_current_start + 1000)
+  {
+    // Start next second, append the earliest arrival of the current second to the envelope
+    if(m_current_valid)
+    {
+      m_envelope_ticks[m_envelope_head] = m_current_tick;
+      m_envelope_times[m_envelope_head] = m_current_time;
+      m_envelope_head = (m_envelope_head + 1) % (int)m_envelope_ticks.size();
+      m_envelope_cnt = std::min(m_envelope_cnt + 1, (int)m_envelope_ticks.size());
+    }
+    m_current_valid = true;
+    m_current_start = tick;
+    m_current_tick = tick;
+    m_current_time = time;
+  }
+  else if(time - 0.001 * (double)(int64_t)(tick - m_current_tick) < m_current_time) // earlier arrival within the current second
+  {
+    m_current_tick = tick;
+    m_current_time = time;
+  }
+  m_last_tick = std::max(m_last_tick, tick);
+  fit();
+  return true;
+}
+
+void sick_lidar_localization::FusionEstimator::fit(void)
+{
+  // Fit a line to the lower envelope of arrivals until the regression of LocRequestTimestamps is valid (i.e. after
+  // fifo_length measurements), or if no result telegrams received. The envelope provides a valid model within about
+  // a second after start, but its error is higher than the error of the regression, once the regression is valid.
+  // The current second is used only until the first second is completed, since its minimum is not yet settled.
+  bool regression_valid = (m_request_cnt >= (int)m_request_ticks.size());
+  bool use_envelope = m_current_valid && !regression_valid;
+  int point_cnt = (use_envelope ? std::max(1, m_envelope_cnt) : m_request_cnt);
+  if(point_cnt <= 0)
+    return;
+  double mean_tick = 0, mean_time = 0, sum_sq_tick = 0, sum_co = 0;
+  int64_t min_tick = 0, max_tick = 0;
+  for(int n = 0; n < point_cnt; n++)
+  {
+    // Welford update relative to the last tick
+    int64_t delta_tick = 0;
+    double time = 0;
+    if(!use_envelope)
+    {
+      delta_tick = (int64_t)(m_request_ticks[n] - m_last_tick);
+      time = m_request_times[n];
+    }
+    else if(n < m_envelope_cnt)
+    {
+      delta_tick = (int64_t)(m_envelope_ticks[n] - m_last_tick);
+      time = m_envelope_times[n];
+    }
+    else
+    {
+      delta_tick = (int64_t)(m_current_tick - m_last_tick);
+      time = m_current_time;
+    }
+    min_tick = ((n == 0) ? delta_tick : std::min(min_tick, delta_tick));
+    max_tick = ((n == 0) ? delta_tick : std::max(max_tick, delta_tick));
+    double dx = (double)delta_tick - mean_tick, dy = time - mean_time;
+    mean_tick += dx / (n + 1);
+    mean_time += dy / (n + 1);
+    sum_sq_tick += dx * ((double)delta_tick - mean_tick);
+    sum_co += dx * (time - mean_time);
+  }
+  // Nominal slope (1 millisecond per tick) until the envelope spans at least 10 seconds with at least 10 points
+  // (the slope of a few envelope points is less accurate than the nominal slope, f.e. with low scan rates)
+  bool fit_slope = (use_envelope ? (point_cnt >= 10 && max_tick - min_tick >= 10000) : (point_cnt >= 3));
+  double slope = ((fit_slope && sum_sq_tick > 0) ? (sum_co / sum_sq_tick) : 0.001);
+  double time_at_last_tick = mean_time - slope * mean_tick;
+  bool valid = false;
+  if(use_envelope)
+  {
+    // Calibrate the delay of the envelope by the median deviation from LocRequestTimestamps
+    if(m_request_cnt > 0)
+    {
+      for(int n = 0; n < m_request_cnt; n++)
+        m_workspace[n] = time_at_last_tick - slope * (double)(int64_t)(m_last_tick - m_request_ticks[n]) - m_request_times[n];
+      std::nth_element(m_workspace.begin(), m_workspace.begin() + m_request_cnt / 2, m_workspace.begin() + m_request_cnt);
+      m_latency = m_workspace[m_request_cnt / 2];
+      time_at_last_tick -= m_latency;
+      valid = (m_envelope_cnt >= 1 || m_request_cnt >= 2);
+    }
+  }
+  else
+  {
+    valid = regression_valid;
+  }
+  // Residual rms of the LocRequestTimestamp measurements
+  double sum_sq_residuals = 0;
+  for(int n = 0; n < m_request_cnt; n++)
+  {
+    double residual = time_at_last_tick - slope * (double)(int64_t)(m_last_tick - m_request_ticks[n]) - m_request_times[n];
+    sum_sq_residuals += residual * residual;
+  }
+  m_residual_rms = ((m_request_cnt > 0) ? sqrt(sum_sq_residuals / m_request_cnt) : 0);
+  m_model = TimeSyncModel(valid, (uint32_t)(m_last_tick & 0xFFFFFFFF), m_reference_time + time_at_last_tick, slope);
+}
@@ -0,0 +1,153 @@
+/*
+ * @brief time_sync_scheduler adapts the rate of LocRequestTimestamp requests to the quality of
+ * the time synchronization: requests are sent faster when residuals, round trip time jitter or divergence
+ * counts rise, and slower down to a configurable minimum rate while the software pll is stable.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#include <algorithm>
+#include <math.h>
+
+#include "sick_lidar_localization/time_sync_scheduler.h"
+
+/*!
+ * Constructor
+ * @param[in] adaptive true: adaptive scheduling, false: constant rate after initial phase
+ * @param[in] rate rate of LocRequestTimestamp requests after the initial phase (not adaptive), default: 0.1
+ * @param[in] min_rate minimum rate of LocRequestTimestamp requests (adaptive scheduling), default: 0.05
+ * @param[in] max_rate rate of LocRequestTimestamp requests during initial phase and after divergence, default: 1.0
+ * @param[in] initial_length number of measurements with max_rate after start, default: 10
+ * @param[in] residual_tolerance tolerated residual rms and round trip time jitter in seconds, default: 0.005
+ */
+sick_lidar_localization::TimeSyncScheduler::TimeSyncScheduler(bool adaptive, double rate, double min_rate, double max_rate, int initial_length, double residual_tolerance)
+: m_adaptive(adaptive), m_min_interval(1.0 / std::max(1.0e-3, max_rate)), m_max_interval(1.0 / std::max(1.0e-3, min_rate)), m_default_interval(1.0 / std::max(1.0e-3, rate)),
+  m_initial_length(initial_length), m_residual_tolerance(residual_tolerance), m_measurement_cnt(0), m_quality_cnt(0),
+  m_residual_sq(0), m_rtt_mean(0), m_rtt_var(0), m_interval(0)
+{
+  m_max_interval = std::max(m_max_interval, m_min_interval);
+  m_interval = m_min_interval;
+}
+
+/*!
+ * Updates the scheduler with a LocRequestTimestamp measurement.
+ * @param[in] initialized true if the software pll is initialized
+ * @param[in] residual difference in seconds between measured and estimated system time before updating the software pll (0 if not initialized)
+ * @param[in] round_trip_time round trip time of the LocRequestTimestamp request in seconds
+ * @param[in] divergence_cnt number of consecutive measurements rejected by the software pll
+ * @param[in] accepted false if the measurement has been rejected by its round trip time (residual not evaluated)
+ */
+void sick_lidar_localization::TimeSyncScheduler::update(bool initialized, double residual, double round_trip_time, int divergence_cnt, bool accepted)
+{
+  boost::lock_guard<boost::mutex> scheduler_lockguard(m_scheduler_mutex);
+  m_measurement_cnt++;
+  // Exponentially weighted averages, weight 1/n during the first measurements, 1/8 afterwards
+  double weight = 1.0 / std::min(++m_quality_cnt, 8);
+  double rtt_delta = round_trip_time - m_rtt_mean;
+  m_rtt_mean += weight * rtt_delta;
+  m_rtt_var = (1 - weight) * (m_rtt_var + weight * rtt_delta * rtt_delta);
+  if(initialized && accepted)
+    m_residual_sq += weight * (residual * residual - m_residual_sq);
+  // Schedule the next request
+  if(!m_adaptive)
+  {
+    m_interval = ((m_measurement_cnt < m_initial_length) ? m_min_interval : m_default_interval);
+  }
+  else if(m_measurement_cnt < m_initial_length || !initialized || divergence_cnt > 0)
+  {
+    m_interval = m_min_interval;
+  }
+  else
+  {
+    double deviation = std::max(sqrt(m_residual_sq), sqrt(m_rtt_var));
+    if(deviation > m_residual_tolerance)
+      m_interval = std::max(m_min_interval, 0.5 * m_interval);
+    else if(deviation < 0.5 * m_residual_tolerance)
+      m_interval = std::min(m_max_interval, 1.5 * m_interval);
+  }
+}
+
+/*!
+ * Updates the scheduler with a failed LocRequestTimestamp request (f.e. timeout or lost connection).
+ * The next request is scheduled after the minimum interval (1/max_rate), like after divergent measurements.
+ */
+void sick_lidar_localization::TimeSyncScheduler::updateFailed(void)
+{
+  boost::lock_guard<boost::mutex> scheduler_lockguard(m_scheduler_mutex);
+  m_interval = m_min_interval;
+}
+
+/*!
+ * Returns the interval in seconds until the next LocRequestTimestamp request.
+ */
+double sick_lidar_localization::TimeSyncScheduler::interval(void)
+{
+  boost::lock_guard<boost::mutex> scheduler_lockguard(m_scheduler_mutex);
+  return m_interval;
+}
+
+/*!
+ * Returns the exponentially weighted residual rms in seconds.
+ */
+double sick_lidar_localization::TimeSyncScheduler::residualRms(void)
+{
+  boost::lock_guard<boost::mutex> scheduler_lockguard(m_scheduler_mutex);
+  return sqrt(m_residual_sq);
+}
+
+/*!
+ * Returns the exponentially weighted round trip time jitter (standard deviation) in seconds.
+ */
+double sick_lidar_localization::TimeSyncScheduler::roundTripJitter(void)
+{
+  boost::lock_guard<boost::mutex> scheduler_lockguard(m_scheduler_mutex);
+  return sqrt(m_rtt_var);
+}
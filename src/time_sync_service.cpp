@@ -82,41 +82,118 @@
  *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
  *
  */
+#include <algorithm>
+#include <boost/make_shared.hpp>
+#include <iomanip>
 #include <ros/ros.h>
 
 #include "sick_lidar_localization/cola_parser.h"
-#include "sick_lidar_localization/SoftwarePLL.h"
 #include "sick_lidar_localization/time_sync_service.h"
 
 /*!
  * Constructor
  */
 sick_lidar_localization::TimeSyncService::TimeSyncService(ros::NodeHandle* nh)
-: m_time_sync_thread_running(false), m_time_sync_thread(0), m_cola_binary(false), m_cola_binary_mode(0), m_software_pll_fifo_length(7),
-  m_time_sync_rate(0.1), m_time_sync_initial_rate(1.0), m_time_sync_initial_length(10), m_cola_response_timeout(1.0)
+: m_time_sync_thread_running(false), m_time_sync_thread(0), m_cola_binary(false), m_cola_binary_mode(0), m_send_time_estimator(0), m_receive_time_estimator(0),
+  m_time_sync_scheduler(0), m_cola_response_timeout(1.0),
+  m_cola_service_client(nh, "SickLocColaTimestampTelegram"), m_time_sync_model_published_valid(false),
+  m_published_clock_offset(0), m_controller_serial_number(0), m_state_file("/tmp/sick_lidar_localization_time_sync_state.txt"), m_state_max_deviation(0.01), m_warm_start_pending(false),
+  m_sample_cnt(0), m_accepted_sample_cnt(0)
 {
   if(nh)
   {
     // Configuration and parameter
     ros::param::param<int>("/sick_lidar_localization/driver/cola_binary", m_cola_binary_mode, m_cola_binary_mode);
     m_cola_binary = (m_cola_binary_mode == 1) ? true : false; //  0: send Cola-ASCII (default), 1: send Cola-Binary, 2: toggle between Cola-ASCII and Cola-Binary (test and development only!)
-    ros::param::param<int>("/sick_lidar_localization/time_sync/software_pll_fifo_length", m_software_pll_fifo_length, m_software_pll_fifo_length);
-    double time_sync_rate = 0.1, time_sync_initial_rate = 1.0;
+    ros::param::param<int>("/sick_lidar_localization/time_sync/software_pll_fifo_length", m_estimator_config.fifo_length, m_estimator_config.fifo_length);
+    ros::param::param<std::string>("/sick_lidar_localization/time_sync/time_sync_estimator", m_estimator_config.estimator, m_estimator_config.estimator);
+    ros::param::param<double>("/sick_lidar_localization/time_sync/kalman_measurement_noise", m_estimator_config.kalman_measurement_noise, m_estimator_config.kalman_measurement_noise);
+    ros::param::param<double>("/sick_lidar_localization/time_sync/kalman_drift_noise", m_estimator_config.kalman_drift_noise, m_estimator_config.kalman_drift_noise);
+    ros::param::param<double>("/sick_lidar_localization/time_sync/fusion_window", m_estimator_config.fusion_window, m_estimator_config.fusion_window);
+    double time_sync_rate = 0.1, time_sync_initial_rate = 1.0, time_sync_min_rate = 0.05, time_sync_residual_tolerance = 0.005;
+    int time_sync_initial_length = 10;
+    bool time_sync_adaptive_rate = true;
     ros::param::param<double>("/sick_lidar_localization/time_sync/time_sync_rate", time_sync_rate, time_sync_rate);
     ros::param::param<double>("/sick_lidar_localization/time_sync/time_sync_initial_rate", time_sync_initial_rate, time_sync_initial_rate);
-    m_time_sync_rate = ros::Rate(time_sync_rate);
-    m_time_sync_initial_rate = ros::Rate(time_sync_initial_rate);
-    ros::param::param<int>("/sick_lidar_localization/time_sync/time_sync_initial_length", m_time_sync_initial_length, m_time_sync_initial_length);
+    ros::param::param<int>("/sick_lidar_localization/time_sync/time_sync_initial_length", time_sync_initial_length, time_sync_initial_length);
+    ros::param::param<bool>("/sick_lidar_localization/time_sync/time_sync_adaptive_rate", time_sync_adaptive_rate, time_sync_adaptive_rate);
+    ros::param::param<double>("/sick_lidar_localization/time_sync/time_sync_min_rate", time_sync_min_rate, time_sync_min_rate);
+    ros::param::param<double>("/sick_lidar_localization/time_sync/time_sync_residual_tolerance", time_sync_residual_tolerance, time_sync_residual_tolerance);
+    m_time_sync_scheduler = new sick_lidar_localization::TimeSyncScheduler(time_sync_adaptive_rate, time_sync_rate, time_sync_min_rate, time_sync_initial_rate, time_sync_initial_length, time_sync_residual_tolerance);
     ros::param::param<double>("/sick_lidar_localization/time_sync/cola_response_timeout", m_cola_response_timeout, m_cola_response_timeout);
+    std::string cola_broker_socket = "/tmp/sick_lidar_localization_cola.sock";
+    ros::param::param<std::string>("/sick_lidar_localization/driver/cola_broker_socket", cola_broker_socket, cola_broker_socket);
+    m_cola_broker_client = boost::make_shared<sick_lidar_localization::ColaBrokerClient>(cola_broker_socket);
+    int time_sync_rtt_window = 16;
+    double time_sync_rtt_margin = 0.002;
+    ros::param::param<int>("/sick_lidar_localization/time_sync/time_sync_rtt_window", time_sync_rtt_window, time_sync_rtt_window);
+    ros::param::param<double>("/sick_lidar_localization/time_sync/time_sync_rtt_margin", time_sync_rtt_margin, time_sync_rtt_margin);
+    m_round_trip_filter = sick_lidar_localization::RoundTripFilter(time_sync_rtt_window, time_sync_rtt_margin, m_cola_response_timeout);
+    ros::param::param<std::string>("/sick_lidar_localization/time_sync/time_sync_state_file", m_state_file, m_state_file);
+    bool time_sync_monotonic_clock = true;
+    ros::param::param<bool>("/sick_lidar_localization/time_sync/time_sync_monotonic_clock", time_sync_monotonic_clock, time_sync_monotonic_clock);
+    m_clock_mapping = sick_lidar_localization::ClockMapping(time_sync_monotonic_clock);
+    ros::param::param<double>("/sick_lidar_localization/time_sync/time_sync_state_max_deviation", m_state_max_deviation, m_state_max_deviation);
+    std::string time_sync_model_topic = "/sick_lidar_localization/time_sync/model"; // default topic to publish the software pll model (type SickLocTimeSyncModelMsg)
+    ros::param::param<std::string>("/sick_lidar_localization/time_sync/time_sync_model_topic", time_sync_model_topic, time_sync_model_topic);
+    // Latched publisher for the software pll model, evaluated by sim_loc_driver to calculate system time from lidar ticks
+    m_time_sync_model_publisher = nh->advertise<sick_lidar_localization::SickLocTimeSyncModelMsg>(time_sync_model_topic, 1, true);
+    // Publisher for round trip time statistics of LocRequestTimestamp measurements
+    std::string time_sync_rtt_topic = "/sick_lidar_localization/time_sync/rtt"; // default topic to publish round trip time statistics (type SickLocTimeSyncRttMsg)
+    ros::param::param<std::string>("/sick_lidar_localization/time_sync/time_sync_rtt_topic", time_sync_rtt_topic, time_sync_rtt_topic);
+    m_time_sync_rtt_publisher = nh->advertise<sick_lidar_localization::SickLocTimeSyncRttMsg>(time_sync_rtt_topic, 1);
+    // Publisher for the time sync quality (offset, drift, residuals, round trip times, acceptance ratio, divergence)
+    std::string time_sync_quality_topic = "/sick_lidar_localization/time_sync/quality"; // default topic to publish the time sync quality (type SickLocTimeSyncQualityMsg)
+    ros::param::param<std::string>("/sick_lidar_localization/time_sync/time_sync_quality_topic", time_sync_quality_topic, time_sync_quality_topic);
+    m_time_sync_quality_publisher = nh->advertise<sick_lidar_localization::SickLocTimeSyncQualityMsg>(time_sync_quality_topic, 1);
     // Advertise service "SickLocRequestTimestamp" to send a LocRequestTimestamp, receive the response and to calculate the time offset
     m_timestamp_service_server = nh->advertiseService("SickLocRequestTimestamp", &sick_lidar_localization::TimeSyncService::serviceCbRequestTimestamp, this);
     ROS_INFO_STREAM("TimeSyncService: advertising ros service \"SickLocRequestTimestamp\" for LocRequestTimestamp commands, message type SickLocRequestTimestamp");
     // Advertise service "SickLocTimeSync" to calculate system time from ticks by software pll
     m_timesync_service_server = nh->advertiseService("SickLocTimeSync", &sick_lidar_localization::TimeSyncService::serviceCbTimeSync, this);
     ROS_INFO_STREAM("TimeSyncService: advertising ros service \"SickLocTimeSync\" for time synchronization by software pll, message type SickLocTimeSync");
-    // Clients for ros services "SickLocColaTelegram", "SickLocRequestTimestamp" and "SickLocTimeSync", required for time synchronization using a software pll
-    m_cola_service_client = nh->serviceClient<sick_lidar_localization::SickLocColaTelegramSrv>("SickLocColaTelegram");
-    m_request_timestamp_client = nh->serviceClient<sick_lidar_localization::SickLocRequestTimestampSrv>("SickLocRequestTimestamp");
+    // Advertise service "SickLocTimeSyncBatch" to calculate system times from an array of ticks by software pll
+    m_timesync_batch_service_server = nh->advertiseService("SickLocTimeSyncBatch", &sick_lidar_localization::TimeSyncService::serviceCbTimeSyncBatch, this);
+    ROS_INFO_STREAM("TimeSyncService: advertising ros service \"SickLocTimeSyncBatch\" for time synchronization of tick arrays by software pll, message type SickLocTimeSyncBatch");
+  }
+  if(!m_time_sync_scheduler)
+    m_time_sync_scheduler = new sick_lidar_localization::TimeSyncScheduler();
+  // Create software pll estimators for send and receive timestamps
+  m_send_time_estimator = sick_lidar_localization::TimeSyncEstimator::create(m_estimator_config, "sick_lidar_localization::TimeSyncService::SendTime");
+  m_receive_time_estimator = sick_lidar_localization::TimeSyncEstimator::create(m_estimator_config, "sick_lidar_localization::TimeSyncService::ReceiveTime");
+  if(!m_send_time_estimator || !m_receive_time_estimator)
+  {
+    ROS_ERROR_STREAM("## ERROR TimeSyncService: invalid time_sync_estimator \"" << m_estimator_config.estimator << "\", using default estimator \"software_pll\"");
+    delete(m_send_time_estimator);
+    delete(m_receive_time_estimator);
+    m_estimator_config.estimator = "software_pll";
+    m_send_time_estimator = sick_lidar_localization::TimeSyncEstimator::create(m_estimator_config, "sick_lidar_localization::TimeSyncService::SendTime");
+    m_receive_time_estimator = sick_lidar_localization::TimeSyncEstimator::create(m_estimator_config, "sick_lidar_localization::TimeSyncService::ReceiveTime");
+  }
+  ROS_INFO_STREAM("TimeSyncService: time_sync_estimator \"" << m_estimator_config.estimator << "\", fifo length " << m_estimator_config.fifo_length);
+  updateClockMapping();
+  // Load the saved state for a warm start, validated against a new LocRequestTimestamp after the serial number of the localization controller is known
+  m_time_sync_state = sick_lidar_localization::TimeSyncState(m_estimator_config.fifo_length);
+  m_warm_start_state = sick_lidar_localization::TimeSyncState(m_estimator_config.fifo_length);
+  if(!m_state_file.empty())
+  {
+    if(m_warm_start_state.load(m_state_file))
+    {
+      m_warm_start_pending = true;
+      m_time_sync_state.serial_number = m_warm_start_state.serial_number;
+      ROS_INFO_STREAM("TimeSyncService: loaded time sync state with " << m_warm_start_state.samples.size() << " measurements from file \"" << m_state_file << "\", serial number " << m_warm_start_state.serial_number);
+    }
+    else
+      ROS_INFO_STREAM("TimeSyncService: no time sync state loaded from file \"" << m_state_file << "\", cold start");
+  }
+  if(nh && (m_estimator_config.estimator == "fusion" || !m_state_file.empty()))
+  {
+    // Subscribe to result port telegrams published by sim_loc_driver to update the estimators by telegram arrivals
+    // and to get the serial number of the localization controller
+    std::string result_telegrams_topic = "/sick_lidar_localization/driver/result_telegrams";
+    ros::param::param<std::string>("/sick_lidar_localization/driver/result_telegrams_topic", result_telegrams_topic, result_telegrams_topic);
+    m_result_telegrams_subscriber = nh->subscribe(result_telegrams_topic, 16, &sick_lidar_localization::TimeSyncService::messageCbResultPortTelegrams, this);
+    ROS_INFO_STREAM("TimeSyncService: subscribed to result telegrams on topic \"" << result_telegrams_topic << "\"");
   }
 }
 
@@ -126,6 +203,9 @@ sick_lidar_localization::TimeSyncService::TimeSyncService(ros::NodeHandle* nh)
 sick_lidar_localization::TimeSyncService::~TimeSyncService()
 {
   stop();
+  delete(m_send_time_estimator);
+  delete(m_receive_time_estimator);
+  delete(m_time_sync_scheduler);
 }
 
 /*!
@@ -137,15 +217,21 @@ sick_lidar_localization::TimeSyncService::~TimeSyncService()
  */
 bool sick_lidar_localization::TimeSyncService::serviceCbRequestTimestamp(sick_lidar_localization::SickLocRequestTimestampSrv::Request & service_request, sick_lidar_localization::SickLocRequestTimestampSrv::Response & service_response)
 {
-  // Sends cola command "sMN LocRequestTimestamp" and receive timestamp from localization controller using ros service "SickLocColaTelegram"
+  // Sends cola command "sMN LocRequestTimestamp" and receive timestamp from localization controller using the timestamp channel of the cola broker
+  // (one local ipc hop) or ros service "SickLocColaTimestampTelegram", if the cola broker is not available
   sick_lidar_localization::SickLocColaTelegramSrv cola_telegram;
   cola_telegram.request.cola_ascii_request = "sMN LocRequestTimestamp";
   cola_telegram.request.wait_response_timeout = m_cola_response_timeout;
   // cola_telegram.request.send_binary = m_cola_binary;
   m_cola_binary = ((m_cola_binary_mode == 2) ? (!m_cola_binary) : (m_cola_binary)); // m_cola_binary_mode == 0: send Cola-ASCII (default), 1: send Cola-Binary, 2: toggle between Cola-ASCII and Cola-Binary (test and development only!)
-  if (!m_cola_service_client.call(cola_telegram) || cola_telegram.response.cola_ascii_response.empty())
+  bool request_sent = false, cola_success = false;
+  if(m_cola_broker_client)
+    cola_success = m_cola_broker_client->call(cola_telegram.request, cola_telegram.response, request_sent, sick_lidar_localization::ColaBroker::TIMESTAMP_REQUEST_CHANNEL);
+  if(!request_sent) // cola broker not available, fallback to ros service
+    cola_success = m_cola_service_client.call(cola_telegram);
+  if (!cola_success || cola_telegram.response.cola_ascii_response.empty())
   {
-    ROS_WARN_STREAM("## ERROR TimeSyncService::serviceCbRequestTimestamp(): calling ros service \"SickLocColaTelegram\" failed with request: "
+    ROS_WARN_STREAM("## ERROR TimeSyncService::serviceCbRequestTimestamp(): timestamp request by cola broker or ros service \"SickLocColaTimestampTelegram\" failed with request: "
       << sick_lidar_localization::Utils::flattenToString(cola_telegram.request) << " response: " << sick_lidar_localization::Utils::flattenToString(cola_telegram.response));
     return false;
   }
@@ -153,26 +239,30 @@ bool sick_lidar_localization::TimeSyncService::serviceCbRequestTimestamp(sick_li
     << " response: " << sick_lidar_localization::Utils::flattenToString(cola_telegram.response) << " succesfull.");
   
   // Decode response, get timestamp_lidar_ms from parameter
-  sick_lidar_localization::SickLocColaTelegramMsg cola_response = sick_lidar_localization::ColaParser::decodeColaTelegram(cola_telegram.response.cola_ascii_response);
-  if(cola_response.command_name != "LocRequestTimestamp" || cola_response.parameter.size() != 1)
+  const std::string & cola_response = cola_telegram.response.cola_ascii_response;
+  sick_lidar_localization::ColaParser::ColaTelegramView cola_response_view;
+  size_t parameter_pos = 0;
+  boost::string_view timestamp_parameter;
+  if(!sick_lidar_localization::ColaParser::tokenizeColaTelegram(cola_response, cola_response_view)
+    || cola_response_view.command_name != "LocRequestTimestamp" || cola_response_view.parameterCount() != 1
+    || !cola_response_view.nextParameter(parameter_pos, timestamp_parameter))
   {
-    ROS_WARN_STREAM("## ERROR TimeSyncService::serviceCbRequestTimestamp(): invalid or unexpected cola response: \"" << cola_telegram.response.cola_ascii_response
-      << "\" decoded to " << sick_lidar_localization::Utils::flattenToString(cola_response));
+    ROS_WARN_STREAM("## ERROR TimeSyncService::serviceCbRequestTimestamp(): invalid or unexpected cola response: \"" << cola_response << "\"");
     return false;
   }
   try
   {
-    service_response.timestamp_lidar_ms = (std::stoul(cola_response.parameter[0],nullptr,16) & 0xFFFFFFFF); // Lidar timestamp in milliseconds from LocRequestTimestamp response
+    service_response.timestamp_lidar_ms = (std::stoul(timestamp_parameter.to_string(),nullptr,16) & 0xFFFFFFFF); // Lidar timestamp in milliseconds from LocRequestTimestamp response
   }
   catch(const std::exception & exc)
   {
-    ROS_WARN_STREAM("## ERROR TimeSyncService::serviceCbRequestTimestamp(): failed to parse timestamp parameter in cola response " << sick_lidar_localization::Utils::flattenToString(cola_response)
-      << ", exception " << exc.what());
+    ROS_WARN_STREAM("## ERROR TimeSyncService::serviceCbRequestTimestamp(): failed to parse timestamp parameter in cola response \"" << cola_response
+      << "\", exception " << exc.what());
     return false;
   }
   if(service_response.timestamp_lidar_ms <= 0 || cola_telegram.response.send_timestamp_sec <= 0 || cola_telegram.response.receive_timestamp_sec <= 0)
   {
-    ROS_WARN_STREAM("## ERROR TimeSyncService::serviceCbRequestTimestamp(): invalid timestamps in cola response " << sick_lidar_localization::Utils::flattenToString(cola_response));
+    ROS_WARN_STREAM("## ERROR TimeSyncService::serviceCbRequestTimestamp(): invalid timestamps in cola response \"" << cola_response << "\"");
     return false;
   }
   
@@ -189,8 +279,12 @@ bool sick_lidar_localization::TimeSyncService::serviceCbRequestTimestamp(sick_li
   service_response.mean_time_vehicle_ms = mean_time_vehicle_nsec / 1000000;                                      // Vehicle mean timestamp in milliseconds: (send_time_vehicle + receive_time_vehicle) / 2
   service_response.delta_time_ms = service_response.mean_time_vehicle_ms - service_response.timestamp_lidar_ms;  // Time offset: mean_time_vehicle_ms - timestamp_lidar_ms
   
-  // Update software pll
+  // Update software pll, publish the software pll model, round trip time statistics and quality and save the state for a warm start
   updateSoftwarePll(service_response);
+  publishSoftwarePllModel();
+  publishRoundTripStatistics();
+  publishQuality();
+  saveState();
   
   // Get system timestamp from ticks via ros service "SickLocTimeSync"
   sick_lidar_localization::SickLocTimeSyncSrv time_sync_msg;
@@ -207,29 +301,293 @@ bool sick_lidar_localization::TimeSyncService::serviceCbRequestTimestamp(sick_li
 
 /*!
  * Update the software pll with lidar ticks and system time from response by "SickLocRequestTimestamp" servcice
+ * and updates the scheduler of LocRequestTimestamp requests with residual, round trip time and divergence.
+ * Measurements with a round trip time exceeding the minimum round trip time of recent measurements by more than
+ * time_sync_rtt_margin are rejected by the round trip filter and do not update the software pll.
  * @param[out] service_response service response by "SickLocRequestTimestamp" servcice
  */
 void sick_lidar_localization::TimeSyncService::updateSoftwarePll(sick_lidar_localization::SickLocRequestTimestampSrv::Response & service_response)
 {
+  updateClockMapping();
   boost::lock_guard<boost::mutex> software_pll_lockguard(m_software_pll_mutex);
-  SoftwarePLL & software_pll_send_time = SoftwarePLL::Instance("sick_lidar_localization::TimeSyncService::SendTime", m_software_pll_fifo_length);
-  SoftwarePLL & software_pll_receive_time = SoftwarePLL::Instance("sick_lidar_localization::TimeSyncService::ReceiveTime", m_software_pll_fifo_length);
-  software_pll_send_time.UpdatePLL(service_response.send_time_vehicle_sec, service_response.send_time_vehicle_nsec, service_response.timestamp_lidar_ms);
-  software_pll_receive_time.UpdatePLL(service_response.receive_time_vehicle_sec, service_response.receive_time_vehicle_nsec, service_response.timestamp_lidar_ms);
+  // The software pll runs on monotonic time, system timestamps are mapped to monotonic time
+  double send_time = m_clock_mapping.toMonotonic(service_response.send_time_vehicle_sec + 1.0e-9 * service_response.send_time_vehicle_nsec);
+  double receive_time = m_clock_mapping.toMonotonic(service_response.receive_time_vehicle_sec + 1.0e-9 * service_response.receive_time_vehicle_nsec);
+  // Residual of the measurement, i.e. difference between mean system time and system time estimated before update
+  sick_lidar_localization::TimeSyncModel model = sick_lidar_localization::TimeSyncModel::mean(m_send_time_estimator->model(), m_receive_time_estimator->model());
+  uint32_t sec = 0, nsec = 0;
+  double residual = 0;
+  if(model.tickToTime(service_response.timestamp_lidar_ms, sec, nsec))
+    residual = (sec + 1.0e-9 * nsec) - 0.5 * (send_time + receive_time);
+  bool accepted = m_round_trip_filter.update(receive_time - send_time);
+  m_sample_cnt++;
+  if(accepted)
+  {
+    sick_lidar_localization::TimeSyncSample sample(service_response.timestamp_lidar_ms, send_time, receive_time);
+    if(m_warm_start_pending && !warmStart(sample))
+    {
+      m_time_sync_state.addSample(sample); // warm start deferred, measurement is replayed after the warm start
+    }
+    else
+    {
+      bool send_time_updated = m_send_time_estimator->update(send_time, service_response.timestamp_lidar_ms);
+      bool receive_time_updated = m_receive_time_estimator->update(receive_time, service_response.timestamp_lidar_ms);
+      if(send_time_updated && receive_time_updated)
+        m_accepted_sample_cnt++;
+      m_time_sync_state.addSample(sample);
+      updateModelSnapshot();
+    }
+  }
+  else
+  {
+    ROS_INFO_STREAM("TimeSyncService::updateSoftwarePll(): LocRequestTimestamp rejected, round trip time " << (1000 * m_round_trip_filter.last())
+      << " ms exceeds minimum round trip time " << (1000 * m_round_trip_filter.minimum()) << " ms");
+  }
+  int divergence_cnt = std::max(m_send_time_estimator->divergenceCount(), m_receive_time_estimator->divergenceCount());
+  m_time_sync_scheduler->update(model.valid, residual, receive_time - send_time, divergence_cnt, accepted);
+}
+
+/*!
+ * Validates the saved state against a new measurement and replays the saved measurements to the
+ * software pll, if the localization controller is still running (warm start). Otherwise the saved state
+ * is discarded (cold start). The warm start is deferred until the serial number of the localization
+ * controller has been received by result telegrams, max. software_pll_fifo_length measurements. Measurements
+ * received while the warm start is deferred are replayed after the saved measurements. Called with
+ * m_software_pll_mutex locked.
+ * @param[in] sample new LocRequestTimestamp measurement
+ * @return true if the saved state has been validated or discarded, false if the warm start is deferred
+ */
+bool sick_lidar_localization::TimeSyncService::warmStart(const sick_lidar_localization::TimeSyncSample & sample)
+{
+  if(m_controller_serial_number == 0 && (int)m_time_sync_state.samples.size() + 1 < m_estimator_config.fifo_length)
+    return false; // serial number not yet received, warm start deferred
+  m_warm_start_pending = false;
+  std::vector<sick_lidar_localization::TimeSyncSample> deferred_samples = m_time_sync_state.samples;
+  m_time_sync_state.samples.clear();
+  double deviation = 0;
+  m_warm_start_state.shiftTime(-m_clock_mapping.offset()); // the state file contains system time, the software pll runs on monotonic time
+  if(m_controller_serial_number == 0)
+  {
+    ROS_WARN_STREAM("TimeSyncService: saved time sync state discarded (serial number of localization controller unknown, no result telegrams received), cold start");
+  }
+  else if(m_warm_start_state.validate(m_controller_serial_number, sample, m_state_max_deviation, deviation))
+  {
+    for(std::vector<sick_lidar_localization::TimeSyncSample>::const_iterator iter = m_warm_start_state.samples.cbegin(); iter != m_warm_start_state.samples.cend(); iter++)
+    {
+      m_send_time_estimator->update(iter->send_time, iter->ticks);
+      m_receive_time_estimator->update(iter->receive_time, iter->ticks);
+      m_time_sync_state.addSample(*iter);
+    }
+    ROS_INFO_STREAM("TimeSyncService: warm start with " << m_warm_start_state.samples.size() << " saved measurements, deviation of saved model " << (1000 * deviation) << " ms");
+  }
+  else
+  {
+    ROS_WARN_STREAM("TimeSyncService: saved time sync state discarded (localization controller restarted or replaced, deviation of saved model " << (1000 * deviation) << " ms), cold start");
+  }
+  for(std::vector<sick_lidar_localization::TimeSyncSample>::const_iterator iter = deferred_samples.cbegin(); iter != deferred_samples.cend(); iter++)
+  {
+    bool send_time_updated = m_send_time_estimator->update(iter->send_time, iter->ticks);
+    bool receive_time_updated = m_receive_time_estimator->update(iter->receive_time, iter->ticks);
+    if(send_time_updated && receive_time_updated)
+      m_accepted_sample_cnt++;
+    m_time_sync_state.addSample(*iter);
+  }
+  m_warm_start_state.clear();
+  return true;
+}
+
+/*!
+ * Saves the current state (serial number, software pll model and recent measurements) to file time_sync_state_file.
+ * The software pll runs on monotonic time, the saved state is mapped to system time. Concurrent calls are
+ * serialized by m_state_file_mutex, i.e. the temporary state file is written by one thread at a time.
+ */
+void sick_lidar_localization::TimeSyncService::saveState(void)
+{
+  if(m_state_file.empty())
+    return;
+  boost::lock_guard<boost::mutex> state_file_lockguard(m_state_file_mutex); // saveState is called by the time sync thread and by callers of service "SickLocRequestTimestamp"
+  sick_lidar_localization::TimeSyncState state;
+  {
+    boost::lock_guard<boost::mutex> software_pll_lockguard(m_software_pll_mutex);
+    if(m_controller_serial_number != 0) // otherwise keep the serial number of the loaded state
+      m_time_sync_state.serial_number = m_controller_serial_number;
+    m_time_sync_state.model = sick_lidar_localization::TimeSyncModel::mean(m_send_time_estimator->model(), m_receive_time_estimator->model());
+    state = m_time_sync_state;
+  }
+  state.shiftTime(m_clock_mapping.offset()); // save system time, monotonic time restarts after a reboot
+  if(state.model.valid && !state.save(m_state_file))
+    ROS_WARN_STREAM("## ERROR TimeSyncService::saveState(): failed to save time sync state to file \"" << m_state_file << "\"");
+}
+
+/*!
+ * Publishes the round trip time statistics of LocRequestTimestamp measurements (message type SickLocTimeSyncRttMsg).
+ */
+void sick_lidar_localization::TimeSyncService::publishRoundTripStatistics(void)
+{
+  sick_lidar_localization::SickLocTimeSyncRttMsg rtt_msg;
+  {
+    boost::lock_guard<boost::mutex> software_pll_lockguard(m_software_pll_mutex);
+    rtt_msg.rtt_last = m_round_trip_filter.last();
+    rtt_msg.rtt_min = m_round_trip_filter.minimum();
+    rtt_msg.rtt_median = m_round_trip_filter.median();
+    rtt_msg.rtt_stddev = m_round_trip_filter.stddev();
+    rtt_msg.last_accepted = m_round_trip_filter.lastAccepted();
+    rtt_msg.accepted_cnt = m_round_trip_filter.acceptedCount();
+    rtt_msg.rejected_cnt = m_round_trip_filter.rejectedCount();
+  }
+  rtt_msg.header.stamp = ros::Time::now();
+  m_time_sync_rtt_publisher.publish(rtt_msg);
+}
+
+/*!
+ * Publishes the quality of the time synchronization (message type SickLocTimeSyncQualityMsg):
+ * offset, drift, residuals, round trip times, acceptance ratio, divergence and initialization state.
+ */
+void sick_lidar_localization::TimeSyncService::publishQuality(void)
+{
+  sick_lidar_localization::TimeSyncModel model = getSoftwarePllModel();
+  sick_lidar_localization::SickLocTimeSyncQualityMsg quality_msg;
+  {
+    boost::lock_guard<boost::mutex> software_pll_lockguard(m_software_pll_mutex);
+    quality_msg.initialized = model.valid;
+    quality_msg.estimator = m_send_time_estimator->type();
+    quality_msg.residual_rms = std::max(m_send_time_estimator->residualRms(), m_receive_time_estimator->residualRms());
+    quality_msg.rtt_last = m_round_trip_filter.last();
+    quality_msg.rtt_min = m_round_trip_filter.minimum();
+    quality_msg.rtt_median = m_round_trip_filter.median();
+    quality_msg.rtt_p99 = m_round_trip_filter.percentile(0.99);
+    quality_msg.acceptance_ratio = ((m_sample_cnt > 0) ? ((double)m_accepted_sample_cnt / m_sample_cnt) : 0);
+    quality_msg.sample_cnt = m_sample_cnt;
+    quality_msg.divergence_cnt = std::max(m_send_time_estimator->divergenceCount(), m_receive_time_estimator->divergenceCount());
+  }
+  if(model.valid)
+  {
+    quality_msg.offset = model.reference_time - 0.001 * model.reference_tick;
+    quality_msg.drift_ppm = (model.slope / 0.001 - 1.0) * 1.0e6;
+  }
+  quality_msg.prediction_rms = m_time_sync_scheduler->residualRms();
+  quality_msg.request_interval = m_time_sync_scheduler->interval();
+  quality_msg.header.stamp = ros::Time::now();
+  m_time_sync_quality_publisher.publish(quality_msg);
+}
+
+/*!
+ * Callback for result port telegrams (SickLocResultPortTelegramMsg) published by sim_loc_driver.
+ * Updates the software pll estimators with the telegram arrival (receive timestamp in the message header
+ * and lidar ticks of the pose). Telegram arrivals are used by time_sync_estimator "fusion" only.
+ * The serial number of the localization controller is saved with the time sync state.
+ * @param[in] msg result port telegram
+ */
+void sick_lidar_localization::TimeSyncService::messageCbResultPortTelegrams(const sick_lidar_localization::SickLocResultPortTelegramMsg & msg)
+{
+  if(msg.header.stamp.sec <= 0 || msg.telegram_payload.Timestamp == 0)
+    return;
+  {
+    boost::lock_guard<boost::mutex> software_pll_lockguard(m_software_pll_mutex);
+    m_controller_serial_number = msg.telegram_header.SerialNumber;
+    double arrival_time = m_clock_mapping.toMonotonic(msg.header.stamp.toSec());
+    bool send_time_updated = m_send_time_estimator->updateArrival(arrival_time, msg.telegram_payload.Timestamp);
+    bool receive_time_updated = m_receive_time_estimator->updateArrival(arrival_time, msg.telegram_payload.Timestamp);
+    if(send_time_updated || receive_time_updated)
+      updateModelSnapshot();
+  }
+  // Publish the model once per second, or immediately if its state changed (f.e. after initialization)
+  if(m_estimator_config.estimator == "fusion" && publishedSoftwarePllModelOutdated(1.0))
+    publishSoftwarePllModel();
+}
+
+/*!
+ * Publishes the current model of the software pll estimators to m_model_snapshot.
+ * Called with m_software_pll_mutex locked after each update of the estimators.
+ */
+void sick_lidar_localization::TimeSyncService::updateModelSnapshot(void)
+{
+  m_model_snapshot.set(sick_lidar_localization::TimeSyncModel::mean(m_send_time_estimator->model(), m_receive_time_estimator->model()));
 }
 
 /*!
  * Returns true, if the initialization phase of the software pll is completed, otherwise false.
+ * Lock-free, reads the snapshot of the software pll model.
  * @return initialization phase of the software pll completed
  */
 bool sick_lidar_localization::TimeSyncService::isSoftwarePllInitialized(void)
 {
-  boost::lock_guard<boost::mutex> software_pll_lockguard(m_software_pll_mutex);
-  SoftwarePLL & software_pll_send_time = SoftwarePLL::Instance("sick_lidar_localization::TimeSyncService::SendTime", m_software_pll_fifo_length);
-  SoftwarePLL & software_pll_receive_time = SoftwarePLL::Instance("sick_lidar_localization::TimeSyncService::ReceiveTime", m_software_pll_fifo_length);
-  return software_pll_send_time.IsInitialized() && software_pll_receive_time.IsInitialized();
+  return m_model_snapshot.get().valid;
+}
+
+/*!
+ * Returns the linear model of the software pll to calculate system time from lidar ticks.
+ * The model combines the software plls for send and receive timestamps, i.e. system time
+ * from ticks is the mean of the estimated send and receive time. The software pll runs on
+ * monotonic time, the returned model is mapped to system time by the current clock offset.
+ * Lock-free, reads the snapshot of the software pll model.
+ * @return software pll model (invalid during initialization phase of the software pll)
+ */
+sick_lidar_localization::TimeSyncModel sick_lidar_localization::TimeSyncService::getSoftwarePllModel(void)
+{
+  return m_clock_mapping.toSystemTime(m_model_snapshot.get());
+}
+
+/*!
+ * Updates the mapping between system time and monotonic time. If the system clock has been stepped
+ * (f.e. by NTP or chrony), the software pll model is not affected, but the published model is updated.
+ * @return true if the system clock has been stepped, false otherwise
+ */
+bool sick_lidar_localization::TimeSyncService::updateClockMapping(void)
+{
+  double monotonic_time = sick_lidar_localization::MonotonicClock::now();
+  double system_time = ros::Time::now().toSec();
+  monotonic_time = 0.5 * (monotonic_time + sick_lidar_localization::MonotonicClock::now());
+  if(m_clock_mapping.update(system_time, monotonic_time))
+  {
+    double published_clock_offset = 0;
+    {
+      boost::lock_guard<boost::mutex> publish_lockguard(m_publish_mutex);
+      published_clock_offset = m_published_clock_offset;
+    }
+    ROS_WARN_STREAM("TimeSyncService: system clock stepped by " << (m_clock_mapping.offset() - published_clock_offset) << " seconds, software pll model mapped to new system time");
+    return true;
+  }
+  return false;
 }
 
+/*!
+ * Publishes the current software pll model (message type SickLocTimeSyncModelMsg).
+ * The model is evaluated by sim_loc_driver to calculate system time from lidar ticks
+ * without calling ros service "SickLocTimeSync". Called by the time sync thread and the
+ * ros spin thread (time_sync_estimator "fusion"). Publishing is serialized by m_publish_mutex
+ * and the model is read after locking, i.e. a newer model is never followed by an older one.
+ */
+void sick_lidar_localization::TimeSyncService::publishSoftwarePllModel(void)
+{
+  boost::lock_guard<boost::mutex> publish_lockguard(m_publish_mutex);
+  sick_lidar_localization::TimeSyncModel model = getSoftwarePllModel();
+  sick_lidar_localization::SickLocTimeSyncModelMsg model_msg;
+  model_msg.header.stamp = ros::Time::now();
+  model_msg.valid = model.valid;
+  model_msg.reference_tick_ms = model.reference_tick;
+  model_msg.reference_time_sec = (uint32_t)model.reference_time;
+  model_msg.reference_time_nsec = (uint32_t)(1.0e9 * (model.reference_time - model_msg.reference_time_sec));
+  model_msg.slope = model.slope;
+  m_time_sync_model_publisher.publish(model_msg);
+  m_time_sync_model_published = model_msg.header.stamp;
+  m_time_sync_model_published_valid = model.valid;
+  m_published_clock_offset = m_clock_mapping.offset();
+}
+
+/*!
+ * Returns true, if the published software pll model is outdated, i.e. its state (valid or invalid) or the
+ * clock offset changed since the last publication, or it has been published more than max_age seconds ago.
+ * @param[in] max_age max. age of the published model in seconds (0: ignore age)
+ * @return true if the model should be published again, false otherwise
+ */
+bool sick_lidar_localization::TimeSyncService::publishedSoftwarePllModelOutdated(double max_age)
+{
+  bool model_valid = isSoftwarePllInitialized();
+  boost::lock_guard<boost::mutex> publish_lockguard(m_publish_mutex);
+  return model_valid != m_time_sync_model_published_valid || fabs(m_clock_mapping.offset() - m_published_clock_offset) > 0.001
+    || (max_age > 0 && (ros::Time::now() - m_time_sync_model_published).toSec() >= max_age);
+}
 
 /*!
  * Callback for service messages (SickLocTimeSync). Calculates the system time of a vehicle pose from lidar ticks,
@@ -245,32 +603,47 @@ bool sick_lidar_localization::TimeSyncService::isSoftwarePllInitialized(void)
  */
 bool sick_lidar_localization::TimeSyncService::serviceCbTimeSync(sick_lidar_localization::SickLocTimeSyncSrv::Request & time_sync_request, sick_lidar_localization::SickLocTimeSyncSrv::Response & time_sync_response)
 {
-  boost::lock_guard<boost::mutex> software_pll_lockguard(m_software_pll_mutex);
-  SoftwarePLL & software_pll_send_time = SoftwarePLL::Instance("sick_lidar_localization::TimeSyncService::SendTime", m_software_pll_fifo_length);
-  SoftwarePLL & software_pll_receive_time = SoftwarePLL::Instance("sick_lidar_localization::TimeSyncService::ReceiveTime", m_software_pll_fifo_length);
   time_sync_response.vehicle_time_sec = 0;
   time_sync_response.vehicle_time_nsec = 0;
   time_sync_response.vehicle_time_valid = false;
   uint32_t ticks = time_sync_request.timestamp_lidar_ms;
-  uint32_t system_timestamp_1_sec = 0, system_timestamp_1_nsec = 0, system_timestamp_2_sec = 0, system_timestamp_2_nsec = 0;
-  if(software_pll_send_time.GetCorrectedTimeStamp(system_timestamp_1_sec, system_timestamp_1_nsec, ticks)
-    && software_pll_receive_time.GetCorrectedTimeStamp(system_timestamp_2_sec, system_timestamp_2_nsec, ticks))
+  sick_lidar_localization::TimeSyncModel software_pll_model = getSoftwarePllModel();
+  if(software_pll_model.tickToTime(ticks, time_sync_response.vehicle_time_sec, time_sync_response.vehicle_time_nsec))
   {
-    ros::Time system_timestamp_1(system_timestamp_1_sec, system_timestamp_1_nsec);
-    ros::Time system_timestamp_2(system_timestamp_2_sec, system_timestamp_2_nsec);
-    ros::Time system_timestamp = system_timestamp_1 + ros::Duration(0.5 * (system_timestamp_2 - system_timestamp_1).toSec());
-    time_sync_response.vehicle_time_sec = system_timestamp.sec;
-    time_sync_response.vehicle_time_nsec = system_timestamp.nsec;
     time_sync_response.vehicle_time_valid = true;
     ROS_INFO_STREAM("TimeSyncService::serviceCbTimeSync(): Lidar ticks: " << ticks << ", Systemtime: " << time_sync_response.vehicle_time_sec << "." << time_sync_response.vehicle_time_nsec);
   }
-  else if(software_pll_send_time.IsInitialized() && software_pll_receive_time.IsInitialized())
-    ROS_WARN_STREAM("## ERROR TimeSyncService::serviceCbTimeSync(): SoftwarePLL::GetCorrectedTimeStamp() failed");
   else
     ROS_INFO_STREAM("TimeSyncService::serviceCbTimeSync(): no system time from ticks, software pll still initializing");
   return time_sync_response.vehicle_time_valid;
 }
 
+/*!
+ * Callback for service messages (SickLocTimeSyncBatch). Calculates the system times of an array of lidar ticks
+ * by one service call, using the same software pll model as service SickLocTimeSync. Returns the model
+ * parameters used for the conversion, too.
+ * @param[in] time_sync_request ros service request (input: array of lidar ticks)
+ * @param[out] time_sync_response service response  (output: system times from ticks and software pll model)
+ * @return true on success, false in case of errors (software pll still in initialization phase).
+ */
+bool sick_lidar_localization::TimeSyncService::serviceCbTimeSyncBatch(sick_lidar_localization::SickLocTimeSyncBatchSrv::Request & time_sync_request, sick_lidar_localization::SickLocTimeSyncBatchSrv::Response & time_sync_response)
+{
+  sick_lidar_localization::TimeSyncModel software_pll_model = getSoftwarePllModel(); // one model for all ticks of the request
+  size_t count = time_sync_request.timestamp_lidar_ms.size();
+  time_sync_response.vehicle_time_sec.resize(count, 0);
+  time_sync_response.vehicle_time_nsec.resize(count, 0);
+  time_sync_response.reference_tick = software_pll_model.reference_tick;
+  time_sync_response.reference_time = software_pll_model.reference_time;
+  time_sync_response.slope = software_pll_model.slope;
+  time_sync_response.vehicle_time_valid = software_pll_model.ticksToTimes(time_sync_request.timestamp_lidar_ms.data(), count,
+    time_sync_response.vehicle_time_sec.data(), time_sync_response.vehicle_time_nsec.data());
+  if(time_sync_response.vehicle_time_valid)
+    ROS_DEBUG_STREAM("TimeSyncService::serviceCbTimeSyncBatch(): " << count << " lidar ticks converted to system time");
+  else
+    ROS_INFO_STREAM("TimeSyncService::serviceCbTimeSyncBatch(): no system time from ticks, software pll still initializing");
+  return time_sync_response.vehicle_time_valid;
+}
+
 
 /*!
  * Class TimeSyncService implements a time synchronization thread, running a software pll
@@ -306,30 +679,49 @@ bool sick_lidar_localization::TimeSyncService::stop(void)
 }
 
 /*!
- * Thread callback, runs time synchronization, calls ros service "SickLocRequestTimestamp" each 10 seconds
- * and updates the software pll.
+ * Thread callback, runs time synchronization, sends LocRequestTimestamp by serviceCbRequestTimestamp and updates the
+ * software pll. The interval between two requests is adapted by TimeSyncScheduler: requests are sent every
+ * second during the initial phase, after a failed request and when the software pll degrades, and every 20 seconds
+ * (time_sync_min_rate) while the software pll is stable.
  */
 void sick_lidar_localization::TimeSyncService::runTimeSyncThreadCb(void)
 {
-  int time_sync_cnt = 0;
+  double last_request_time = sick_lidar_localization::MonotonicClock::now(); // schedule by monotonic time, immune to steps of the system clock
+  double last_interval = m_time_sync_scheduler->interval();
   while(ros::ok() && m_time_sync_thread_running)
   {
-    // Run LocRequestTimestamp every second during initialization of software pll, otherwise every 10 seconds
-    ros::Rate & time_sync_rate = ((time_sync_cnt < m_time_sync_initial_length) ? m_time_sync_initial_rate : m_time_sync_rate);
-    time_sync_rate.sleep();
+    // Wait for the next LocRequestTimestamp, interval scheduled by TimeSyncScheduler
+    double interval = m_time_sync_scheduler->interval();
+    if(fabs(interval - last_interval) > 1.0e-3)
+    {
+      ROS_INFO_STREAM("TimeSyncService::runTimeSyncThreadCb(): LocRequestTimestamp interval " << std::fixed << std::setprecision(3) << interval << " seconds (residual rms "
+        << (1000 * m_time_sync_scheduler->residualRms()) << " ms, round trip jitter " << (1000 * m_time_sync_scheduler->roundTripJitter()) << " ms)");
+      last_interval = interval;
+    }
+    double time_to_request = interval - (sick_lidar_localization::MonotonicClock::now() - last_request_time);
+    while(ros::ok() && m_time_sync_thread_running && time_to_request > 0)
+    {
+      ros::Duration(std::min(0.1, time_to_request)).sleep(); // sleep in short steps, stop() does not wait for long intervals
+      time_to_request = interval - (sick_lidar_localization::MonotonicClock::now() - last_request_time);
+      // Track the offset between system time and monotonic time, republish the model after a step or slew of the system clock
+      updateClockMapping();
+      if(publishedSoftwarePllModelOutdated(0))
+        publishSoftwarePllModel();
+    }
+    last_request_time = sick_lidar_localization::MonotonicClock::now();
     if(ros::ok() && m_time_sync_thread_running)
     {
-      // Call ros service "SickLocRequestTimestamp"
+      // Send LocRequestTimestamp (direct call of the service callback, the ros service "SickLocRequestTimestamp" is for other nodes only)
       sick_lidar_localization::SickLocRequestTimestampSrv timestamp_service;
-      if (!m_request_timestamp_client.call(timestamp_service) || timestamp_service.response.timestamp_lidar_ms == 0)
+      if (!serviceCbRequestTimestamp(timestamp_service.request, timestamp_service.response) || timestamp_service.response.timestamp_lidar_ms == 0)
       {
-        ROS_WARN_STREAM("## ERROR TimeSyncService::runTimeSyncThreadCb(): calling ros service \"SickLocRequestTimestamp\" failed, response: "
+        ROS_WARN_STREAM("## ERROR TimeSyncService::runTimeSyncThreadCb(): LocRequestTimestamp failed, response: "
           << sick_lidar_localization::Utils::flattenToString(timestamp_service.response));
+        m_time_sync_scheduler->updateFailed(); // retry after the minimum interval
       }
       else
       {
-        time_sync_cnt++;
-        ROS_INFO_STREAM("TimeSyncService::runTimeSyncThreadCb(): ros service \"SickLocRequestTimestamp\" successfull, response: "
+        ROS_INFO_STREAM("TimeSyncService::runTimeSyncThreadCb(): LocRequestTimestamp successfull, response: "
           << sick_lidar_localization::Utils::flattenToString(timestamp_service.response));
       }
     }
@@ -0,0 +1,198 @@
+/*
+ * @brief time_sync_state saves and restores the state of the time synchronization (controller serial number,
+ * software pll model and recent LocRequestTimestamp measurements) to warm start sim_loc_time_sync after a restart.
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#include <fstream>
+#include <iomanip>
+#include <math.h>
+#include <sstream>
+#include <stdio.h>
+
+#include "sick_lidar_localization/time_sync_state.h"
+
+/*!
+ * Constructor
+ * @param[in] max_samples max. number of measurements in the state (oldest measurements are removed)
+ */
+sick_lidar_localization::TimeSyncState::TimeSyncState(int max_samples) : serial_number(0), m_max_samples(max_samples > 0 ? max_samples : 1)
+{
+}
+
+/*!
+ * Appends a measurement. The oldest measurement is removed if the state contains more than max_samples measurements.
+ * @param[in] sample LocRequestTimestamp measurement
+ */
+void sick_lidar_localization::TimeSyncState::addSample(const TimeSyncSample & sample)
+{
+  samples.push_back(sample);
+  if((int)samples.size() > m_max_samples)
+    samples.erase(samples.begin(), samples.begin() + (samples.size() - m_max_samples));
+}
+
+/*!
+ * Clears the state.
+ */
+void sick_lidar_localization::TimeSyncState::clear(void)
+{
+  serial_number = 0;
+  model = TimeSyncModel();
+  samples.clear();
+}
+
+/*!
+ * Shifts all times of the state (model and measurements) by an offset, f.e. to map monotonic time to system time.
+ * @param[in] offset time offset in seconds
+ */
+void sick_lidar_localization::TimeSyncState::shiftTime(double offset)
+{
+  model.reference_time += offset;
+  for(std::vector<TimeSyncSample>::iterator iter = samples.begin(); iter != samples.end(); iter++)
+  {
+    iter->send_time += offset;
+    iter->receive_time += offset;
+  }
+}
+
+/*!
+ * Saves the state to file. The file is written to a temporary file and renamed, i.e. a restart while
+ * saving does not leave a corrupted state file.
+ * @param[in] filename state file
+ * @return true on success, false on error
+ */
+bool sick_lidar_localization::TimeSyncState::save(const std::string & filename) const
+{
+  std::string tmp_filename = filename + ".tmp";
+  {
+    std::ofstream state_file(tmp_filename.c_str());
+    if(!state_file.is_open())
+      return false;
+    state_file << std::setprecision(17);
+    state_file << "serial_number " << serial_number << "\n";
+    state_file << "model " << (model.valid ? 1 : 0) << " " << model.reference_tick << " " << model.reference_time << " " << model.slope << "\n";
+    for(std::vector<TimeSyncSample>::const_iterator iter = samples.cbegin(); iter != samples.cend(); iter++)
+      state_file << "sample " << iter->ticks << " " << iter->send_time << " " << iter->receive_time << "\n";
+    if(!state_file.good())
+      return false;
+  }
+  return rename(tmp_filename.c_str(), filename.c_str()) == 0;
+}
+
+/*!
+ * Loads the state from file.
+ * @param[in] filename state file
+ * @return true on success, false on error (file not found or invalid)
+ */
+bool sick_lidar_localization::TimeSyncState::load(const std::string & filename)
+{
+  clear();
+  std::ifstream state_file(filename.c_str());
+  if(!state_file.is_open())
+    return false;
+  std::string line;
+  bool has_model = false;
+  while(std::getline(state_file, line))
+  {
+    std::istringstream line_stream(line);
+    std::string key;
+    line_stream >> key;
+    if(key == "serial_number")
+    {
+      line_stream >> serial_number;
+    }
+    else if(key == "model")
+    {
+      int valid = 0;
+      line_stream >> valid >> model.reference_tick >> model.reference_time >> model.slope;
+      model.valid = (valid != 0);
+      has_model = true;
+    }
+    else if(key == "sample")
+    {
+      TimeSyncSample sample;
+      line_stream >> sample.ticks >> sample.send_time >> sample.receive_time;
+      if(!line_stream.fail())
+        addSample(sample);
+    }
+    if(line_stream.fail())
+    {
+      clear();
+      return false;
+    }
+  }
+  return has_model;
+}
+
+/*!
+ * Returns true, if the state is still valid for a new measurement, i.e. the saved model is valid,
+ * the serial numbers match (if known) and the system time estimated by the saved model deviates from
+ * the measured system time by max. max_deviation seconds.
+ * @param[in] serial_number serial number of the localization controller (0 if unknown)
+ * @param[in] sample new LocRequestTimestamp measurement
+ * @param[in] max_deviation max. time difference in seconds between estimated and measured system time
+ * @param[out] deviation time difference in seconds between estimated and measured system time
+ * @return true if the state is valid, false otherwise
+ */
+bool sick_lidar_localization::TimeSyncState::validate(uint32_t serial_number, const TimeSyncSample & sample, double max_deviation, double & deviation) const
+{
+  deviation = 0;
+  uint32_t sec = 0, nsec = 0;
+  if(!model.valid || samples.empty() || !model.tickToTime(sample.ticks, sec, nsec))
+    return false;
+  if(serial_number != 0 && this->serial_number != 0 && serial_number != this->serial_number) // different localization controller
+    return false;
+  if((int32_t)(sample.ticks - samples.back().ticks) <= 0) // ticks not increasing, localization controller restarted
+    return false;
+  deviation = (sec + 1.0e-9 * nsec) - 0.5 * (sample.send_time + sample.receive_time);
+  return fabs(deviation) <= max_deviation;
+}
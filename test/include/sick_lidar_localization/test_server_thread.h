@@ -67,9 +67,11 @@
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/recursive_mutex.hpp>
 #include <list>
+#include <map>
 
 #include "sick_lidar_localization/fifo_buffer.h"
 #include "sick_lidar_localization/utils.h"
+#include "sick_lidar_localization/SickLocColaTelegramMsg.h"
 
 namespace sick_lidar_localization
 {
@@ -173,12 +175,28 @@ namespace sick_lidar_localization
   
     /*!
      * Worker thread callback, receives command requests from a tcp client
-     * and sends a synthetical command response.
+     * and sends a synthetical command response. Event telegrams are sent after changes of subscribed variables.
      * There's one request worker thread for each tcp client.
      * @param[in] p_socket socket to receive command requests from the tcp client
      */
     virtual void runWorkerThreadColaCb(boost::asio::ip::tcp::socket* p_socket);
   
+    /*!
+     * Encodes a cola telegram to send to a tcp client. Cola-Binary telegrams listed in the ColaSchema are encoded typed.
+     * @param[in] cola_telegram cola telegram (response or event)
+     * @param[in] cola_binary true: encode Cola-Binary, false: encode Cola-ASCII
+     * @return encoded telegram
+     */
+    static std::vector<uint8_t> encodeColaTelegram(const sick_lidar_localization::SickLocColaTelegramMsg & cola_telegram, bool cola_binary);
+  
+    /*!
+     * Sends event telegrams "sSN <variable_name> <value>" to a tcp client for all subscribed variables, whose value changed since the last event.
+     * @param[in] p_socket socket to send event telegrams to the tcp client
+     * @param[in,out] event_subscriptions subscribed variables (registered by "sEN <variable_name> 1") and their value last sent
+     * @param[in] cola_binary true: send Cola-Binary, false: send Cola-ASCII
+     */
+    void sendColaEvents(boost::asio::ip::tcp::socket* p_socket, std::map<std::string, int32_t> & event_subscriptions, bool cola_binary);
+  
     /*!
      * Thread callback, runs an error simulation and switches m_error_simulation_flag through the error test cases.
      */
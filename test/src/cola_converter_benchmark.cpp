@@ -0,0 +1,403 @@
+/*
+ * @brief cola_converter_benchmark measures the throughput (MB/s) of the Cola-ASCII to binary and binary to
+ * Cola-ASCII conversions by ColaAsciiBinaryConverter::ConvertColaAscii(), of the Cola-ASCII tokenizer
+ * ColaParser::tokenizeColaTelegram() and of the typed Cola-Binary encoding by ColaSchema, and verifies the results
+ * against the reference implementation (std::map lookup resp. std::stringstream resp. boost::split).
+ *
+ * Usage: cola_converter_benchmark [--iterations=<n>]
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string.h>
+#include <vector>
+#include <boost/algorithm/string.hpp>
+
+#include "sick_lidar_localization/cola_converter.h"
+#include "sick_lidar_localization/cola_parser.h"
+#include "sick_lidar_localization/cola_schema.h"
+
+/*!
+ * class ReferenceConverter implements the conversions by walking s_ascii_map resp. by std::stringstream,
+ * i.e. the implementation before the lookup tables, used as reference for results and throughput.
+ */
+class ReferenceConverter : public sick_lidar_localization::ColaAsciiBinaryConverter
+{
+public:
+  
+  /*! Converts a Cola-ASCII telegram to string by s_ascii_table and std::stringstream */
+  static std::string BinaryToAscii(const std::vector<uint8_t> & cola_telegram)
+  {
+    std::stringstream cola_ascii;
+    for(std::vector<uint8_t>::const_iterator iter = cola_telegram.cbegin(); iter != cola_telegram.cend(); iter++)
+      cola_ascii << s_ascii_table[((*iter) & 0xFF)];
+    return cola_ascii.str();
+  }
+  
+  /*! Converts a Cola-ASCII string to binary by comparing each character with all entries in s_ascii_map */
+  static std::vector<uint8_t> AsciiToBinary(const std::string & cola_telegram)
+  {
+    std::vector<uint8_t> cola_ascii;
+    cola_ascii.reserve(cola_telegram.size());
+    for(size_t char_cnt = 0; char_cnt < cola_telegram.size(); char_cnt++)
+    {
+      cola_ascii.push_back(0);
+      for(std::map<std::string, uint8_t>::const_iterator map_iter = s_ascii_map.cbegin(); map_iter != s_ascii_map.cend(); map_iter++)
+      {
+        if(strncmp(map_iter->first.c_str(), cola_telegram.c_str() + char_cnt, map_iter->first.size()) == 0)
+        {
+          cola_ascii.back() = map_iter->second;
+          char_cnt += (map_iter->first.size() - 1);
+          break;
+        }
+      }
+    }
+    return cola_ascii;
+  }
+};
+
+/*!
+ * Decodes a Cola-ASCII telegram by substr copies and boost::split, i.e. the implementation of
+ * ColaParser::decodeColaTelegram() before the tokenizer, used as reference for results and throughput.
+ */
+static sick_lidar_localization::SickLocColaTelegramMsg referenceDecodeColaTelegram(const std::string & cola_ascii)
+{
+  const std::string & stx = sick_lidar_localization::ColaParser::asciiSTX(), & etx = sick_lidar_localization::ColaParser::asciiETX();
+  std::string cola_ascii_cmd = cola_ascii;
+  if (cola_ascii.size() > stx.size() + etx.size() && cola_ascii.substr(0, stx.size()) == stx && cola_ascii.substr(cola_ascii.size() - etx.size()) == etx)
+    cola_ascii_cmd = cola_ascii.substr(stx.size(), cola_ascii.size() - stx.size() - etx.size());
+  std::vector<std::string> cola_parts;
+  boost::split(cola_parts, cola_ascii_cmd, boost::algorithm::is_space());
+  if(cola_parts.size() < 2 || sick_lidar_localization::ColaParser::convertSopasCommand(cola_parts[0]) == sick_lidar_localization::ColaParser::sINVALID || cola_parts[1].empty())
+    return sick_lidar_localization::ColaParser::createColaTelegram(sick_lidar_localization::ColaParser::sINVALID, "");
+  sick_lidar_localization::SickLocColaTelegramMsg cola_telegram = sick_lidar_localization::ColaParser::createColaTelegram(sick_lidar_localization::ColaParser::convertSopasCommand(cola_parts[0]), cola_parts[1]);
+  for(size_t n = 2; n < cola_parts.size(); n++)
+    cola_telegram.parameter.push_back(cola_parts[n]);
+  return cola_telegram;
+}
+
+/*!
+ * Returns true, if two decoded Cola telegrams are identical (except for the header timestamp).
+ */
+static bool identicalColaTelegrams(const sick_lidar_localization::SickLocColaTelegramMsg & telegram1, const sick_lidar_localization::SickLocColaTelegramMsg & telegram2)
+{
+  return telegram1.command_type == telegram2.command_type && telegram1.command_name == telegram2.command_name && telegram1.parameter == telegram2.parameter;
+}
+
+/*!
+ * Returns typical Cola-ASCII telegrams (requests and responses of the localization controller)
+ * plus telegrams with random parameter.
+ */
+static std::vector<std::string> createAsciiTelegrams(std::mt19937 & random_engine)
+{
+  std::vector<std::string> telegrams = {
+    "<STX>sMN SetAccessMode 3 F4724744<ETX>", "<STX>sAN SetAccessMode 1<ETX>", "<STX>sMN LocRequestTimestamp<ETX>",
+    "<STX>sAN LocRequestTimestamp 1EAF3F4<ETX>", "<STX>sRN LocState<ETX>", "<STX>sRA LocState 2<ETX>",
+    "<STX>sMN LocSetResultPoseEnabled 1<ETX>", "<STX>sAN LocSetResultPoseEnabled 1<ETX>", "<STX>sMN LocStartLocalizing<ETX>",
+    "<STX>sMN LocInitializePose 200 300 400 1000<ETX>", "<STX>sRN LocResultPort<ETX>", "<STX>sRA LocResultPort 07D0<ETX>",
+    "<STX>sMN LocSetPoseQualityCovWeight 0.9<ETX>", "<STX>sWN EIHstCola 0<ETX>", "<STX>sMN mEEwriteall<ETX>"
+  };
+  std::uniform_int_distribution<int> random_length(1, 64), random_char(0x20, 0x7E);
+  for(int n = 0; n < 64; n++)
+  {
+    std::string parameter;
+    for(int m = random_length(random_engine); m > 0; m--)
+      parameter.push_back((char)random_char(random_engine));
+    telegrams.push_back("<STX>sAN LocRequestTimestamp " + parameter + "<ETX>");
+  }
+  return telegrams;
+}
+
+/*!
+ * Returns random strings with tags, partial tags and arbitrary characters to verify the conversion of corner cases.
+ */
+static std::vector<std::string> createRandomStrings(std::mt19937 & random_engine, int number_of_strings)
+{
+  const std::vector<std::string> fragments = { "<STX>", "<ETX>", "<SO>", "<SOH>", "<DC1>", "<HT>", "<DEL>", "<", ">", "<ST", "<XYZ>", "<<ETX>", "<>", "\n", "\r", "\t", std::string(1, '\0') };
+  std::uniform_int_distribution<int> random_length(0, 32), random_fragment(0, (int)fragments.size() - 1), random_byte(0, 255), random_choice(0, 3);
+  std::vector<std::string> strings;
+  for(int n = 0; n < number_of_strings; n++)
+  {
+    std::string str;
+    for(int m = random_length(random_engine); m > 0; m--)
+    {
+      if(random_choice(random_engine) == 0)
+        str.push_back((char)random_byte(random_engine));
+      else
+        str += fragments[random_fragment(random_engine)];
+    }
+    strings.push_back(str);
+  }
+  return strings;
+}
+
+/*!
+ * Runs a conversion over all telegrams for a given number of iterations and prints the throughput in MB/s
+ * (megabyte input per second).
+ */
+template<typename Conversion> static void benchmark(const std::string & name, size_t input_bytes, int iterations, Conversion conversion)
+{
+  size_t checksum = 0;
+  std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+  for(int n = 0; n < iterations; n++)
+    checksum += conversion();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+  double mbyte_per_sec = (seconds > 0) ? ((double)input_bytes * iterations / seconds / 1.0e6) : 0;
+  std::cout << "  " << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(1)
+    << std::setw(10) << mbyte_per_sec << " MB/s  (checksum " << checksum << ")" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  int iterations = 2000;
+  for(int arg_cnt = 1; arg_cnt < argc; arg_cnt++)
+  {
+    std::string arg(argv[arg_cnt]);
+    if(arg.compare(0, 13, "--iterations=") == 0)
+      iterations = std::max(1, std::stoi(arg.substr(13)));
+    else
+    {
+      std::cerr << "Usage: cola_converter_benchmark [--iterations=<n>]" << std::endl;
+      return 1;
+    }
+  }
+  std::mt19937 random_engine(1);
+  std::vector<std::string> ascii_telegrams = createAsciiTelegrams(random_engine);
+  std::vector<std::vector<uint8_t> > binary_telegrams;
+  size_t ascii_bytes = 0, binary_bytes = 0;
+  for(size_t n = 0; n < ascii_telegrams.size(); n++)
+  {
+    binary_telegrams.push_back(ReferenceConverter::AsciiToBinary(ascii_telegrams[n]));
+    ascii_bytes += ascii_telegrams[n].size();
+    binary_bytes += binary_telegrams.back().size();
+  }
+  
+  // Verify identical results of lookup tables and reference implementation
+  int error_cnt = 0;
+  std::vector<std::string> verify_strings = createRandomStrings(random_engine, 100000);
+  verify_strings.insert(verify_strings.end(), ascii_telegrams.begin(), ascii_telegrams.end());
+  for(size_t n = 0; n < verify_strings.size(); n++)
+  {
+    std::vector<uint8_t> binary = sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(verify_strings[n]);
+    if(binary != ReferenceConverter::AsciiToBinary(verify_strings[n])
+      || sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(binary) != ReferenceConverter::BinaryToAscii(binary))
+    {
+      if(error_cnt++ < 10)
+        std::cerr << "## ERROR cola_converter_benchmark: conversion of \"" << ReferenceConverter::BinaryToAscii(binary) << "\" differs from reference" << std::endl;
+    }
+  }
+  std::vector<std::string> tokenizer_strings = { "", " ", "sAN", "sAN ", "sAN  X", "sXX Run", "sINVALID Run", "sMN Run ", "sMN Run  1", "sMN\tRun\t1", "<STX><ETX>", "<STX>sMN Run<ETX>", "<STX>sMN Run 1<ETX>x" };
+  for(size_t n = 0; n < 1000; n++)
+    tokenizer_strings.push_back(ReferenceConverter::BinaryToAscii(sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(verify_strings[n])));
+  tokenizer_strings.insert(tokenizer_strings.end(), ascii_telegrams.begin(), ascii_telegrams.end());
+  for(size_t n = 0; n < tokenizer_strings.size(); n++)
+  {
+    if(!identicalColaTelegrams(sick_lidar_localization::ColaParser::decodeColaTelegram(tokenizer_strings[n]), referenceDecodeColaTelegram(tokenizer_strings[n])))
+    {
+      if(error_cnt++ < 10)
+        std::cerr << "## ERROR cola_converter_benchmark: decodeColaTelegram(\"" << tokenizer_strings[n] << "\") differs from reference" << std::endl;
+    }
+  }
+  std::cout << "cola_converter_benchmark: " << (verify_strings.size() + tokenizer_strings.size()) << " conversions verified, " << error_cnt << " errors" << std::endl;
+  
+  // Throughput of both directions
+  std::cout << "Cola-ASCII to binary (" << ascii_telegrams.size() << " telegrams, " << ascii_bytes << " byte, " << iterations << " iterations):" << std::endl;
+  benchmark("reference (std::map, strncmp)", ascii_bytes, iterations, [&]()
+  {
+    size_t checksum = 0;
+    for(size_t n = 0; n < ascii_telegrams.size(); n++)
+      checksum += ReferenceConverter::AsciiToBinary(ascii_telegrams[n]).size();
+    return checksum;
+  });
+  benchmark("ConvertColaAscii(std::string)", ascii_bytes, iterations, [&]()
+  {
+    size_t checksum = 0;
+    for(size_t n = 0; n < ascii_telegrams.size(); n++)
+      checksum += sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(ascii_telegrams[n]).size();
+    return checksum;
+  });
+  std::vector<uint8_t> binary_output;
+  benchmark("ConvertColaAscii(char*, preallocated)", ascii_bytes, iterations, [&]()
+  {
+    size_t checksum = 0;
+    for(size_t n = 0; n < ascii_telegrams.size(); n++)
+    {
+      sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(ascii_telegrams[n].data(), ascii_telegrams[n].size(), binary_output);
+      checksum += binary_output.size();
+    }
+    return checksum;
+  });
+  std::cout << "Binary to Cola-ASCII (" << binary_telegrams.size() << " telegrams, " << binary_bytes << " byte, " << iterations << " iterations):" << std::endl;
+  benchmark("reference (std::stringstream)", binary_bytes, iterations, [&]()
+  {
+    size_t checksum = 0;
+    for(size_t n = 0; n < binary_telegrams.size(); n++)
+      checksum += ReferenceConverter::BinaryToAscii(binary_telegrams[n]).size();
+    return checksum;
+  });
+  benchmark("ConvertColaAscii(std::vector)", binary_bytes, iterations, [&]()
+  {
+    size_t checksum = 0;
+    for(size_t n = 0; n < binary_telegrams.size(); n++)
+      checksum += sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(binary_telegrams[n]).size();
+    return checksum;
+  });
+  std::string ascii_output;
+  benchmark("ConvertColaAscii(uint8_t*, preallocated)", binary_bytes, iterations, [&]()
+  {
+    size_t checksum = 0;
+    for(size_t n = 0; n < binary_telegrams.size(); n++)
+    {
+      sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(binary_telegrams[n].data(), binary_telegrams[n].size(), ascii_output);
+      checksum += ascii_output.size();
+    }
+    return checksum;
+  });
+  std::vector<std::string> responses; // typical responses, f.e. "<STX>sAN LocRequestTimestamp 1EAF3F4<ETX>"
+  size_t response_bytes = 0;
+  for(size_t n = 0; n < ascii_telegrams.size(); n++)
+  {
+    if(ascii_telegrams[n].compare(0, 8, "<STX>sAN") == 0 || ascii_telegrams[n].compare(0, 8, "<STX>sRA") == 0)
+    {
+      responses.push_back(ascii_telegrams[n]);
+      response_bytes += ascii_telegrams[n].size();
+    }
+  }
+  std::cout << "Cola-ASCII tokenizer (" << responses.size() << " responses, " << response_bytes << " byte, " << iterations << " iterations):" << std::endl;
+  benchmark("reference (substr, boost::split)", response_bytes, iterations, [&]()
+  {
+    size_t checksum = 0;
+    for(size_t n = 0; n < responses.size(); n++)
+      checksum += referenceDecodeColaTelegram(responses[n]).parameter.size();
+    return checksum;
+  });
+  benchmark("decodeColaTelegram", response_bytes, iterations, [&]()
+  {
+    size_t checksum = 0;
+    for(size_t n = 0; n < responses.size(); n++)
+      checksum += sick_lidar_localization::ColaParser::decodeColaTelegram(responses[n]).parameter.size();
+    return checksum;
+  });
+  benchmark("tokenizeColaTelegram", response_bytes, iterations, [&]()
+  {
+    size_t checksum = 0;
+    sick_lidar_localization::ColaParser::ColaTelegramView telegram_view;
+    for(size_t n = 0; n < responses.size(); n++)
+    {
+      sick_lidar_localization::ColaParser::tokenizeColaTelegram(responses[n], telegram_view);
+      checksum += telegram_view.parameterCount();
+    }
+    return checksum;
+  });
+  // Cola-Binary requests and responses: ASCII hex round trip (ColaAsciiToColaBinary, ColaBinaryToColaAscii) vs. typed encoding by ColaSchema
+  std::vector<std::string> typed_requests = { "sMN LocSetPose +10300 -5200 +30000 +1000", "sMN LocSetResultPort +2201", "sMN LocSetResultMode +0", "sMN LocRequestTimestamp", "sRN LocState" };
+  std::vector<std::string> typed_responses = { "sAN LocSetPose 1", "sAN LocSetResultPort 1", "sAN LocSetResultMode 1", "sAN LocRequestTimestamp 1EAF3F4", "sRA LocState 2" };
+  std::vector<std::vector<uint8_t> > typed_binary_responses(typed_responses.size());
+  size_t typed_request_bytes = 0, typed_response_bytes = 0;
+  for(size_t n = 0; n < typed_requests.size(); n++)
+  {
+    std::vector<uint8_t> typed_binary;
+    std::string typed_ascii;
+    if(!sick_lidar_localization::ColaSchema::encodeColaBinary(typed_requests[n], typed_binary) || !sick_lidar_localization::ColaSchema::decodeColaBinary(typed_binary, typed_ascii) || typed_ascii != typed_requests[n]
+      || !sick_lidar_localization::ColaSchema::encodeColaBinary(typed_responses[n], typed_binary_responses[n]) || !sick_lidar_localization::ColaSchema::decodeColaBinary(typed_binary_responses[n], typed_ascii) || typed_ascii != typed_responses[n])
+    {
+      std::cerr << "## ERROR cola_converter_benchmark: ColaSchema round trip failed for \"" << typed_requests[n] << "\" resp. \"" << typed_responses[n] << "\"" << std::endl;
+      error_cnt++;
+    }
+    typed_request_bytes += typed_requests[n].size();
+    typed_response_bytes += typed_binary_responses[n].size();
+  }
+  std::cout << "Cola-ASCII request to Cola-Binary (" << typed_requests.size() << " requests, " << typed_request_bytes << " byte, " << iterations << " iterations):" << std::endl;
+  benchmark("ConvertColaAscii + ColaAsciiToColaBinary", typed_request_bytes, iterations, [&]()
+  {
+    size_t checksum = 0;
+    for(size_t n = 0; n < typed_requests.size(); n++)
+      checksum += sick_lidar_localization::ColaAsciiBinaryConverter::ColaAsciiToColaBinary(sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii("<STX>" + typed_requests[n] + "<ETX>")).size();
+    return checksum;
+  });
+  benchmark("ColaSchema::encodeColaBinary", typed_request_bytes, iterations, [&]()
+  {
+    size_t checksum = 0;
+    std::vector<uint8_t> typed_binary;
+    for(size_t n = 0; n < typed_requests.size(); n++)
+    {
+      sick_lidar_localization::ColaSchema::encodeColaBinary(typed_requests[n], typed_binary);
+      checksum += typed_binary.size();
+    }
+    return checksum;
+  });
+  std::cout << "Cola-Binary response to Cola-ASCII (" << typed_binary_responses.size() << " responses, " << typed_response_bytes << " byte, " << iterations << " iterations):" << std::endl;
+  benchmark("ColaBinaryToColaAscii + ConvertColaAscii", typed_response_bytes, iterations, [&]()
+  {
+    size_t checksum = 0;
+    for(size_t n = 0; n < typed_binary_responses.size(); n++)
+      checksum += sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(sick_lidar_localization::ColaAsciiBinaryConverter::ColaBinaryToColaAscii(typed_binary_responses[n])).size();
+    return checksum;
+  });
+  benchmark("ColaSchema::decodeColaBinary", typed_response_bytes, iterations, [&]()
+  {
+    size_t checksum = 0;
+    std::string typed_ascii;
+    for(size_t n = 0; n < typed_binary_responses.size(); n++)
+    {
+      sick_lidar_localization::ColaSchema::decodeColaBinary(typed_binary_responses[n], typed_ascii);
+      checksum += typed_ascii.size();
+    }
+    return checksum;
+  });
+  return (error_cnt > 0) ? 1 : 0;
+}
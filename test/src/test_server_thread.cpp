@@ -58,6 +58,7 @@
 #include <ros/ros.h>
 
 #include "sick_lidar_localization/cola_parser.h"
+#include "sick_lidar_localization/cola_schema.h"
 #include "sick_lidar_localization/cola_transmitter.h"
 #include "sick_lidar_localization/random_generator.h"
 #include "sick_lidar_localization/test_server_thread.h"
@@ -403,7 +404,7 @@ void sick_lidar_localization::TestServerThread::runWorkerThreadResultCb(boost::a
 
 /*!
  * Worker thread callback, receives command requests from a tcp client
- * and sends a synthetical command response.
+ * and sends a synthetical command response. Event telegrams are sent after changes of subscribed variables.
  * There's one request worker thread for each tcp client.
  * @param[in] p_socket socket to receive command requests from the tcp client
  */
@@ -413,12 +414,18 @@ void sick_lidar_localization::TestServerThread::runWorkerThreadColaCb(boost::asi
   sick_lidar_localization::UniformRandomInteger random_generator(0,255);
   sick_lidar_localization::UniformRandomInteger random_length(1, 128);
   sick_lidar_localization::UniformRandomAsciiString random_ascii;
+  sick_lidar_localization::ColaFramer framer; // splits the data received from the tcp client into cola requests
+  std::map<std::string, int32_t> event_subscriptions; // variables subscribed by "sEN <variable_name> 1" and their value last sent
+  bool cola_binary_events = false; // event telegrams are encoded like the event registration (Cola-ASCII or Cola-Binary)
   while(ros::ok() && m_worker_thread_running && p_socket && p_socket->is_open())
   {
+    // Send event telegrams, if subscribed variables changed
+    if(!event_subscriptions.empty() && m_error_simulation_flag.get() == NO_ERROR)
+      sendColaEvents(p_socket, event_subscriptions, cola_binary_events);
     // Read command request from tcp client
     ServerColaRequest request;
     ros::Time receive_timestamp;
-    if(sick_lidar_localization::ColaTransmitter::receive(*p_socket, request.telegram_data, 1, receive_timestamp))
+    if(sick_lidar_localization::ColaTransmitter::receive(*p_socket, framer, request.telegram_data, 0.1, receive_timestamp)) // short timeout to send events with low latency
     {
       if (m_error_simulation_flag.get() == DONT_SEND) // error simulation: testserver does not send any telegrams
       {
@@ -435,11 +442,19 @@ void sick_lidar_localization::TestServerThread::runWorkerThreadColaCb(boost::asi
       }
       // command requests received, generate and send a synthetical response
       bool cola_binary = sick_lidar_localization::ColaAsciiBinaryConverter::IsColaBinary(request.telegram_data);
-      if(cola_binary)
-        request.telegram_data = sick_lidar_localization::ColaAsciiBinaryConverter::ColaBinaryToColaAscii(request.telegram_data);
-      std::string ascii_telegram = sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(request.telegram_data);
-      ROS_INFO_STREAM("TestServerThread: received cola request " << ascii_telegram);
-      sick_lidar_localization::SickLocColaTelegramMsg telegram_msg = sick_lidar_localization::ColaParser::decodeColaTelegram(ascii_telegram);
+      sick_lidar_localization::SickLocColaTelegramMsg telegram_msg;
+      if(cola_binary && sick_lidar_localization::ColaSchema::decodeColaBinary(request.telegram_data, telegram_msg)) // typed Cola-Binary request
+      {
+        ROS_INFO_STREAM("TestServerThread: received cola request " << sick_lidar_localization::Utils::flattenToString(telegram_msg) << " (typed Cola-Binary)");
+      }
+      else
+      {
+        if(cola_binary)
+          request.telegram_data = sick_lidar_localization::ColaAsciiBinaryConverter::ColaBinaryToColaAscii(request.telegram_data);
+        std::string ascii_telegram = sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(request.telegram_data);
+        ROS_INFO_STREAM("TestServerThread: received cola request " << ascii_telegram);
+        telegram_msg = sick_lidar_localization::ColaParser::decodeColaTelegram(ascii_telegram);
+      }
       // Generate a synthetical response depending on the request
       sick_lidar_localization::SickLocColaTelegramMsg telegram_answer = sick_lidar_localization::TestcaseGenerator::createColaResponse(telegram_msg);
       if (m_error_simulation_flag.get() == SEND_INVALID_TELEGRAMS) // error simulation: testserver sends invalid telegrams (invalid data, false checksums, etc.)
@@ -451,16 +466,25 @@ void sick_lidar_localization::TestServerThread::runWorkerThreadColaCb(boost::asi
         ROS_DEBUG_STREAM("TestServerThread for result telegrams: send random cola response " << sick_lidar_localization::Utils::flattenToString(telegram_answer));
       }
       // Send command response to tcp client
-      std::vector<uint8_t> binary_response = sick_lidar_localization::ColaParser::encodeColaTelegram(telegram_answer);
-      std::string ascii_response = sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(binary_response);
-      if(cola_binary)
-        binary_response = sick_lidar_localization::ColaAsciiBinaryConverter::ColaAsciiToColaBinary(binary_response);
-      ROS_INFO_STREAM("TestServerThread: sending cola response " << ascii_response << (cola_binary ? " (Cola-Binary)" : " (Cola-ASCII)"));
+      std::vector<uint8_t> binary_response = encodeColaTelegram(telegram_answer, cola_binary);
+      ROS_INFO_STREAM("TestServerThread: sending cola response " << sick_lidar_localization::ColaAsciiBinaryConverter::ConvertColaAscii(sick_lidar_localization::ColaParser::encodeColaTelegram(telegram_answer))
+        << (cola_binary ? " (Cola-Binary)" : " (Cola-ASCII)"));
       ros::Time send_timestamp;
       if (!sick_lidar_localization::ColaTransmitter::send(*p_socket, binary_response, send_timestamp))
       {
         ROS_WARN_STREAM("TestServerThread: failed to send cola response, ColaTransmitter::send() returned false, data hexdump: " << sick_lidar_localization::Utils::toHexString(binary_response));
       }
+      // Register resp. unregister events, the current value is sent with the next change
+      int32_t event_value = 0;
+      sick_lidar_localization::SickLocColaTelegramMsg cola_event;
+      if(telegram_answer.command_type == sick_lidar_localization::ColaParser::sEA && telegram_answer.parameter.size() == 1)
+      {
+        if(telegram_answer.parameter[0] == "1" && sick_lidar_localization::TestcaseGenerator::createColaEvent(telegram_answer.command_name, event_value, cola_event))
+          event_subscriptions[telegram_answer.command_name] = event_value;
+        else
+          event_subscriptions.erase(telegram_answer.command_name);
+        cola_binary_events = cola_binary;
+      }
     }
     ros::Duration(0.0001).sleep();
   }
@@ -468,6 +492,47 @@ void sick_lidar_localization::TestServerThread::runWorkerThreadColaCb(boost::asi
   ROS_INFO_STREAM("TestServerThread: worker thread for command requests finished");
 }
 
+/*!
+ * Encodes a cola telegram to send to a tcp client. Cola-Binary telegrams listed in the ColaSchema are encoded typed.
+ * @param[in] cola_telegram cola telegram (response or event)
+ * @param[in] cola_binary true: encode Cola-Binary, false: encode Cola-ASCII
+ * @return encoded telegram
+ */
+std::vector<uint8_t> sick_lidar_localization::TestServerThread::encodeColaTelegram(const sick_lidar_localization::SickLocColaTelegramMsg & cola_telegram, bool cola_binary)
+{
+  std::vector<uint8_t> binary_telegram = sick_lidar_localization::ColaParser::encodeColaTelegram(cola_telegram);
+  if(cola_binary && !sick_lidar_localization::ColaSchema::encodeColaBinary(cola_telegram, binary_telegram)) // typed Cola-Binary telegram, if listed in the schema
+    binary_telegram = sick_lidar_localization::ColaAsciiBinaryConverter::ColaAsciiToColaBinary(binary_telegram);
+  return binary_telegram;
+}
+
+/*!
+ * Sends event telegrams "sSN <variable_name> <value>" to a tcp client for all subscribed variables, whose value changed since the last event.
+ * @param[in] p_socket socket to send event telegrams to the tcp client
+ * @param[in,out] event_subscriptions subscribed variables (registered by "sEN <variable_name> 1") and their value last sent
+ * @param[in] cola_binary true: send Cola-Binary, false: send Cola-ASCII
+ */
+void sick_lidar_localization::TestServerThread::sendColaEvents(boost::asio::ip::tcp::socket* p_socket, std::map<std::string, int32_t> & event_subscriptions, bool cola_binary)
+{
+  for(std::map<std::string, int32_t>::iterator iter_subscription = event_subscriptions.begin(); iter_subscription != event_subscriptions.end(); iter_subscription++)
+  {
+    int32_t event_value = 0;
+    sick_lidar_localization::SickLocColaTelegramMsg cola_event;
+    if(!sick_lidar_localization::TestcaseGenerator::createColaEvent(iter_subscription->first, event_value, cola_event) || event_value == iter_subscription->second)
+      continue; // value unchanged
+    iter_subscription->second = event_value;
+    std::vector<uint8_t> binary_event = encodeColaTelegram(cola_event, cola_binary);
+    ROS_INFO_STREAM("TestServerThread: sending cola event " << sick_lidar_localization::Utils::flattenToString(cola_event) << (cola_binary ? " (Cola-Binary)" : " (Cola-ASCII)"));
+    ros::Time send_timestamp;
+    if (!sick_lidar_localization::ColaTransmitter::send(*p_socket, binary_event, send_timestamp))
+    {
+      ROS_WARN_STREAM("TestServerThread: failed to send cola event, ColaTransmitter::send() returned false, data hexdump: " << sick_lidar_localization::Utils::toHexString(binary_event));
+      event_subscriptions.clear(); // connection lost, events have to be registered again
+      break;
+    }
+  }
+}
+
 /*!
  * Waits for a given time in seconds, as long as ros::ok() and m_error_simulation_thread_running == true.
  * @param[in] seconds delay in seconds
@@ -0,0 +1,393 @@
+/*
+ * @brief time_sync_estimator_benchmark is a deterministic scenario harness for the time sync estimators
+ * (software_pll, kalman, theil_sen, fusion). It generates synthetic streams of LocRequestTimestamp measurements
+ * and result telegram arrivals with clock drift, drift ramps, network jitter, asymmetric and delayed packets,
+ * 32 bit tick wraparound and system clock steps, runs the estimators faster than real time and reports
+ * convergence time, error percentiles and cpu time per update.
+ *
+ * Usage: time_sync_estimator_benchmark [--estimator=<name>] [--scenario=<name>] [--duration=<seconds>] [--seed=<n>]
+ *                                      [--system-clock] [--no-rtt-filter]
+ *
+ * Copyright (C) 2019 Ing.-Buero Dr. Michael Lehning, Hildesheim
+ * Copyright (C) 2019 SICK AG, Waldkirch
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *       http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of SICK AG nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *     * Neither the name of Ing.-Buero Dr. Michael Lehning nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ *      Authors:
+ *         Michael Lehning <michael.lehning@lehning.de>
+ *
+ *  Copyright 2019 SICK AG
+ *  Copyright 2019 Ing.-Buero Dr. Michael Lehning
+ *
+ */
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <math.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sick_lidar_localization/monotonic_clock.h"
+#include "sick_lidar_localization/round_trip_filter.h"
+#include "sick_lidar_localization/tick_unwrapper.h"
+#include "sick_lidar_localization/time_sync_estimator.h"
+
+/*!
+ * Synthetic scenario of LocRequestTimestamp measurements and result telegram arrivals:
+ * - lidar ticks with clock drift and a linear drift ramp (f.e. by temperature) and optional 32 bit wraparound,
+ * - one-way network delays of requests and responses with base delay and jitter (gaussian, uniform or laplace),
+ * - responses delayed by 50 to 300 milliseconds (f.e. queued behind other cola telegrams),
+ * - a step of the system clock (f.e. by NTP or chrony).
+ * Result telegrams arrive with 10 Hz, delayed by 20 milliseconds plus an exponential queuing delay. Long scenarios
+ * (f.e. several 32 bit overflows of lidar ticks) can be fast forwarded by a larger time step.
+ */
+class Scenario
+{
+public:
+  Scenario(const std::string & _name = "", double _drift_ppm = 0, double _jitter = 0, const std::string & _jitter_distribution = "gaussian")
+  : name(_name), drift_ppm(_drift_ppm), drift_ramp(0), jitter(_jitter), jitter_distribution(_jitter_distribution), request_delay(0.001), response_delay(0.001),
+    outlier_ratio(0), start_tick(0), clock_step(0), clock_step_time(0), duration(0), time_step(0.1) {} ///< Constructor
+  std::string name;                ///< name of the scenario
+  double drift_ppm;                ///< drift of the lidar clock in ppm at start
+  double drift_ramp;               ///< change of the drift in ppm per hour
+  double jitter;                   ///< jitter of the one-way network delays in seconds (standard deviation)
+  std::string jitter_distribution; ///< distribution of the jitter: "gaussian", "uniform" or "laplace" (heavy tailed)
+  double request_delay;            ///< base delay of requests in seconds (send until lidar ticks sampled)
+  double response_delay;           ///< base delay of responses in seconds (lidar ticks sampled until response received)
+  double outlier_ratio;            ///< ratio of responses delayed by 50 to 300 milliseconds
+  uint32_t start_tick;             ///< lidar ticks at start (f.e. close to 32 bit overflow)
+  double clock_step;               ///< step of the system clock in seconds
+  double clock_step_time;          ///< time of the system clock step in seconds since start
+  double duration;                 ///< simulated time in seconds (0: duration by harness options)
+  double time_step;                ///< time step of the simulation in seconds, i.e. interval of result telegrams (default: 0.1)
+  
+  /*! Returns the 64 bit lidar ticks at time t (seconds since start) */
+  uint64_t ticks64(double t) const
+  {
+    double drift = 1.0e-6 * (drift_ppm * t + 0.5 * (drift_ramp / 3600.0) * t * t);
+    return start_tick + (uint64_t)(int64_t)floor(1000.0 * (t + drift));
+  }
+  
+  /*! Returns the 32 bit lidar ticks at time t (seconds since start) */
+  uint32_t ticks(double t) const { return (uint32_t)(ticks64(t) & 0xFFFFFFFF); }
+  
+  /*! Returns the system time (stepped by clock_step at clock_step_time) at time t (seconds since start) */
+  double systemTime(double t) const { return 1.5e9 + t + ((clock_step_time > 0 && t >= clock_step_time) ? clock_step : 0); }
+  
+  /*! Returns the monotonic time at time t (seconds since start) */
+  double monotonicTime(double t) const { return 1000.0 + t; }
+};
+
+/*!
+ * Generates the jitter of one-way network delays
+ */
+class JitterGenerator
+{
+public:
+  JitterGenerator(const Scenario & scenario, int seed)
+  : m_scenario(scenario), m_random_generator(seed), m_gaussian(0.0, 1.0), m_uniform(-sqrt(3.0), sqrt(3.0)), m_exponential(1.0) {} ///< Constructor
+  
+  /*! Returns a random jitter (non-negative, a network can delay packets, but not speed them up) */
+  double jitter(void)
+  {
+    double value = 0;
+    if(m_scenario.jitter_distribution == "uniform")
+      value = m_uniform(m_random_generator);
+    else if(m_scenario.jitter_distribution == "laplace")
+      value = m_exponential(m_random_generator) - m_exponential(m_random_generator); // difference of two exponentials, standard deviation sqrt(2)
+    else
+      value = m_gaussian(m_random_generator);
+    return fabs(value) * m_scenario.jitter;
+  }
+  
+  std::mt19937 & generator(void) { return m_random_generator; } ///< Returns the random generator
+  
+protected:
+  const Scenario & m_scenario;
+  std::mt19937 m_random_generator;
+  std::normal_distribution<double> m_gaussian;
+  std::uniform_real_distribution<double> m_uniform;
+  std::exponential_distribution<double> m_exponential;
+};
+
+/*!
+ * Options of the harness
+ */
+class HarnessOptions
+{
+public:
+  HarnessOptions() : duration(1800), seed(1), monotonic_clock(true), rtt_filter(true) {} ///< Constructor
+  double duration;      ///< simulated time in seconds per scenario
+  int seed;             ///< seed of the random generator
+  bool monotonic_clock; ///< true: estimators run on monotonic time (time_sync_monotonic_clock), false: estimators run on system time
+  bool rtt_filter;      ///< true: measurements are filtered by round trip time (time_sync_rtt_window, time_sync_rtt_margin)
+};
+
+/*!
+ * Benchmark result of an estimator on a scenario
+ */
+class BenchmarkResult
+{
+public:
+  BenchmarkResult() : valid_time(-1), settled_time(-1), p50_error(0), p95_error(0), p99_error(0), max_error(0), update_usec(0), invalid_cnt(0), unwrap_error_cnt(0) {} ///< Constructor
+  double valid_time;   ///< time in seconds until the estimator returns a valid model
+  double settled_time; ///< time in seconds until the error stays below 2 milliseconds
+  double p50_error;    ///< median of absolute errors in seconds after valid_time
+  double p95_error;    ///< 95% percentile of absolute errors in seconds after valid_time
+  double p99_error;    ///< 99% percentile of absolute errors in seconds after valid_time
+  double max_error;    ///< max. absolute error in seconds after valid_time
+  double update_usec;  ///< mean cpu time in microseconds per update
+  int invalid_cnt;     ///< number of result telegrams without valid system time after valid_time
+  int unwrap_error_cnt; ///< number of result telegrams with 64 bit ticks different from the true 64 bit ticks
+};
+
+/*!
+ * Runs an estimator on a scenario like sim_loc_time_sync: LocRequestTimestamp measurements with 1 Hz during the
+ * first 10 seconds, then with 0.1 Hz (default time_sync_initial_rate and time_sync_rate), filtered by round trip
+ * time, and result telegrams with 10 Hz. System timestamps are mapped to monotonic time and back. The estimated
+ * system time of each result telegram is compared to its true system time.
+ */
+static BenchmarkResult runBenchmark(const sick_lidar_localization::TimeSyncEstimatorConfig & config, const Scenario & scenario, const HarnessOptions & options)
+{
+  BenchmarkResult result;
+  sick_lidar_localization::TimeSyncEstimator* estimator = sick_lidar_localization::TimeSyncEstimator::create(config, config.estimator + "::" + scenario.name + "::" + std::to_string(options.seed));
+  if(!estimator)
+    return result;
+  JitterGenerator jitter_generator(scenario, options.seed);
+  std::exponential_distribution<double> arrival_distribution(1.0 / 0.005);
+  std::uniform_real_distribution<double> uniform_distribution(0.0, 1.0);
+  sick_lidar_localization::ClockMapping clock_mapping(options.monotonic_clock);
+  sick_lidar_localization::RoundTripFilter round_trip_filter;
+  sick_lidar_localization::TickUnwrapper tick_unwrapper;
+  double duration = ((scenario.duration > 0) ? scenario.duration : options.duration);
+  std::vector<double> errors;
+  double update_time = 0, last_error_time = 0;
+  int update_cnt = 0, request_cnt = 0;
+  double next_measurement = 1.0;
+  for(int64_t step = 1; step * scenario.time_step <= duration; step++)
+  {
+    double t = step * scenario.time_step;
+    if(tick_unwrapper.update(scenario.ticks(t), scenario.monotonicTime(t)) != scenario.ticks64(t))
+      result.unwrap_error_cnt++;
+    clock_mapping.update(scenario.systemTime(t), scenario.monotonicTime(t));
+    double arrival_delay = 0.02 + arrival_distribution(jitter_generator.generator());
+    estimator->updateArrival(clock_mapping.toMonotonic(scenario.systemTime(t + arrival_delay)), scenario.ticks(t));
+    if(t >= next_measurement - 1.0e-6)
+    {
+      double request_delay = scenario.request_delay + jitter_generator.jitter();
+      double response_delay = scenario.response_delay + jitter_generator.jitter();
+      if(uniform_distribution(jitter_generator.generator()) < scenario.outlier_ratio)
+        response_delay += 0.05 + 0.25 * uniform_distribution(jitter_generator.generator());
+      double send_time = clock_mapping.toMonotonic(scenario.systemTime(t));
+      double receive_time = clock_mapping.toMonotonic(scenario.systemTime(t + request_delay + response_delay));
+      uint32_t ticks = scenario.ticks(t + request_delay);
+      if(!options.rtt_filter || round_trip_filter.update(receive_time - send_time))
+      {
+        std::chrono::steady_clock::time_point update_start = std::chrono::steady_clock::now();
+        estimator->update(0.5 * (send_time + receive_time), ticks);
+        update_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - update_start).count();
+        update_cnt++;
+      }
+      request_cnt++;
+      next_measurement += ((request_cnt < 10) ? 1.0 : 10.0);
+    }
+    uint32_t sec = 0, nsec = 0;
+    if(clock_mapping.toSystemTime(estimator->model()).tickToTime(scenario.ticks(t), sec, nsec))
+    {
+      double error = fabs((sec - scenario.systemTime(t)) + 1.0e-9 * nsec);
+      if(result.valid_time < 0)
+        result.valid_time = t;
+      errors.push_back(error);
+      if(error >= 0.002)
+        last_error_time = t;
+    }
+    else
+    {
+      last_error_time = t;
+      if(result.valid_time >= 0)
+        result.invalid_cnt++;
+    }
+  }
+  if(!errors.empty())
+  {
+    std::sort(errors.begin(), errors.end());
+    result.p50_error = errors[(50 * errors.size()) / 100];
+    result.p95_error = errors[(95 * errors.size()) / 100];
+    result.p99_error = errors[(99 * errors.size()) / 100];
+    result.max_error = errors.back();
+    result.settled_time = ((last_error_time < duration - 1.0) ? (last_error_time + scenario.time_step) : -1);
+  }
+  result.update_usec = ((update_cnt > 0) ? (1.0e6 * update_time / update_cnt) : 0);
+  delete(estimator);
+  return result;
+}
+
+/*!
+ * Returns the predefined scenarios
+ */
+static std::vector<Scenario> createScenarios(void)
+{
+  std::vector<Scenario> scenarios;
+  scenarios.push_back(Scenario("nominal", 50, 0.001));
+  scenarios.push_back(Scenario("high_jitter", -100, 0.010));
+  scenarios.push_back(Scenario("heavy_tail", 50, 0.002, "laplace"));
+  scenarios.push_back(Scenario("uniform", 50, 0.002, "uniform"));
+  Scenario outliers("outliers", 50, 0.001);
+  outliers.outlier_ratio = 0.10;
+  scenarios.push_back(outliers);
+  Scenario asymmetric("asymmetric", 50, 0.001);
+  asymmetric.request_delay = 0.004; // constant bias of (response_delay - request_delay) / 2 = -1.5 milliseconds, not observable by round trip measurements
+  scenarios.push_back(asymmetric);
+  Scenario drift_ramp("drift_ramp", -50, 0.001);
+  drift_ramp.drift_ramp = 100; // f.e. warm up of the localization controller
+  scenarios.push_back(drift_ramp);
+  Scenario wraparound("wraparound", 20, 0.002);
+  wraparound.start_tick = 0xFFFFFFFF - 600000; // 32 bit overflow of lidar ticks after 10 minutes
+  scenarios.push_back(wraparound);
+  Scenario clock_step("clock_step", 50, 0.001);
+  clock_step.clock_step = 2.5; // system clock stepped by 2.5 seconds after 15 minutes
+  clock_step.clock_step_time = 900;
+  scenarios.push_back(clock_step);
+  Scenario multi_wrap("multi_wrap", 20, 0.001);
+  multi_wrap.start_tick = 0xFFFFFFFF - 600000; // fast forward over 3 overflows of 32 bit lidar ticks (about 150 days)
+  multi_wrap.duration = 3.1 * 4294967.296;
+  multi_wrap.time_step = 10;
+  scenarios.push_back(multi_wrap);
+  return scenarios;
+}
+
+/*!
+ * Returns true, if argument arg starts with option, and sets value to the remaining characters.
+ */
+static bool parseOption(const std::string & arg, const std::string & option, std::string & value)
+{
+  if(arg.compare(0, option.size(), option) != 0)
+    return false;
+  value = arg.substr(option.size());
+  return true;
+}
+
+int main(int argc, char** argv)
+{
+  HarnessOptions options;
+  std::vector<std::string> estimators = { "software_pll", "kalman", "theil_sen", "fusion" };
+  std::vector<Scenario> scenarios = createScenarios();
+  std::string estimator_arg, scenario_arg, value;
+  for(int arg_cnt = 1; arg_cnt < argc; arg_cnt++)
+  {
+    std::string arg(argv[arg_cnt]);
+    if(parseOption(arg, "--estimator=", value))
+      estimator_arg = value;
+    else if(parseOption(arg, "--scenario=", value))
+      scenario_arg = value;
+    else if(parseOption(arg, "--duration=", value))
+      options.duration = std::stod(value);
+    else if(parseOption(arg, "--seed=", value))
+      options.seed = std::stoi(value);
+    else if(arg == "--system-clock")
+      options.monotonic_clock = false;
+    else if(arg == "--no-rtt-filter")
+      options.rtt_filter = false;
+    else
+    {
+      std::cerr << "Usage: time_sync_estimator_benchmark [--estimator=<name>] [--scenario=<name>] [--duration=<seconds>] [--seed=<n>] [--system-clock] [--no-rtt-filter]" << std::endl;
+      std::cerr << "Scenarios:";
+      for(size_t n = 0; n < scenarios.size(); n++)
+        std::cerr << " " << scenarios[n].name;
+      std::cerr << std::endl;
+      return 1;
+    }
+  }
+  if(!estimator_arg.empty())
+    estimators = { estimator_arg };
+  if(!scenario_arg.empty())
+  {
+    std::vector<Scenario> selected;
+    for(size_t n = 0; n < scenarios.size(); n++)
+      if(scenarios[n].name == scenario_arg)
+        selected.push_back(scenarios[n]);
+    if(selected.empty())
+    {
+      std::cerr << "## ERROR time_sync_estimator_benchmark: unknown scenario \"" << scenario_arg << "\"" << std::endl;
+      return 1;
+    }
+    scenarios = selected;
+  }
+  std::cout << "time_sync_estimator_benchmark: " << options.duration << " seconds per scenario, LocRequestTimestamp with 1 Hz (10 times), then 0.1 Hz, "
+    << (options.monotonic_clock ? "monotonic clock" : "system clock") << ", " << (options.rtt_filter ? "round trip filter" : "no round trip filter")
+    << ", seed " << options.seed << std::endl;
+  std::cout << std::setw(12) << "scenario" << std::setw(14) << "estimator" << std::setw(12) << "valid [s]" << std::setw(14) << "settled [s]"
+    << std::setw(12) << "p50 [ms]" << std::setw(12) << "p95 [ms]" << std::setw(12) << "p99 [ms]" << std::setw(12) << "max [ms]" << std::setw(14) << "update [us]" << std::setw(10) << "invalid" << std::endl;
+  std::chrono::steady_clock::time_point harness_start = std::chrono::steady_clock::now();
+  double simulated_time = 0;
+  int unwrap_error_cnt = 0;
+  for(size_t scenario_cnt = 0; scenario_cnt < scenarios.size(); scenario_cnt++)
+  {
+    for(size_t estimator_cnt = 0; estimator_cnt < estimators.size(); estimator_cnt++)
+    {
+      sick_lidar_localization::TimeSyncEstimatorConfig config;
+      config.estimator = estimators[estimator_cnt];
+      if(!sick_lidar_localization::TimeSyncEstimator::create(config, "time_sync_estimator_benchmark::check"))
+      {
+        std::cerr << "## ERROR time_sync_estimator_benchmark: unknown estimator \"" << config.estimator << "\"" << std::endl;
+        return 1;
+      }
+      BenchmarkResult result = runBenchmark(config, scenarios[scenario_cnt], options);
+      simulated_time += ((scenarios[scenario_cnt].duration > 0) ? scenarios[scenario_cnt].duration : options.duration);
+      unwrap_error_cnt += result.unwrap_error_cnt;
+      std::cout << std::setw(12) << scenarios[scenario_cnt].name << std::setw(14) << config.estimator << std::fixed << std::setprecision(1)
+        << std::setw(12) << result.valid_time << std::setw(14) << result.settled_time << std::setprecision(3)
+        << std::setw(12) << (1000 * result.p50_error) << std::setw(12) << (1000 * result.p95_error) << std::setw(12) << (1000 * result.p99_error)
+        << std::setw(12) << (1000 * result.max_error) << std::setprecision(2) << std::setw(14) << result.update_usec << std::setw(10) << result.invalid_cnt << std::endl;
+    }
+  }
+  double harness_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - harness_start).count();
+  std::cout << "time_sync_estimator_benchmark: " << simulated_time << " seconds simulated in " << std::setprecision(2) << harness_time << " seconds" << std::endl;
+  if(unwrap_error_cnt > 0)
+  {
+    std::cerr << "## ERROR time_sync_estimator_benchmark: " << unwrap_error_cnt << " lidar ticks not correctly extended to 64 bit" << std::endl;
+    return 1;
+  }
+  return 0;
+}
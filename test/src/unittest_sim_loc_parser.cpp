@@ -54,10 +54,15 @@
  *
  */
 #include <ros/ros.h>
+#include <sstream>
 #include <string>
 #include <vector>
 
+#include "sick_lidar_localization/cola_broker.h"
+#include "sick_lidar_localization/cola_broker_client.h"
+#include "sick_lidar_localization/cola_framer.h"
 #include "sick_lidar_localization/cola_parser.h"
+#include "sick_lidar_localization/cola_schema.h"
 #include "sick_lidar_localization/random_generator.h"
 #include "sick_lidar_localization/testcase_generator.h"
 #include "sick_lidar_localization/utils.h"
@@ -81,6 +86,16 @@ std::vector<uint8_t> cola_ascii_reference = // "<STX>sMN SetAccessMode 3 F472474
 std::vector<uint8_t> cola_binary_reference = // Example from Technical_information_Telegram_Listing_Ranging_sensors_....pdf
   { 0x02, 0x02, 0x02, 0x02, 0x00, 0x00, 0x00, 0x17, 0x73, 0x4D, 0x4E, 0x20, 0x53, 0x65, 0x74, 0x41, 0x63, 0x63, 0x65, 0x73, 0x73, 0x4D, 0x6F, 0x64, 0x65, 0x20, 0x03, 0xF4, 0x72, 0x47, 0x44, 0xB3 };
 
+/*!
+ * Request handler for the cola broker testcases: responds with a large telegram after a short delay,
+ * so that responses are still queued in the broker when a client disconnects.
+ */
+static bool brokerTestHandler(sick_lidar_localization::SickLocColaTelegramSrv::Request & cola_request, sick_lidar_localization::SickLocColaTelegramSrv::Response & cola_response)
+{
+  ros::Duration(0.001).sleep();
+  cola_response.cola_ascii_response = "sAN " + cola_request.cola_ascii_request.substr(4) + " " + std::string(32000, 'A');
+  return true;
+}
 
 int main(int argc, char** argv)
 {
@@ -265,6 +280,183 @@ int main(int argc, char** argv)
     testcase_cnt++;
   }
 
+  // Run sim_loc_parser unittest for splitting a tcp stream into Cola-ASCII and Cola-Binary telegrams:
+  // push all testcase telegrams in chunks of random size, each telegram must be popped with the timestamp of its first byte
+  sick_lidar_localization::UniformRandomInteger random_chunk_size(1, 64);
+  for(int framer_testcase = 0; framer_testcase < 10; framer_testcase++, testcase_cnt++)
+  {
+    std::vector<std::vector<uint8_t> > telegrams_expected;
+    std::vector<uint8_t> stream;
+    std::vector<size_t> telegram_start;
+    for(std::vector<ColaBinaryTestcase>::iterator iter_testcase = cola_binary_to_cola_ascii_testcases.begin(); iter_testcase != cola_binary_to_cola_ascii_testcases.end(); iter_testcase++)
+    {
+      telegrams_expected.push_back(iter_testcase->cola_ascii);
+      telegrams_expected.push_back(iter_testcase->cola_binary);
+    }
+    for(size_t n = 0; n < telegrams_expected.size(); n++)
+    {
+      telegram_start.push_back(stream.size());
+      stream.insert(stream.end(), telegrams_expected[n].begin(), telegrams_expected[n].end());
+    }
+    sick_lidar_localization::ColaFramer framer;
+    std::vector<std::vector<uint8_t> > telegrams_received;
+    std::vector<ros::Time> timestamps_received, timestamps_expected;
+    for(size_t chunk_start = 0, chunk_cnt = 0; chunk_start < stream.size(); chunk_cnt++)
+    {
+      size_t chunk_size = std::min((size_t)random_chunk_size.generate(), stream.size() - chunk_start);
+      ros::Time chunk_timestamp(1000 + chunk_cnt, 0);
+      for(size_t n = 0; n < telegram_start.size(); n++)
+      {
+        if(telegram_start[n] >= chunk_start && telegram_start[n] < chunk_start + chunk_size)
+          timestamps_expected.push_back(chunk_timestamp);
+      }
+      framer.push(stream.data() + chunk_start, chunk_size, chunk_timestamp);
+      std::vector<uint8_t> telegram;
+      ros::Time receive_timestamp;
+      while(framer.pop(telegram, receive_timestamp))
+      {
+        telegrams_received.push_back(telegram);
+        timestamps_received.push_back(receive_timestamp);
+      }
+      chunk_start += chunk_size;
+    }
+    if(telegrams_received != telegrams_expected || timestamps_received != timestamps_expected || framer.size() != 0)
+    {
+      failed_testcase_cnt++;
+      ROS_ERROR_STREAM("## ERROR unittest_sim_loc_parser: sick_lidar_localization::ColaFramer failed, " << telegrams_received.size() << " of " << telegrams_expected.size()
+        << " telegrams received, " << framer.size() << " byte remaining in framer.");
+    }
+    else
+    {
+      ROS_INFO_STREAM("unittest_sim_loc_parser: " << (testcase_cnt + 1) << ". testcase passed (ColaFramer, " << telegrams_received.size() << " telegrams received)");
+    }
+  }
+
+  // Run sim_loc_parser unittest for typed Cola-Binary encoding and decoding by ColaSchema:
+  // typed encoding must be identical to the telegram listing examples, native values and Cola-ASCII must round trip
+  std::vector<std::vector<uint8_t> > cola_schema_expected = { cola_ascii_to_cola_binary_testcases[0].cola_binary, cola_ascii_to_cola_binary_testcases[1].cola_binary };
+  std::vector<std::string> cola_schema_ascii = { "sAN SetAccessMode 1", "sMN SetAccessMode 3 F4724744", "sMN LocSetPose +10300 -5200 +30000 +1000", "sMN LocSetResultPort +2201", "sRA LocState 2",
+    "sEN LocState +1", "sEA LocState 1", "sSN LocState 2", "sSN LocResultState 0", // event registration and event telegrams
+    "sRA LocResultPort 899", "sRA LocResultPoseInterval 14" }; // result output settings read by ColaConfiguration
+  for(size_t n = 0; n < 10; n++)
+  {
+    std::stringstream timestamp_response;
+    timestamp_response << "sAN LocRequestTimestamp " << std::hex << std::uppercase << random32_generator.generate(); // hex timestamp response
+    cola_schema_ascii.push_back(timestamp_response.str());
+  }
+  for(size_t n = 0; n < cola_schema_ascii.size(); n++, testcase_cnt++)
+  {
+    std::vector<uint8_t> cola_binary;
+    std::string cola_ascii;
+    bool success = sick_lidar_localization::ColaSchema::encodeColaBinary(cola_schema_ascii[n], cola_binary)
+      && (n >= cola_schema_expected.size() || cola_binary == cola_schema_expected[n])
+      && sick_lidar_localization::ColaSchema::decodeColaBinary(cola_binary, cola_ascii)
+      && (cola_ascii == cola_schema_ascii[n] || n == 1); // "SetAccessMode 3" decoded as "+3" (int8 request parameter)
+    if(!success)
+    {
+      failed_testcase_cnt++;
+      ROS_ERROR_STREAM("## ERROR unittest_sim_loc_parser: sick_lidar_localization::ColaSchema failed, \"" << cola_schema_ascii[n] << "\" encoded to " << sick_lidar_localization::Utils::toHexString(cola_binary) << ", decoded to \"" << cola_ascii << "\"");
+    }
+    else
+    {
+      ROS_INFO_STREAM("unittest_sim_loc_parser: " << (testcase_cnt + 1) << ". testcase passed (ColaSchema, \"" << cola_schema_ascii[n] << "\")");
+    }
+  }
+  std::vector<int64_t> pose_values = { 10300, -5200, 30000, 1000 }, pose_decoded;
+  std::vector<uint8_t> pose_binary;
+  sick_lidar_localization::ColaParser::COLA_SOPAS_COMMAND pose_command_type = sick_lidar_localization::ColaParser::sINVALID;
+  std::string pose_command_name;
+  if(!sick_lidar_localization::ColaSchema::encodeColaBinary(sick_lidar_localization::ColaParser::sMN, "LocSetPose", pose_values, pose_binary)
+    || !sick_lidar_localization::ColaSchema::decodeColaBinary(pose_binary, pose_command_type, pose_command_name, pose_decoded)
+    || pose_command_type != sick_lidar_localization::ColaParser::sMN || pose_command_name != "LocSetPose" || pose_decoded != pose_values
+    || sick_lidar_localization::ColaSchema::encodeColaBinary(sick_lidar_localization::ColaParser::sMN, "LocSetPose", { 10300, -5200, 30000, 100000 }, pose_binary)) // uncertainty out of range (uint16)
+  {
+    failed_testcase_cnt++;
+    ROS_ERROR_STREAM("## ERROR unittest_sim_loc_parser: sick_lidar_localization::ColaSchema failed to encode and decode native values of LocSetPose");
+  }
+  else
+  {
+    ROS_INFO_STREAM("unittest_sim_loc_parser: " << (testcase_cnt + 1) << ". testcase passed (ColaSchema, native values of LocSetPose)");
+  }
+  testcase_cnt++;
+
+  // Run sim_loc_parser unittest for the framing of the cola broker: requests and responses must round trip, truncated frames are invalid
+  sick_lidar_localization::SickLocColaTelegramSrv broker_telegram, broker_decoded;
+  broker_telegram.request.cola_ascii_request = "sMN LocRequestTimestamp";
+  broker_telegram.request.wait_response_timeout = 1.5;
+  broker_telegram.response.cola_ascii_response = "sAN LocRequestTimestamp 1D3C5E7A";
+  broker_telegram.response.send_timestamp_sec = 1500000000;
+  broker_telegram.response.send_timestamp_nsec = 123456789;
+  broker_telegram.response.receive_timestamp_sec = 1500000001;
+  broker_telegram.response.receive_timestamp_nsec = 987654321;
+  std::vector<uint8_t> broker_request = sick_lidar_localization::ColaBroker::encodeRequest(4711, sick_lidar_localization::ColaBroker::TIMESTAMP_REQUEST_CHANNEL, broker_telegram.request);
+  std::vector<uint8_t> broker_response = sick_lidar_localization::ColaBroker::encodeResponse(4712, true, broker_telegram.response);
+  uint32_t broker_request_id = 0, broker_response_id = 0;
+  sick_lidar_localization::ColaBroker::COLA_CHANNEL broker_channel = sick_lidar_localization::ColaBroker::COLA_REQUEST_CHANNEL;
+  bool broker_success = false;
+  if(!sick_lidar_localization::ColaBroker::decodeRequest(std::vector<uint8_t>(broker_request.begin() + 4, broker_request.end()), broker_request_id, broker_channel, broker_decoded.request)
+    || !sick_lidar_localization::ColaBroker::decodeResponse(std::vector<uint8_t>(broker_response.begin() + 4, broker_response.end()), broker_response_id, broker_success, broker_decoded.response)
+    || broker_request_id != 4711 || broker_channel != sick_lidar_localization::ColaBroker::TIMESTAMP_REQUEST_CHANNEL || broker_response_id != 4712 || !broker_success
+    || !sick_lidar_localization::Utils::identicalByStream(broker_decoded.request, broker_telegram.request)
+    || !sick_lidar_localization::Utils::identicalByStream(broker_decoded.response, broker_telegram.response)
+    || sick_lidar_localization::ColaBroker::decodeResponse(std::vector<uint8_t>(broker_response.begin() + 4, broker_response.begin() + 20), broker_response_id, broker_success, broker_decoded.response))
+  {
+    failed_testcase_cnt++;
+    ROS_ERROR_STREAM("## ERROR unittest_sim_loc_parser: sick_lidar_localization::ColaBroker failed to encode and decode request " << sick_lidar_localization::Utils::toHexString(broker_request)
+      << " and response " << sick_lidar_localization::Utils::toHexString(broker_response));
+  }
+  else
+  {
+    ROS_INFO_STREAM("unittest_sim_loc_parser: " << (testcase_cnt + 1) << ". testcase passed (ColaBroker framing)");
+  }
+  testcase_cnt++;
+
+  // Run sim_loc_parser unittest for client disconnects of the cola broker: clients disconnecting while their responses are still queued must not affect other clients
+  std::string broker_socket_path = "/tmp/unittest_sim_loc_parser_cola_broker.sock";
+  sick_lidar_localization::ColaBroker cola_broker(brokerTestHandler, brokerTestHandler);
+  bool broker_disconnect_success = cola_broker.start(broker_socket_path);
+  for(int client_cnt = 0; broker_disconnect_success && client_cnt < 8; client_cnt++)
+  {
+    try
+    {
+      boost::asio::io_service client_io_service;
+      boost::asio::local::stream_protocol::socket client_socket(client_io_service);
+      client_socket.connect(boost::asio::local::stream_protocol::endpoint(broker_socket_path));
+      std::vector<uint8_t> client_requests;
+      for(uint32_t request_cnt = 0; request_cnt < 32; request_cnt++)
+      {
+        std::vector<uint8_t> client_request = sick_lidar_localization::ColaBroker::encodeRequest(request_cnt, sick_lidar_localization::ColaBroker::COLA_REQUEST_CHANNEL, broker_telegram.request);
+        client_requests.insert(client_requests.end(), client_request.begin(), client_request.end());
+      }
+      boost::asio::write(client_socket, boost::asio::buffer(client_requests));
+      ros::Duration(0.001 * client_cnt).sleep(); // disconnect at different stages of request processing
+      client_socket.close(); // disconnect without reading the responses
+    }
+    catch(const std::exception & exc)
+    {
+      ROS_WARN_STREAM("## ERROR unittest_sim_loc_parser: cola broker client exception \"" << exc.what() << "\"");
+      broker_disconnect_success = false;
+    }
+  }
+  ros::Duration(0.5).sleep(); // let the broker process the requests of the disconnected clients
+  sick_lidar_localization::ColaBrokerClient broker_client(broker_socket_path);
+  sick_lidar_localization::SickLocColaTelegramSrv broker_client_telegram;
+  broker_client_telegram.request.cola_ascii_request = "sRN LocState";
+  broker_client_telegram.request.wait_response_timeout = 1;
+  bool broker_request_sent = false;
+  if(!broker_disconnect_success || !broker_client.call(broker_client_telegram.request, broker_client_telegram.response, broker_request_sent)
+    || broker_client_telegram.response.cola_ascii_response.compare(0, 16, "sAN LocState AAA") != 0)
+  {
+    failed_testcase_cnt++;
+    ROS_ERROR_STREAM("## ERROR unittest_sim_loc_parser: sick_lidar_localization::ColaBroker failed to serve requests after client disconnects with queued responses");
+  }
+  else
+  {
+    ROS_INFO_STREAM("unittest_sim_loc_parser: " << (testcase_cnt + 1) << ". testcase passed (ColaBroker client disconnect with queued responses)");
+  }
+  testcase_cnt++;
+  cola_broker.stop();
+
   ROS_INFO_STREAM("unittest_sim_loc_parser finished, " << (testcase_cnt - failed_testcase_cnt) << " of " << testcase_cnt << " testcases passed, " << failed_testcase_cnt << " testcases failed.");
   return 0;
 }